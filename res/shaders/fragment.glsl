@@ -1,6 +1,26 @@
 #version 410 core
 
+// Permutation defines (see ShaderDefines); leaving them all out gives the full multiple-lights shader:
+//   DIR_LIGHT, NR_POINT_LIGHTS, SPOT_LIGHT, CLUSTERED_LIGHTS   the light set, see include/lighting.glsl
+//   SPECULAR_MAP     0/1   sample material.specular, or use the constant specularColor
+//   ALPHA_TEST       0/1   discard fragments whose diffuse alpha is below alphaCutoff
+//   GBUFFER          0/1   write the surface to the G-buffer for a deferred lighting pass instead of lighting it
+#ifndef SPECULAR_MAP
+#define SPECULAR_MAP 1
+#endif
+#ifndef ALPHA_TEST
+#define ALPHA_TEST 0
+#endif
+#ifndef GBUFFER
+#define GBUFFER 0
+#endif
+
+#if GBUFFER
+layout (location = 0) out vec4 gAlbedoSpecular;
+layout (location = 1) out vec4 gNormalShininess;
+#else
 out vec4 FragColor;
+#endif
 
 in vec3 FragPos;
 in vec3 Normal;
@@ -8,120 +28,51 @@ in vec2 TexCoords;
 
 struct Material {
     sampler2D diffuse;
+#if SPECULAR_MAP
     sampler2D specular;
+#endif
     float shininess;
 };
 
-struct DirLight {
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct PointLight {
-    vec3 position;
-
-    float constant;
-    float linear;
-    float quadratic;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    float innerCutOff;
-    float outerCutOff;
-
-    float constant;
-    float linear;
-    float quadratic;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-#define NR_POINT_LIGHTS 4
-
 uniform Material material;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-uniform SpotLight spotLight;
-uniform vec3 viewPos;
-
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir) {
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
-
-    vec3 lightDir = -light.direction;
-
-    float diff = max(dot(normal, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
-
-    vec3 refrlectDir = reflect(-lightDir, normal);
-
-    float spec = pow(max(dot(viewDir, refrlectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * (spec * texture(material.specular, TexCoords).rgb);
-
-    return ambient + diffuse + specular;
-}
-
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
-
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * distance * distance);
-
-    vec3 lightDir = normalize(light.position - FragPos);
-
-    float diff = max(dot(normal, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
-
-    vec3 refrlectDir = reflect(-lightDir, normal);
-
-    float spec = pow(max(dot(viewDir, refrlectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * (spec * texture(material.specular, TexCoords).rgb);
-
-    return (ambient + diffuse + specular) * attenuation;
-}
-
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
-    vec3 lightDir = normalize(light.position - fragPos);
-
-    float theta = dot(lightDir, normalize(-light.direction));
-    float epsilon = light.innerCutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
-
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
-
-    float diff = max(dot(normal, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
-
-    vec3 refrlectDir = reflect(-lightDir, normal);
-
-    float spec = pow(max(dot(viewDir, refrlectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * (spec * texture(material.specular, TexCoords).rgb);
-
-    return ambient + (diffuse + specular) * intensity;
-}
+#if !SPECULAR_MAP
+uniform vec3 specularColor = vec3(0.5);
+#endif
+#if ALPHA_TEST
+uniform float alphaCutoff = 0.5;
+#endif
+
+#if GBUFFER
+#include "include/gbuffer.glsl"
+#else
+#include "include/lighting.glsl"
+#endif
 
 void main() {
-    vec3 norm = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec4 albedo = texture(material.diffuse, TexCoords);
+#if ALPHA_TEST
+    if (albedo.a < alphaCutoff) {
+        discard;
+    }
+#endif
 
-    vec3 result = CalcDirLight(dirLight, norm, viewDir);
+#if SPECULAR_MAP
+    vec3 specular = texture(material.specular, TexCoords).rgb;
+#else
+    vec3 specular = specularColor;
+#endif
 
-    for (int i = 0; i < NR_POINT_LIGHTS; i++) {
-        result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);
-    }
+    vec3 norm = normalize(Normal);
 
-    result += CalcSpotLight(spotLight, norm, FragPos, viewDir);
+#if GBUFFER
+    writeGBuffer(albedo.rgb, specular, material.shininess, norm, gAlbedoSpecular, gNormalShininess);
+#else
+    Surface surface;
+    surface.diffuse = albedo.rgb;
+    surface.specular = specular;
+    surface.shininess = material.shininess;
 
-    FragColor = vec4(result, 1.0);
+    vec3 viewDir = normalize(viewPos - FragPos);
+    FragColor = vec4(shadeSurface(surface, norm, FragPos, viewDir), 1.0);
+#endif
 }
-
@@ -1,11 +1,36 @@
 #version 410 core
 
+// Permutation defines (see ShaderDefines):
+//   WEIGHTED_BLENDED  0/1   write to the weighted blended OIT targets (include/oit.glsl) instead of blending directly
+#ifndef WEIGHTED_BLENDED
+#define WEIGHTED_BLENDED 0
+#endif
+
+#if WEIGHTED_BLENDED
+layout (location = 0) out vec4 accum;
+layout (location = 1) out float weight;
+#else
 out vec4 FragColor;
+#endif
 
 in vec2 TexCoords;
 
 uniform sampler2D texture1;
+// Fully transparent texels (the space around a blade of grass) are dropped instead of blended
+uniform float alphaCutoff = 0.05;
+
+#if WEIGHTED_BLENDED
+#include "include/oit.glsl"
+#endif
 
 void main() {
-    FragColor = texture(texture1, TexCoords);
+    vec4 color = texture(texture1, TexCoords);
+    if (color.a < alphaCutoff) {
+        discard;
+    }
+#if WEIGHTED_BLENDED
+    writeWeightedBlended(color, gl_FragCoord.z, accum, weight);
+#else
+    FragColor = color;
+#endif
 }
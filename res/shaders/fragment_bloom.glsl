@@ -0,0 +1,31 @@
+#version 410 core
+
+// The two ends of bloom (see add_standard_passes in src/post_process.cpp), with a blur run in between:
+//   BLOOM_COMPOSITE  0  bright pass: keeps what's brighter than bloomThreshold, with a soft knee
+//                    1  adds the blurred bright pass back onto the scene
+#ifndef BLOOM_COMPOSITE
+#define BLOOM_COMPOSITE 0
+#endif
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D sourceTexture;
+#if BLOOM_COMPOSITE
+uniform sampler2D sceneTexture;
+uniform float bloomStrength = 0.8;
+#else
+uniform float bloomThreshold = 0.6;
+#endif
+
+void main() {
+    vec3 color = texture(sourceTexture, TexCoords).rgb;
+#if BLOOM_COMPOSITE
+    FragColor = vec4(texture(sceneTexture, TexCoords).rgb + color * bloomStrength, 1.0);
+#else
+    // Scaling the whole colour by how far its brightest channel gets past the threshold keeps the hue
+    float brightness = max(color.r, max(color.g, color.b));
+    FragColor = vec4(color * (max(brightness - bloomThreshold, 0.0) / max(brightness, 1e-4)), 1.0);
+#endif
+}
@@ -0,0 +1,39 @@
+#version 410 core
+
+// One axis of a separable Gaussian blur, linear-sampled (see LinearTaps in src/post_process.hpp): tap 0 is the centre
+// texel, every other tap is taken on both sides of it and lands between two texels, so the bilinear filter does half
+// of the weighting. The source must filter linearly.
+//   BLUR_AXIS  0/1  blur along x or y
+//   BLUR_TAPS       number of taps, centre included
+#ifndef BLUR_AXIS
+#define BLUR_AXIS 0
+#endif
+#ifndef BLUR_TAPS
+#define BLUR_TAPS 3
+#endif
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D sourceTexture;
+uniform vec2 sourceTexel;
+// In texels
+uniform float tapOffsets[BLUR_TAPS];
+uniform float tapWeights[BLUR_TAPS];
+
+void main() {
+#if BLUR_AXIS == 0
+    vec2 axis = vec2(sourceTexel.x, 0.0);
+#else
+    vec2 axis = vec2(0.0, sourceTexel.y);
+#endif
+
+    vec3 color = texture(sourceTexture, TexCoords).rgb * tapWeights[0];
+    for (int i = 1; i < BLUR_TAPS; i++) {
+        vec2 offset = axis * tapOffsets[i];
+        color += (texture(sourceTexture, TexCoords + offset).rgb + texture(sourceTexture, TexCoords - offset).rgb) *
+                 tapWeights[i];
+    }
+    FragColor = vec4(color, 1.0);
+}
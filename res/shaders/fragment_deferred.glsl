@@ -0,0 +1,41 @@
+#version 410 core
+
+// Deferred lighting: shades every pixel the G-buffer pass covered, once, with the light set of include/lighting.glsl
+// (same permutation defines as fragment.glsl). Pixels nothing was drawn to are discarded, keeping the target's clear;
+// the others also get the G-buffer's depth, so forward draws after this pass test against the opaque scene.
+
+out vec4 FragColor;
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormalShininess;
+uniform sampler2D gDepth;
+// Clip space back to world space, for rebuilding positions from depth
+uniform mat4 inverseViewProjection;
+
+#include "include/gbuffer.glsl"
+#include "include/lighting.glsl"
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth == 1.0) {
+        discard;
+    }
+
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(gDepth, 0));
+    vec4 world = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    vec3 fragPos = world.xyz / world.w;
+    gl_FragDepth = depth;
+
+    vec4 albedoSpecular = texelFetch(gAlbedoSpecular, pixel, 0);
+    vec4 normalShininess = texelFetch(gNormalShininess, pixel, 0);
+
+    Surface surface;
+    surface.diffuse = albedoSpecular.rgb;
+    surface.specular = vec3(albedoSpecular.a);
+    surface.shininess = decodeShininess(normalShininess.z);
+
+    vec3 normal = decodeOctahedral(normalShininess.xy);
+    vec3 viewDir = normalize(viewPos - fragPos);
+    FragColor = vec4(shadeSurface(surface, normal, fragPos, viewDir), 1.0);
+}
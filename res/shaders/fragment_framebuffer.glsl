@@ -1,64 +1,52 @@
-#version 410
+#version 410 core
+
+// The framebuffer chapter's effects as post passes (see PostChain in src/post_process.hpp). EFFECT picks one:
+//   0  copy       1  invert     2  grayscale
+//   3  sharpen    4  edge detection
+// The kernels step one source texel, whatever resolution the source is at.
+#ifndef EFFECT
+#define EFFECT 0
+#endif
 
 out vec4 FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D screenTexture;
+uniform sampler2D sourceTexture;
+uniform vec2 sourceTexel;
 
-const float offset = 1.0 / 300.0;
+vec3 source(vec2 offset) {
+    return texture(sourceTexture, TexCoords + offset * sourceTexel).rgb;
+}
 
 void main() {
-    // FragColor = vec4(texture(screenTexture, TexCoords).rgb, 1.0); // normal
-    // FragColor = vec4(vec3(1.0 - texture(screenTexture, TexCoords)), 1.0); // inversion
-
-    // gray scale
-    // vec4 color = texture(screenTexture, TexCoords);
-    // float average = color.r * 0.2126 + color.g * 0.7152 + color.b * 0.0722;
-    // FragColor = vec4(average, average, average, 1.0);
-
-    vec2 offsets[9] = vec2[](
-            vec2(-offset, offset), // top-left
-            vec2(0.0f, offset), // top-center
-            vec2(offset, offset), // top-right
-
-            vec2(-offset, 0.0f), // center-left
-            vec2(0.0f, 0.0f), // center-center
-            vec2(offset, 0.0f), // center-right
-
-            vec2(-offset, -offset), // bottom-left
-            vec2(0.0f, -offset), // bottom-center
-            vec2(offset, -offset) // bottom-right
+#if EFFECT == 1
+    FragColor = vec4(1.0 - source(vec2(0.0)), 1.0);
+#elif EFFECT == 2
+    float average = dot(source(vec2(0.0)), vec3(0.2126, 0.7152, 0.0722));
+    FragColor = vec4(vec3(average), 1.0);
+#elif EFFECT == 3 || EFFECT == 4
+#if EFFECT == 3
+    float kernel[9] = float[](
+            -1, -1, -1,
+            -1, 9, -1,
+            -1, -1, -1
         );
-
-    // sharpen kernel
-    // float kernel[9] = float[](
-    //         -1, -1, -1,
-    //         -1, 9, -1,
-    //         -1, -1, -1
-    //     );
-    // blur kernel
-    // float kernel[9] = float[](
-    //         1.0 / 16.0, 1.0 / 16.0, 1.0 / 16.0,
-    //         1.0 / 16.0, 4.0 / 16.0, 1.0 / 16.0,
-    //         1.0 / 16.0, 1.0 / 16.0, 1.0 / 16.0
-    //     );
-    // edge detection
+#else
     float kernel[9] = float[](
             1, 1, 1,
             1, -8, 1,
             1, 1, 1
         );
+#endif
 
-    vec3 sampleTex[9];
-    for (int i = 0; i < 9; i++) {
-        sampleTex[i] = vec3(texture(screenTexture, TexCoords.st + offsets[i]));
-    }
-
+    // Row by row from the top left
     vec3 col = vec3(0.0);
     for (int i = 0; i < 9; i++) {
-        col += sampleTex[i] * kernel[i];
+        col += source(vec2(i % 3 - 1, 1 - i / 3)) * kernel[i];
     }
-
     FragColor = vec4(col, 1.0);
+#else
+    FragColor = vec4(source(vec2(0.0)), 1.0);
+#endif
 }
@@ -0,0 +1,24 @@
+#version 410 core
+
+// Weighted blended OIT resolve: the weighted average colour of the transparent fragments, blended over the opaque
+// scene (SRC_ALPHA, ONE_MINUS_SRC_ALPHA) by how much of it they cover. Draw with vertex_fullscreen.glsl at the
+// accumulation targets' size.
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D accumTexture;
+uniform sampler2D weightTexture;
+
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec4 accum = texelFetch(accumTexture, texel, 0);
+    float revealage = accum.a;
+    if (revealage >= 0.999) {
+        // Nothing transparent here; leave the opaque scene alone
+        discard;
+    }
+    float weight = texelFetch(weightTexture, texel, 0).r;
+    FragColor = vec4(accum.rgb / max(weight, 1e-5), 1.0 - revealage);
+}
@@ -1,51 +0,0 @@
-#version 410 core
-
-out vec4 FragColor;
-
-in vec3 FragPos;
-in vec3 Normal;
-in vec2 TexCoords;
-
-struct Material {
-    sampler2D diffuse;
-    sampler2D specular;
-    float shininess;
-};
-
-struct Light {
-    vec3 position;
-    vec3 direction;
-    float innerCutOff;
-    float outerCutOff;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-uniform Material material;
-uniform Light light;
-
-uniform vec3 viewPos;
-
-void main() {
-    vec3 lightDir = normalize(light.position - FragPos);
-    float theta = dot(lightDir, normalize(-light.direction));
-    float epsilon = light.innerCutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
-
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
-
-    vec3 norm = normalize(Normal);
-
-    float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
-
-    vec3 viewDir = normalize(viewPos - FragPos);
-    vec3 refrlectDir = reflect(-lightDir, norm);
-
-    float spec = pow(max(dot(viewDir, refrlectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * (spec * texture(material.specular, TexCoords).rgb);
-
-    vec3 result = ambient + (diffuse + specular) * intensity;
-    FragColor = vec4(result, 1.0);
-}
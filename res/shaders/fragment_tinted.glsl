@@ -0,0 +1,12 @@
+#version 410 core
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec4 Tint;
+
+uniform sampler2D texture1;
+
+void main() {
+    FragColor = texture(texture1, TexCoords) * Tint;
+}
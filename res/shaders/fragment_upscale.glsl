@@ -0,0 +1,42 @@
+#version 410 core
+
+// Catmull-Rom upscale, the last step of PostChain when the scene was drawn below the output's resolution (dynamic
+// resolution). The 4x4 texel bicubic in 9 bilinear samples instead of 16: the two middle weights of each axis are both
+// positive, so like the blur taps they fold into one linear sample between their texels. Sharper than the bilinear
+// copy, with a little overshoot on hard edges.
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D sourceTexture;
+uniform vec2 sourceTexel;
+
+void main() {
+    vec2 position = TexCoords / sourceTexel;
+    vec2 center = floor(position - 0.5) + 0.5;
+    vec2 f = position - center;
+
+    // Weights of the texels at center - 1, center, center + 1 and center + 2
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+    vec2 w12 = w1 + w2;
+
+    vec2 t0 = (center - 1.0) * sourceTexel;
+    vec2 t12 = (center + w2 / w12) * sourceTexel;
+    vec2 t3 = (center + 2.0) * sourceTexel;
+
+    vec3 color = texture(sourceTexture, vec2(t0.x, t0.y)).rgb * w0.x * w0.y;
+    color += texture(sourceTexture, vec2(t12.x, t0.y)).rgb * w12.x * w0.y;
+    color += texture(sourceTexture, vec2(t3.x, t0.y)).rgb * w3.x * w0.y;
+    color += texture(sourceTexture, vec2(t0.x, t12.y)).rgb * w0.x * w12.y;
+    color += texture(sourceTexture, vec2(t12.x, t12.y)).rgb * w12.x * w12.y;
+    color += texture(sourceTexture, vec2(t3.x, t12.y)).rgb * w3.x * w12.y;
+    color += texture(sourceTexture, vec2(t0.x, t3.y)).rgb * w0.x * w3.y;
+    color += texture(sourceTexture, vec2(t12.x, t3.y)).rgb * w12.x * w3.y;
+    color += texture(sourceTexture, vec2(t3.x, t3.y)).rgb * w3.x * w3.y;
+
+    FragColor = vec4(max(color, vec3(0.0)), 1.0);
+}
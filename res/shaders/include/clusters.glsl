@@ -0,0 +1,44 @@
+// Clustered light lists, rebuilt every frame by ClusteredLights (src/light_clusters.hpp); the block mirrors
+// ClusterUniforms in uniform_blocks.hpp. Needs the Frame block for the view matrix.
+layout (std140) uniform Clusters {
+    uvec4 clusterGrid;  // tiles x, tiles y, depth slices, light count
+    vec4 clusterParams; // pixels per tile x and y, slice scale, slice bias
+};
+
+// Bound to fixed units by bind_uniform_blocks
+uniform samplerBuffer clusterLights;   // 3 texels per light
+uniform usamplerBuffer clusterRanges;  // per cluster: first index, count
+uniform usamplerBuffer clusterIndices; // light indices
+
+struct ClusterLight {
+    vec3 position;
+    float radius;
+    vec3 color;
+    float cosInner;
+    vec3 direction;
+    float cosOuter;
+};
+
+ClusterLight fetchClusterLight(int index) {
+    vec4 a = texelFetch(clusterLights, 3 * index);
+    vec4 b = texelFetch(clusterLights, 3 * index + 1);
+    vec4 c = texelFetch(clusterLights, 3 * index + 2);
+    return ClusterLight(a.xyz, a.w, b.xyz, b.w, c.xyz, c.w);
+}
+
+// The cluster a fragment at world position fragPos falls in: its screen tile, and the slice of its view depth
+int clusterIndex(vec3 fragPos) {
+    float depth = max(-(view * vec4(fragPos, 1.0)).z, 1e-4);
+    int slice = int(clamp(floor(log(depth) * clusterParams.z + clusterParams.w), 0.0, float(clusterGrid.z - 1u)));
+    ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterParams.xy), ivec2(clusterGrid.xy) - 1);
+    return (slice * int(clusterGrid.y) + tile.y) * int(clusterGrid.x) + tile.x;
+}
+
+// First index and count of the cluster's lights in clusterIndices
+uvec2 clusterRange(vec3 fragPos) {
+    return texelFetch(clusterRanges, clusterIndex(fragPos)).xy;
+}
+
+int clusterLightIndex(uint i) {
+    return int(texelFetch(clusterIndices, int(i)).x);
+}
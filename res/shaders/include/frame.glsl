@@ -0,0 +1,6 @@
+// Per-frame camera data, uploaded once per frame by SceneRenderer; mirrors FrameUniforms in uniform_blocks.hpp
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
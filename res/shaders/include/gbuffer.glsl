@@ -0,0 +1,40 @@
+// G-buffer packing shared by the GBUFFER permutation of fragment.glsl and fragment_deferred.glsl; the attachment
+// formats are the GBUFFER_*_FORMAT constants in src/deferred.hpp.
+//   0  RGBA8     albedo rgb, specular intensity
+//   1  RGB10_A2  octahedral normal xy, shininess (log2 / 10, so 1..1024), unused
+// Position isn't stored: the lighting pass rebuilds it from the depth attachment.
+
+vec2 signNotZero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Unit vector to [0, 1]^2: project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the upper
+vec2 encodeOctahedral(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 folded = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    return folded * 0.5 + 0.5;
+}
+
+vec3 decodeOctahedral(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    }
+    return normalize(n);
+}
+
+float encodeShininess(float shininess) {
+    return clamp(log2(max(shininess, 1.0)) / 10.0, 0.0, 1.0);
+}
+
+float decodeShininess(float encoded) {
+    return exp2(encoded * 10.0);
+}
+
+// The specular colour is kept as its mean, which is all the grey specular maps in res/textures carry anyway
+void writeGBuffer(vec3 albedo, vec3 specular, float shininess, vec3 normal, out vec4 albedoSpecular,
+                  out vec4 normalShininess) {
+    albedoSpecular = vec4(albedo, dot(specular, vec3(1.0 / 3.0)));
+    normalShininess = vec4(encodeOctahedral(normal), encodeShininess(shininess), 0.0);
+}
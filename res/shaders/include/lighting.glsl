@@ -0,0 +1,142 @@
+// The light set of fragment.glsl and fragment_deferred.glsl, chosen by permutation defines (see ShaderDefines);
+// leaving them all out gives the full multiple-lights set:
+//   DIR_LIGHT        0/1   evaluate dirLight
+//   NR_POINT_LIGHTS  0-4   evaluate pointLights[0, NR_POINT_LIGHTS)
+//   SPOT_LIGHT       0/1   evaluate spotLight
+//   CLUSTERED_LIGHTS 0-2   also evaluate the ClusteredLights lights: 1 only those of the fragment's cluster, 2 all of
+//                          them (the unculled baseline for comparison)
+#ifndef DIR_LIGHT
+#define DIR_LIGHT 1
+#endif
+#ifndef NR_POINT_LIGHTS
+#define NR_POINT_LIGHTS 4
+#endif
+#ifndef SPOT_LIGHT
+#define SPOT_LIGHT 1
+#endif
+#ifndef CLUSTERED_LIGHTS
+#define CLUSTERED_LIGHTS 0
+#endif
+
+#include "lights.glsl"
+#include "frame.glsl"
+#if CLUSTERED_LIGHTS
+#include "clusters.glsl"
+#endif
+
+#if NR_POINT_LIGHTS > MAX_POINT_LIGHTS
+#error NR_POINT_LIGHTS is larger than the Lights block
+#endif
+
+// Material inputs shared by every light
+struct Surface {
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+};
+
+vec3 CalcDirLight(DirLight light, Surface surface, vec3 normal, vec3 viewDir) {
+    vec3 ambient = light.ambient * surface.diffuse;
+
+    vec3 lightDir = -light.direction;
+
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 diffuse = light.diffuse * diff * surface.diffuse;
+
+    vec3 refrlectDir = reflect(-lightDir, normal);
+
+    float spec = pow(max(dot(viewDir, refrlectDir), 0.0), surface.shininess);
+    vec3 specular = light.specular * (spec * surface.specular);
+
+    return ambient + diffuse + specular;
+}
+
+vec3 CalcPointLight(PointLight light, Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir) {
+    vec3 ambient = light.ambient * surface.diffuse;
+
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * distance * distance);
+
+    vec3 lightDir = normalize(light.position - fragPos);
+
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 diffuse = light.diffuse * diff * surface.diffuse;
+
+    vec3 refrlectDir = reflect(-lightDir, normal);
+
+    float spec = pow(max(dot(viewDir, refrlectDir), 0.0), surface.shininess);
+    vec3 specular = light.specular * (spec * surface.specular);
+
+    return (ambient + diffuse + specular) * attenuation;
+}
+
+vec3 CalcSpotLight(SpotLight light, Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir) {
+    vec3 lightDir = normalize(light.position - fragPos);
+
+    float theta = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.innerCutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+
+    vec3 ambient = light.ambient * surface.diffuse;
+
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 diffuse = light.diffuse * diff * surface.diffuse;
+
+    vec3 refrlectDir = reflect(-lightDir, normal);
+
+    float spec = pow(max(dot(viewDir, refrlectDir), 0.0), surface.shininess);
+    vec3 specular = light.specular * (spec * surface.specular);
+
+    return ambient + (diffuse + specular) * intensity;
+}
+
+#if CLUSTERED_LIGHTS
+vec3 CalcClusterLight(int index, Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir) {
+    ClusterLight light = fetchClusterLight(index);
+
+    vec3 toLight = light.position - fragPos;
+    float distance = length(toLight);
+    vec3 lightDir = toLight / max(distance, 1e-4);
+
+    // Inverse square, windowed to reach zero at the radius the light was binned with
+    float window = clamp(1.0 - pow(distance / light.radius, 4.0), 0.0, 1.0);
+    float attenuation = window * window / (1.0 + distance * distance);
+    float cone = smoothstep(light.cosOuter, light.cosInner, dot(lightDir, -light.direction));
+
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 refrlectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, refrlectDir), 0.0), surface.shininess);
+
+    return light.color * (diff * surface.diffuse + spec * surface.specular) * (attenuation * cone);
+}
+#endif
+
+// Every light of the permutation at one surface point
+vec3 shadeSurface(Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir) {
+    vec3 result = vec3(0.0);
+#if DIR_LIGHT
+    result += CalcDirLight(dirLight, surface, normal, viewDir);
+#endif
+
+#if NR_POINT_LIGHTS > 0
+    for (int i = 0; i < NR_POINT_LIGHTS; i++) {
+        result += CalcPointLight(pointLights[i], surface, normal, fragPos, viewDir);
+    }
+#endif
+
+#if SPOT_LIGHT
+    result += CalcSpotLight(spotLight, surface, normal, fragPos, viewDir);
+#endif
+
+#if CLUSTERED_LIGHTS == 1
+    uvec2 range = clusterRange(fragPos);
+    for (uint i = range.x; i < range.x + range.y; i++) {
+        result += CalcClusterLight(clusterLightIndex(i), surface, normal, fragPos, viewDir);
+    }
+#elif CLUSTERED_LIGHTS == 2
+    for (int i = 0; i < int(clusterGrid.w); i++) {
+        result += CalcClusterLight(i, surface, normal, fragPos, viewDir);
+    }
+#endif
+    return result;
+}
@@ -0,0 +1,41 @@
+// The Lights block, uploaded once per frame by SceneRenderer; mirrors LightUniforms in uniform_blocks.hpp. Its layout
+// is fixed at MAX_POINT_LIGHTS whatever a permutation evaluates, so every program can share one buffer.
+
+// Field order follows std140 packing (a float fills the tail of the preceding vec3); see uniform_blocks.hpp
+struct DirLight {
+    vec3 direction;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+    float constant;
+    vec3 ambient;
+    float linear;
+    vec3 diffuse;
+    float quadratic;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec3 position;
+    float innerCutOff;
+    vec3 direction;
+    float outerCutOff;
+    vec3 ambient;
+    float constant;
+    vec3 diffuse;
+    float linear;
+    vec3 specular;
+    float quadratic;
+};
+
+#define MAX_POINT_LIGHTS 4
+
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    PointLight pointLights[MAX_POINT_LIGHTS];
+    SpotLight spotLight;
+};
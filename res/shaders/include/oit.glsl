@@ -0,0 +1,17 @@
+// Weighted blended OIT packing shared by the WEIGHTED_BLENDED permutation of fragment_blending.glsl and
+// fragment_oit_composite.glsl; the attachment formats are the OIT_*_FORMAT constants in src/transparency.hpp, blended
+// with glBlendFuncSeparate(ONE, ONE, ZERO, ONE_MINUS_SRC_ALPHA).
+//   0  RGBA16F  sum of premultiplied colour x weight, product of (1 - alpha) in alpha (the revealage)
+//   1  R16F     sum of alpha x weight
+
+// Closer and more opaque fragments count for more. McGuire and Bavoil's depth weight, capped low enough that a
+// couple of hundred opaque layers still fit in half floats.
+float oitWeight(float alpha, float depth) {
+    return clamp(pow(min(1.0, alpha * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - depth * 0.9, 3.0), 1e-2, 3e2);
+}
+
+void writeWeightedBlended(vec4 color, float depth, out vec4 accumOut, out float weightOut) {
+    float w = oitWeight(color.a, depth);
+    accumOut = vec4(color.rgb * color.a * w, color.a);
+    weightOut = color.a * w;
+}
@@ -9,11 +9,16 @@ out vec3 FragPos;
 out vec2 TexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// Dequantization for VERTEX_FORMAT_QUANTIZED meshes (positions arrive as unorm16 in [0, 1]); identity otherwise
+uniform vec3 positionScale = vec3(1.0);
+uniform vec3 positionOffset = vec3(0.0);
+
+#include "include/frame.glsl"
 
 void main() {
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    vec3 position = aPos * positionScale + positionOffset;
+    FragPos = vec3(model * vec4(position, 1.0));
     Normal = mat3(transpose(inverse(model))) * aNormal;
     TexCoords = aTexCoords;
     gl_Position = projection * view *  vec4(FragPos, 1.0);
@@ -5,8 +5,7 @@ layout (location = 1) in vec2 aTexCoords;
 out vec2 TexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "include/frame.glsl"
 
 void main() {
     TexCoords = aTexCoords;
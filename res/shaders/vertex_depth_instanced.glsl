@@ -0,0 +1,18 @@
+#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+// Per instance (see src/instancing.hpp); the mat4 takes locations 3..6
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in vec4 aTint;
+
+out vec2 TexCoords;
+out vec4 Tint;
+
+#include "include/frame.glsl"
+
+void main() {
+    TexCoords = aTexCoords;
+    Tint = aTint;
+    gl_Position = projection * view * aModel * vec4(aPos, 1.0f);
+}
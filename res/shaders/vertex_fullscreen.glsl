@@ -0,0 +1,12 @@
+#version 410 core
+
+// One triangle covering the viewport, generated from gl_VertexID; draw 3 vertices with any (empty) VAO bound.
+// TexCoords run 0..1 across the viewport.
+
+out vec2 TexCoords;
+
+void main() {
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    TexCoords = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
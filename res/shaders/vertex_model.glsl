@@ -7,11 +7,16 @@ layout (location = 2) in vec2 aTexCoords;
 out vec2 TexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// Dequantization for VERTEX_FORMAT_QUANTIZED meshes (positions arrive as unorm16 in [0, 1]); identity otherwise
+uniform vec3 positionScale = vec3(1.0);
+uniform vec3 positionOffset = vec3(0.0);
+
+#include "include/frame.glsl"
 
 void main() {
+    vec3 position = aPos * positionScale + positionOffset;
     TexCoords = aTexCoords;
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * model * vec4(position, 1.0);
 }
 
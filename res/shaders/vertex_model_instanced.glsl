@@ -0,0 +1,27 @@
+#version 410 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+// Per instance (see src/instancing.hpp); the mat4 takes locations 3..6
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in vec4 aTint;
+
+out vec2 TexCoords;
+out vec4 Tint;
+
+// Dequantization for VERTEX_FORMAT_QUANTIZED meshes (positions arrive as unorm16 in [0, 1]); identity otherwise
+uniform vec3 positionScale = vec3(1.0);
+uniform vec3 positionOffset = vec3(0.0);
+// The mesh's place within its model (the node transform), under the instance's model matrix
+uniform mat4 nodeTransform = mat4(1.0);
+
+#include "include/frame.glsl"
+
+void main() {
+    vec3 position = aPos * positionScale + positionOffset;
+    TexCoords = aTexCoords;
+    Tint = aTint;
+    gl_Position = projection * view * aModel * nodeTransform * vec4(position, 1.0);
+}
@@ -0,0 +1,49 @@
+#include "bounds.hpp"
+
+AABB AABB::transformed(const glm::mat4 &m) const {
+    // Arvo: each axis of the new half extent sums the absolute contributions of the old one
+    const glm::vec3 c = glm::vec3(m * glm::vec4(center(), 1.0f));
+    const glm::vec3 h = extent() * 0.5f;
+    const glm::vec3 e =
+        glm::abs(glm::vec3(m[0])) * h.x + glm::abs(glm::vec3(m[1])) * h.y + glm::abs(glm::vec3(m[2])) * h.z;
+    return {c - e, c + e};
+}
+
+Frustum Frustum::from_matrix(const glm::mat4 &m) {
+    const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum f;
+    f.planes[PLANE_LEFT] = row3 + row0;
+    f.planes[PLANE_RIGHT] = row3 - row0;
+    f.planes[PLANE_BOTTOM] = row3 + row1;
+    f.planes[PLANE_TOP] = row3 - row1;
+    f.planes[PLANE_NEAR] = row3 + row2;
+    f.planes[PLANE_FAR] = row3 - row2;
+    return f;
+}
+
+Frustum Frustum::transformed(const glm::mat4 &model) const {
+    // dot(p, M x) == dot(transpose(M) p, x)
+    Frustum f;
+    for (int i = 0; i < 6; i++) {
+        const glm::vec4 &p = planes[i];
+        f.planes[i] = glm::vec4(glm::dot(model[0], p), glm::dot(model[1], p), glm::dot(model[2], p),
+                                glm::dot(model[3], p));
+    }
+    return f;
+}
+
+bool Frustum::intersects(const AABB &box) const {
+    for (const auto &p : planes) {
+        // Corner furthest along the plane normal
+        const glm::vec3 v(p.x >= 0.0f ? box.max.x : box.min.x, p.y >= 0.0f ? box.max.y : box.min.y,
+                          p.z >= 0.0f ? box.max.z : box.min.z);
+        if (p.x * v.x + p.y * v.y + p.z * v.z + p.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef BOUNDS_HPP
+#define BOUNDS_HPP
+
+#include <glm/glm.hpp>
+
+struct AABB {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extent() const { return max - min; }
+
+    void expand(const AABB &o) {
+        min = glm::min(min, o.min);
+        max = glm::max(max, o.max);
+    }
+
+    // The box around this one after `m` maps it, e.g. from mesh space into a parent node's space
+    AABB transformed(const glm::mat4 &m) const;
+};
+
+// Six inward-facing planes (xyz normal, w distance): a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for
+// every plane. Planes are not normalized unless noted, which is all the sign tests below need.
+struct Frustum {
+    enum { PLANE_LEFT, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR };
+
+    glm::vec4 planes[6];
+
+    // Gribb/Hartmann extraction; view_projection = projection * view gives world-space planes
+    static Frustum from_matrix(const glm::mat4 &view_projection);
+
+    // The same frustum expressed in the space `model` maps from, so model-space bounds can be tested directly
+    Frustum transformed(const glm::mat4 &model) const;
+
+    bool intersects(const AABB &box) const;
+};
+
+#endif
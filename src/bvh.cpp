@@ -0,0 +1,194 @@
+#include "bvh.hpp"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define BVH_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+// Lane bits: `visible` lanes intersect the frustum, `inside` lanes are entirely within it
+struct NodeTest {
+    int visible;
+    int inside;
+};
+
+} // namespace
+
+void Bvh::build(std::span<const AABB> boxes) {
+    m_nodes.clear();
+    m_items.resize(boxes.size());
+    std::iota(m_items.begin(), m_items.end(), 0u);
+
+    if (boxes.empty()) {
+        return;
+    }
+
+    std::vector<glm::vec3> centroids(boxes.size());
+    for (size_t i = 0; i < boxes.size(); i++) {
+        centroids[i] = boxes[i].center();
+    }
+
+    m_nodes.reserve(boxes.size() / 3 + 1);
+    build_node(boxes, centroids, 0, boxes.size());
+}
+
+uint32_t Bvh::build_node(std::span<const AABB> boxes, std::vector<glm::vec3> &centroids, uint32_t begin,
+                         uint32_t end) {
+    // Median split of [begin, end) along the longest centroid axis
+    auto split = [&](uint32_t b, uint32_t e) {
+        glm::vec3 lo = centroids[m_items[b]], hi = lo;
+        for (uint32_t i = b + 1; i < e; i++) {
+            lo = glm::min(lo, centroids[m_items[i]]);
+            hi = glm::max(hi, centroids[m_items[i]]);
+        }
+        const glm::vec3 extent = hi - lo;
+        const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+        const uint32_t mid = b + (e - b) / 2;
+        std::nth_element(m_items.begin() + b, m_items.begin() + mid, m_items.begin() + e,
+                         [&](uint32_t l, uint32_t r) { return centroids[l][axis] < centroids[r][axis]; });
+        return mid;
+    };
+
+    // Partition into up to four groups
+    uint32_t bounds[WIDTH + 1];
+    int groups = 0;
+    const uint32_t n = end - begin;
+    if (n <= WIDTH) {
+        for (uint32_t i = 0; i <= n; i++) {
+            bounds[i] = begin + i;
+        }
+        groups = n;
+    } else {
+        const uint32_t mid = split(begin, end);
+        bounds[0] = begin;
+        bounds[1] = split(begin, mid);
+        bounds[2] = mid;
+        bounds[3] = split(mid, end);
+        bounds[4] = end;
+        groups = WIDTH;
+    }
+
+    const uint32_t index = m_nodes.size();
+    m_nodes.emplace_back();
+
+    for (int slot = 0; slot < WIDTH; slot++) {
+        Node &node = m_nodes[index];
+
+        if (slot >= groups) {
+            node.min_x[slot] = node.min_y[slot] = node.min_z[slot] = std::numeric_limits<float>::max();
+            node.max_x[slot] = node.max_y[slot] = node.max_z[slot] = -std::numeric_limits<float>::max();
+            node.child[slot] = -1;
+            node.first[slot] = 0;
+            node.count[slot] = 0;
+            continue;
+        }
+
+        const uint32_t b = bounds[slot], e = bounds[slot + 1];
+        AABB box = boxes[m_items[b]];
+        for (uint32_t i = b + 1; i < e; i++) {
+            box.expand(boxes[m_items[i]]);
+        }
+
+        node.min_x[slot] = box.min.x;
+        node.min_y[slot] = box.min.y;
+        node.min_z[slot] = box.min.z;
+        node.max_x[slot] = box.max.x;
+        node.max_y[slot] = box.max.y;
+        node.max_z[slot] = box.max.z;
+        node.first[slot] = b;
+        node.count[slot] = e - b;
+        node.child[slot] = -1;
+
+        if (e - b > 1) {
+            // m_nodes may reallocate, so don't hold `node` across the recursion
+            const uint32_t child = build_node(boxes, centroids, b, e);
+            m_nodes[index].child[slot] = child;
+        }
+    }
+
+    return index;
+}
+
+void Bvh::cull(const Frustum &frustum, std::vector<uint32_t> &visible) const {
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    auto test = [&frustum](const Node &node) {
+        NodeTest result;
+#ifdef BVH_USE_SSE
+        const __m128 min_x = _mm_load_ps(node.min_x), min_y = _mm_load_ps(node.min_y), min_z = _mm_load_ps(node.min_z);
+        const __m128 max_x = _mm_load_ps(node.max_x), max_y = _mm_load_ps(node.max_y), max_z = _mm_load_ps(node.max_z);
+        const __m128 zero = _mm_setzero_ps();
+        __m128 outside = zero, straddle = zero;
+
+        for (const auto &p : frustum.planes) {
+            // Corner furthest along the normal decides "outside", the nearest one decides "fully inside"
+            const __m128 far_x = p.x >= 0.0f ? max_x : min_x, near_x = p.x >= 0.0f ? min_x : max_x;
+            const __m128 far_y = p.y >= 0.0f ? max_y : min_y, near_y = p.y >= 0.0f ? min_y : max_y;
+            const __m128 far_z = p.z >= 0.0f ? max_z : min_z, near_z = p.z >= 0.0f ? min_z : max_z;
+            const __m128 nx = _mm_set1_ps(p.x), ny = _mm_set1_ps(p.y), nz = _mm_set1_ps(p.z), d = _mm_set1_ps(p.w);
+
+            const __m128 far_d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, far_x), _mm_mul_ps(ny, far_y)),
+                                            _mm_add_ps(_mm_mul_ps(nz, far_z), d));
+            const __m128 near_d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, near_x), _mm_mul_ps(ny, near_y)),
+                                             _mm_add_ps(_mm_mul_ps(nz, near_z), d));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(far_d, zero));
+            straddle = _mm_or_ps(straddle, _mm_cmplt_ps(near_d, zero));
+        }
+
+        result.visible = ~_mm_movemask_ps(outside) & 0xF;
+        result.inside = result.visible & ~_mm_movemask_ps(straddle);
+#else
+        result.visible = 0;
+        result.inside = 0;
+        for (int lane = 0; lane < WIDTH; lane++) {
+            bool out = false, straddles = false;
+            for (const auto &p : frustum.planes) {
+                const float far_d = p.x * (p.x >= 0.0f ? node.max_x[lane] : node.min_x[lane]) +
+                                    p.y * (p.y >= 0.0f ? node.max_y[lane] : node.min_y[lane]) +
+                                    p.z * (p.z >= 0.0f ? node.max_z[lane] : node.min_z[lane]) + p.w;
+                const float near_d = p.x * (p.x >= 0.0f ? node.min_x[lane] : node.max_x[lane]) +
+                                     p.y * (p.y >= 0.0f ? node.min_y[lane] : node.max_y[lane]) +
+                                     p.z * (p.z >= 0.0f ? node.min_z[lane] : node.max_z[lane]) + p.w;
+                out |= far_d < 0.0f;
+                straddles |= near_d < 0.0f;
+            }
+            if (!out) {
+                result.visible |= 1 << lane;
+                if (!straddles) {
+                    result.inside |= 1 << lane;
+                }
+            }
+        }
+#endif
+        return result;
+    };
+
+    uint32_t stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node &node = m_nodes[stack[--top]];
+        const NodeTest result = test(node);
+
+        for (int lane = 0; lane < WIDTH; lane++) {
+            if (node.count[lane] == 0 || !(result.visible & (1 << lane))) {
+                continue;
+            }
+
+            if (node.child[lane] < 0 || (result.inside & (1 << lane))) {
+                visible.insert(visible.end(), m_items.begin() + node.first[lane],
+                               m_items.begin() + node.first[lane] + node.count[lane]);
+            } else {
+                stack[top++] = node.child[lane];
+            }
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include "bounds.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct CullStats {
+    uint64_t tested = 0;
+    uint64_t visible = 0;
+    uint64_t culled = 0;
+    double ms = 0.0;
+
+    CullStats &operator+=(const CullStats &o) {
+        tested += o.tested;
+        visible += o.visible;
+        culled += o.culled;
+        ms += o.ms;
+        return *this;
+    }
+};
+
+// 4-wide bounding volume hierarchy over a set of boxes, laid out so one node's four child boxes are tested against a
+// frustum plane in a single SSE operation. Every slot is either an inner node or exactly one item, so the visible
+// set is exact (no leaf-level false positives), and a slot found entirely inside the frustum emits its whole subtree
+// without further tests.
+class Bvh {
+  public:
+    static constexpr int WIDTH = 4;
+
+    void build(std::span<const AABB> boxes);
+
+    // Appends the index (into the boxes given to build) of every box intersecting the frustum to `visible`
+    void cull(const Frustum &frustum, std::vector<uint32_t> &visible) const;
+
+    size_t node_count() const { return m_nodes.size(); }
+    size_t item_count() const { return m_items.size(); }
+
+  private:
+    struct alignas(16) Node {
+        float min_x[WIDTH], min_y[WIDTH], min_z[WIDTH];
+        float max_x[WIDTH], max_y[WIDTH], max_z[WIDTH];
+        // Inner node index, or -1 for a single item
+        int32_t child[WIDTH];
+        // Subtree item range in m_items; count == 0 marks an empty slot
+        uint32_t first[WIDTH];
+        uint32_t count[WIDTH];
+    };
+
+    std::vector<Node> m_nodes;
+    // Item indices reordered so every subtree is contiguous
+    std::vector<uint32_t> m_items;
+
+    uint32_t build_node(std::span<const AABB> boxes, std::vector<glm::vec3> &centroids, uint32_t begin, uint32_t end);
+};
+
+#endif
@@ -38,6 +38,14 @@ void Camera::rotate(float dx, float dy) {
 
 void Camera::zoom(float delta) { m_zoom = glm::clamp(m_zoom - delta, 1.0f, 45.0f); }
 
+void Camera::set_pose(glm::vec3 position, float yaw, float pitch) {
+    m_position = position;
+    m_yaw = yaw;
+    m_pitch = glm::clamp(pitch, -89.0f, 89.0f);
+
+    update_vectors();
+}
+
 void Camera::update_vectors() {
     m_front = glm::normalize(glm::vec3(static_cast<float>(cos(glm::radians(m_yaw)) * cos(glm::radians(m_pitch))),
                                        static_cast<float>(sin(glm::radians(m_pitch))),
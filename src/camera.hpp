@@ -36,6 +36,8 @@ class Camera {
     void pan(PanMovement direction, float delta_time);
     void rotate(float dx, float dy);
     void zoom(float delta);
+    // Places the camera directly, e.g. from a scripted CameraPath
+    void set_pose(glm::vec3 position, float yaw, float pitch);
 
   private:
     void update_vectors();
@@ -0,0 +1,81 @@
+#include "camera_path.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+glm::vec3 catmull_rom(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, float u) {
+    const float u2 = u * u;
+    const float u3 = u2 * u;
+    return 0.5f * (2.0f * p1 + (p2 - p0) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 +
+                   (3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+}
+
+} // namespace
+
+void CameraPath::add(float time, const CameraPose &pose) {
+    if (!m_keyframes.empty() && time < m_keyframes.back().time) {
+        throw std::runtime_error("camera path keyframes must be in time order");
+    }
+    m_keyframes.push_back({time, pose});
+}
+
+void CameraPath::add_look_at(float time, glm::vec3 position, glm::vec3 target) {
+    const glm::vec3 front = glm::normalize(target - position);
+    float yaw = glm::degrees(std::atan2(front.z, front.x));
+    const float pitch = glm::degrees(std::asin(glm::clamp(front.y, -1.0f, 1.0f)));
+
+    // Take the short way round from the previous yaw instead of jumping across +-180
+    if (!m_keyframes.empty()) {
+        const float previous = m_keyframes.back().pose.yaw;
+        yaw = previous + std::remainder(yaw - previous, 360.0f);
+    }
+
+    add(time, {position, yaw, pitch});
+}
+
+CameraPath CameraPath::orbit(glm::vec3 target, float radius, float height, float seconds, unsigned int keyframes) {
+    CameraPath path;
+    keyframes = std::max(keyframes, 3u);
+    for (unsigned int i = 0; i <= keyframes; i++) {
+        const float t = static_cast<float>(i) / keyframes;
+        const float angle = glm::radians(360.0f) * t;
+        const glm::vec3 position = target + glm::vec3(std::cos(angle) * radius, height, std::sin(angle) * radius);
+        path.add_look_at(t * seconds, position, target);
+    }
+    return path;
+}
+
+CameraPose CameraPath::sample(float time) const {
+    if (m_keyframes.empty()) {
+        return {glm::vec3(0.0f), DEFAULT_YAW, DEFAULT_PITCH};
+    }
+    if (time <= m_keyframes.front().time) {
+        return m_keyframes.front().pose;
+    }
+    if (time >= m_keyframes.back().time) {
+        return m_keyframes.back().pose;
+    }
+
+    // First keyframe after `time`; the segment is [i - 1, i]
+    const auto it = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), time,
+                                     [](float t, const Keyframe &k) { return t < k.time; });
+    const size_t i = it - m_keyframes.begin();
+    const Keyframe &a = m_keyframes[i - 1];
+    const Keyframe &b = m_keyframes[i];
+    const float span = b.time - a.time;
+    const float u = span > 0.0f ? (time - a.time) / span : 1.0f;
+
+    // End segments reuse their own endpoint as the missing neighbour
+    const glm::vec3 p0 = m_keyframes[i >= 2 ? i - 2 : i - 1].pose.position;
+    const glm::vec3 p3 = m_keyframes[std::min(i + 1, m_keyframes.size() - 1)].pose.position;
+
+    return {catmull_rom(p0, a.pose.position, b.pose.position, p3, u), glm::mix(a.pose.yaw, b.pose.yaw, u),
+            glm::mix(a.pose.pitch, b.pose.pitch, u)};
+}
+
+void CameraPath::apply(Camera &camera, float time) const {
+    const CameraPose pose = sample(time);
+    camera.set_pose(pose.position, pose.yaw, pose.pitch);
+}
@@ -0,0 +1,45 @@
+#ifndef CAMERA_PATH_HPP
+#define CAMERA_PATH_HPP
+
+#include "camera.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+struct CameraPose {
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+};
+
+// A scripted camera: keyframed poses sampled by time, so a benchmark run sees exactly the same views on every machine
+// regardless of frame rate. Positions follow a Catmull-Rom spline through the keyframes; yaw and pitch are
+// interpolated linearly.
+class CameraPath {
+  public:
+    struct Keyframe {
+        float time;
+        CameraPose pose;
+    };
+
+    // Keyframes must be added in increasing time order
+    void add(float time, const CameraPose &pose);
+    // Adds a keyframe at `position` looking at `target`, keeping yaw continuous with the previous keyframe
+    void add_look_at(float time, glm::vec3 position, glm::vec3 target);
+
+    // Circles `target` once at the given radius and height above it
+    static CameraPath orbit(glm::vec3 target, float radius, float height, float seconds, unsigned int keyframes = 16);
+
+    float duration() const { return m_keyframes.empty() ? 0.0f : m_keyframes.back().time; }
+    bool empty() const { return m_keyframes.empty(); }
+
+    // Clamped to [0, duration()]
+    CameraPose sample(float time) const;
+    void apply(Camera &camera, float time) const;
+
+  private:
+    std::vector<Keyframe> m_keyframes;
+};
+
+#endif
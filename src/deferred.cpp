@@ -0,0 +1,42 @@
+#include "deferred.hpp"
+
+namespace {
+
+// Texture units the lighting pass samples the G-buffer from
+constexpr unsigned int ALBEDO_SPECULAR_UNIT = 0;
+constexpr unsigned int NORMAL_SHININESS_UNIT = 1;
+constexpr unsigned int DEPTH_UNIT = 2;
+
+} // namespace
+
+DeferredLighting::DeferredLighting() { glGenVertexArrays(1, &m_vao); }
+
+DeferredLighting::~DeferredLighting() { glDeleteVertexArrays(1, &m_vao); }
+
+void DeferredLighting::draw(GlStateCache &state, const GBufferTextures &gbuffer, const ShaderDefines &lighting,
+                            const glm::mat4 &view_projection) {
+    const Shader &shader =
+        m_shaders.get("res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_deferred.glsl", lighting);
+
+    state.use_program(shader._m_id);
+    state.bind_texture(ALBEDO_SPECULAR_UNIT, GL_TEXTURE_2D, gbuffer.albedo_specular);
+    state.set_sampler(shader.location("gAlbedoSpecular"), ALBEDO_SPECULAR_UNIT);
+    state.bind_texture(NORMAL_SHININESS_UNIT, GL_TEXTURE_2D, gbuffer.normal_shininess);
+    state.set_sampler(shader.location("gNormalShininess"), NORMAL_SHININESS_UNIT);
+    state.bind_texture(DEPTH_UNIT, GL_TEXTURE_2D, gbuffer.depth);
+    state.set_sampler(shader.location("gDepth"), DEPTH_UNIT);
+    shader.set(shader.uniform<glm::mat4>("inverseViewProjection"), glm::inverse(view_projection));
+    state.bind_vertex_array(m_vao);
+
+    // Every covered pixel is written once, depth included: the test has to be on for depth writes, but must pass
+    const GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    GLint depth_func = GL_LESS;
+    glGetIntegerv(GL_DEPTH_FUNC, &depth_func);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_ALWAYS);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glDepthFunc(depth_func);
+    if (!depth_test) {
+        glDisable(GL_DEPTH_TEST);
+    }
+}
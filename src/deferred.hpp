@@ -0,0 +1,57 @@
+#ifndef DEFERRED_HPP
+#define DEFERRED_HPP
+
+#include "gl_state.hpp"
+#include "shader.hpp"
+#include "shader_library.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// Deferred shading: opaque geometry writes its surface to a G-buffer (the GBUFFER permutation of fragment.glsl), then
+// one full-screen pass lights every covered pixel once. Lighting cost follows pixels x lights instead of overdraw x
+// lights, and the pass reads the same light set permutations as forward shading, clustered lists included.
+
+// The G-buffer is two colour attachments plus depth, 8 bytes per pixel before depth (packing in
+// res/shaders/include/gbuffer.glsl), declared as frame graph transients by SceneRenderer:
+//   0      RGBA8             albedo, specular intensity
+//   1      RGB10_A2          octahedral normal, shininess
+//   depth  DEPTH24_STENCIL8  positions are rebuilt from it; copied into the lit target's depth by the lighting pass
+constexpr GLenum GBUFFER_ALBEDO_SPECULAR_FORMAT = GL_RGBA8;
+constexpr GLenum GBUFFER_NORMAL_SHININESS_FORMAT = GL_RGB10_A2;
+constexpr GLenum GBUFFER_DEPTH_FORMAT = GL_DEPTH24_STENCIL8;
+constexpr size_t GBUFFER_BYTES_PER_PIXEL = 4 + 4 + 4;
+
+struct GBufferTextures {
+    unsigned int albedo_specular;
+    unsigned int normal_shininess;
+    unsigned int depth;
+};
+
+// The lighting half: a full-screen triangle running fragment_deferred.glsl, one program per light set permutation
+class DeferredLighting {
+  public:
+    DeferredLighting();
+    ~DeferredLighting();
+
+    DeferredLighting(const DeferredLighting &) = delete;
+    DeferredLighting &operator=(const DeferredLighting &) = delete;
+
+    // Shades the G-buffer into the currently bound framebuffer, whose viewport must match the G-buffer size, and
+    // writes the G-buffer's depth to its depth attachment so forward draws after it test against the opaque scene.
+    // `lighting` are the light set defines of include/lighting.glsl. Binds through `state` (units 0-2) and sets the
+    // depth test to always pass for the draw, restoring it after.
+    void draw(GlStateCache &state, const GBufferTextures &gbuffer, const ShaderDefines &lighting,
+              const glm::mat4 &view_projection);
+
+    // Permutations built so far
+    size_t programs() const { return m_shaders.size(); }
+
+  private:
+    ShaderLibrary m_shaders;
+    unsigned int m_vao = 0;
+};
+
+#endif
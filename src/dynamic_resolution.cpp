@@ -0,0 +1,51 @@
+#include "dynamic_resolution.hpp"
+#include "post_process.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+glm::ivec2 DynamicResolution::render_size(glm::ivec2 output) const { return scaled_size(output, m_scale); }
+
+bool DynamicResolution::set_scale(float scale, uint64_t next_frame) {
+    if (scale == m_scale) {
+        return false;
+    }
+    m_scale = scale;
+    m_since = next_frame;
+    m_stats.change_ms = m_stats.average_ms;
+    m_stats.average_ms = 0.0;
+    m_stats.samples = 0;
+    m_stats.changes++;
+    return true;
+}
+
+bool DynamicResolution::update(uint64_t frame, double ms, uint64_t next_frame) {
+    if (!enabled) {
+        return set_scale(max_scale, next_frame);
+    }
+    if (m_scale < min_scale || m_scale > max_scale) {
+        return set_scale(std::clamp(m_scale, min_scale, max_scale), next_frame);
+    }
+    if (frame < m_since) {
+        // Still in flight when the scale last changed, so drawn at the old one
+        return false;
+    }
+
+    m_stats.average_ms = m_stats.samples == 0 ? ms : m_stats.average_ms + (ms - m_stats.average_ms) * smoothing;
+    m_stats.samples++;
+    if (m_stats.samples < settle_frames || m_stats.average_ms <= 0.0) {
+        return false;
+    }
+    const bool over = m_stats.average_ms > target_ms;
+    const bool under = m_stats.average_ms < target_ms * raise_below;
+    if (!over && !under) {
+        return false;
+    }
+
+    const float wanted = m_scale * static_cast<float>(std::sqrt(target_ms / m_stats.average_ms));
+    // The small bias keeps exact multiples (0.6 / 0.05 is 11.999...) on their own step. Over budget always goes down
+    // at least a step; under it never goes down.
+    float snapped = std::floor(wanted / step + 1e-3f) * step;
+    snapped = over ? std::min(snapped, m_scale - step) : std::max(snapped, m_scale);
+    return set_scale(std::clamp(snapped, min_scale, max_scale), next_frame);
+}
@@ -0,0 +1,59 @@
+#ifndef DYNAMIC_RESOLUTION_HPP
+#define DYNAMIC_RESOLUTION_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// Dynamic resolution: the scene is drawn at a scale of the output's size that follows measured GPU frame time, then
+// upscaled by the post chain (see PostChain::add_passes).
+//
+// GPU time is taken to go with pixel count, i.e. with scale squared, so a frame averaging `ms` at scale s would hit
+// the target at s * sqrt(target / ms). Scales snap down to multiples of `step`, which keeps the set of render sizes
+// (and so the render targets the pools keep) small and gives the controller some hysteresis: it only scales up while
+// frames stay under `raise_below` of the target. Timings come back a few frames late, so after a change the
+// controller ignores frames drawn before it and restarts its average.
+struct DynamicResolutionStats {
+    // Average GPU time of the current scale's frames, 0 until one arrives
+    double average_ms = 0.0;
+    // Frames in that average
+    unsigned int samples = 0;
+    // The average that made the last change
+    double change_ms = 0.0;
+    uint64_t changes = 0;
+};
+
+class DynamicResolution {
+  public:
+    // GPU time to hold a frame to
+    double target_ms = 1000.0 / 60.0;
+    float min_scale = 0.5f;
+    float max_scale = 1.0f;
+    float step = 0.05f;
+    double raise_below = 0.85;
+    // Weight of each new frame in the moving average
+    double smoothing = 0.2;
+    // Frames to average at a scale before deciding to leave it
+    unsigned int settle_frames = 4;
+    // When false the scale stays at max_scale
+    bool enabled = true;
+
+    float scale() const { return m_scale; }
+    // scaled_size() of `output` at the current scale
+    glm::ivec2 render_size(glm::ivec2 output) const;
+    const DynamicResolutionStats &stats() const { return m_stats; }
+
+    // Feeds the GPU time `ms` of frame `frame`. `next_frame` is the frame about to be drawn, the first a new scale
+    // applies to. Returns whether the scale changed.
+    bool update(uint64_t frame, double ms, uint64_t next_frame);
+
+  private:
+    float m_scale = 1.0f;
+    // First frame drawn at m_scale
+    uint64_t m_since = 0;
+    DynamicResolutionStats m_stats;
+
+    bool set_scale(float scale, uint64_t next_frame);
+};
+
+#endif
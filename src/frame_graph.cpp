@@ -0,0 +1,471 @@
+#include "frame_graph.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+bool is_depth(GLenum format) {
+    switch (format) {
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH32F_STENCIL8:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool has_stencil(GLenum format) { return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8; }
+
+unsigned int make_texture(glm::ivec2 size, GLenum format) {
+    // The pixel format and type only have to be valid for the internal format; nothing is uploaded
+    GLenum pixel_format = GL_RGBA, type = GL_UNSIGNED_BYTE;
+    if (format == GL_DEPTH24_STENCIL8) {
+        pixel_format = GL_DEPTH_STENCIL;
+        type = GL_UNSIGNED_INT_24_8;
+    } else if (format == GL_DEPTH32F_STENCIL8) {
+        pixel_format = GL_DEPTH_STENCIL;
+        type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+    } else if (is_depth(format)) {
+        pixel_format = GL_DEPTH_COMPONENT;
+        type = GL_FLOAT;
+    }
+    // Depth is only ever read with texelFetch; colour may be sampled at another resolution
+    const GLint filter = is_depth(format) ? GL_NEAREST : GL_LINEAR;
+
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, size.x, size.y, 0, pixel_format, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+} // namespace
+
+size_t texture_format_bytes(GLenum format) {
+    switch (format) {
+    case GL_R8:
+        return 1;
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+        return 2;
+    case GL_RGBA16F:
+    case GL_DEPTH32F_STENCIL8:
+        return 8;
+    case GL_RGBA32F:
+        return 16;
+    default:
+        // RGBA8, RGB10_A2, R11F_G11F_B10F, DEPTH24_STENCIL8, DEPTH_COMPONENT32F, and DEPTH_COMPONENT24 and RGB8 (padded
+        // by the driver anyway)
+        return 4;
+    }
+}
+
+FrameGraph::~FrameGraph() {
+    for (const auto &[attachments, framebuffer] : m_framebuffers) {
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+    for (const auto &texture : m_pool) {
+        glDeleteTextures(1, &texture.texture);
+    }
+}
+
+FrameResource FrameGraph::create(const std::string &name, glm::ivec2 size, GLenum format) {
+    m_resources.push_back({name, size, format, false, 0});
+    m_compiled = false;
+    return static_cast<FrameResource>(m_resources.size() - 1);
+}
+
+FrameResource FrameGraph::import_framebuffer(const std::string &name, unsigned int framebuffer, glm::ivec2 size) {
+    m_resources.push_back({name, size, GL_NONE, true, framebuffer});
+    m_compiled = false;
+    return static_cast<FrameResource>(m_resources.size() - 1);
+}
+
+unsigned int FrameGraph::add_pass(FramePass pass) {
+    const auto fail = [&pass](const std::string &what) {
+        throw std::runtime_error("frame graph: pass " + pass.name + " " + what);
+    };
+    for (FrameResource resource : pass.reads) {
+        if (resource >= m_resources.size()) {
+            fail("reads an unknown resource");
+        }
+        if (m_resources[resource].imported) {
+            fail("samples the imported framebuffer " + m_resources[resource].name);
+        }
+        if (std::count(pass.writes.begin(), pass.writes.end(), resource) > 0) {
+            fail("reads and writes " + m_resources[resource].name);
+        }
+    }
+    unsigned int depth = 0;
+    for (FrameResource resource : pass.writes) {
+        if (resource >= m_resources.size()) {
+            fail("writes an unknown resource");
+        }
+        const Resource &written = m_resources[resource];
+        if (written.imported && pass.writes.size() > 1) {
+            fail("writes the imported framebuffer " + written.name + " along with other resources");
+        }
+        if (written.size != m_resources[pass.writes.front()].size) {
+            fail("writes resources of different sizes");
+        }
+        if (std::count(pass.writes.begin(), pass.writes.end(), resource) > 1) {
+            fail("writes " + written.name + " twice");
+        }
+        depth += is_depth(written.format);
+    }
+    if (depth > 1) {
+        fail("writes more than one depth attachment");
+    }
+
+    m_passes.emplace_back();
+    m_passes.back().desc = std::move(pass);
+    m_compiled = false;
+    return static_cast<unsigned int>(m_passes.size() - 1);
+}
+
+bool FrameGraph::clears(const FramePass &pass, FrameResource resource) const {
+    return pass.clear && (pass.clear_depth || !is_depth(m_resources[resource].format));
+}
+
+void FrameGraph::reset() {
+    m_resources.clear();
+    m_passes.clear();
+    m_order.clear();
+    m_slots.clear();
+    m_compiled = false;
+}
+
+void FrameGraph::schedule(unsigned int index) {
+    Pass &pass = m_passes[index];
+    if (pass.scheduled) {
+        return;
+    }
+    pass.scheduled = true;
+    // Both lists only point at earlier passes, so this can't loop
+    std::vector<unsigned int> first = pass.needs;
+    first.insert(first.end(), pass.after_passes.begin(), pass.after_passes.end());
+    std::sort(first.begin(), first.end());
+    for (unsigned int other : first) {
+        if (m_passes[other].live) {
+            schedule(other);
+        }
+    }
+    m_order.push_back(index);
+}
+
+void FrameGraph::compile() {
+    PROFILE_ZONE("FrameGraph::compile");
+    for (auto &pass : m_passes) {
+        pass.needs.clear();
+        pass.after_passes.clear();
+        pass.live = pass.scheduled = false;
+        pass.before.clear();
+        pass.after.clear();
+    }
+    for (auto &resource : m_resources) {
+        resource.first = resource.last = resource.slot = NONE;
+    }
+    m_order.clear();
+    m_slots.clear();
+
+    // Dependencies, from declaration order: a read needs the resource's last writer, and so does a write that keeps
+    // the previous contents. A write must also wait for the passes still reading what it overwrites.
+    std::vector<unsigned int> last_writer(m_resources.size(), NONE);
+    std::vector<std::vector<unsigned int>> readers(m_resources.size());
+    for (unsigned int i = 0; i < m_passes.size(); i++) {
+        Pass &pass = m_passes[i];
+        for (FrameResource resource : pass.desc.reads) {
+            if (last_writer[resource] == NONE) {
+                throw std::runtime_error("frame graph: pass " + pass.desc.name + " reads " +
+                                         m_resources[resource].name + " before anything wrote it");
+            }
+            pass.needs.push_back(last_writer[resource]);
+            readers[resource].push_back(i);
+        }
+        for (FrameResource resource : pass.desc.writes) {
+            if (last_writer[resource] != NONE) {
+                (clears(pass.desc, resource) ? pass.after_passes : pass.needs).push_back(last_writer[resource]);
+            }
+            pass.after_passes.insert(pass.after_passes.end(), readers[resource].begin(), readers[resource].end());
+            readers[resource].clear();
+            last_writer[resource] = i;
+        }
+    }
+
+    // Culling: only what leads to an imported framebuffer is live
+    std::vector<unsigned int> roots, stack;
+    for (unsigned int i = 0; i < m_passes.size(); i++) {
+        for (FrameResource resource : m_passes[i].desc.writes) {
+            if (m_resources[resource].imported) {
+                roots.push_back(i);
+                break;
+            }
+        }
+    }
+    stack = roots;
+    while (!stack.empty()) {
+        Pass &pass = m_passes[stack.back()];
+        stack.pop_back();
+        if (!pass.live) {
+            pass.live = true;
+            stack.insert(stack.end(), pass.needs.begin(), pass.needs.end());
+        }
+    }
+
+    // Ordering: depth first from the roots, so every pass runs right before the first one that needs it
+    for (unsigned int root : roots) {
+        schedule(root);
+    }
+
+    // Lifetimes, in positions of m_order
+    for (unsigned int position = 0; position < m_order.size(); position++) {
+        const FramePass &desc = m_passes[m_order[position]].desc;
+        for (const auto *resources : {&desc.reads, &desc.writes}) {
+            for (FrameResource index : *resources) {
+                Resource &resource = m_resources[index];
+                if (resource.first == NONE) {
+                    resource.first = position;
+                }
+                resource.last = position;
+            }
+        }
+    }
+
+    // Aliasing: a transient takes the first slot of its size and format whose previous transient is dead by then
+    const uint64_t allocations = m_stats.allocations;
+    m_stats = {};
+    m_stats.allocations = allocations;
+    for (unsigned int position = 0; position < m_order.size(); position++) {
+        Pass &pass = m_passes[m_order[position]];
+        for (FrameResource index : pass.desc.writes) {
+            Resource &resource = m_resources[index];
+            if (resource.imported || resource.first != position) {
+                continue;
+            }
+            const auto free = std::find_if(m_slots.begin(), m_slots.end(), [&resource](const Slot &slot) {
+                return slot.size == resource.size && slot.format == resource.format && slot.busy_until < resource.first;
+            });
+            if (free == m_slots.end()) {
+                resource.slot = static_cast<unsigned int>(m_slots.size());
+                m_slots.push_back({resource.size, resource.format, resource.last});
+            } else {
+                resource.slot = static_cast<unsigned int>(free - m_slots.begin());
+                free->busy_until = resource.last;
+            }
+            m_stats.transients++;
+            m_stats.unaliased_bytes +=
+                size_t(resource.size.x) * resource.size.y * texture_format_bytes(resource.format);
+
+            // Whatever an aliased transient left there is garbage to this one
+            if (!clears(pass.desc, index)) {
+                pass.before.push_back(index);
+            }
+        }
+        for (FrameResource index : pass.desc.writes) {
+            const Resource &resource = m_resources[index];
+            if (!resource.imported && resource.last == position) {
+                // Written and never read: only needed while the pass runs (say a depth buffer)
+                pass.after.push_back(index);
+            }
+        }
+    }
+
+    m_stats.passes = static_cast<unsigned int>(m_passes.size());
+    m_stats.culled = static_cast<unsigned int>(m_passes.size() - m_order.size());
+    m_stats.textures = static_cast<unsigned int>(m_slots.size());
+    for (const auto &slot : m_slots) {
+        m_stats.transient_bytes += size_t(slot.size.x) * slot.size.y * texture_format_bytes(slot.format);
+    }
+    m_compiled = true;
+}
+
+unsigned int FrameGraph::texture(FrameResource resource) const {
+    const unsigned int slot = m_resources[resource].slot;
+    return slot < m_slot_textures.size() ? m_slot_textures[slot] : 0;
+}
+
+void FrameGraph::acquire_textures() {
+    m_slot_textures.clear();
+    for (const auto &slot : m_slots) {
+        auto pooled = std::find_if(m_pool.begin(), m_pool.end(), [this, &slot](const PoolTexture &texture) {
+            return texture.size == slot.size && texture.format == slot.format && texture.last_used != m_frame;
+        });
+        if (pooled == m_pool.end()) {
+            m_pool.push_back({make_texture(slot.size, slot.format), slot.size, slot.format, m_frame});
+            m_stats.allocations++;
+            pooled = m_pool.end() - 1;
+        }
+        pooled->last_used = m_frame;
+        m_slot_textures.push_back(pooled->texture);
+    }
+}
+
+unsigned int FrameGraph::framebuffer_for(const Pass &pass) {
+    std::vector<unsigned int> attachments;
+    unsigned int depth = 0;
+    for (FrameResource resource : pass.desc.writes) {
+        if (is_depth(m_resources[resource].format)) {
+            depth = texture(resource);
+        } else {
+            attachments.push_back(texture(resource));
+        }
+    }
+    attachments.push_back(depth);
+
+    const auto found = m_framebuffers.find(attachments);
+    if (found != m_framebuffers.end()) {
+        return found->second;
+    }
+
+    unsigned int framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    std::vector<GLenum> draw_buffers;
+    for (size_t i = 0; i + 1 < attachments.size(); i++) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, attachments[i], 0);
+        draw_buffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+    }
+    for (FrameResource resource : pass.desc.writes) {
+        if (is_depth(m_resources[resource].format)) {
+            const GLenum point = has_stencil(m_resources[resource].format) ? GL_DEPTH_STENCIL_ATTACHMENT
+                                                                           : GL_DEPTH_ATTACHMENT;
+            glFramebufferTexture2D(GL_FRAMEBUFFER, point, GL_TEXTURE_2D, depth, 0);
+        }
+    }
+    if (draw_buffers.empty()) {
+        glDrawBuffer(GL_NONE);
+    } else {
+        glDrawBuffers(static_cast<GLsizei>(draw_buffers.size()), draw_buffers.data());
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        glDeleteFramebuffers(1, &framebuffer);
+        throw std::runtime_error("frame graph: framebuffer for pass " + pass.desc.name + " is not complete");
+    }
+    m_framebuffers.emplace(std::move(attachments), framebuffer);
+    return framebuffer;
+}
+
+void FrameGraph::run(Pass &pass) {
+    PROFILE_ZONE("FrameGraph pass");
+    const FramePass &desc = pass.desc;
+    unsigned int framebuffer = 0;
+    // Attachment points of the writes, for invalidating
+    std::vector<GLenum> points(desc.writes.size());
+    if (!desc.writes.empty()) {
+        const Resource &first = m_resources[desc.writes.front()];
+        framebuffer = first.imported ? first.framebuffer : framebuffer_for(pass);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, first.size.x, first.size.y);
+        m_stats.framebuffer_binds++;
+
+        GLenum colour = GL_COLOR_ATTACHMENT0;
+        for (size_t i = 0; i < desc.writes.size(); i++) {
+            const GLenum format = m_resources[desc.writes[i]].format;
+            points[i] = !is_depth(format) ? colour++
+                        : has_stencil(format) ? GL_DEPTH_STENCIL_ATTACHMENT
+                                              : GL_DEPTH_ATTACHMENT;
+        }
+    }
+
+    const auto invalidate = [&](const std::vector<FrameResource> &resources) {
+        if (resources.empty() || !GLAD_GL_ARB_invalidate_subdata) {
+            return;
+        }
+        std::vector<GLenum> attachments;
+        for (FrameResource resource : resources) {
+            const size_t i = std::find(desc.writes.begin(), desc.writes.end(), resource) - desc.writes.begin();
+            attachments.push_back(points[i]);
+        }
+        glInvalidateFramebuffer(GL_FRAMEBUFFER, static_cast<GLsizei>(attachments.size()), attachments.data());
+        m_stats.invalidated += static_cast<unsigned int>(attachments.size());
+    };
+
+    invalidate(pass.before);
+    if (desc.clear && !desc.writes.empty()) {
+        // Clears obey the depth mask like draws do
+        glDepthMask(GL_TRUE);
+        const float colour[] = {desc.clear_color[0], desc.clear_color[1], desc.clear_color[2], desc.clear_color[3]};
+        if (m_resources[desc.writes.front()].imported) {
+            glClearBufferfv(GL_COLOR, 0, colour);
+            if (desc.clear_depth) {
+                glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+            }
+        } else {
+            GLint buffer = 0;
+            for (FrameResource resource : desc.writes) {
+                const GLenum format = m_resources[resource].format;
+                if (!is_depth(format)) {
+                    glClearBufferfv(GL_COLOR, buffer++, colour);
+                } else if (!desc.clear_depth) {
+                    continue;
+                } else if (has_stencil(format)) {
+                    glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+                } else {
+                    const float one = 1.0f;
+                    glClearBufferfv(GL_DEPTH, 0, &one);
+                }
+            }
+        }
+    }
+
+    if (desc.execute) {
+        desc.execute(*this);
+    }
+
+    if (!pass.after.empty()) {
+        // The pass may have bound something else
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        invalidate(pass.after);
+    }
+}
+
+void FrameGraph::evict() {
+    std::vector<unsigned int> freed;
+    std::erase_if(m_pool, [this, &freed](const PoolTexture &texture) {
+        if (m_frame - texture.last_used < m_keep_frames) {
+            return false;
+        }
+        freed.push_back(texture.texture);
+        return true;
+    });
+    if (freed.empty()) {
+        return;
+    }
+    std::erase_if(m_framebuffers, [&freed](const auto &entry) {
+        for (unsigned int texture : entry.first) {
+            if (std::count(freed.begin(), freed.end(), texture) > 0) {
+                glDeleteFramebuffers(1, &entry.second);
+                return true;
+            }
+        }
+        return false;
+    });
+    glDeleteTextures(static_cast<GLsizei>(freed.size()), freed.data());
+}
+
+void FrameGraph::execute() {
+    PROFILE_ZONE("FrameGraph::execute");
+    if (!m_compiled) {
+        compile();
+    }
+    acquire_textures();
+    for (unsigned int index : m_order) {
+        run(m_passes[index]);
+    }
+    evict();
+    m_frame++;
+    m_slot_textures.clear();
+    reset();
+}
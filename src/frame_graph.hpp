@@ -0,0 +1,173 @@
+#ifndef FRAME_GRAPH_HPP
+#define FRAME_GRAPH_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// A declarative frame. Every frame, passes are declared with the textures they sample and the ones they draw into;
+// execute() then
+//   - culls the passes nothing needs, keeping only what leads to an imported framebuffer (the window, say)
+//   - orders the rest so each pass runs just before the first pass that needs it, which keeps transients short-lived
+//   - backs the transient textures with pooled textures, sharing one between transients whose lifetimes don't overlap
+//   - binds a framebuffer with each pass's attachments, sets the viewport and clears if asked
+//   - invalidates attachments whose contents are undefined before a pass or dead after it (glInvalidateFramebuffer,
+//     when ARB_invalidate_subdata is there), so tiled GPUs skip loading and storing them
+//
+// A pass reads what the passes declared before it wrote, so declaration order is the program order; the graph only
+// moves passes where that doesn't change what anyone reads. GL has no placed resources, so aliasing shares whole
+// textures between transients of the same size and format. Pooled textures survive across frames, and one unused for
+// `keep_frames` frames is freed, so a resolution change only allocates the first time.
+using FrameResource = unsigned int;
+
+class FrameGraph;
+
+struct FramePass {
+    std::string name;
+    // Sampled; execute() gets their textures from FrameGraph::texture()
+    std::vector<FrameResource> reads;
+    // Drawn into: colour formats become colour attachments 0, 1, ... in order, a depth format the depth attachment.
+    // All the same size. An imported framebuffer must be the only write.
+    std::vector<FrameResource> writes;
+    // Clears the writes before execute(): colour to clear_color, depth to 1 and stencil to 0. Otherwise a pass draws
+    // over whatever earlier passes left, and needs them.
+    bool clear = false;
+    glm::vec4 clear_color = glm::vec4(0.0f);
+    // Runs with the writes bound and the viewport covering them
+    std::function<void(const FrameGraph &)> execute;
+    // With clear, whether the depth write is cleared too. Off for a pass that tests against the depth earlier passes
+    // drew, which then needs them like an uncleared write.
+    bool clear_depth = true;
+};
+
+// Of the most recent frame
+struct FrameGraphStats {
+    unsigned int passes = 0;
+    unsigned int culled = 0;
+    // Transient resources the remaining passes use, and the pooled textures backing them
+    unsigned int transients = 0;
+    unsigned int textures = 0;
+    // Storage of those textures, i.e. the frame's peak transient memory, and what a texture per transient would take
+    size_t transient_bytes = 0;
+    size_t unaliased_bytes = 0;
+    unsigned int framebuffer_binds = 0;
+    // Attachments invalidated (0 without ARB_invalidate_subdata)
+    unsigned int invalidated = 0;
+    // Textures the pool has created so far; flat once every size and format in use has been seen
+    uint64_t allocations = 0;
+};
+
+// Storage per pixel of a texture format
+size_t texture_format_bytes(GLenum format);
+
+class FrameGraph {
+  public:
+    explicit FrameGraph(unsigned int keep_frames = 240) : m_keep_frames(keep_frames) {}
+    ~FrameGraph();
+
+    FrameGraph(const FrameGraph &) = delete;
+    FrameGraph &operator=(const FrameGraph &) = delete;
+
+    // A texture that lives for this frame only
+    FrameResource create(const std::string &name, glm::ivec2 size, GLenum format);
+    // A framebuffer owned elsewhere; passes writing it are what the frame is for and are never culled
+    FrameResource import_framebuffer(const std::string &name, unsigned int framebuffer, glm::ivec2 size);
+
+    // Throws std::runtime_error on a bad declaration: an unknown resource, a pass reading what it writes, writes of
+    // different sizes, two depth attachments, or an imported framebuffer alongside other writes
+    unsigned int add_pass(FramePass pass);
+
+    // Culls, orders and assigns textures without touching GL; execute() does it when it hasn't been done. Throws
+    // std::runtime_error when a pass reads a transient nothing wrote before it.
+    void compile();
+    // Runs the frame, then forgets its passes and resources (not the pooled textures). Leaves the last pass's
+    // framebuffer bound. Throws std::runtime_error when a framebuffer isn't complete.
+    void execute();
+    // Forgets the declared frame without running it
+    void reset();
+
+    glm::ivec2 size(FrameResource resource) const { return m_resources[resource].size; }
+    bool imported(FrameResource resource) const { return m_resources[resource].imported; }
+    GLenum format(FrameResource resource) const { return m_resources[resource].format; }
+    // The texture behind a transient, only while execute() runs its passes
+    unsigned int texture(FrameResource resource) const;
+
+    // After compile(): the passes to run, in order; which transient shares a texture with which (same slot); the
+    // attachments invalidated before and after each pass
+    const std::vector<unsigned int> &order() const { return m_order; }
+    bool culled(unsigned int pass) const { return !m_passes[pass].live; }
+    unsigned int slot(FrameResource resource) const { return m_resources[resource].slot; }
+    const std::vector<FrameResource> &invalidated_before(unsigned int pass) const { return m_passes[pass].before; }
+    const std::vector<FrameResource> &invalidated_after(unsigned int pass) const { return m_passes[pass].after; }
+
+    const FrameGraphStats &stats() const { return m_stats; }
+
+  private:
+    static constexpr unsigned int NONE = ~0u;
+
+    struct Resource {
+        std::string name;
+        glm::ivec2 size;
+        GLenum format;
+        bool imported;
+        unsigned int framebuffer;
+        // Filled in by compile(): positions in m_order of the first and last use, and the texture slot
+        unsigned int first = NONE, last = NONE;
+        unsigned int slot = NONE;
+    };
+
+    struct Pass {
+        FramePass desc;
+        // Earlier passes whose output this one uses, and ones that must merely run first (they read what this
+        // overwrites)
+        std::vector<unsigned int> needs, after_passes;
+        bool live = false;
+        bool scheduled = false;
+        std::vector<FrameResource> before, after;
+    };
+
+    struct Slot {
+        glm::ivec2 size;
+        GLenum format;
+        // Position in m_order of its current transient's last use
+        unsigned int busy_until;
+    };
+
+    struct PoolTexture {
+        unsigned int texture;
+        glm::ivec2 size;
+        GLenum format;
+        uint64_t last_used;
+    };
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    std::vector<unsigned int> m_order;
+    std::vector<Slot> m_slots;
+    bool m_compiled = false;
+    FrameGraphStats m_stats;
+
+    // Texture of each slot while executing
+    std::vector<unsigned int> m_slot_textures;
+    std::vector<PoolTexture> m_pool;
+    // Framebuffers by attachments: colour textures, then the depth texture (0 for none)
+    std::map<std::vector<unsigned int>, unsigned int> m_framebuffers;
+    unsigned int m_keep_frames;
+    uint64_t m_frame = 0;
+
+    // Whether `pass` clears `resource` before drawing into it
+    bool clears(const FramePass &pass, FrameResource resource) const;
+    void schedule(unsigned int pass);
+    void acquire_textures();
+    unsigned int framebuffer_for(const Pass &pass);
+    void run(Pass &pass);
+    void evict();
+};
+
+#endif
@@ -0,0 +1,34 @@
+#include "frame_stats.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+SampleSummary SampleSummary::of(std::vector<double> samples) {
+    SampleSummary summary;
+    if (samples.empty()) {
+        return summary;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    const auto percentile = [&](double p) {
+        const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+        return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+    };
+
+    summary.count = samples.size();
+    summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    summary.min = samples.front();
+    summary.p50 = percentile(50.0);
+    summary.p90 = percentile(90.0);
+    summary.p95 = percentile(95.0);
+    summary.p99 = percentile(99.0);
+    summary.max = samples.back();
+    return summary;
+}
+
+void SampleSummary::write_json(std::FILE *out) const {
+    std::fprintf(out,
+                 "{\"count\": %zu, \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, "
+                 "\"p99\": %.4f, \"max\": %.4f}",
+                 count, mean, min, p50, p90, p95, p99, max);
+}
@@ -0,0 +1,25 @@
+#ifndef FRAME_STATS_HPP
+#define FRAME_STATS_HPP
+
+#include <cstdio>
+#include <vector>
+
+// Distribution of a set of per-frame samples (milliseconds, draw calls, ...)
+struct SampleSummary {
+    size_t count = 0;
+    double mean = 0.0;
+    double min = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+
+    // Percentiles use the nearest-rank method, so every reported value is an actual sample
+    static SampleSummary of(std::vector<double> samples);
+
+    // Writes the summary as a JSON object (no trailing newline)
+    void write_json(std::FILE *out) const;
+};
+
+#endif
@@ -0,0 +1,204 @@
+#include "geometry_arena.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+RangeAllocator::RangeAllocator(uint32_t capacity) : m_capacity(capacity), m_used(0) {
+    if (capacity > 0) {
+        m_free[0] = capacity;
+    }
+}
+
+std::optional<uint32_t> RangeAllocator::allocate(uint32_t count) {
+    if (count == 0) {
+        return 0;
+    }
+
+    for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+        const auto [offset, size] = *it;
+        if (size < count) {
+            continue;
+        }
+
+        m_free.erase(it);
+        if (size > count) {
+            m_free[offset + count] = size - count;
+        }
+        m_used += count;
+        return offset;
+    }
+
+    return std::nullopt;
+}
+
+void RangeAllocator::release(uint32_t offset, uint32_t count) {
+    if (count == 0) {
+        return;
+    }
+    m_used -= count;
+
+    auto next = m_free.lower_bound(offset);
+
+    // Merge with the preceding block
+    if (next != m_free.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            count += prev->second;
+            m_free.erase(prev);
+        }
+    }
+
+    // Merge with the following block
+    if (next != m_free.end() && offset + count == next->first) {
+        count += next->second;
+        m_free.erase(next);
+    }
+
+    m_free[offset] = count;
+}
+
+void RangeAllocator::grow(uint32_t new_capacity) {
+    if (new_capacity <= m_capacity) {
+        return;
+    }
+
+    const uint32_t old_capacity = m_capacity;
+    m_capacity = new_capacity;
+    // Treat the new tail as a released range so it merges with a free block at the old end
+    m_used += new_capacity - old_capacity;
+    release(old_capacity, new_capacity - old_capacity);
+}
+
+namespace {
+
+// Replaces `buffer` with a larger one, keeping its first `old_bytes`
+void grow_buffer(unsigned int &buffer, size_t old_bytes, size_t new_bytes) {
+    unsigned int grown;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, new_bytes, nullptr, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_bytes);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+    buffer = grown;
+}
+
+} // namespace
+
+GeometryArena::GeometryArena(const VertexLayout &layout, uint32_t vertex_capacity, uint32_t index_capacity)
+    : m_layout(layout), m_vertices(vertex_capacity), m_indices(index_capacity), m_allocations(0), m_grows(0) {
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_vbo);
+    glGenBuffers(1, &m_ebo);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, size_t(vertex_capacity) * m_layout.stride, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, size_t(index_capacity) * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+    bind_attributes();
+    glBindVertexArray(0);
+}
+
+GeometryArena::~GeometryArena() {
+    glDeleteVertexArrays(1, &m_vao);
+    glDeleteBuffers(1, &m_vbo);
+    glDeleteBuffers(1, &m_ebo);
+}
+
+GeometryAllocation GeometryArena::allocate(std::span<const Vertex> vertices, std::span<const unsigned int> indices) {
+    const GeometryAllocation allocation = allocate(vertices.size(), indices.size());
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, size_t(allocation.base_vertex) * m_layout.stride,
+                    vertices.size() * m_layout.stride, vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // GL_ELEMENT_ARRAY_BUFFER is VAO state, so go through the copy target instead of disturbing whatever is bound
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, size_t(allocation.first_index) * sizeof(unsigned int),
+                    indices.size() * sizeof(unsigned int), indices.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    return allocation;
+}
+
+GeometryAllocation GeometryArena::allocate(uint32_t vertex_count, uint32_t index_count) {
+    auto base_vertex = m_vertices.allocate(vertex_count);
+    if (!base_vertex) {
+        // Growing by at least the request guarantees a large enough free tail regardless of fragmentation
+        grow_vertices(m_vertices.capacity() + vertex_count);
+        base_vertex = m_vertices.allocate(vertex_count);
+    }
+
+    auto first_index = m_indices.allocate(index_count);
+    if (!first_index) {
+        grow_indices(m_indices.capacity() + index_count);
+        first_index = m_indices.allocate(index_count);
+    }
+
+    if (!base_vertex || !first_index) {
+        throw std::runtime_error("geometry arena allocation failed");
+    }
+
+    m_allocations++;
+    return {*base_vertex, vertex_count, *first_index, index_count};
+}
+
+void GeometryArena::release(const GeometryAllocation &allocation) {
+    m_vertices.release(allocation.base_vertex, allocation.vertex_count);
+    m_indices.release(allocation.first_index, allocation.index_count);
+    m_allocations--;
+}
+
+GeometryArenaStats GeometryArena::stats() const {
+    return {m_allocations, m_vertices.used(), m_vertices.capacity(), m_indices.used(), m_indices.capacity(), m_grows};
+}
+
+GeometryArena &GeometryArena::shared() {
+    static GeometryArena *arena = new GeometryArena(vertex_layout(), 1 << 16, 1 << 18);
+    return *arena;
+}
+
+void GeometryArena::grow_vertices(uint32_t min_capacity) {
+    const uint32_t old_capacity = m_vertices.capacity();
+    const uint32_t new_capacity = std::max(min_capacity, std::max(old_capacity * 2, 1u));
+
+    grow_buffer(m_vbo, size_t(old_capacity) * m_layout.stride, size_t(new_capacity) * m_layout.stride);
+    m_vertices.grow(new_capacity);
+    m_grows++;
+
+    // Attribute pointers captured the old buffer name
+    glBindVertexArray(m_vao);
+    bind_attributes();
+    glBindVertexArray(0);
+}
+
+void GeometryArena::grow_indices(uint32_t min_capacity) {
+    const uint32_t old_capacity = m_indices.capacity();
+    const uint32_t new_capacity = std::max(min_capacity, std::max(old_capacity * 2, 1u));
+
+    grow_buffer(m_ebo, size_t(old_capacity) * sizeof(unsigned int), size_t(new_capacity) * sizeof(unsigned int));
+    m_indices.grow(new_capacity);
+    m_grows++;
+
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    glBindVertexArray(0);
+}
+
+void GeometryArena::bind_attributes() {
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    for (const auto &attribute : m_layout.attributes) {
+        glEnableVertexAttribArray(attribute.index);
+        glVertexAttribPointer(attribute.index, attribute.size, attribute.type, attribute.normalized,
+                              m_layout.stride, reinterpret_cast<void *>(attribute.offset));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,86 @@
+#ifndef GEOMETRY_ARENA_HPP
+#define GEOMETRY_ARENA_HPP
+
+#include "vertex.hpp"
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+
+// First-fit free-list over [0, capacity). Adjacent free ranges are merged on release.
+class RangeAllocator {
+  public:
+    explicit RangeAllocator(uint32_t capacity);
+
+    std::optional<uint32_t> allocate(uint32_t count);
+    void release(uint32_t offset, uint32_t count);
+    // Extends the range; the new tail is free
+    void grow(uint32_t new_capacity);
+
+    uint32_t capacity() const { return m_capacity; }
+    uint32_t used() const { return m_used; }
+
+  private:
+    uint32_t m_capacity;
+    uint32_t m_used;
+    // offset -> size
+    std::map<uint32_t, uint32_t> m_free;
+};
+
+// A mesh's slice of an arena. Index values are relative to base_vertex, so a mesh's indices are stored unchanged and
+// drawn with glDrawElementsBaseVertex.
+struct GeometryAllocation {
+    uint32_t base_vertex = 0;
+    uint32_t vertex_count = 0;
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+};
+
+struct GeometryArenaStats {
+    uint32_t allocations;
+    uint32_t vertices_used, vertex_capacity;
+    uint32_t indices_used, index_capacity;
+    uint32_t grows;
+};
+
+// One VAO plus one large vertex buffer and one large index buffer shared by every mesh with the same vertex layout.
+// Buffers grow by doubling; the VAO name never changes so allocations stay valid across a grow.
+class GeometryArena {
+  public:
+    GeometryArena(const VertexLayout &layout, uint32_t vertex_capacity, uint32_t index_capacity);
+    ~GeometryArena();
+
+    GeometryArena(const GeometryArena &) = delete;
+    GeometryArena &operator=(const GeometryArena &) = delete;
+
+    GeometryAllocation allocate(std::span<const Vertex> vertices, std::span<const unsigned int> indices);
+    // Reserves space without filling it; the caller copies the data into vertex_buffer()/index_buffer() itself (at
+    // base_vertex * stride() and first_index * sizeof(unsigned int)), e.g. in chunks from a staging buffer
+    GeometryAllocation allocate(uint32_t vertex_count, uint32_t index_count);
+    void release(const GeometryAllocation &allocation);
+
+    unsigned int vao() const { return m_vao; }
+    // Buffer names change when the arena grows, so look them up again after any allocate()
+    unsigned int vertex_buffer() const { return m_vbo; }
+    unsigned int index_buffer() const { return m_ebo; }
+    uint32_t stride() const { return m_layout.stride; }
+    GeometryArenaStats stats() const;
+
+    // Arena for the Vertex layout. Deliberately never destroyed: it outlives every Mesh and the GL context is already
+    // gone by the time static destructors run.
+    static GeometryArena &shared();
+
+  private:
+    VertexLayout m_layout;
+    unsigned int m_vao, m_vbo, m_ebo;
+    RangeAllocator m_vertices, m_indices;
+    uint32_t m_allocations;
+    uint32_t m_grows;
+
+    void grow_vertices(uint32_t min_capacity);
+    void grow_indices(uint32_t min_capacity);
+    void bind_attributes();
+};
+
+#endif
@@ -0,0 +1,89 @@
+#include "gl_state.hpp"
+
+GlStateStats &GlStateStats::operator+=(const GlStateStats &o) {
+    program_binds += o.program_binds;
+    vao_binds += o.vao_binds;
+    texture_binds += o.texture_binds;
+    sampler_sets += o.sampler_sets;
+    skipped_binds += o.skipped_binds;
+    return *this;
+}
+
+GlStateStats GlStateStats::operator-(const GlStateStats &o) const {
+    GlStateStats d;
+    d.program_binds = program_binds - o.program_binds;
+    d.vao_binds = vao_binds - o.vao_binds;
+    d.texture_binds = texture_binds - o.texture_binds;
+    d.sampler_sets = sampler_sets - o.sampler_sets;
+    d.skipped_binds = skipped_binds - o.skipped_binds;
+    return d;
+}
+
+GlStateCache::GlStateCache() { invalidate(); }
+
+void GlStateCache::use_program(unsigned int program) {
+    if (m_program == program) {
+        stats.skipped_binds++;
+        return;
+    }
+    glUseProgram(program);
+    m_program = program;
+    stats.program_binds++;
+}
+
+void GlStateCache::bind_vertex_array(unsigned int vao) {
+    if (m_vao == vao) {
+        stats.skipped_binds++;
+        return;
+    }
+    glBindVertexArray(vao);
+    m_vao = vao;
+    stats.vao_binds++;
+}
+
+void GlStateCache::bind_texture(unsigned int unit, GLenum target, unsigned int texture) {
+    if (unit < GL_STATE_TEXTURE_UNITS && m_textures[unit] == texture) {
+        stats.skipped_binds++;
+        return;
+    }
+    active_texture(unit);
+    glBindTexture(target, texture);
+    if (unit < GL_STATE_TEXTURE_UNITS) {
+        m_textures[unit] = texture;
+    }
+    stats.texture_binds++;
+}
+
+void GlStateCache::set_sampler(int location, int unit) {
+    if (location < 0) {
+        return;
+    }
+
+    const uint64_t key = (uint64_t(m_program) << 32) | uint32_t(location);
+    const auto it = m_samplers.find(key);
+    if (it != m_samplers.end() && it->second == unit) {
+        stats.skipped_binds++;
+        return;
+    }
+    glUniform1i(location, unit);
+    m_samplers[key] = unit;
+    stats.sampler_sets++;
+}
+
+void GlStateCache::invalidate() {
+    m_program = UNKNOWN;
+    m_vao = UNKNOWN;
+    m_active_unit = UNKNOWN;
+    for (auto &texture : m_textures) {
+        texture = UNKNOWN;
+    }
+    // Shader::set_i can rewrite sampler uniforms too
+    m_samplers.clear();
+}
+
+void GlStateCache::active_texture(unsigned int unit) {
+    if (m_active_unit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        m_active_unit = unit;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef GL_STATE_HPP
+#define GL_STATE_HPP
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <unordered_map>
+
+constexpr unsigned int GL_STATE_TEXTURE_UNITS = 16;
+
+// Number of binds the cache issued to the driver vs. the ones it dropped because the state was already current.
+struct GlStateStats {
+    uint64_t program_binds = 0;
+    uint64_t vao_binds = 0;
+    uint64_t texture_binds = 0;
+    uint64_t sampler_sets = 0;
+    uint64_t skipped_binds = 0;
+
+    uint64_t state_changes() const { return program_binds + vao_binds + texture_binds + sampler_sets; }
+
+    GlStateStats &operator+=(const GlStateStats &o);
+    GlStateStats operator-(const GlStateStats &o) const;
+};
+
+// Shadows the bits of GL state the renderer changes most often and skips redundant calls. Anything that changes this
+// state behind the cache's back (immediate-mode code in main, Mesh::draw, ...) must be followed by invalidate().
+class GlStateCache {
+  public:
+    GlStateStats stats;
+
+    GlStateCache();
+
+    void use_program(unsigned int program);
+    void bind_vertex_array(unsigned int vao);
+    void bind_texture(unsigned int unit, GLenum target, unsigned int texture);
+    // Sets a sampler uniform on the currently bound program
+    void set_sampler(int location, int unit);
+
+    void invalidate();
+
+  private:
+    static constexpr unsigned int UNKNOWN = ~0u;
+
+    unsigned int m_program;
+    unsigned int m_vao;
+    unsigned int m_active_unit;
+    unsigned int m_textures[GL_STATE_TEXTURE_UNITS];
+    // (program << 32 | location) -> unit
+    std::unordered_map<uint64_t, int> m_samplers;
+
+    void active_texture(unsigned int unit);
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include "gpu_timer.hpp"
+#include <algorithm>
+
+GpuTimer::GpuTimer(unsigned int ring_size) : m_slots(std::max(ring_size, 2u)), m_head(0), m_tail(0) {
+    for (auto &slot : m_slots) {
+        glGenQueries(1, &slot.begin);
+        glGenQueries(1, &slot.end);
+        slot.tag = 0;
+        slot.pending = false;
+    }
+}
+
+GpuTimer::~GpuTimer() {
+    for (auto &slot : m_slots) {
+        glDeleteQueries(1, &slot.begin);
+        glDeleteQueries(1, &slot.end);
+    }
+}
+
+void GpuTimer::begin(uint64_t tag) {
+    Slot &slot = m_slots[m_head];
+    if (slot.pending) {
+        // Wrapped onto the oldest query; it has to finish before its object can be reused
+        read(slot, true, m_ready);
+        stalls++;
+        m_tail = (m_head + 1) % m_slots.size();
+    }
+
+    slot.tag = tag;
+    glQueryCounter(slot.begin, GL_TIMESTAMP);
+    m_open.push_back(m_head);
+    m_head = (m_head + 1) % m_slots.size();
+}
+
+void GpuTimer::end() {
+    Slot &slot = m_slots[m_open.back()];
+    m_open.pop_back();
+    glQueryCounter(slot.end, GL_TIMESTAMP);
+    slot.pending = true;
+}
+
+void GpuTimer::collect(std::vector<GpuTiming> &out, bool wait) {
+    out.insert(out.end(), m_ready.begin(), m_ready.end());
+    m_ready.clear();
+
+    for (size_t i = 0; i < m_slots.size(); i++) {
+        Slot &slot = m_slots[m_tail];
+        if (!slot.pending || !read(slot, wait, out)) {
+            break;
+        }
+        m_tail = (m_tail + 1) % m_slots.size();
+    }
+}
+
+bool GpuTimer::read(Slot &slot, bool wait, std::vector<GpuTiming> &out) {
+    if (!wait) {
+        GLint available = 0;
+        // The end query is issued last, so it's the one that finishes last
+        glGetQueryObjectiv(slot.end, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return false;
+        }
+    }
+
+    GLuint64 begin_ns = 0, end_ns = 0;
+    glGetQueryObjectui64v(slot.begin, GL_QUERY_RESULT, &begin_ns);
+    glGetQueryObjectui64v(slot.end, GL_QUERY_RESULT, &end_ns);
+    out.push_back({slot.tag, (end_ns - begin_ns) / 1e6});
+    slot.pending = false;
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef GPU_TIMER_HPP
+#define GPU_TIMER_HPP
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+struct GpuTiming {
+    // Whatever the caller passed to begin(), usually a frame number
+    uint64_t tag;
+    double ms;
+};
+
+// Times GPU work with pairs of GL_TIMESTAMP queries without stalling on them. Queries go into a ring and are only read
+// back once the driver reports them available, normally a few frames later. The ring only waits on a query when it
+// wraps around onto one that still hasn't finished; `stalls` counts those.
+//
+// Timestamps (unlike GL_TIME_ELAPSED) nest, so begin()/end() pairs may be nested, as long as they close in reverse
+// order and fewer than ring_size are open at once. Timings come back in begin() order.
+class GpuTimer {
+  public:
+    uint64_t stalls = 0;
+
+    explicit GpuTimer(unsigned int ring_size = 8);
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer &) = delete;
+    GpuTimer &operator=(const GpuTimer &) = delete;
+
+    void begin(uint64_t tag);
+    // Closes the innermost open begin()
+    void end();
+
+    // Appends every finished timing to `out`, oldest first. With `wait` set, blocks until all of them are finished.
+    void collect(std::vector<GpuTiming> &out, bool wait = false);
+
+  private:
+    struct Slot {
+        unsigned int begin, end;
+        uint64_t tag;
+        bool pending;
+    };
+
+    std::vector<Slot> m_slots;
+    // Next slot to begin, oldest slot that may still be pending
+    unsigned int m_head;
+    unsigned int m_tail;
+    // Slots begun but not ended, innermost last
+    std::vector<unsigned int> m_open;
+    // Results read early because the ring wrapped; handed out by the next collect()
+    std::vector<GpuTiming> m_ready;
+
+    bool read(Slot &slot, bool wait, std::vector<GpuTiming> &out);
+};
+
+#endif
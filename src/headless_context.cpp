@@ -0,0 +1,133 @@
+#include "headless_context.hpp"
+#include <glad/glad.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+bool has_extension(const char *extensions, const char *name) {
+    if (!extensions) {
+        return false;
+    }
+
+    const size_t len = std::strlen(name);
+    for (const char *p = std::strstr(extensions, name); p; p = std::strstr(p + len, name)) {
+        if ((p == extensions || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+EGLDisplay open_display() {
+    const char *client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (has_extension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+        const auto get_platform_display =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (get_platform_display) {
+            EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY) {
+                return display;
+            }
+        }
+    }
+
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+std::string gl_string(GLenum name) {
+    const auto *s = reinterpret_cast<const char *>(glGetString(name));
+    return s ? s : "";
+}
+
+} // namespace
+
+HeadlessContext::HeadlessContext() : m_display(EGL_NO_DISPLAY), m_context(EGL_NO_CONTEXT) {
+    EGLDisplay display = open_display();
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        throw std::runtime_error("couldn't initialize an EGL display");
+    }
+    m_display = display;
+
+    if (!has_extension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+        eglTerminate(display);
+        throw std::runtime_error("EGL display doesn't support EGL_KHR_surfaceless_context");
+    }
+
+    const EGLint config_attribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(display, config_attribs, &config, 1, &config_count) ||
+        config_count == 0) {
+        eglTerminate(display);
+        throw std::runtime_error("no EGL config for desktop OpenGL");
+    }
+
+    const EGLint context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                      3,
+                                      EGL_CONTEXT_MINOR_VERSION,
+                                      3,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                      EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                      EGL_NONE};
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if (context == EGL_NO_CONTEXT) {
+        eglTerminate(display);
+        throw std::runtime_error("couldn't create an OpenGL 3.3 core EGL context");
+    }
+    m_context = context;
+
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) ||
+        !gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress))) {
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        throw std::runtime_error("couldn't make the EGL context current");
+    }
+}
+
+HeadlessContext::~HeadlessContext() {
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(m_display, m_context);
+    eglTerminate(m_display);
+}
+
+std::string HeadlessContext::vendor() const { return gl_string(GL_VENDOR); }
+
+std::string HeadlessContext::renderer() const { return gl_string(GL_RENDERER); }
+
+std::string HeadlessContext::version() const { return gl_string(GL_VERSION); }
+
+OffscreenTarget::OffscreenTarget(int width, int height) {
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+    glGenRenderbuffers(1, &m_color);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_color);
+
+    glGenRenderbuffers(1, &m_depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depth);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        glDeleteFramebuffers(1, &m_framebuffer);
+        glDeleteRenderbuffers(1, &m_color);
+        glDeleteRenderbuffers(1, &m_depth);
+        throw std::runtime_error("offscreen framebuffer is not complete");
+    }
+}
+
+OffscreenTarget::~OffscreenTarget() {
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteRenderbuffers(1, &m_color);
+    glDeleteRenderbuffers(1, &m_depth);
+}
+
+void OffscreenTarget::bind() const { glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer); }
@@ -0,0 +1,47 @@
+#ifndef HEADLESS_CONTEXT_HPP
+#define HEADLESS_CONTEXT_HPP
+
+#include <string>
+
+// An OpenGL 3.3 core context with no window and no default framebuffer, made current on construction. Uses EGL on the
+// Mesa surfaceless platform when available, so it runs on llvmpipe in CI without X or Wayland, and falls back to the
+// default EGL display otherwise. Loads GL through glad; render into an FBO.
+//
+// Only linked into the tools that need it (see CMakeLists.txt), so the core library doesn't depend on EGL.
+class HeadlessContext {
+  public:
+    // Throws std::runtime_error when no suitable display or context can be created
+    HeadlessContext();
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext &) = delete;
+    HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+    // GL_VENDOR / GL_RENDERER / GL_VERSION of the created context
+    std::string vendor() const;
+    std::string renderer() const;
+    std::string version() const;
+
+  private:
+    void *m_display;
+    void *m_context;
+};
+
+// Color + depth/stencil target standing in for the window's default framebuffer
+class OffscreenTarget {
+  public:
+    // Throws std::runtime_error when the framebuffer isn't complete
+    OffscreenTarget(int width, int height);
+    ~OffscreenTarget();
+
+    OffscreenTarget(const OffscreenTarget &) = delete;
+    OffscreenTarget &operator=(const OffscreenTarget &) = delete;
+
+    void bind() const;
+    unsigned int framebuffer() const { return m_framebuffer; }
+
+  private:
+    unsigned int m_framebuffer, m_color, m_depth;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include "instancing.hpp"
+#include <algorithm>
+#include <cstdint>
+
+InstanceBatch::InstanceBatch() : m_buffer(0), m_capacity(0), m_uploaded(0) { glGenBuffers(1, &m_buffer); }
+
+InstanceBatch::~InstanceBatch() { glDeleteBuffers(1, &m_buffer); }
+
+void InstanceBatch::upload() {
+    const size_t bytes = m_instances.size() * sizeof(InstanceData);
+    m_uploaded = m_instances.size();
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    if (bytes > m_capacity) {
+        m_capacity = std::max(bytes, m_capacity * 2);
+    }
+    glBufferData(GL_ARRAY_BUFFER, m_capacity, nullptr, GL_STREAM_DRAW);
+    if (bytes > 0) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, m_instances.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBatch::attach() const {
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+
+    for (unsigned int column = 0; column < 4; column++) {
+        const unsigned int location = INSTANCE_MODEL_LOCATION + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              reinterpret_cast<void *>(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+    }
+
+    glEnableVertexAttribArray(INSTANCE_TINT_LOCATION);
+    glVertexAttribPointer(INSTANCE_TINT_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                          reinterpret_cast<void *>(offsetof(InstanceData, tint)));
+    glVertexAttribDivisor(INSTANCE_TINT_LOCATION, 1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBatch::draw_arrays(unsigned int vao, GLenum mode, int first, int count) const {
+    if (empty()) {
+        return;
+    }
+
+    glBindVertexArray(vao);
+    attach();
+    glDrawArraysInstanced(mode, first, count, m_uploaded);
+    glBindVertexArray(0);
+}
+
+void InstanceBatch::draw_elements(unsigned int vao, GLenum mode, unsigned int count, unsigned int first_index,
+                                  int base_vertex) const {
+    if (empty()) {
+        return;
+    }
+
+    glBindVertexArray(vao);
+    attach();
+    glDrawElementsInstancedBaseVertex(mode, count, GL_UNSIGNED_INT,
+                                      reinterpret_cast<void *>(uintptr_t(first_index) * sizeof(unsigned int)),
+                                      m_uploaded, base_vertex);
+    glBindVertexArray(0);
+}
@@ -0,0 +1,64 @@
+#ifndef INSTANCING_HPP
+#define INSTANCING_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// Per-instance vertex attributes read by the *_instanced.glsl vertex shaders. They sit above the mesh attributes
+// (0..2) so any VAO can take them without clashing.
+constexpr unsigned int INSTANCE_MODEL_LOCATION = 3; // mat4, one column per location: 3..6
+constexpr unsigned int INSTANCE_TINT_LOCATION = 7;
+
+struct InstanceData {
+    glm::mat4 model;
+    glm::vec4 tint;
+};
+
+// Collects transforms (and tints) for many copies of the same geometry and draws them with one instanced call.
+//
+//   batch.clear();
+//   for (...) batch.add(model);
+//   batch.upload();
+//   mesh.draw_instanced(shader, batch);    // or model.draw_instanced(...), batch.draw_arrays(vao, ...), a DrawPacket
+//
+// The instance attributes are attached to whichever VAO is drawn, right before the draw, so one VAO (e.g. the shared
+// geometry arena) can be drawn with any number of batches.
+class InstanceBatch {
+  public:
+    InstanceBatch();
+    ~InstanceBatch();
+
+    InstanceBatch(const InstanceBatch &) = delete;
+    InstanceBatch &operator=(const InstanceBatch &) = delete;
+
+    void clear() { m_instances.clear(); }
+    void add(const glm::mat4 &model, glm::vec4 tint = glm::vec4(1.0f)) { m_instances.push_back({model, tint}); }
+
+    // Instances added since clear(); only the ones present at the last upload() are drawn
+    const std::vector<InstanceData> &instances() const { return m_instances; }
+    unsigned int size() const { return m_uploaded; }
+    bool empty() const { return m_uploaded == 0; }
+
+    // Streams the instances into the instance buffer, orphaning the old storage so in-flight draws aren't stalled
+    void upload();
+
+    // Points the instance attributes of the currently bound VAO at this batch's buffer
+    void attach() const;
+
+    // Draws a raw VAO once per instance
+    void draw_arrays(unsigned int vao, GLenum mode, int first, int count) const;
+    void draw_elements(unsigned int vao, GLenum mode, unsigned int count, unsigned int first_index = 0,
+                       int base_vertex = 0) const;
+
+  private:
+    std::vector<InstanceData> m_instances;
+    unsigned int m_buffer;
+    // Bytes of buffer storage
+    size_t m_capacity;
+    unsigned int m_uploaded;
+};
+
+#endif
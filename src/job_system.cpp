@@ -0,0 +1,121 @@
+#include "job_system.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+
+struct JobSystem::Worker {
+    // The owner pushes and pops at the back, thieves take from the front. Only ever held for a push or a pop.
+    std::mutex mutex;
+    std::deque<Range> ranges;
+};
+
+JobSystem::JobSystem(unsigned int thread_count) {
+    for (unsigned int i = 0; i <= thread_count; i++) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (unsigned int i = 1; i <= thread_count; i++) {
+        m_threads.emplace_back(&JobSystem::thread_loop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    m_stopping = true;
+    m_generation.fetch_add(1);
+    m_generation.notify_all();
+    for (auto &thread : m_threads) {
+        thread.join();
+    }
+}
+
+void JobSystem::parallel_for(size_t count, size_t grain, const RangeJob &job) {
+    PROFILE_ZONE("JobSystem::parallel_for");
+    m_ranges = 0;
+    m_steals = 0;
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    if (m_threads.empty() || count <= grain) {
+        m_ranges = 1;
+        job(0, count, 0);
+        return;
+    }
+
+    m_job = &job;
+    m_grain = grain;
+    m_remaining = count;
+    {
+        std::lock_guard lock(m_workers[0]->mutex);
+        m_workers[0]->ranges.push_back({0, count});
+    }
+    m_generation.fetch_add(1);
+    m_generation.notify_all();
+
+    // work() only returns once the last range has finished, wherever it ran
+    work(0);
+}
+
+void JobSystem::thread_loop(unsigned int worker) {
+    uint64_t seen = 0;
+    for (;;) {
+        m_generation.wait(seen);
+        seen = m_generation.load();
+        if (m_stopping) {
+            return;
+        }
+        work(worker);
+    }
+}
+
+void JobSystem::work(unsigned int worker) {
+    Range range;
+    while (m_remaining.load() > 0) {
+        if (next(worker, range)) {
+            run(worker, range);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::next(unsigned int worker, Range &range) {
+    {
+        Worker &own = *m_workers[worker];
+        std::lock_guard lock(own.mutex);
+        if (!own.ranges.empty()) {
+            range = own.ranges.back();
+            own.ranges.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < m_workers.size(); i++) {
+        Worker &victim = *m_workers[(worker + i) % m_workers.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.ranges.empty()) {
+            range = victim.ranges.front();
+            victim.ranges.pop_front();
+            m_steals.fetch_add(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::run(unsigned int worker, Range range) {
+    // Leave the far half for whoever runs out of work first
+    Worker &own = *m_workers[worker];
+    while (range.end - range.begin > m_grain) {
+        const size_t middle = range.begin + (range.end - range.begin) / 2;
+        {
+            std::lock_guard lock(own.mutex);
+            own.ranges.push_back({middle, range.end});
+        }
+        range.end = middle;
+    }
+
+    (*m_job)(range.begin, range.end, worker);
+    m_ranges.fetch_add(1);
+    m_remaining.fetch_sub(range.end - range.begin);
+}
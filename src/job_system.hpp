@@ -0,0 +1,76 @@
+#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+struct JobStats {
+    // Ranges the work was cut into, and how many of them ran on a worker other than the one that split them off
+    size_t ranges = 0;
+    size_t steals = 0;
+};
+
+// Fork-join scheduler for per-frame CPU work. Every worker owns a deque of index ranges: it keeps halving the range it
+// holds, pushing the upper half onto its own deque, until it's down to the grain and runs it. Then it pops its own
+// deque from the back, and once that's empty steals from the front of another worker's, which is where the biggest
+// ranges are. Idle workers take over large chunks while busy ones keep working through neighbouring items.
+//
+// Unlike ThreadPool, whose FIFO is shared with the loaders' long tasks, nothing but parallel_for runs here, so a frame
+// never waits behind a texture decode. Jobs must not touch GL.
+class JobSystem {
+  public:
+    using RangeJob = std::function<void(size_t begin, size_t end, unsigned int worker)>;
+
+    // Threads besides the caller of parallel_for, which works as worker 0; 0 runs everything on the caller
+    explicit JobSystem(unsigned int thread_count = ThreadPool::default_thread_count());
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // The threads plus the calling thread; `worker` is always below this
+    unsigned int worker_count() const { return m_workers.size(); }
+
+    // Calls job(begin, end, worker) on ranges of at most `grain` items that cover [0, count) exactly once, and returns
+    // when every call has. A worker runs one range at a time, so state indexed by `worker` needs no locking. One
+    // parallel_for at a time, from one thread.
+    void parallel_for(size_t count, size_t grain, const RangeJob &job);
+
+    // Of the most recent parallel_for
+    JobStats stats() const { return {m_ranges.load(), m_steals.load()}; }
+
+  private:
+    struct Range {
+        size_t begin;
+        size_t end;
+    };
+    struct Worker;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    // Set before the first range of a parallel_for is pushed, so whoever pops a range sees the matching job
+    const RangeJob *m_job = nullptr;
+    size_t m_grain = 1;
+    // Items not run yet; the parallel_for is over at zero
+    std::atomic<size_t> m_remaining{0};
+    // Bumped to wake the threads for a parallel_for, or to stop them
+    std::atomic<uint64_t> m_generation{0};
+    std::atomic<bool> m_stopping{false};
+    std::atomic<size_t> m_ranges{0};
+    std::atomic<size_t> m_steals{0};
+
+    void thread_loop(unsigned int worker);
+    // Runs ranges until every item of the current parallel_for is done
+    void work(unsigned int worker);
+    bool next(unsigned int worker, Range &range);
+    void run(unsigned int worker, Range range);
+};
+
+#endif
@@ -0,0 +1,339 @@
+#include "light_clusters.hpp"
+#include "profiler.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define CLUSTERS_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::duration<double, std::milli>;
+
+namespace {
+
+// Below this many lights a frame's binning is cheaper than waking the pool
+constexpr size_t PARALLEL_MIN_LIGHTS = 64;
+
+#ifdef CLUSTERS_USE_SSE
+// Per-lane distance from p to [lo, hi], zero inside
+__m128 axis_distance(__m128 p, float lo, float hi) {
+    return _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(lo), p), _mm_sub_ps(p, _mm_set1_ps(hi))), _mm_setzero_ps());
+}
+#endif
+
+// Lane bits of the four spheres starting at the given pointers that touch the box: the squared distance from the
+// center to the box is at most the squared radius
+int touch_mask(const float *x, const float *y, const float *z, const float *radius_sq, const AABB &box) {
+#ifdef CLUSTERS_USE_SSE
+    const __m128 dx = axis_distance(_mm_loadu_ps(x), box.min.x, box.max.x);
+    const __m128 dy = axis_distance(_mm_loadu_ps(y), box.min.y, box.max.y);
+    const __m128 dz = axis_distance(_mm_loadu_ps(z), box.min.z, box.max.z);
+    const __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+    return _mm_movemask_ps(_mm_cmple_ps(d2, _mm_loadu_ps(radius_sq)));
+#else
+    int mask = 0;
+    for (int i = 0; i < 4; i++) {
+        const float dx = std::max({box.min.x - x[i], x[i] - box.max.x, 0.0f});
+        const float dy = std::max({box.min.y - y[i], y[i] - box.max.y, 0.0f});
+        const float dz = std::max({box.min.z - z[i], z[i] - box.max.z, 0.0f});
+        if (dx * dx + dy * dy + dz * dz <= radius_sq[i]) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+} // namespace
+
+ClusterLight ClusterLight::point(glm::vec3 position, float radius, glm::vec3 color) {
+    ClusterLight light;
+    light.position = position;
+    light.radius = radius;
+    light.color = color;
+    return light;
+}
+
+ClusterLight ClusterLight::spot(glm::vec3 position, glm::vec3 direction, float radius, glm::vec3 color,
+                                float inner_degrees, float outer_degrees) {
+    ClusterLight light = point(position, radius, color);
+    light.direction = glm::normalize(direction);
+    light.cos_inner = std::cos(glm::radians(inner_degrees));
+    light.cos_outer = std::cos(glm::radians(outer_degrees));
+    return light;
+}
+
+void LightBinner::Spheres::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    radius_sq.clear();
+    id.clear();
+}
+
+void LightBinner::Spheres::push(float px, float py, float pz, float r2, uint32_t light) {
+    x.push_back(px);
+    y.push_back(py);
+    z.push_back(pz);
+    radius_sq.push_back(r2);
+    id.push_back(light);
+}
+
+void LightBinner::Spheres::pad() {
+    // Infinitely far from every box with radius 0, so the padding lanes never pass
+    const float far = std::numeric_limits<float>::max();
+    while (id.size() % 4 != 0) {
+        push(far, far, far, 0.0f, ~0u);
+    }
+}
+
+void LightBinner::Spheres::filter(const Spheres &from, const AABB &box) {
+    clear();
+    for (size_t i = 0; i < from.id.size(); i += 4) {
+        int mask = touch_mask(&from.x[i], &from.y[i], &from.z[i], &from.radius_sq[i], box);
+        for (; mask != 0; mask &= mask - 1) {
+            const size_t j = i + std::countr_zero(static_cast<unsigned int>(mask));
+            push(from.x[j], from.y[j], from.z[j], from.radius_sq[j], from.id[j]);
+        }
+    }
+    pad();
+}
+
+// Per-task scratch and output, reused across frames
+struct LightBinner::Slice {
+    // Lights touching the slice, then those of them touching the current row of tiles
+    Spheres candidates;
+    Spheres row;
+    // Light count of each of the slice's clusters (tiles_x * tiles_y, x fastest), and the lights themselves
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> indices;
+};
+
+LightBinner::LightBinner(ClusterGrid grid) : m_grid(grid) {
+    m_slices.resize(m_grid.slices);
+    m_ranges.assign(2 * m_grid.count(), 0);
+}
+
+LightBinner::~LightBinner() = default;
+
+void LightBinner::bin(std::span<const ClusterLight> lights, const glm::mat4 &view, const glm::mat4 &projection,
+                      float near_plane, float far_plane, ThreadPool *pool) {
+    PROFILE_ZONE("LightBinner::bin");
+    const ClusterGrid &grid = m_grid;
+
+    // For a perspective projection x_ndc = (P[0][0] * x + P[2][0] * z) / -z, so x / -z is linear in x_ndc (same for y)
+    m_slopes_x.resize(grid.tiles_x + 1);
+    for (unsigned int i = 0; i <= grid.tiles_x; i++) {
+        const float ndc = -1.0f + 2.0f * i / grid.tiles_x;
+        m_slopes_x[i] = (ndc + projection[2][0]) / projection[0][0];
+    }
+    m_slopes_y.resize(grid.tiles_y + 1);
+    for (unsigned int i = 0; i <= grid.tiles_y; i++) {
+        const float ndc = -1.0f + 2.0f * i / grid.tiles_y;
+        m_slopes_y[i] = (ndc + projection[2][1]) / projection[1][1];
+    }
+
+    m_slice_scale = grid.slices / std::log(far_plane / near_plane);
+    m_slice_bias = -std::log(near_plane) * m_slice_scale;
+    m_depths.resize(grid.slices + 1);
+    for (unsigned int i = 0; i <= grid.slices; i++) {
+        m_depths[i] = near_plane * std::pow(far_plane / near_plane, static_cast<float>(i) / grid.slices);
+    }
+
+    m_lights.clear();
+    for (size_t i = 0; i < lights.size(); i++) {
+        const glm::vec4 center = view * glm::vec4(lights[i].position, 1.0f);
+        m_lights.push(center.x, center.y, center.z, lights[i].radius * lights[i].radius, static_cast<uint32_t>(i));
+    }
+    m_lights.pad();
+
+    if (pool && lights.size() >= PARALLEL_MIN_LIGHTS) {
+        pool->run_batches(grid.slices, [this](size_t slice) { bin_slice(static_cast<unsigned int>(slice)); });
+    } else {
+        for (unsigned int slice = 0; slice < grid.slices; slice++) {
+            bin_slice(slice);
+        }
+    }
+
+    // Concatenate the slices in cluster order
+    m_stats = {};
+    m_stats.lights = lights.size();
+    m_indices.clear();
+    const unsigned int tiles = grid.tiles_x * grid.tiles_y;
+    for (unsigned int slice = 0; slice < grid.slices; slice++) {
+        const Slice &bins = m_slices[slice];
+        size_t read = 0;
+        for (unsigned int tile = 0; tile < tiles; tile++) {
+            const uint32_t count = bins.counts[tile];
+            const size_t offset = m_indices.size();
+            const uint32_t kept = std::min<size_t>(count, max_references - offset);
+            m_indices.insert(m_indices.end(), bins.indices.begin() + read, bins.indices.begin() + read + kept);
+            read += count;
+
+            const unsigned int cluster = slice * tiles + tile;
+            m_ranges[2 * cluster] = offset;
+            m_ranges[2 * cluster + 1] = kept;
+            m_stats.max_per_cluster = std::max(m_stats.max_per_cluster, kept);
+            m_stats.dropped += count - kept;
+        }
+    }
+    m_stats.references = m_indices.size();
+}
+
+void LightBinner::bin_slice(unsigned int slice) {
+    const ClusterGrid &grid = m_grid;
+    Slice &bins = m_slices[slice];
+    bins.counts.assign(grid.tiles_x * grid.tiles_y, 0);
+    bins.indices.clear();
+
+    bins.candidates.filter(m_lights, tile_bounds(0, grid.tiles_x, 0, grid.tiles_y, slice));
+    if (bins.candidates.id.empty()) {
+        return;
+    }
+
+    for (unsigned int y = 0; y < grid.tiles_y; y++) {
+        Spheres &row = bins.row;
+        row.filter(bins.candidates, tile_bounds(0, grid.tiles_x, y, y + 1, slice));
+
+        for (unsigned int x = 0; x < grid.tiles_x && !row.id.empty(); x++) {
+            const AABB box = cluster_bounds(x, y, slice);
+            uint32_t count = 0;
+            for (size_t i = 0; i < row.id.size(); i += 4) {
+                int mask = touch_mask(&row.x[i], &row.y[i], &row.z[i], &row.radius_sq[i], box);
+                for (; mask != 0; mask &= mask - 1) {
+                    bins.indices.push_back(row.id[i + std::countr_zero(static_cast<unsigned int>(mask))]);
+                    count++;
+                }
+            }
+            bins.counts[y * grid.tiles_x + x] = count;
+        }
+    }
+}
+
+AABB LightBinner::cluster_bounds(unsigned int x, unsigned int y, unsigned int slice) const {
+    return tile_bounds(x, x + 1, y, y + 1, slice);
+}
+
+AABB LightBinner::tile_bounds(unsigned int x_begin, unsigned int x_end, unsigned int y_begin, unsigned int y_end,
+                              unsigned int slice) const {
+    const float near_depth = m_depths[slice], far_depth = m_depths[slice + 1];
+
+    // A tile edge leans out or in depending on its side of the view axis; take whichever depth reaches further
+    AABB box;
+    box.min.x = std::min(m_slopes_x[x_begin] * near_depth, m_slopes_x[x_begin] * far_depth);
+    box.max.x = std::max(m_slopes_x[x_end] * near_depth, m_slopes_x[x_end] * far_depth);
+    box.min.y = std::min(m_slopes_y[y_begin] * near_depth, m_slopes_y[y_begin] * far_depth);
+    box.max.y = std::max(m_slopes_y[y_end] * near_depth, m_slopes_y[y_end] * far_depth);
+    box.min.z = -far_depth;
+    box.max.z = -near_depth;
+    return box;
+}
+
+ClusteredLights::ClusteredLights(ClusterGrid grid) : m_binner(grid), m_ubo(CLUSTERS_BLOCK_BINDING) {
+    create(m_lights, GL_RGBA32F);
+    create(m_ranges, GL_RG32UI);
+    create(m_indices, GL_R32UI);
+
+    // GL 3.3 guarantees at least 65536 texels
+    int max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    max_texels = std::max(max_texels, 65536);
+    m_max_lights = max_texels / 3;
+    m_binner.max_references = std::min<size_t>(m_binner.max_references, max_texels);
+}
+
+ClusteredLights::~ClusteredLights() {
+    for (BufferTexture *target : {&m_lights, &m_ranges, &m_indices}) {
+        glDeleteTextures(1, &target->texture);
+        glDeleteBuffers(1, &target->buffer);
+    }
+}
+
+void ClusteredLights::create(BufferTexture &target, GLenum format) {
+    // A few bytes of storage up front, so the textures are complete before the first update
+    target.capacity = 16;
+    glGenBuffers(1, &target.buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    glBufferData(GL_TEXTURE_BUFFER, target.capacity, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &target.texture);
+    glBindTexture(GL_TEXTURE_BUFFER, target.texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, target.buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLights::upload(BufferTexture &target, const void *data, size_t bytes) {
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    if (bytes > target.capacity) {
+        target.capacity = std::max(bytes, target.capacity * 2);
+    }
+    // Orphan last frame's storage so draws still reading it don't stall the upload
+    glBufferData(GL_TEXTURE_BUFFER, target.capacity, nullptr, GL_STREAM_DRAW);
+    if (bytes > 0) {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLights::update(std::span<const ClusterLight> lights, const glm::mat4 &view,
+                             const glm::mat4 &projection, float near_plane, float far_plane, glm::ivec2 viewport) {
+    PROFILE_ZONE("ClusteredLights::update");
+    lights = lights.first(std::min(lights.size(), m_max_lights));
+    // Scenes without clustered lights: the buffers already hold empty lists from the last update
+    if (lights.empty() && m_uploaded && m_stats.lights == 0) {
+        m_stats.bin_ms = m_stats.upload_ms = 0.0;
+        return;
+    }
+
+    auto start = Clock::now();
+    m_binner.bin(lights, view, projection, near_plane, far_plane, &ThreadPool::shared());
+    m_stats = m_binner.stats();
+    m_stats.bin_ms = Millis(Clock::now() - start).count();
+
+    start = Clock::now();
+    m_light_texels.resize(3 * lights.size());
+    for (size_t i = 0; i < lights.size(); i++) {
+        const ClusterLight &light = lights[i];
+        m_light_texels[3 * i] = glm::vec4(light.position, light.radius);
+        m_light_texels[3 * i + 1] = glm::vec4(light.color, light.cos_inner);
+        m_light_texels[3 * i + 2] = glm::vec4(light.direction, light.cos_outer);
+    }
+    upload(m_lights, m_light_texels.data(), m_light_texels.size() * sizeof(glm::vec4));
+    upload(m_ranges, m_binner.ranges().data(), m_binner.ranges().size() * sizeof(uint32_t));
+    upload(m_indices, m_binner.indices().data(), m_binner.indices().size() * sizeof(uint32_t));
+
+    const ClusterGrid &grid = m_binner.grid();
+    ClusterUniforms uniforms{};
+    uniforms.grid = glm::uvec4(grid.tiles_x, grid.tiles_y, grid.slices, static_cast<unsigned int>(lights.size()));
+    uniforms.params = glm::vec4(static_cast<float>(viewport.x) / grid.tiles_x,
+                                static_cast<float>(viewport.y) / grid.tiles_y, m_binner.slice_scale(),
+                                m_binner.slice_bias());
+    m_ubo.update(uniforms);
+    m_uploaded = true;
+    m_stats.upload_ms = Millis(Clock::now() - start).count();
+}
+
+void ClusteredLights::bind() const {
+    const struct {
+        unsigned int unit;
+        unsigned int texture;
+    } bindings[] = {
+        {CLUSTER_LIGHTS_UNIT, m_lights.texture},
+        {CLUSTER_RANGES_UNIT, m_ranges.texture},
+        {CLUSTER_INDICES_UNIT, m_indices.texture},
+    };
+
+    for (const auto &binding : bindings) {
+        glActiveTexture(GL_TEXTURE0 + binding.unit);
+        glBindTexture(GL_TEXTURE_BUFFER, binding.texture);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,192 @@
+#ifndef LIGHT_CLUSTERS_HPP
+#define LIGHT_CLUSTERS_HPP
+
+#include "bounds.hpp"
+#include "uniform_blocks.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class ThreadPool;
+
+// Clustered forward shading: the view frustum is cut into a grid of tiles x tiles x depth slices, every frame each
+// light is assigned to the clusters its sphere of influence touches, and a fragment only evaluates the lights listed
+// for the cluster it falls in. Tiles split the screen evenly; slices are exponential in view depth so clusters stay
+// roughly cubic from the near plane to the far one:
+//
+//   slice(depth) = floor(log(depth) * scale + bias),  scale = slices / log(far / near),  bias = -log(near) * scale
+//
+// The lists reach the shaders through three buffer textures (include/clusters.glsl), bound to fixed texture units
+// the same way the uniform blocks sit at fixed binding points.
+
+// A light evaluated through the clusters. Nothing is lit beyond `radius`: the attenuation is windowed to reach zero
+// there, which is what lets the binning leave the light out of every cluster its sphere misses.
+struct ClusterLight {
+    glm::vec3 position = glm::vec3(0.0f);
+    float radius = 1.0f;
+    // Intensity included
+    glm::vec3 color = glm::vec3(1.0f);
+    // Spot lights: the cone axis and the cosines of the half angles where the falloff starts and ends. The defaults
+    // describe a cone wider than the sphere, so point lights pay for the same shader path without being cut.
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+    float cos_inner = -1.0f;
+    float cos_outer = -2.0f;
+
+    static ClusterLight point(glm::vec3 position, float radius, glm::vec3 color);
+    static ClusterLight spot(glm::vec3 position, glm::vec3 direction, float radius, glm::vec3 color,
+                             float inner_degrees, float outer_degrees);
+};
+
+struct ClusterGrid {
+    unsigned int tiles_x = 16;
+    unsigned int tiles_y = 9;
+    unsigned int slices = 24;
+
+    unsigned int count() const { return tiles_x * tiles_y * slices; }
+    // Clusters are numbered x fastest, then y, then slice, as in clusterIndex() in include/clusters.glsl
+    unsigned int index(unsigned int x, unsigned int y, unsigned int slice) const {
+        return (slice * tiles_y + y) * tiles_x + x;
+    }
+};
+
+struct ClusterStats {
+    unsigned int lights = 0;
+    // Light references written to the index list, one per (light, cluster) pair
+    unsigned int references = 0;
+    unsigned int max_per_cluster = 0;
+    // References past the index list capacity; those lights are missing from the clusters that dropped them
+    unsigned int dropped = 0;
+    // CPU time spent binning and uploading
+    double bin_ms = 0.0;
+    double upload_ms = 0.0;
+
+    ClusterStats &operator+=(const ClusterStats &o) {
+        lights += o.lights;
+        references += o.references;
+        max_per_cluster = std::max(max_per_cluster, o.max_per_cluster);
+        dropped += o.dropped;
+        bin_ms += o.bin_ms;
+        upload_ms += o.upload_ms;
+        return *this;
+    }
+};
+
+// CPU half of clustered shading; no GL. bin() transforms the lights to view space and tests their spheres against
+// the cluster bounds, one depth slice per task on the thread pool. Each slice first keeps the lights touching the
+// whole slice, then those touching each row of tiles, and only those are tested against the row's clusters, four
+// lights at a time with SSE. Spot lights are binned by their sphere, not their cone.
+class LightBinner {
+  public:
+    // Total index list length; references past it are dropped (and counted in ClusterStats::dropped)
+    size_t max_references = 1u << 20;
+
+    explicit LightBinner(ClusterGrid grid = {});
+    ~LightBinner();
+
+    LightBinner(const LightBinner &) = delete;
+    LightBinner &operator=(const LightBinner &) = delete;
+
+    const ClusterGrid &grid() const { return m_grid; }
+
+    // `projection` must be a perspective projection (glm::perspective or glm::frustum) with the given planes.
+    // Without a pool, or with few lights, everything runs on the calling thread.
+    void bin(std::span<const ClusterLight> lights, const glm::mat4 &view, const glm::mat4 &projection,
+             float near_plane, float far_plane, ThreadPool *pool);
+
+    // Per cluster: offset into indices() and light count
+    const std::vector<uint32_t> &ranges() const { return m_ranges; }
+    const std::vector<uint32_t> &indices() const { return m_indices; }
+    // Everything but the timings, for the last bin()
+    const ClusterStats &stats() const { return m_stats; }
+
+    // View-space bounds of a cluster for the last bin()
+    AABB cluster_bounds(unsigned int x, unsigned int y, unsigned int slice) const;
+    // Coefficients of slice(depth) above
+    float slice_scale() const { return m_slice_scale; }
+    float slice_bias() const { return m_slice_bias; }
+
+  private:
+    // Spheres in view space as structure of arrays, padded to a multiple of 4 with spheres that touch nothing
+    struct Spheres {
+        std::vector<float> x, y, z, radius_sq;
+        std::vector<uint32_t> id;
+
+        void clear();
+        void push(float px, float py, float pz, float radius_sq, uint32_t light);
+        void pad();
+        // Keeps the spheres of `from` that touch `box`, padded
+        void filter(const Spheres &from, const AABB &box);
+    };
+    struct Slice;
+
+    ClusterGrid m_grid;
+    // Tile edges as view-space x/y over depth (x / -z), tiles_x + 1 and tiles_y + 1 of them
+    std::vector<float> m_slopes_x, m_slopes_y;
+    // Slice boundaries as view depth, slices + 1 of them
+    std::vector<float> m_depths;
+    float m_slice_scale = 0.0f, m_slice_bias = 0.0f;
+
+    Spheres m_lights;
+    std::vector<Slice> m_slices;
+    std::vector<uint32_t> m_ranges;
+    std::vector<uint32_t> m_indices;
+    ClusterStats m_stats;
+
+    void bin_slice(unsigned int slice);
+    // Bounds of tiles [x_begin, x_end) x [y_begin, y_end) of a slice
+    AABB tile_bounds(unsigned int x_begin, unsigned int x_end, unsigned int y_begin, unsigned int y_end,
+                     unsigned int slice) const;
+};
+
+// GL half: bins through a LightBinner and streams the result into the Clusters block and three buffer textures
+//   clusterLights   RGBA32F  3 texels per light: position, radius | color, cos_inner | direction, cos_outer
+//   clusterRanges   RG32UI   per cluster: first index, count
+//   clusterIndices  R32UI    light indices
+// Programs find them at CLUSTER_*_UNIT (see bind_uniform_blocks).
+class ClusteredLights {
+  public:
+    explicit ClusteredLights(ClusterGrid grid = {});
+    ~ClusteredLights();
+
+    ClusteredLights(const ClusteredLights &) = delete;
+    ClusteredLights &operator=(const ClusteredLights &) = delete;
+
+    // Lights past what the light buffer texture holds are ignored. `viewport` is the size of the target being drawn,
+    // whose origin must be at the bottom left of the window (gl_FragCoord picks the tile).
+    void update(std::span<const ClusterLight> lights, const glm::mat4 &view, const glm::mat4 &projection,
+                float near_plane, float far_plane, glm::ivec2 viewport);
+
+    // Binds the buffer textures to their units. Changes the active texture unit: invalidate a GlStateCache after.
+    void bind() const;
+
+    // For the last update()
+    const ClusterStats &stats() const { return m_stats; }
+    const LightBinner &binner() const { return m_binner; }
+
+  private:
+    struct BufferTexture {
+        unsigned int buffer = 0;
+        unsigned int texture = 0;
+        size_t capacity = 0;
+    };
+
+    LightBinner m_binner;
+    UniformBuffer<ClusterUniforms> m_ubo;
+    BufferTexture m_lights, m_ranges, m_indices;
+    std::vector<glm::vec4> m_light_texels;
+    // GL_MAX_TEXTURE_BUFFER_SIZE / 3
+    size_t m_max_lights;
+    bool m_uploaded = false;
+    ClusterStats m_stats;
+
+    static void create(BufferTexture &target, GLenum format);
+    static void upload(BufferTexture &target, const void *data, size_t bytes);
+};
+
+#endif
@@ -0,0 +1,47 @@
+#include "lod.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+unsigned int lod_for_size(float screen_size, unsigned int lod_count) {
+    unsigned int lod = 0;
+    while (lod + 1 < lod_count && screen_size < LOD_SCREEN_SIZES[lod + 1]) {
+        lod++;
+    }
+    return lod;
+}
+
+} // namespace
+
+void LodSelector::set_camera(const Camera &camera) {
+    camera_position = camera.m_position;
+    projection_scale = 1.0f / std::tan(glm::radians(camera.m_zoom) * 0.5f);
+}
+
+float LodSelector::screen_size(glm::vec3 center, float radius) const {
+    const float distance = glm::length(center - camera_position);
+    // Inside the sphere counts as filling the screen
+    if (distance <= radius) {
+        return 1.0f;
+    }
+    return radius * projection_scale / distance;
+}
+
+unsigned int LodSelector::select(float screen_size, unsigned int lod_count, unsigned int previous) const {
+    if (!enabled || lod_count <= 1) {
+        return 0;
+    }
+
+    const float size = screen_size * bias;
+    const unsigned int target = lod_for_size(size, lod_count);
+    if (previous >= lod_count || target == previous) {
+        return target;
+    }
+
+    // Going coarser, the object has to look smaller than the threshold by the hysteresis margin; going finer, larger
+    if (target > previous) {
+        return std::max(previous, lod_for_size(size * (1.0f + hysteresis), lod_count));
+    }
+    return std::min(previous, lod_for_size(size * (1.0f - hysteresis), lod_count));
+}
@@ -0,0 +1,68 @@
+#ifndef LOD_HPP
+#define LOD_HPP
+
+#include "camera.hpp"
+#include "model_data.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Runtime LOD selection by projected size.
+//
+// An object's screen size is its bounding sphere's projected radius as a fraction of half the viewport height,
+// radius * cot(fov_y / 2) / distance, so 1.0 fills the view vertically. LOD n is picked once the screen size drops
+// below LOD_SCREEN_SIZES[n]. Leaving the current LOD takes crossing a threshold by the hysteresis fraction, so an
+// object hovering at a boundary doesn't flicker between two LODs.
+
+// Entry 0 is unused: LOD 0 covers everything above LOD_SCREEN_SIZES[1]
+constexpr float LOD_SCREEN_SIZES[MAX_MESH_LODS] = {0.0f, 0.25f, 0.125f, 0.0625f};
+constexpr float DEFAULT_LOD_HYSTERESIS = 0.15f;
+// No previous pick, e.g. the first frame an object is drawn
+constexpr uint8_t LOD_NONE = 0xff;
+
+struct LodStats {
+    // Meshes drawn at each LOD
+    uint64_t meshes[MAX_MESH_LODS] = {};
+    // Triangles the LODs saved against drawing every mesh at LOD 0
+    uint64_t triangles_saved = 0;
+    // Meshes whose LOD changed since their previous frame
+    uint64_t switches = 0;
+
+    LodStats &operator+=(const LodStats &o) {
+        for (unsigned int i = 0; i < MAX_MESH_LODS; i++) {
+            meshes[i] += o.meshes[i];
+        }
+        triangles_saved += o.triangles_saved;
+        switches += o.switches;
+        return *this;
+    }
+};
+
+struct LodSelector {
+    glm::vec3 camera_position = glm::vec3(0.0f);
+    // cot(fov_y / 2)
+    float projection_scale = 1.0f;
+    float hysteresis = DEFAULT_LOD_HYSTERESIS;
+    // Multiplies every screen size; below 1 switches to coarser LODs sooner
+    float bias = 1.0f;
+    // When false, everything draws at LOD 0
+    bool enabled = true;
+
+    // Takes the position and the vertical field of view (m_zoom, in degrees) from the camera
+    void set_camera(const Camera &camera);
+
+    float screen_size(glm::vec3 center, float radius) const;
+
+    // `previous` is the LOD picked for the same object last frame, or LOD_NONE
+    unsigned int select(float screen_size, unsigned int lod_count, unsigned int previous = LOD_NONE) const;
+};
+
+// Last LOD picked for each mesh of one drawn object, which is what the hysteresis compares against. Keep one per model
+// instance; Model::submit sizes it.
+struct LodState {
+    std::vector<uint8_t> lods;
+};
+
+#endif
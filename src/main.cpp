@@ -9,8 +9,8 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
-#define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
 #include <glm/glm.hpp>
@@ -21,7 +21,14 @@
 #include <cstdlib>
 
 #include "camera.hpp"
-#include "model.hpp"
+#include "dynamic_resolution.hpp"
+#include "frame_graph.hpp"
+#include "gpu_timer.hpp"
+#include "job_system.hpp"
+#include "post_process.hpp"
+#include "profiler.hpp"
+#include "program_cache.hpp"
+#include "scene.hpp"
 #include "shader.hpp"
 
 void framebuffer_size_callback(GLFWwindow *, int, int);
@@ -34,7 +41,15 @@ Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 #define SCR_WIDTH 800
 #define SCR_HEIGHT 600
 
-int main(void) {
+// Number keys toggling the standard post effects
+struct PostKey {
+    int key;
+    const char *pass;
+};
+const PostKey POST_KEYS[] = {{GLFW_KEY_1, "bloom"},  {GLFW_KEY_2, "blur"},    {GLFW_KEY_3, "grayscale"},
+                             {GLFW_KEY_4, "invert"}, {GLFW_KEY_5, "sharpen"}, {GLFW_KEY_6, "edge"}};
+
+int main(int argc, char **argv) {
     if (!glfwInit()) {
         const char *msg = nullptr;
         glfwGetError(&msg);
@@ -44,7 +59,6 @@ int main(void) {
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
@@ -65,26 +79,16 @@ int main(void) {
     }
     {
 
-        ShaderBuilder sb, sb_framebuffer;
-        try {
-            sb._m_vertex_src = readFileToString("res/shaders/vertex_depth.glsl");
-            sb._m_fragment_src = readFileToString("res/shaders/fragment_depth.glsl");
-            sb_framebuffer._m_vertex_src = readFileToString("res/shaders/vertex_framebuffer.glsl");
-            sb_framebuffer._m_fragment_src = readFileToString("res/shaders/fragment_framebuffer.glsl");
-
-        } catch (const std::runtime_error &e) {
-            std::cerr << e.what();
-            return EXIT_FAILURE;
-        }
-
-        std::unique_ptr<Shader> shader, shader_framebuffer;
+        // post-processing: the framebuffer chapter's edge detection to start with, the number keys toggle the rest
+        std::unique_ptr<PostChain> post;
         try {
-            shader = sb.build();
-            shader_framebuffer = sb_framebuffer.build();
+            post = std::make_unique<PostChain>();
+            add_standard_passes(*post);
         } catch (const std::runtime_error &e) {
             std::cerr << e.what();
             return EXIT_FAILURE;
         }
+        post->set_enabled("edge", true);
 
         glEnable(GL_DEPTH_TEST);
 
@@ -96,140 +100,51 @@ int main(void) {
 
         stbi_set_flip_vertically_on_load(true);
 
-        // Model model("res/models/backpack/backpack.obj");
-
-        // set up vertex data (and buffer(s)) and configure vertex attributes
-        // ------------------------------------------------------------------
-        float cubeVertices[] = {
-            // Back face
-            -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, // Bottom-left
-            0.5f, 0.5f, -0.5f, 1.0f, 1.0f,   // top-right
-            0.5f, -0.5f, -0.5f, 1.0f, 0.0f,  // bottom-right
-            0.5f, 0.5f, -0.5f, 1.0f, 1.0f,   // top-right
-            -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, // bottom-left
-            -0.5f, 0.5f, -0.5f, 0.0f, 1.0f,  // top-left
-            // Front face
-            -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, // bottom-left
-            0.5f, -0.5f, 0.5f, 1.0f, 0.0f,  // bottom-right
-            0.5f, 0.5f, 0.5f, 1.0f, 1.0f,   // top-right
-            0.5f, 0.5f, 0.5f, 1.0f, 1.0f,   // top-right
-            -0.5f, 0.5f, 0.5f, 0.0f, 1.0f,  // top-left
-            -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, // bottom-left
-            // Left face
-            -0.5f, 0.5f, 0.5f, 1.0f, 0.0f,   // top-right
-            -0.5f, 0.5f, -0.5f, 1.0f, 1.0f,  // top-left
-            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, // bottom-left
-            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, // bottom-left
-            -0.5f, -0.5f, 0.5f, 0.0f, 0.0f,  // bottom-right
-            -0.5f, 0.5f, 0.5f, 1.0f, 0.0f,   // top-right
-                                             // Right face
-            0.5f, 0.5f, 0.5f, 1.0f, 0.0f,    // top-left
-            0.5f, -0.5f, -0.5f, 0.0f, 1.0f,  // bottom-right
-            0.5f, 0.5f, -0.5f, 1.0f, 1.0f,   // top-right
-            0.5f, -0.5f, -0.5f, 0.0f, 1.0f,  // bottom-right
-            0.5f, 0.5f, 0.5f, 1.0f, 0.0f,    // top-left
-            0.5f, -0.5f, 0.5f, 0.0f, 0.0f,   // bottom-left
-            // Bottom face
-            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, // top-right
-            0.5f, -0.5f, -0.5f, 1.0f, 1.0f,  // top-left
-            0.5f, -0.5f, 0.5f, 1.0f, 0.0f,   // bottom-left
-            0.5f, -0.5f, 0.5f, 1.0f, 0.0f,   // bottom-left
-            -0.5f, -0.5f, 0.5f, 0.0f, 0.0f,  // bottom-right
-            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, // top-right
-            // Top face
-            -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, // top-left
-            0.5f, 0.5f, 0.5f, 1.0f, 0.0f,   // bottom-right
-            0.5f, 0.5f, -0.5f, 1.0f, 1.0f,  // top-right
-            0.5f, 0.5f, 0.5f, 1.0f, 0.0f,   // bottom-right
-            -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, // top-left
-            -0.5f, 0.5f, 0.5f, 0.0f, 0.0f   // bottom-left
-        };
-        float planeVertices[] = {
-            // positions          // texture Coords (note we set these higher
-            // than 1 (together with GL_REPEAT as texture wrapping mode). this
-            // will cause the floor texture to repeat)
-            5.0f, -0.5f, 5.0f, 2.0f, 0.0f, -5.0f, -0.5f, 5.0f,  0.0f, 0.0f, -5.0f, -0.5f, -5.0f, 0.0f, 2.0f,
-
-            5.0f, -0.5f, 5.0f, 2.0f, 0.0f, -5.0f, -0.5f, -5.0f, 0.0f, 2.0f, 5.0f,  -0.5f, -5.0f, 2.0f, 2.0f};
-        float quadVertices[] = {
-            // vertex attributes for a quad that fills the entire screen in Normalized Device Coordinates.
-            // positions   // texCoords
-            -1.0f, 1.0f, 0.0f, 1.0f, -1.0f, -1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 1.0f, 0.0f,
-
-            -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,  -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,  1.0f, 1.0f};
-        // cube VAO
-        unsigned int cubeVAO, cubeVBO;
-        glGenVertexArrays(1, &cubeVAO);
-        glGenBuffers(1, &cubeVBO);
-        glBindVertexArray(cubeVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), &cubeVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
-        glBindVertexArray(0);
-        // plane VAO
-        unsigned int planeVAO, planeVBO;
-        glGenVertexArrays(1, &planeVAO);
-        glGenBuffers(1, &planeVBO);
-        glBindVertexArray(planeVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), &planeVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
-        glBindVertexArray(0);
-        // screen quad VAO
-        unsigned int quadVAO, quadVBO;
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
-
-        // framebuffer configuration
-        // -------------------------
-        unsigned int framebuffer;
-        glGenFramebuffers(1, &framebuffer);
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-        // create a color attachment texture
-        unsigned int textureColorbuffer;
-        glGenTextures(1, &textureColorbuffer);
-        glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorbuffer, 0);
-        // create a renderbuffer object for depth and stencil attachment (we won't be sampling these)
-        unsigned int rbo;
-        glGenRenderbuffers(1, &rbo);
-        glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH,
-                              SCR_HEIGHT); // use a single renderbuffer object for both a depth AND stencil buffer.
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
-                                  rbo); // now actually attach it
-        // now that we actually created the framebuffer and added all attachments we want to check if it is actually
-        // complete now
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::printf("ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n");
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // load textures
-        // -------------
-        Texture cubeTexture{"res/textures/container.jpg", ""};
-        Texture floorTexture{"res/textures/metal.png", ""};
-
-        // shader configuration
-        // --------------------
-        shader->use();
-        shader->set_i("texture1", 0);
-        shader_framebuffer->set_i("screenTexture", 0);
+        // the scene to show, e.g. `LearnOpenGL backpack`; see scene_names()
+        std::unique_ptr<Scene> scene;
+        try {
+            scene = make_scene(argc > 1 ? argv[1] : scene_names().front());
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << "\n";
+            return EXIT_FAILURE;
+        }
+
+        const ProgramCacheStats &program_stats = ProgramCache::shared().stats();
+        std::printf("shaders: %u from cache in %.1f ms, %u compiled in %.1f ms (%u cached binaries rejected)\n",
+                    program_stats.hits, program_stats.load_ms, program_stats.compiled, program_stats.compile_ms,
+                    program_stats.rejected);
+
+        // the frame is declared as a graph of passes every frame; the graph culls and orders them, and shares textures
+        // between passes that don't need them at the same time
+        FrameGraph graph;
+        FrameGraphStats graph_stats;
+
+        // the scene is drawn into a texture for the post passes to read, at a resolution the controller picks to hold
+        // 60 fps of GPU time; the post chain upscales it to the window. Hold R to stay at full resolution.
+        DynamicResolution resolution;
+        GpuTimer frame_timer;
+        std::vector<GpuTiming> frame_timings;
+        double frame_gpu_ms = 0.0;
+        unsigned int frame_gpu_samples = 0;
+
+        // scenes with many objects record them on the job system's workers; only this thread issues GL calls
+        JobSystem jobs;
+        SceneRenderer renderer;
+        renderer.jobs = &jobs;
+        RenderStats render_stats;
+        RecordStats record_stats;
+        CullStats cull_stats;
+        LodStats lod_stats;
+        ClusterStats cluster_stats;
+        bool path_key_down = false;
+        bool transparency_key_down = false;
+        std::vector<PostTiming> post_timings;
+        std::map<std::string, double> post_ms;
+        bool post_keys_down[std::size(POST_KEYS)] = {};
+        uint64_t frame_index = 0;
+
+        float last_stats_report = 0.0f;
+        unsigned int frames_since_report = 0;
 
         glfwSetWindowSize(window, 800, 600);
         glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
@@ -240,7 +155,13 @@ int main(void) {
             last_frame = current_frame;
 
             int width, height;
-            glfwGetWindowSize(window, &width, &height);
+            glfwGetFramebufferSize(window, &width, &height);
+            if (width == 0 || height == 0) {
+                // minimized
+                glfwWaitEvents();
+                continue;
+            }
+            const glm::ivec2 output_size(width, height);
 
             if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
                 glfwSetWindowShouldClose(window, GLFW_TRUE);
@@ -258,6 +179,34 @@ int main(void) {
             if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
                 camera.pan(PanMovement::LEFT, delta_time);
             }
+            // hold L to draw everything at full detail
+            renderer.lod_selector().enabled = glfwGetKey(window, GLFW_KEY_L) != GLFW_PRESS;
+            resolution.enabled = glfwGetKey(window, GLFW_KEY_R) != GLFW_PRESS;
+            // press G to switch between forward and deferred shading
+            const bool path_key = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS;
+            if (path_key && !path_key_down) {
+                renderer.path = renderer.path == RenderPath::FORWARD ? RenderPath::DEFERRED : RenderPath::FORWARD;
+                std::printf("render path: %s%s\n", render_path_name(renderer.path),
+                            scene->deferred_lighting() ? "" : " (this scene is always drawn forward)");
+            }
+            path_key_down = path_key;
+            // press T to switch between sorted and weighted blended transparency
+            const bool transparency_key = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+            if (transparency_key && !transparency_key_down) {
+                renderer.transparency = renderer.transparency == TransparencyMode::SORTED
+                                            ? TransparencyMode::WEIGHTED_BLENDED
+                                            : TransparencyMode::SORTED;
+                std::printf("transparency: %s\n", transparency_mode_name(renderer.transparency));
+            }
+            transparency_key_down = transparency_key;
+            for (size_t i = 0; i < std::size(POST_KEYS); i++) {
+                const bool down = glfwGetKey(window, POST_KEYS[i].key) == GLFW_PRESS;
+                if (down && !post_keys_down[i]) {
+                    post->toggle(POST_KEYS[i].pass);
+                    std::printf("post: %s %s\n", POST_KEYS[i].pass, post->enabled(POST_KEYS[i].pass) ? "on" : "off");
+                }
+                post_keys_down[i] = down;
+            }
             if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) {
                 camera.m_panning_speed = DEFAULT_PANNING_SPEED * 2.0;
             } else {
@@ -266,56 +215,133 @@ int main(void) {
 
                     // render
         // ------
-        // bind to framebuffer and draw scene as we normally would to color texture 
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-        glEnable(GL_DEPTH_TEST); // enable depth testing (is disabled for rendering screen-space quad)
-
-        // make sure we clear the framebuffer's content
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        shader->use();
-        glm::mat4 model = glm::mat4(1.0f);
-        glm::mat4 view = camera.get_view_matrix();
-        glm::mat4 projection = glm::perspective(glm::radians(camera.m_zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        shader->set_mat4("view", view);
-        shader->set_mat4("projection", projection);
-        // cubes
-        glBindVertexArray(cubeVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, cubeTexture.id);
-        model = glm::translate(model, glm::vec3(-1.0f, 0.0f, -1.0f));
-        shader->set_mat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(2.0f, 0.0f, 0.0f));
-        shader->set_mat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        // floor
-        glBindVertexArray(planeVAO);
-        glBindTexture(GL_TEXTURE_2D, floorTexture.id);
-        shader->set_mat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-
-        // now bind back to default framebuffer and draw a quad plane with the attached framebuffer color texture
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glDisable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
-        // clear all relevant buffers
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f); // set clear color to white (not really necessary actually, since we won't be able to see behind the quad anyways)
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        shader_framebuffer->use();
-        glBindVertexArray(quadVAO);
-        glBindTexture(GL_TEXTURE_2D, textureColorbuffer);	// use the color attachment texture as the texture of the quad plane
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
+        // the scene goes to a colour texture (and a depth buffer nothing reads after), then the enabled effects run
+        // over it and upscale it into the default framebuffer
+        const glm::ivec2 render_size = resolution.render_size(output_size);
+        const FrameResource backbuffer = graph.import_framebuffer("backbuffer", 0, output_size);
+        const FrameResource scene_color = graph.create("scene color", render_size, GL_RGBA8);
+        const FrameResource scene_depth = graph.create("scene depth", render_size, GL_DEPTH24_STENCIL8);
+        renderer.add_passes(graph, *scene, camera, (float)width / (float)height, scene_color, scene_depth,
+                            glm::vec4(0.1f, 0.1f, 0.1f, 1.0f));
+        post->add_passes(graph, scene_color, backbuffer, frame_index);
+
+        frame_timer.begin(frame_index);
+        try {
+            PROFILE_GPU_ZONE("frame graph");
+            graph.execute();
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << "\n";
+            return EXIT_FAILURE;
+        }
+        frame_timer.end();
+        graph_stats = graph.stats();
+        frame_index++;
+
+        frame_timer.collect(frame_timings);
+        for (const auto &timing : frame_timings) {
+            frame_gpu_ms += timing.ms;
+            frame_gpu_samples++;
+            if (resolution.update(timing.tag, timing.ms, frame_index)) {
+                const glm::ivec2 size = resolution.render_size(output_size);
+                std::printf("resolution: scale %.2f (%dx%d) after %.2f ms average GPU time, target %.2f ms\n",
+                            resolution.scale(), size.x, size.y, resolution.stats().change_ms, resolution.target_ms);
+            }
+        }
+        frame_timings.clear();
+        post->collect(post_timings);
+        for (const auto &timing : post_timings) {
+            post_ms[post->pass_name(timing.pass)] += timing.ms;
+        }
+        post_timings.clear();
+
+        render_stats += renderer.stats;
+        record_stats += renderer.record_stats;
+        cull_stats += renderer.cull_stats;
+        lod_stats += renderer.lod_stats;
+        cluster_stats += renderer.cluster_stats;
+
+        frames_since_report++;
+        if (current_frame - last_stats_report >= 1.0f) {
+            const UniformStats &stats = Shader::stats();
+            std::printf("uniforms/frame: %.1f glGetUniformLocation calls removed (%.1f by handle, %.1f by table), "
+                        "%.1f driver queries\n",
+                        (double)stats.lookups_removed() / frames_since_report,
+                        (double)stats.handle_sets / frames_since_report,
+                        (double)stats.table_lookups / frames_since_report,
+                        (double)stats.driver_queries / frames_since_report);
+            std::printf("render/frame: %.1f draw calls for %.1f objects, %.1f state changes, %.1f skipped binds, "
+                        "%.3f ms sorting\n",
+                        (double)render_stats.draw_calls / frames_since_report,
+                        (double)render_stats.instances / frames_since_report,
+                        (double)render_stats.state.state_changes() / frames_since_report,
+                        (double)render_stats.state.skipped_binds / frames_since_report,
+                        render_stats.sort_ms / frames_since_report);
+            if (record_stats.items > 0) {
+                std::printf("recording/frame: %.3f ms for %.0f items in %.1f ranges (%.1f stolen) on %u workers\n",
+                            record_stats.ms / frames_since_report, (double)record_stats.items / frames_since_report,
+                            (double)record_stats.ranges / frames_since_report,
+                            (double)record_stats.steals / frames_since_report, jobs.worker_count());
+            }
+            std::printf("culling/frame: %.1f visible, %.1f culled, %.3f ms\n",
+                        (double)cull_stats.visible / frames_since_report,
+                        (double)cull_stats.culled / frames_since_report, cull_stats.ms / frames_since_report);
+            std::printf("lod/frame: %.0f triangles (%.0f saved), meshes at lod 0-3: %.1f %.1f %.1f %.1f, "
+                        "%.1f switches\n",
+                        (double)render_stats.triangles / frames_since_report,
+                        (double)lod_stats.triangles_saved / frames_since_report,
+                        (double)lod_stats.meshes[0] / frames_since_report,
+                        (double)lod_stats.meshes[1] / frames_since_report,
+                        (double)lod_stats.meshes[2] / frames_since_report,
+                        (double)lod_stats.meshes[3] / frames_since_report,
+                        (double)lod_stats.switches / frames_since_report);
+            if (cluster_stats.lights > 0) {
+                std::printf("clusters/frame: %.0f lights, %.1f references (max %u per cluster, %.1f dropped), "
+                            "%.3f ms binning, %.3f ms upload\n",
+                            (double)cluster_stats.lights / frames_since_report,
+                            (double)cluster_stats.references / frames_since_report, cluster_stats.max_per_cluster,
+                            (double)cluster_stats.dropped / frames_since_report,
+                            cluster_stats.bin_ms / frames_since_report, cluster_stats.upload_ms / frames_since_report);
+            }
+            if (frame_gpu_samples > 0) {
+                const glm::ivec2 size = resolution.render_size(output_size);
+                std::printf("resolution/frame: scale %.2f (%dx%d of %dx%d), %.3f ms GPU (target %.2f ms)\n",
+                            resolution.scale(), size.x, size.y, width, height, frame_gpu_ms / frame_gpu_samples,
+                            resolution.target_ms);
+            }
+            std::printf("frame graph: %u passes (%u culled), %u transients in %u textures, %.1f MB peak transient "
+                        "memory (%.1f MB unaliased), %u attachments invalidated, %llu textures allocated so far\n",
+                        graph_stats.passes, graph_stats.culled, graph_stats.transients, graph_stats.textures,
+                        graph_stats.transient_bytes / (1024.0 * 1024.0),
+                        graph_stats.unaliased_bytes / (1024.0 * 1024.0), graph_stats.invalidated,
+                        (unsigned long long)graph_stats.allocations);
+            if (!post_ms.empty()) {
+                std::printf("post/frame:");
+                for (const auto &[name, ms] : post_ms) {
+                    std::printf(" %s %.3f ms", name.c_str(), ms / frames_since_report);
+                }
+                std::printf("\n");
+            }
+            render_stats = {};
+            record_stats = {};
+            cull_stats = {};
+            lod_stats = {};
+            cluster_stats = {};
+            post_ms.clear();
+            frame_gpu_ms = 0.0;
+            frame_gpu_samples = 0;
+            Shader::reset_stats();
+            last_stats_report = current_frame;
+            frames_since_report = 0;
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
         glfwPollEvents();
+        PROFILE_FRAME();
         }
+
+        PROFILE_WRITE_TRACE("profile.json");
     }
 
     glfwDestroyWindow(window);
@@ -1,100 +1,212 @@
 #include "mesh.hpp"
+#include "profiler.hpp"
 #include "shader.hpp"
+#include "texture_loader.hpp"
+#include <algorithm>
 #include <cstdio>
-#include <stb/stb_image.h>
 #include <stdexcept>
+#include <utility>
 
 Mesh::Mesh(const std::string &name, std::vector<Vertex> vertices, std::vector<unsigned int> indices,
-           std::vector<Texture> textures)
-    : vertices(vertices), indices(indices), textures(textures), name(name) {
-    setup_mesh();
+           std::vector<Texture> textures, VertexQuantization quantization, AABB bounds, std::vector<MeshLod> lods)
+    : vertices(vertices), indices(indices), textures(textures), quantization(quantization), bounds(bounds),
+      lods(std::move(lods)), name(name) {
+    assign_sampler_names();
+    setup_mesh(this->vertices, this->indices);
 }
 
-void Mesh::draw(const Shader &shader) const {
-    unsigned int diffuse_n = 1;
-    unsigned int specular_n = 1;
-
-    for (unsigned int i = 0; i < textures.size(); i++) {
-        glActiveTexture(GL_TEXTURE0 + i);
+Mesh::Mesh(const std::string &name, std::span<const Vertex> vertices, std::span<const unsigned int> indices,
+           std::vector<Texture> textures, VertexQuantization quantization, AABB bounds, std::vector<MeshLod> lods)
+    : textures(textures), quantization(quantization), bounds(bounds), lods(std::move(lods)), name(name) {
+    assign_sampler_names();
+    setup_mesh(vertices, indices);
+}
 
-        std::string number;
-        std::string name = textures[i].type;
-        if (name == "texture_diffuse") {
-            number = std::to_string(diffuse_n++);
-        } else if (name == "texture_specular") {
-            number = std::to_string(specular_n++);
-        } else {
-            throw std::runtime_error("Unknown texture type: " + name);
-        }
+Mesh::Mesh(const std::string &name, GeometryAllocation allocation, std::vector<Texture> textures,
+           VertexQuantization quantization, AABB bounds, std::vector<MeshLod> lods)
+    : textures(textures), quantization(quantization), bounds(bounds), lods(std::move(lods)), name(name),
+      vao(GeometryArena::shared().vao()), allocation(allocation) {
+    assign_sampler_names();
+    if (this->lods.empty()) {
+        this->lods.push_back({0, allocation.index_count, 0.0f});
+    }
+}
 
-        shader.set_i((name + number).c_str(), i);
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+Mesh::~Mesh() {
+    if (vao != 0) {
+        GeometryArena::shared().release(allocation);
     }
+}
+
+Mesh::Mesh(Mesh &&other)
+    : vertices(std::move(other.vertices)), indices(std::move(other.indices)), textures(std::move(other.textures)),
+      quantization(other.quantization), bounds(other.bounds), lods(std::move(other.lods)), name(other.name),
+      vao(std::exchange(other.vao, 0)), allocation(other.allocation), sampler_names(std::move(other.sampler_names)),
+      material_uniforms(std::move(other.material_uniforms)) {}
+
+void Mesh::draw(const Shader &shader, unsigned int lod) const {
+    PROFILE_ZONE("Mesh::draw");
+    bind_material(shader);
 
+    const MeshLod &range = lods[lod];
     glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElementsBaseVertex(
+        GL_TRIANGLES, range.index_count, GL_UNSIGNED_INT,
+        reinterpret_cast<void *>(uintptr_t(allocation.first_index + range.first_index) * sizeof(unsigned int)),
+        allocation.base_vertex);
     glBindVertexArray(0);
 
     glActiveTexture(GL_TEXTURE0);
 }
 
-void Mesh::setup_mesh() {
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glGenBuffers(1, &ebo);
+void Mesh::draw_instanced(const Shader &shader, const InstanceBatch &instances, unsigned int lod,
+                          const glm::mat4 &node_transform) const {
+    PROFILE_ZONE("Mesh::draw_instanced");
+    if (instances.empty()) {
+        return;
+    }
 
-    glBindVertexArray(vao);
+    bind_material(shader);
+    shader.set(material_uniforms.node_transform, node_transform);
+    const MeshLod &range = lods[lod];
+    instances.draw_elements(vao, GL_TRIANGLES, range.index_count, allocation.first_index + range.first_index,
+                            allocation.base_vertex);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    glActiveTexture(GL_TEXTURE0);
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+void Mesh::bind_material(const Shader &shader) const {
+    const MaterialUniforms &uniforms = resolve_material_uniforms(shader);
+    for (unsigned int i = 0; i < textures.size(); i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        shader.set(uniforms.samplers[i], int(i));
+        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+    }
 
-    // Vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
+#if VERTEX_FORMAT == VERTEX_FORMAT_QUANTIZED
+    shader.set(uniforms.position_scale, quantization.scale);
+    shader.set(uniforms.position_offset, quantization.offset);
+#endif
+}
 
-    // Vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
+const Mesh::MaterialUniforms &Mesh::resolve_material_uniforms(const Shader &shader) const {
+    // The program name too, in case a new shader was allocated where a deleted one used to be
+    if (material_uniforms.shader == &shader && material_uniforms.program == shader._m_id) {
+        return material_uniforms;
+    }
 
-    // Texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, tex_coord));
+    material_uniforms.shader = &shader;
+    material_uniforms.program = shader._m_id;
+    material_uniforms.samplers.clear();
+    for (const auto &name : sampler_names) {
+        material_uniforms.samplers.push_back(shader.uniform<int>(name));
+    }
+#if VERTEX_FORMAT == VERTEX_FORMAT_QUANTIZED
+    material_uniforms.position_scale = shader.uniform<glm::vec3>("positionScale");
+    material_uniforms.position_offset = shader.uniform<glm::vec3>("positionOffset");
+#endif
+    material_uniforms.node_transform = shader.uniform<glm::mat4>("nodeTransform");
+    return material_uniforms;
+}
 
-    glBindVertexArray(0);
+void Mesh::submit(RenderQueue &queue, const Shader &shader, const glm::mat4 &model, Uniform<glm::mat4> model_uniform,
+                  RenderLayer layer, unsigned int lod) const {
+    const MaterialUniforms &uniforms = resolve_material_uniforms(shader);
+    DrawPacket packet;
+    packet.shader = &shader;
+    packet.vao = vao;
+    packet.first = allocation.first_index + lods[lod].first_index;
+    packet.count = lods[lod].index_count;
+    packet.base_vertex = allocation.base_vertex;
+    packet.model_uniform = model_uniform;
+    packet.model = model;
+#if VERTEX_FORMAT == VERTEX_FORMAT_QUANTIZED
+    packet.position_scale = uniforms.position_scale;
+    packet.position_offset = uniforms.position_offset;
+    packet.quantization = quantization;
+#endif
+
+    // Textures past MAX_PACKET_TEXTURES were reported when the mesh was made
+    packet.texture_count = std::min<size_t>(textures.size(), MAX_PACKET_TEXTURES);
+    for (unsigned int i = 0; i < packet.texture_count; i++) {
+        packet.textures[i] = {textures[i].id, uniforms.samplers[i].location};
+    }
+
+    queue.submit(layer, glm::vec3(model * glm::vec4(bounds.center(), 1.0f)), packet);
 }
 
-Texture::Texture(const std::string &file_path, const std::string &type) : type(type), file_path(file_path) {
-    glGenTextures(1, &id);
+void Mesh::assign_sampler_names() {
+    unsigned int diffuse_n = 1;
+    unsigned int specular_n = 1;
+
+    sampler_names.clear();
+    for (const auto &texture : textures) {
+        std::string number;
+        const std::string &name = texture.type;
+        if (name == "texture_diffuse") {
+            number = std::to_string(diffuse_n++);
+        } else if (name == "texture_specular") {
+            number = std::to_string(specular_n++);
+        } else {
+            throw std::runtime_error("Unknown texture type: " + name);
+        }
 
-    int width, height, k;
-    unsigned char *data = stbi_load(file_path.c_str(), &width, &height, &k, 0);
+        sampler_names.push_back(name + number);
+    }
 
-    if (data == NULL) {
-        throw std::runtime_error("couldn't load image file: " + file_path);
+    if (textures.size() > MAX_PACKET_TEXTURES) {
+        std::fprintf(stderr, "mesh %s has %zu textures, but only the first %u are bound when it is queued\n",
+                     name.c_str(), textures.size(), MAX_PACKET_TEXTURES);
     }
+}
 
-    GLenum format;
-    if (k == 1) {
-        format = GL_RED;
-    } else if (k == 3) {
-        format = GL_RGB;
-    } else if (k == 4) {
-        format = GL_RGBA;
-    } else {
-        throw std::runtime_error("Unable to infer texture format");
+void Mesh::setup_mesh(std::span<const Vertex> vertices, std::span<const unsigned int> indices) {
+    if (lods.empty()) {
+        lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f});
     }
 
+    GeometryArena &arena = GeometryArena::shared();
+    vao = arena.vao();
+    allocation = arena.allocate(vertices, indices);
+}
+
+Texture::Texture(const std::string &file_path, const std::string &type)
+    : Texture(file_path, type, Image::load(file_path)) {}
+
+Texture::Texture(unsigned int id, const std::string &file_path, const std::string &type)
+    : id(id), type(type), file_path(file_path) {}
+
+Texture::Texture(const std::string &file_path, const std::string &type, const Image &image)
+    : type(type), file_path(file_path) {
+    if (image.compressed && !texture_codec_supported(image.compressed->codec)) {
+        // The driver can't sample the baked format (no S3TC), so go back to the source image
+        *this = Texture(file_path, type, Image::decode(file_path));
+        return;
+    }
+
+    glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_2D, id);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    if (image.compressed) {
+        // The whole mip chain was baked offline, so there's nothing to generate
+        const CompressedTexture &texture = *image.compressed;
+        const GLenum format = texture_codec_gl_format(texture.codec);
+        int width = texture.width, height = texture.height;
+        for (size_t level = 0; level < texture.levels.size(); level++) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, texture.levels[level].size(),
+                                   texture.levels[level].data());
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.levels.size() - 1);
+    } else {
+        const GLenum format = image.format();
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE,
+                     image.pixels.get());
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
 }
@@ -1,16 +1,20 @@
 #ifndef MESH_HPP
 #define MESH_HPP
 
+#include "bounds.hpp"
+#include "geometry_arena.hpp"
+#include "instancing.hpp"
+#include "model_data.hpp"
+#include "render_queue.hpp"
 #include "shader.hpp"
+#include "vertex.hpp"
 
 #include <glm/glm.hpp>
+#include <span>
 #include <string>
 #include <vector>
 
-struct Vertex {
-    glm::vec3 position, normal;
-    glm::vec2 tex_coord;
-};
+struct Image;
 
 struct Texture {
     unsigned int id;
@@ -18,25 +22,80 @@ struct Texture {
     std::string file_path;
 
     Texture(const std::string &file_path, const std::string &type);
+    // Uploads pixels that were already decoded (possibly on another thread)
+    Texture(const std::string &file_path, const std::string &type, const Image &image);
+    // Wraps a texture object that was already created and filled (e.g. by ModelStreamer)
+    Texture(unsigned int id, const std::string &file_path, const std::string &type);
 };
 
 class Mesh {
   public:
-    // Mesh Data
+    // Mesh Data (vertices/indices are left empty when the mesh was uploaded straight from a baked cache)
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
     std::vector<Texture> textures;
 
+    // Dequantizes positions for VERTEX_FORMAT_QUANTIZED, identity otherwise
+    VertexQuantization quantization;
+    // Model-space bounds of the vertices
+    AABB bounds;
+    // Index ranges of the LOD chain, finest first; never empty
+    std::vector<MeshLod> lods;
+
     Mesh(const std::string &name, std::vector<Vertex> vertices, std::vector<unsigned int> indices,
-         std::vector<Texture> textures);
+         std::vector<Texture> textures, VertexQuantization quantization = {}, AABB bounds = {},
+         std::vector<MeshLod> lods = {});
+    Mesh(const std::string &name, std::span<const Vertex> vertices, std::span<const unsigned int> indices,
+         std::vector<Texture> textures, VertexQuantization quantization = {}, AABB bounds = {},
+         std::vector<MeshLod> lods = {});
+    // Takes over an arena allocation whose vertices and indices were already copied in (see ModelStreamer)
+    Mesh(const std::string &name, GeometryAllocation allocation, std::vector<Texture> textures,
+         VertexQuantization quantization, AABB bounds, std::vector<MeshLod> lods);
+    // Gives the arena allocation back. Meshes are move-only so that exactly one of them owns it.
+    ~Mesh();
+    Mesh(Mesh &&other);
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+
+    unsigned int lod_count() const { return lods.size(); }
 
-    void draw(const Shader &shader) const;
+    // `lod` must be below lod_count()
+    void draw(const Shader &shader, unsigned int lod = 0) const;
+    // One draw for every instance in the (uploaded) batch; the shader must be an *_instanced.glsl variant.
+    // `node_transform` goes into its "nodeTransform" uniform, applied before each instance's matrix.
+    void draw_instanced(const Shader &shader, const InstanceBatch &instances, unsigned int lod = 0,
+                        const glm::mat4 &node_transform = glm::mat4(1.0f)) const;
+    // Queues this mesh instead of drawing it immediately. Binds at most MAX_PACKET_TEXTURES of `textures`. Like the
+    // draws, GL thread only: it shares the cached uniform handles with them.
+    void submit(RenderQueue &queue, const Shader &shader, const glm::mat4 &model, Uniform<glm::mat4> model_uniform,
+                RenderLayer layer = RenderLayer::OPAQUE, unsigned int lod = 0) const;
 
     const std::string name;
 
   private:
-    unsigned int vao, vbo, ebo;
-    void setup_mesh();
+    // Shared arena VAO; this mesh's vertices and indices are `allocation`'s slice of the arena buffers. 0 once moved
+    // from, with nothing left to release.
+    unsigned int vao;
+    GeometryAllocation allocation;
+    // Sampler uniform for each entry in `textures` ("texture_diffuse1", ...), built once instead of per draw
+    std::vector<std::string> sampler_names;
+    // Handles for bind_material and submit, resolved against the last shader this mesh was drawn or queued with
+    struct MaterialUniforms {
+        const Shader *shader = nullptr;
+        unsigned int program = 0;
+        std::vector<Uniform<int>> samplers;
+        Uniform<glm::vec3> position_scale;
+        Uniform<glm::vec3> position_offset;
+        // Only in the *_instanced.glsl variants
+        Uniform<glm::mat4> node_transform;
+    };
+    mutable MaterialUniforms material_uniforms;
+    void assign_sampler_names();
+    // Binds textures and sets the per-mesh uniforms shared by draw and draw_instanced
+    void bind_material(const Shader &shader) const;
+    // Looks the handles up again only when `shader` isn't the one they were resolved for
+    const MaterialUniforms &resolve_material_uniforms(const Shader &shader) const;
+    void setup_mesh(std::span<const Vertex> vertices, std::span<const unsigned int> indices);
 };
 
 #endif
@@ -0,0 +1,338 @@
+#include "mesh_cache.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct SourceStamp {
+    int64_t mtime;
+    uint64_t size;
+};
+
+SourceStamp stamp_source(const std::string &source_path) {
+    return {static_cast<int64_t>(fs::last_write_time(source_path).time_since_epoch().count()),
+            static_cast<uint64_t>(fs::file_size(source_path))};
+}
+
+size_t align_up(size_t v, size_t alignment) { return (v + alignment - 1) & ~(alignment - 1); }
+
+class Writer {
+  public:
+    std::vector<char> bytes;
+
+    template <typename T> size_t put(const T &v) {
+        const size_t at = bytes.size();
+        const char *p = reinterpret_cast<const char *>(&v);
+        bytes.insert(bytes.end(), p, p + sizeof(T));
+        return at;
+    }
+
+    void put_string(const std::string &s) {
+        put(static_cast<uint32_t>(s.size()));
+        bytes.insert(bytes.end(), s.begin(), s.end());
+    }
+
+    template <typename T> void patch(size_t at, const T &v) { std::memcpy(bytes.data() + at, &v, sizeof(T)); }
+};
+
+class Reader {
+  public:
+    Reader(const char *data, size_t size) : m_data(data), m_size(size), m_pos(0) {}
+
+    template <typename T> T get() {
+        require(sizeof(T));
+        T v;
+        std::memcpy(&v, m_data + m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return v;
+    }
+
+    std::string get_string() {
+        const uint32_t len = get<uint32_t>();
+        require(len);
+        std::string s(m_data + m_pos, len);
+        m_pos += len;
+        return s;
+    }
+
+    template <typename T> std::span<const T> blob(uint64_t offset, uint32_t count) const {
+        if (offset % alignof(T) != 0 || offset > m_size || count * sizeof(T) > m_size - offset) {
+            throw std::runtime_error("mesh cache blob out of range");
+        }
+        return {reinterpret_cast<const T *>(m_data + offset), count};
+    }
+
+  private:
+    const char *m_data;
+    size_t m_size;
+    size_t m_pos;
+
+    void require(size_t n) const {
+        if (n > m_size - m_pos) {
+            throw std::runtime_error("mesh cache truncated");
+        }
+    }
+};
+
+} // namespace
+
+std::string mesh_cache_path(const std::string &source_path) { return source_path + ".mcache"; }
+
+BakedModel::BakedModel(const std::string &cache_path) : m_data(nullptr), m_size(0) {
+    const int fd = open(cache_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("couldn't open mesh cache: " + cache_path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(MeshCacheHeader)) {
+        close(fd);
+        throw std::runtime_error("mesh cache too small: " + cache_path);
+    }
+
+    m_size = st.st_size;
+    m_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (m_data == MAP_FAILED) {
+        m_data = nullptr;
+        throw std::runtime_error("couldn't map mesh cache: " + cache_path);
+    }
+
+    try {
+        Reader r(static_cast<const char *>(m_data), m_size);
+        const auto hdr = r.get<MeshCacheHeader>();
+
+        if (std::memcmp(hdr.magic, MESH_CACHE_MAGIC, sizeof(hdr.magic)) != 0 || hdr.version != MESH_CACHE_VERSION ||
+            hdr.vertex_format != VERTEX_FORMAT || hdr.vertex_size != sizeof(Vertex)) {
+            throw std::runtime_error("mesh cache format mismatch");
+        }
+
+        // The cache sits next to its source, so its directory is the model's
+        const fs::path directory = fs::path(cache_path).parent_path();
+        textures.reserve(hdr.texture_count);
+        for (uint32_t i = 0; i < hdr.texture_count; i++) {
+            TextureRef ref;
+            ref.type = r.get_string();
+            ref.file_path = (directory / r.get_string()).string();
+            textures.push_back(std::move(ref));
+        }
+
+        meshes.reserve(hdr.mesh_count);
+        for (uint32_t i = 0; i < hdr.mesh_count; i++) {
+            BakedMesh mesh;
+            mesh.name = r.get_string();
+
+            const uint32_t n_textures = r.get<uint32_t>();
+            for (uint32_t j = 0; j < n_textures; j++) {
+                const uint32_t index = r.get<uint32_t>();
+                if (index >= textures.size()) {
+                    throw std::runtime_error("mesh cache texture index out of range");
+                }
+                mesh.textures.push_back(index);
+            }
+
+            mesh.quantization = r.get<VertexQuantization>();
+            mesh.bounds = r.get<AABB>();
+            const uint32_t vertex_count = r.get<uint32_t>();
+            const uint32_t index_count = r.get<uint32_t>();
+            const uint64_t vertex_offset = r.get<uint64_t>();
+            const uint64_t index_offset = r.get<uint64_t>();
+            mesh.vertices = r.blob<Vertex>(vertex_offset, vertex_count);
+            mesh.indices = r.blob<unsigned int>(index_offset, index_count);
+
+            const uint32_t n_lods = r.get<uint32_t>();
+            if (n_lods == 0 || n_lods > MAX_MESH_LODS) {
+                throw std::runtime_error("mesh cache lod count out of range");
+            }
+            for (uint32_t j = 0; j < n_lods; j++) {
+                const auto lod = r.get<MeshLod>();
+                if (lod.first_index > index_count || lod.index_count > index_count - lod.first_index) {
+                    throw std::runtime_error("mesh cache lod out of range");
+                }
+                mesh.lods.push_back(lod);
+            }
+
+            meshes.push_back(std::move(mesh));
+        }
+
+        nodes.reserve(hdr.node_count);
+        for (uint32_t i = 0; i < hdr.node_count; i++) {
+            NodeData node;
+            node.name = r.get_string();
+            node.parent = r.get<int32_t>();
+            if (node.parent < -1 || node.parent >= static_cast<int32_t>(i)) {
+                throw std::runtime_error("mesh cache node parent out of range");
+            }
+            node.local = r.get<Transform>();
+
+            const uint32_t n_meshes = r.get<uint32_t>();
+            for (uint32_t j = 0; j < n_meshes; j++) {
+                const uint32_t index = r.get<uint32_t>();
+                if (index >= meshes.size()) {
+                    throw std::runtime_error("mesh cache node mesh index out of range");
+                }
+                node.meshes.push_back(index);
+            }
+
+            nodes.push_back(std::move(node));
+        }
+    } catch (...) {
+        munmap(m_data, m_size);
+        throw;
+    }
+}
+
+BakedModel::~BakedModel() {
+    if (m_data) {
+        munmap(m_data, m_size);
+    }
+}
+
+const MeshCacheHeader &BakedModel::header() const { return *static_cast<const MeshCacheHeader *>(m_data); }
+
+bool mesh_cache_is_fresh(const std::string &source_path) {
+    std::ifstream ifs(mesh_cache_path(source_path), std::ios_base::binary);
+    if (!ifs.is_open()) {
+        return false;
+    }
+
+    MeshCacheHeader hdr;
+    if (!ifs.read(reinterpret_cast<char *>(&hdr), sizeof(hdr))) {
+        return false;
+    }
+
+    std::error_code ec;
+    if (!fs::exists(source_path, ec)) {
+        return false;
+    }
+    const SourceStamp stamp = stamp_source(source_path);
+
+    return std::memcmp(hdr.magic, MESH_CACHE_MAGIC, sizeof(hdr.magic)) == 0 && hdr.version == MESH_CACHE_VERSION &&
+           hdr.vertex_format == VERTEX_FORMAT && hdr.vertex_size == sizeof(Vertex) && hdr.source_mtime == stamp.mtime &&
+           hdr.source_size == stamp.size;
+}
+
+void write_mesh_cache(const std::string &source_path, const ModelData &data) {
+    const SourceStamp stamp = stamp_source(source_path);
+
+    MeshCacheHeader hdr{};
+    std::memcpy(hdr.magic, MESH_CACHE_MAGIC, sizeof(hdr.magic));
+    hdr.version = MESH_CACHE_VERSION;
+    hdr.vertex_format = VERTEX_FORMAT;
+    hdr.vertex_size = sizeof(Vertex);
+    hdr.source_mtime = stamp.mtime;
+    hdr.source_size = stamp.size;
+    hdr.texture_count = data.textures.size();
+    hdr.mesh_count = data.meshes.size();
+    hdr.node_count = data.nodes.size();
+
+    Writer w;
+    w.put(hdr);
+
+    // Relative to the model, so the cache still finds them when it is loaded through another spelling of the path
+    // (absolute, or from another working directory) than the one it was baked with
+    const fs::path directory = fs::path(source_path).parent_path();
+    for (const auto &tex : data.textures) {
+        const fs::path relative = fs::path(tex.file_path).lexically_relative(directory);
+        w.put_string(tex.type);
+        w.put_string(relative.empty() ? tex.file_path : relative.string());
+    }
+
+    // Blob offsets aren't known until the whole table is written, so remember where to patch them.
+    std::vector<std::pair<size_t, size_t>> offset_slots;
+    for (const auto &mesh : data.meshes) {
+        w.put_string(mesh.name);
+        w.put(static_cast<uint32_t>(mesh.textures.size()));
+        for (unsigned int index : mesh.textures) {
+            w.put(static_cast<uint32_t>(index));
+        }
+        w.put(mesh.quantization);
+        w.put(mesh.bounds);
+        w.put(static_cast<uint32_t>(mesh.vertices.size()));
+        w.put(static_cast<uint32_t>(mesh.indices.size()));
+        const size_t vertex_slot = w.put(uint64_t{0});
+        const size_t index_slot = w.put(uint64_t{0});
+        offset_slots.emplace_back(vertex_slot, index_slot);
+
+        if (mesh.lods.empty()) {
+            w.put(uint32_t{1});
+            w.put(MeshLod{0, static_cast<uint32_t>(mesh.indices.size()), 0.0f});
+        } else {
+            w.put(static_cast<uint32_t>(mesh.lods.size()));
+            for (const auto &lod : mesh.lods) {
+                w.put(lod);
+            }
+        }
+    }
+
+    for (const auto &node : data.nodes) {
+        w.put_string(node.name);
+        w.put(node.parent);
+        w.put(node.local);
+        w.put(static_cast<uint32_t>(node.meshes.size()));
+        for (unsigned int index : node.meshes) {
+            w.put(static_cast<uint32_t>(index));
+        }
+    }
+
+    for (size_t i = 0; i < data.meshes.size(); i++) {
+        const auto &mesh = data.meshes[i];
+
+        w.bytes.resize(align_up(w.bytes.size(), MESH_CACHE_BLOB_ALIGNMENT));
+        w.patch(offset_slots[i].first, static_cast<uint64_t>(w.bytes.size()));
+        const char *vp = reinterpret_cast<const char *>(mesh.vertices.data());
+        w.bytes.insert(w.bytes.end(), vp, vp + mesh.vertices.size() * sizeof(Vertex));
+
+        w.bytes.resize(align_up(w.bytes.size(), MESH_CACHE_BLOB_ALIGNMENT));
+        w.patch(offset_slots[i].second, static_cast<uint64_t>(w.bytes.size()));
+        const char *ip = reinterpret_cast<const char *>(mesh.indices.data());
+        w.bytes.insert(w.bytes.end(), ip, ip + mesh.indices.size() * sizeof(unsigned int));
+    }
+
+    const std::string path = mesh_cache_path(source_path);
+    const std::string tmp_path = unique_temp_path(path);
+    std::error_code ec;
+    {
+        std::ofstream ofs(tmp_path, std::ios_base::binary | std::ios_base::trunc);
+        if (!ofs.is_open() || !ofs.write(w.bytes.data(), w.bytes.size())) {
+            ofs.close();
+            fs::remove(tmp_path, ec);
+            throw std::runtime_error("Failed to write mesh cache: " + tmp_path);
+        }
+    }
+    fs::rename(tmp_path, path, ec);
+    if (ec) {
+        const std::string message = ec.message();
+        fs::remove(tmp_path, ec);
+        throw std::runtime_error("Failed to write mesh cache " + path + ": " + message);
+    }
+}
+
+std::string unique_temp_path(const std::string &path) {
+    static std::atomic<unsigned int> counter{0};
+    return path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(counter++);
+}
+
+std::unique_ptr<BakedModel> open_mesh_cache(const std::string &source_path) {
+    if (!mesh_cache_is_fresh(source_path)) {
+        return nullptr;
+    }
+
+    try {
+        return std::make_unique<BakedModel>(mesh_cache_path(source_path));
+    } catch (const std::runtime_error &e) {
+        std::fprintf(stderr, "ignoring mesh cache for %s: %s\n", source_path.c_str(), e.what());
+        return nullptr;
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include "model_data.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+// Baked binary mesh cache.
+//
+// The first import of a model writes "<source>.mcache" next to the source file. Later loads memory-map that file and
+// hand the vertex/index blobs straight to glBufferData. A cache is stale when its format version, vertex format, or
+// the recorded source mtime/size no longer match.
+//
+// Layout (little endian, all offsets absolute):
+//   MeshCacheHeader
+//   texture table: texture_count x { u32 len, type bytes, u32 len, path bytes (relative to the source's directory) }
+//   mesh table:    mesh_count x { u32 len, name bytes, u32 n, n x u32 texture index, VertexQuantization, AABB,
+//                                 u32 vertex_count, u32 index_count, u64 vertex_offset, u64 index_offset,
+//                                 u32 lod_count, lod_count x MeshLod }
+//   node table:    node_count x { u32 len, name bytes, i32 parent, Transform, u32 n, n x u32 mesh index }
+//   blobs:         vertex and index arrays, each MESH_CACHE_BLOB_ALIGNMENT aligned
+
+constexpr char MESH_CACHE_MAGIC[8] = {'L', 'O', 'G', 'L', 'M', 'E', 'S', 'H'};
+constexpr uint32_t MESH_CACHE_VERSION = 7;
+constexpr size_t MESH_CACHE_BLOB_ALIGNMENT = 16;
+
+struct MeshCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t vertex_format;
+    uint32_t vertex_size;
+    int64_t source_mtime;
+    uint64_t source_size;
+    uint32_t texture_count;
+    uint32_t mesh_count;
+    uint32_t node_count;
+};
+
+struct BakedMesh {
+    std::string name;
+    std::vector<unsigned int> textures;
+    VertexQuantization quantization;
+    AABB bounds;
+    std::span<const Vertex> vertices;
+    std::span<const unsigned int> indices;
+    std::vector<MeshLod> lods;
+};
+
+// A read-only view of a mapped cache file. The spans in `meshes` point into the mapping and stay valid for the
+// lifetime of this object. Texture paths come back resolved against the cache file's directory, spelled the way
+// import_model spells them for the same source path.
+class BakedModel {
+  public:
+    std::vector<TextureRef> textures;
+    std::vector<BakedMesh> meshes;
+    std::vector<NodeData> nodes;
+
+    BakedModel(const std::string &cache_path);
+    ~BakedModel();
+
+    BakedModel(const BakedModel &) = delete;
+    BakedModel &operator=(const BakedModel &) = delete;
+
+    const MeshCacheHeader &header() const;
+
+  private:
+    void *m_data;
+    size_t m_size;
+};
+
+std::string mesh_cache_path(const std::string &source_path);
+
+// True when a cache exists for source_path and was baked from the current version of the source file.
+bool mesh_cache_is_fresh(const std::string &source_path);
+
+// A temp file name next to `path` that no other thread or process writing `path` at the same time uses, so the
+// writes can each be renamed over `path` without interleaving.
+std::string unique_temp_path(const std::string &path);
+
+// Writes the cache atomically (temp file + rename) so a concurrent reader never sees a partial file, and concurrent
+// writers of the same cache each publish a whole file.
+void write_mesh_cache(const std::string &source_path, const ModelData &data);
+
+// Opens the cache for source_path, or returns nullptr when it is missing, stale or corrupt.
+std::unique_ptr<BakedModel> open_mesh_cache(const std::string &source_path);
+
+#endif
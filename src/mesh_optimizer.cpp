@@ -0,0 +1,390 @@
+#include "mesh_optimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+constexpr unsigned int NONE = std::numeric_limits<unsigned int>::max();
+
+// Forsyth's scoring constants; the LRU cache he models is larger than the FIFO we measure with, which is deliberate
+constexpr int FORSYTH_CACHE_SIZE = 32;
+constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+constexpr size_t FETCH_CACHE_LINE = 64;
+constexpr size_t FETCH_CACHE_LINES = 64;
+
+float forsyth_vertex_score(int cache_position, unsigned int remaining_triangles) {
+    if (remaining_triangles == 0) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cache_position >= 0) {
+        if (cache_position < 3) {
+            // The triangle just emitted; using these again right away is good but no better than anything else cached
+            score = FORSYTH_LAST_TRIANGLE_SCORE;
+        } else {
+            const float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cache_position - 3) * scale, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+
+    // Favour vertices with few triangles left so they get finished off instead of lingering
+    return score + FORSYTH_VALENCE_BOOST_SCALE * std::pow(float(remaining_triangles), -FORSYTH_VALENCE_BOOST_POWER);
+}
+
+// A FIFO post-transform cache; returns true on a miss
+class FifoCache {
+  public:
+    FifoCache(size_t vertex_count, unsigned int size) : m_timestamps(vertex_count, 0), m_size(size), m_time(size + 1) {}
+
+    bool access(unsigned int v) {
+        if (m_time - m_timestamps[v] > m_size) {
+            m_timestamps[v] = m_time++;
+            return true;
+        }
+        return false;
+    }
+
+  private:
+    // Time each vertex last entered the cache; a vertex is cached while fewer than m_size others entered since
+    std::vector<unsigned int> m_timestamps;
+    unsigned int m_size;
+    unsigned int m_time;
+};
+
+struct VertexBytesHash {
+    const std::vector<Vertex> &vertices;
+    size_t operator()(unsigned int i) const {
+        const auto *p = reinterpret_cast<const unsigned char *>(&vertices[i]);
+        uint64_t h = 1469598103934665603ull;
+        for (size_t j = 0; j < sizeof(Vertex); j++) {
+            h = (h ^ p[j]) * 1099511628211ull;
+        }
+        return h;
+    }
+};
+
+struct VertexBytesEqual {
+    const std::vector<Vertex> &vertices;
+    bool operator()(unsigned int a, unsigned int b) const {
+        return std::memcmp(&vertices[a], &vertices[b], sizeof(Vertex)) == 0;
+    }
+};
+
+} // namespace
+
+VertexCacheStats analyze_vertex_cache(std::span<const unsigned int> indices, size_t vertex_count,
+                                      unsigned int cache_size) {
+    VertexCacheStats stats;
+    if (indices.empty()) {
+        return stats;
+    }
+
+    FifoCache cache(vertex_count, cache_size);
+    std::vector<bool> referenced(vertex_count, false);
+    size_t misses = 0, unique = 0;
+    for (unsigned int v : indices) {
+        misses += cache.access(v);
+        if (!referenced[v]) {
+            referenced[v] = true;
+            unique++;
+        }
+    }
+
+    stats.acmr = float(misses) / (indices.size() / 3);
+    stats.atvr = float(misses) / unique;
+    return stats;
+}
+
+float analyze_vertex_fetch(std::span<const unsigned int> indices, size_t vertex_count, size_t vertex_size) {
+    if (indices.empty()) {
+        return 0.0f;
+    }
+
+    std::deque<size_t> lines;
+    std::unordered_set<size_t> cached;
+    std::vector<bool> referenced(vertex_count, false);
+    size_t fetched = 0, unique = 0;
+
+    for (unsigned int v : indices) {
+        if (!referenced[v]) {
+            referenced[v] = true;
+            unique++;
+        }
+
+        // A vertex may straddle two lines
+        const size_t first = v * vertex_size / FETCH_CACHE_LINE;
+        const size_t last = ((v + 1) * vertex_size - 1) / FETCH_CACHE_LINE;
+        for (size_t line = first; line <= last; line++) {
+            if (cached.contains(line)) {
+                continue;
+            }
+            fetched += FETCH_CACHE_LINE;
+            lines.push_back(line);
+            cached.insert(line);
+            if (lines.size() > FETCH_CACHE_LINES) {
+                cached.erase(lines.front());
+                lines.pop_front();
+            }
+        }
+    }
+
+    return float(fetched) / (unique * vertex_size);
+}
+
+size_t weld_vertices(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices) {
+    std::unordered_map<unsigned int, unsigned int, VertexBytesHash, VertexBytesEqual> canonical(
+        vertices.size(), VertexBytesHash{vertices}, VertexBytesEqual{vertices});
+
+    std::vector<Vertex> welded;
+    welded.reserve(vertices.size());
+    std::vector<unsigned int> remap(vertices.size(), NONE);
+
+    for (unsigned int &index : indices) {
+        if (remap[index] == NONE) {
+            const auto [it, inserted] = canonical.try_emplace(index, static_cast<unsigned int>(welded.size()));
+            if (inserted) {
+                welded.push_back(vertices[index]);
+            }
+            remap[index] = it->second;
+        }
+        index = remap[index];
+    }
+
+    const size_t removed = vertices.size() - welded.size();
+    vertices = std::move(welded);
+    return removed;
+}
+
+void optimize_vertex_cache(std::vector<unsigned int> &indices, size_t vertex_count) {
+    const size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    // Triangles using each vertex; the first `remaining[v]` entries of a vertex's range are the unemitted ones
+    std::vector<unsigned int> remaining(vertex_count, 0);
+    for (unsigned int v : indices) {
+        remaining[v]++;
+    }
+    std::vector<unsigned int> offsets(vertex_count + 1, 0);
+    std::partial_sum(remaining.begin(), remaining.end(), offsets.begin() + 1);
+    std::vector<unsigned int> adjacency(indices.size());
+    {
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+    }
+
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> vertex_score(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++) {
+        vertex_score[v] = forsyth_vertex_score(-1, remaining[v]);
+    }
+
+    std::vector<float> triangle_score(triangle_count);
+    for (size_t t = 0; t < triangle_count; t++) {
+        triangle_score[t] =
+            vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+    }
+
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<unsigned int> cache, next_cache;
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+
+    unsigned int best = static_cast<unsigned int>(
+        std::max_element(triangle_score.begin(), triangle_score.end()) - triangle_score.begin());
+    size_t cursor = 0;
+
+    for (size_t emitted_count = 0; emitted_count < triangle_count; emitted_count++) {
+        if (best == NONE) {
+            // Nothing in the cache has triangles left; continue with the next unemitted triangle in input order
+            while (emitted[cursor]) {
+                cursor++;
+            }
+            best = static_cast<unsigned int>(cursor);
+        }
+
+        const unsigned int *tri = &indices[best * 3];
+        output.insert(output.end(), tri, tri + 3);
+        emitted[best] = true;
+
+        for (int k = 0; k < 3; k++) {
+            const unsigned int v = tri[k];
+            unsigned int *begin = &adjacency[offsets[v]];
+            unsigned int *end = begin + remaining[v];
+            unsigned int *it = std::find(begin, end, best);
+            std::swap(*it, *(end - 1));
+            remaining[v]--;
+        }
+
+        // Emitted vertices move to the front; everything else shifts back and may fall out
+        next_cache.assign(tri, tri + 3);
+        for (unsigned int v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) {
+                next_cache.push_back(v);
+            }
+        }
+        for (size_t i = 0; i < next_cache.size(); i++) {
+            cache_position[next_cache[i]] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+        }
+
+        for (unsigned int v : next_cache) {
+            vertex_score[v] = forsyth_vertex_score(cache_position[v], remaining[v]);
+        }
+
+        best = NONE;
+        float best_score = -std::numeric_limits<float>::infinity();
+        for (unsigned int v : next_cache) {
+            for (unsigned int i = 0; i < remaining[v]; i++) {
+                const unsigned int t = adjacency[offsets[v] + i];
+                const float score = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] +
+                                    vertex_score[indices[t * 3 + 2]];
+                triangle_score[t] = score;
+                if (score > best_score) {
+                    best_score = score;
+                    best = t;
+                }
+            }
+        }
+
+        if (next_cache.size() > FORSYTH_CACHE_SIZE) {
+            next_cache.resize(FORSYTH_CACHE_SIZE);
+        }
+        std::swap(cache, next_cache);
+    }
+
+    indices = std::move(output);
+}
+
+void optimize_overdraw(std::vector<unsigned int> &indices, std::span<const glm::vec3> positions,
+                       unsigned int cache_size) {
+    const size_t triangle_count = indices.size() / 3;
+    if (triangle_count < 2) {
+        return;
+    }
+
+    // Cluster boundaries: triangles that miss on all three vertices start from a cold cache, so moving the run that
+    // follows them elsewhere doesn't cost extra transforms
+    std::vector<size_t> cluster_starts;
+    FifoCache cache(positions.size(), cache_size);
+    for (size_t t = 0; t < triangle_count; t++) {
+        const int misses = cache.access(indices[t * 3]) + cache.access(indices[t * 3 + 1]) +
+                           cache.access(indices[t * 3 + 2]);
+        if (t == 0 || misses == 3) {
+            cluster_starts.push_back(t);
+        }
+    }
+    cluster_starts.push_back(triangle_count);
+    const size_t cluster_count = cluster_starts.size() - 1;
+    if (cluster_count < 2) {
+        return;
+    }
+
+    struct Cluster {
+        size_t first, last;
+        glm::vec3 centroid;
+        glm::vec3 normal;
+        float area;
+        float sort_key;
+    };
+
+    std::vector<Cluster> clusters(cluster_count);
+    glm::vec3 mesh_centroid(0.0f);
+    float mesh_area = 0.0f;
+
+    for (size_t c = 0; c < cluster_count; c++) {
+        Cluster &cluster = clusters[c];
+        cluster = {cluster_starts[c], cluster_starts[c + 1], glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, 0.0f};
+
+        for (size_t t = cluster.first; t < cluster.last; t++) {
+            const glm::vec3 a = positions[indices[t * 3]];
+            const glm::vec3 b = positions[indices[t * 3 + 1]];
+            const glm::vec3 c3 = positions[indices[t * 3 + 2]];
+            // Twice the area, pointing along the face normal
+            const glm::vec3 n = glm::cross(b - a, c3 - a);
+            const float area = glm::length(n);
+
+            cluster.centroid += (a + b + c3) * (area / 3.0f);
+            cluster.normal += n;
+            cluster.area += area;
+        }
+
+        mesh_centroid += cluster.centroid;
+        mesh_area += cluster.area;
+        if (cluster.area > 0.0f) {
+            cluster.centroid /= cluster.area;
+        }
+    }
+    if (mesh_area > 0.0f) {
+        mesh_centroid /= mesh_area;
+    }
+
+    // Clusters far out along their own normal are the ones most likely to occlude the rest
+    for (auto &cluster : clusters) {
+        const float length = glm::length(cluster.normal);
+        cluster.sort_key = length > 0.0f ? glm::dot(cluster.centroid - mesh_centroid, cluster.normal / length) : 0.0f;
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(),
+                     [](const Cluster &a, const Cluster &b) { return a.sort_key > b.sort_key; });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (const auto &cluster : clusters) {
+        output.insert(output.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.last * 3);
+    }
+    indices = std::move(output);
+}
+
+void optimize_vertex_fetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices) {
+    std::vector<unsigned int> remap(vertices.size(), NONE);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (unsigned int &index : indices) {
+        if (remap[index] == NONE) {
+            remap[index] = static_cast<unsigned int>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(reordered);
+}
+
+MeshOptimizationStats optimize_mesh(MeshData &mesh) {
+    MeshOptimizationStats stats;
+    stats.vertices_before = mesh.vertices.size();
+    stats.cache_before = analyze_vertex_cache(mesh.indices, mesh.vertices.size());
+    stats.overfetch_before = analyze_vertex_fetch(mesh.indices, mesh.vertices.size(), sizeof(Vertex));
+
+    weld_vertices(mesh.vertices, mesh.indices);
+    optimize_vertex_cache(mesh.indices, mesh.vertices.size());
+
+    std::vector<glm::vec3> positions;
+    positions.reserve(mesh.vertices.size());
+    for (const auto &v : mesh.vertices) {
+        positions.push_back(decode_position(v, mesh.quantization));
+    }
+    optimize_overdraw(mesh.indices, positions);
+
+    optimize_vertex_fetch(mesh.vertices, mesh.indices);
+
+    stats.vertices_after = mesh.vertices.size();
+    stats.cache_after = analyze_vertex_cache(mesh.indices, mesh.vertices.size());
+    stats.overfetch_after = analyze_vertex_fetch(mesh.indices, mesh.vertices.size(), sizeof(Vertex));
+    return stats;
+}
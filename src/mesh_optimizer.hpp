@@ -0,0 +1,60 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+#include "model_data.hpp"
+#include "vertex.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Import-time index and vertex reordering. Nothing in here touches GL.
+//
+// Every pass keeps the mesh's set of triangles, including each triangle's winding. Only the order of triangles and
+// vertices changes, plus the number of duplicate vertices.
+
+// FIFO size used to measure post-transform cache efficiency and to find overdraw cluster boundaries
+constexpr unsigned int VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+    // Average cache miss ratio: vertex shader invocations per triangle (0.5 is ideal for large grids, 3 is worst)
+    float acmr = 0.0f;
+    // Average transform to vertex ratio: invocations per referenced vertex (1 is ideal)
+    float atvr = 0.0f;
+};
+
+struct MeshOptimizationStats {
+    size_t vertices_before = 0;
+    size_t vertices_after = 0;
+    VertexCacheStats cache_before;
+    VertexCacheStats cache_after;
+    // Vertex bytes fetched through a small cache of 64-byte lines, divided by the bytes of the referenced vertices
+    float overfetch_before = 0.0f;
+    float overfetch_after = 0.0f;
+};
+
+VertexCacheStats analyze_vertex_cache(std::span<const unsigned int> indices, size_t vertex_count,
+                                      unsigned int cache_size = VERTEX_CACHE_SIZE);
+float analyze_vertex_fetch(std::span<const unsigned int> indices, size_t vertex_count, size_t vertex_size);
+
+// Merges vertices whose encoded bytes are identical and drops the ones no index refers to. Returns how many were
+// removed.
+size_t weld_vertices(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices);
+
+// Reorders triangles for post-transform cache hits (Forsyth's linear-speed algorithm)
+void optimize_vertex_cache(std::vector<unsigned int> &indices, size_t vertex_count);
+
+// Splits a cache-optimized index buffer into clusters at points where the cache is cold anyway, then sorts the
+// clusters so outward-facing ones draw first. This cuts overdraw from most view directions while barely touching ACMR.
+void optimize_overdraw(std::vector<unsigned int> &indices, std::span<const glm::vec3> positions,
+                       unsigned int cache_size = VERTEX_CACHE_SIZE);
+
+// Renumbers vertices in the order the index buffer first uses them, so vertex fetch walks memory linearly
+void optimize_vertex_fetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices);
+
+// Runs every pass above on an imported mesh
+MeshOptimizationStats optimize_mesh(MeshData &mesh);
+
+#endif
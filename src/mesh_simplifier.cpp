@@ -0,0 +1,318 @@
+#include "mesh_simplifier.hpp"
+#include "mesh_optimizer.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+
+namespace {
+
+// A collapse may turn a surviving triangle's normal by at most ~75 degrees. Anything that allows close to 90 lets a
+// chain of collapses stand triangles on edge, which reads as a crease even when no triangle actually flips.
+constexpr float MAX_NORMAL_TURN_COS = 0.25f;
+
+// Symmetric 4x4 error quadric over homogeneous positions, upper triangle only. Doubles because the terms of a
+// summed quadric nearly cancel at points close to its planes.
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+
+    // Squared distance to the plane dot(normal, p) + d = 0, times weight; normal must be unit length
+    static Quadric from_plane(glm::vec3 normal, float d, double weight) {
+        const double a = normal.x, b = normal.y, c = normal.z, w = d;
+        Quadric q;
+        q.a00 = a * a * weight, q.a01 = a * b * weight, q.a02 = a * c * weight, q.a03 = a * w * weight;
+        q.a11 = b * b * weight, q.a12 = b * c * weight, q.a13 = b * w * weight;
+        q.a22 = c * c * weight, q.a23 = c * w * weight;
+        q.a33 = w * w * weight;
+        return q;
+    }
+
+    Quadric &operator+=(const Quadric &o) {
+        a00 += o.a00, a01 += o.a01, a02 += o.a02, a03 += o.a03;
+        a11 += o.a11, a12 += o.a12, a13 += o.a13;
+        a22 += o.a22, a23 += o.a23;
+        a33 += o.a33;
+        return *this;
+    }
+
+    double error(glm::vec3 p) const {
+        const double x = p.x, y = p.y, z = p.z;
+        const double e = a00 * x * x + a11 * y * y + a22 * z * z + 2 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                         2 * (a03 * x + a13 * y + a23 * z) + a33;
+        return std::max(e, 0.0);
+    }
+};
+
+struct Collapse {
+    unsigned int from;
+    unsigned int to;
+    double cost;
+};
+
+// Positions closer than this fraction of the bounding box diagonal count as the same point. Seam vertices are often
+// computed separately per side (sin(pi) isn't 0), so exact comparison would miss some.
+constexpr float POSITION_WELD_TOLERANCE = 1.0f / (1 << 20);
+
+// For each vertex, the lowest-numbered vertex at the same position, rounded to a grid of POSITION_WELD_TOLERANCE
+std::vector<unsigned int> position_groups(std::span<const glm::vec3> positions, glm::vec3 min, float diagonal) {
+    using Cell = std::array<int64_t, 3>;
+    const float cell_size = diagonal * POSITION_WELD_TOLERANCE;
+    std::vector<Cell> cells(positions.size());
+    for (size_t v = 0; v < positions.size(); v++) {
+        const glm::vec3 cell = (positions[v] - min) / cell_size + 0.5f;
+        cells[v] = {int64_t(cell.x), int64_t(cell.y), int64_t(cell.z)};
+    }
+
+    std::vector<unsigned int> order(positions.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+        return cells[a] != cells[b] ? cells[a] < cells[b] : a < b;
+    });
+
+    std::vector<unsigned int> groups(positions.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        const bool same = i > 0 && cells[order[i]] == cells[order[i - 1]];
+        groups[order[i]] = same ? groups[order[i - 1]] : order[i];
+    }
+    return groups;
+}
+
+// Vertices that must not move: anything sharing its position with another vertex (a UV or normal seam), and both ends
+// of every edge that isn't shared by exactly two triangles (open borders and non-manifold edges)
+std::vector<uint8_t> find_locked_vertices(std::span<const glm::vec3> positions, std::span<const unsigned int> indices,
+                                          glm::vec3 min, float diagonal) {
+    const std::vector<unsigned int> groups = position_groups(positions, min, diagonal);
+
+    std::vector<unsigned int> group_size(positions.size(), 0);
+    for (unsigned int group : groups) {
+        group_size[group]++;
+    }
+
+    std::vector<uint8_t> locked_groups(positions.size(), 0);
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        for (int e = 0; e < 3; e++) {
+            const unsigned int a = groups[indices[t + e]], b = groups[indices[t + (e + 1) % 3]];
+            edges.push_back(uint64_t(std::min(a, b)) << 32 | std::max(a, b));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();) {
+        size_t j = i;
+        while (j < edges.size() && edges[j] == edges[i]) {
+            j++;
+        }
+        if (j - i != 2) {
+            locked_groups[edges[i] >> 32] = 1;
+            locked_groups[edges[i] & 0xffffffffu] = 1;
+        }
+        i = j;
+    }
+
+    std::vector<uint8_t> locked(positions.size());
+    for (size_t v = 0; v < positions.size(); v++) {
+        locked[v] = group_size[groups[v]] > 1 || locked_groups[groups[v]];
+    }
+    return locked;
+}
+
+} // namespace
+
+std::vector<unsigned int> simplify_mesh(std::span<const glm::vec3> positions, std::span<const glm::vec3> normals,
+                                        std::span<const unsigned int> indices, size_t target_index_count,
+                                        float max_error, float *result_error) {
+    std::vector<unsigned int> result(indices.begin(), indices.end());
+    if (result_error) {
+        *result_error = 0.0f;
+    }
+    if (result.size() <= target_index_count || positions.empty()) {
+        return result;
+    }
+
+    glm::vec3 min = positions.front(), max = positions.front();
+    for (const auto &p : positions) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    const float diagonal = glm::length(max - min);
+    if (diagonal <= 0.0f) {
+        return result;
+    }
+
+    const size_t vertex_count = positions.size();
+    const std::vector<uint8_t> locked = find_locked_vertices(positions, result, min, diagonal);
+
+    std::vector<Quadric> quadrics(vertex_count);
+    for (size_t t = 0; t + 2 < result.size(); t += 3) {
+        const glm::vec3 &p0 = positions[result[t]], &p1 = positions[result[t + 1]], &p2 = positions[result[t + 2]];
+        const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(n);
+        if (length <= 0.0f) {
+            continue;
+        }
+        const glm::vec3 unit = n / length;
+        // Weighted by area, so many small triangles don't outvote one large one
+        const Quadric q = Quadric::from_plane(unit, -glm::dot(unit, p0), 0.5 * length);
+        for (int i = 0; i < 3; i++) {
+            quadrics[result[t + i]] += q;
+        }
+    }
+
+    const auto collapse_cost = [&](unsigned int from, unsigned int to) {
+        const glm::vec3 d = positions[to] - positions[from];
+        const float normal_penalty = 1.0f - glm::dot(normals[from], normals[to]);
+        return quadrics[from].error(positions[to]) + double(std::max(normal_penalty, 0.0f)) * glm::dot(d, d);
+    };
+
+    const double max_cost = double(max_error) * diagonal * double(max_error) * diagonal;
+    double worst_cost = 0.0;
+
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> remap(vertex_count);
+    std::vector<uint8_t> touched(vertex_count);
+    std::vector<unsigned int> adjacency_offsets(vertex_count + 1), adjacency;
+
+    // Each pass collapses a set of edges whose one-rings don't overlap, so the flip test of one collapse can't be
+    // invalidated by another in the same pass
+    while (result.size() > target_index_count) {
+        std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0u);
+        for (unsigned int v : result) {
+            adjacency_offsets[v + 1]++;
+        }
+        std::partial_sum(adjacency_offsets.begin(), adjacency_offsets.end(), adjacency_offsets.begin());
+        adjacency.resize(result.size());
+        std::vector<unsigned int> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t i = 0; i < result.size(); i++) {
+            adjacency[fill[result[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        collapses.clear();
+        for (size_t t = 0; t < result.size(); t += 3) {
+            for (int e = 0; e < 3; e++) {
+                const unsigned int a = result[t + e], b = result[t + (e + 1) % 3];
+                if (!locked[a]) {
+                    collapses.push_back({a, b, collapse_cost(a, b)});
+                }
+                if (!locked[b]) {
+                    collapses.push_back({b, a, collapse_cost(b, a)});
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+        // Moving `from` onto `to` must not turn any surviving triangle around `from` over, or nearly so. Turns add up
+        // over a chain of collapses, so the result must also still face the way its vertex normals say it should.
+        const auto flips = [&](unsigned int from, unsigned int to) {
+            for (unsigned int i = adjacency_offsets[from]; i < adjacency_offsets[from + 1]; i++) {
+                const unsigned int *tri = &result[size_t(adjacency[i]) * 3];
+                if (tri[0] == to || tri[1] == to || tri[2] == to) {
+                    continue;
+                }
+                glm::vec3 before[3], after[3];
+                glm::vec3 surface(0.0f);
+                for (int k = 0; k < 3; k++) {
+                    const unsigned int v = tri[k] == from ? to : tri[k];
+                    before[k] = positions[tri[k]];
+                    after[k] = positions[v];
+                    surface += normals[v];
+                }
+                const glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+                const glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+                if (glm::dot(n0, n1) <= MAX_NORMAL_TURN_COS * glm::length(n0) * glm::length(n1)) {
+                    return true;
+                }
+                // Meshes imported without normals have zero vectors here and skip this test
+                if (glm::dot(surface, surface) > 0.0f && glm::dot(n1, surface) <= 0.0f) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        std::iota(remap.begin(), remap.end(), 0u);
+        std::fill(touched.begin(), touched.end(), uint8_t(0));
+        const size_t goal = std::max<size_t>((result.size() - target_index_count) / 3, 1);
+        size_t removed = 0;
+        bool collapsed = false;
+
+        for (const Collapse &c : collapses) {
+            if (removed >= goal || c.cost > max_cost) {
+                break;
+            }
+            if (touched[c.from] || touched[c.to] || flips(c.from, c.to)) {
+                continue;
+            }
+
+            for (unsigned int i = adjacency_offsets[c.from]; i < adjacency_offsets[c.from + 1]; i++) {
+                const unsigned int *tri = &result[size_t(adjacency[i]) * 3];
+                touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+                removed += tri[0] == c.to || tri[1] == c.to || tri[2] == c.to;
+            }
+            touched[c.to] = 1;
+
+            remap[c.from] = c.to;
+            quadrics[c.to] += quadrics[c.from];
+            worst_cost = std::max(worst_cost, c.cost);
+            collapsed = true;
+        }
+
+        if (!collapsed) {
+            break;
+        }
+
+        size_t out = 0;
+        for (size_t t = 0; t < result.size(); t += 3) {
+            const unsigned int a = remap[result[t]], b = remap[result[t + 1]], c = remap[result[t + 2]];
+            if (a != b && b != c && a != c) {
+                result[out++] = a, result[out++] = b, result[out++] = c;
+            }
+        }
+        result.resize(out);
+    }
+
+    if (result_error) {
+        *result_error = static_cast<float>(std::sqrt(worst_cost)) / diagonal;
+    }
+    return result;
+}
+
+void generate_lods(MeshData &mesh) {
+    mesh.lods = {{0, static_cast<uint32_t>(mesh.indices.size()), 0.0f}};
+    if (mesh.indices.empty()) {
+        return;
+    }
+
+    std::vector<glm::vec3> positions, normals;
+    positions.reserve(mesh.vertices.size());
+    normals.reserve(mesh.vertices.size());
+    for (const auto &v : mesh.vertices) {
+        positions.push_back(decode_position(v, mesh.quantization));
+        normals.push_back(decode_normal(v));
+    }
+
+    // Simplify each LOD from the previous one; the quadrics start fresh, so errors add up along the chain
+    std::vector<unsigned int> previous(mesh.indices);
+    float error = 0.0f;
+    for (unsigned int lod = 1; lod < MAX_MESH_LODS; lod++) {
+        const size_t target = size_t(previous.size() / 3 * LOD_TRIANGLE_RATIO) * 3;
+        float lod_error = 0.0f;
+        std::vector<unsigned int> simplified =
+            simplify_mesh(positions, normals, previous, target, LOD_MAX_ERROR[lod] - error, &lod_error);
+        if (simplified.empty() || simplified.size() > previous.size() * LOD_MIN_REDUCTION) {
+            break;
+        }
+
+        optimize_vertex_cache(simplified, mesh.vertices.size());
+        error += lod_error;
+        mesh.lods.push_back({static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(simplified.size()),
+                             error});
+        mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+        previous = std::move(simplified);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef MESH_SIMPLIFIER_HPP
+#define MESH_SIMPLIFIER_HPP
+
+#include "model_data.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Import-time LOD generation. Nothing in here touches GL.
+//
+// Simplification is index-only: each edge collapse moves one vertex onto a neighbour that already exists, so every LOD
+// draws the base mesh's vertex buffer and only needs its own index range. Collapses are ordered by quadric error
+// (Garland-Heckbert, area weighted) plus a penalty for merging vertices with diverging normals, and a collapse is
+// rejected if a remaining triangle would end up facing against its vertex normals. Vertices on open borders and on UV
+// or normal seams (several vertices at one position) are never moved, so texture seams and hard edges stay intact.
+
+// Each LOD aims for this fraction of the previous LOD's triangles
+constexpr float LOD_TRIANGLE_RATIO = 0.5f;
+// A LOD that can't get below this fraction of the previous one isn't worth its memory, and ends the chain
+constexpr float LOD_MIN_REDUCTION = 0.8f;
+// Largest total error of each LOD, as a fraction of the mesh's bounding box diagonal (LOD 0 is exact)
+constexpr float LOD_MAX_ERROR[MAX_MESH_LODS] = {0.0f, 0.01f, 0.02f, 0.04f};
+
+// Collapses edges of the triangle list until at most target_index_count indices remain, or until the next collapse
+// would exceed max_error (relative to the bounding box diagonal of `positions`). Returns the new triangle list over
+// the same vertices; result_error receives the largest relative error actually introduced.
+std::vector<unsigned int> simplify_mesh(std::span<const glm::vec3> positions, std::span<const glm::vec3> normals,
+                                        std::span<const unsigned int> indices, size_t target_index_count,
+                                        float max_error, float *result_error = nullptr);
+
+// Fills mesh.lods with the chain, appending each simplified LOD's (cache-optimized) indices to mesh.indices. Run after
+// optimize_mesh, which LOD 0 keeps as is.
+void generate_lods(MeshData &mesh);
+
+#endif
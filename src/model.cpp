@@ -1,118 +1,183 @@
 #include "model.hpp"
-#include "assimp/Importer.hpp"
-#include "assimp/material.h"
-#include "assimp/postprocess.h"
-#include "assimp/scene.h"
 #include "glm/fwd.hpp"
+#include "mesh_cache.hpp"
+#include "profiler.hpp"
 #include "shader.hpp"
+#include "texture_loader.hpp"
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <stdexcept>
 
 std::vector<Texture> loaded_textures;
 
-Model::Model(const std::string &file_path) : directory(file_path.substr(0, file_path.find_last_of('/'))) {
-    load_model(file_path);
-}
+namespace {
 
-void Model::draw(const Shader &shader) {
-    for (const auto &mesh : meshes) {
-        mesh.draw(shader);
+// MeshSource is MeshData for a fresh import or BakedMesh for a cache hit
+template <typename MeshSource>
+void append_meshes(std::vector<Mesh> &meshes, const std::vector<MeshSource> &sources,
+                   const std::vector<Texture> &textures) {
+    for (const auto &mesh : sources) {
+        std::vector<Texture> mesh_textures;
+        for (unsigned int index : mesh.textures) {
+            mesh_textures.push_back(textures[index]);
+        }
+        meshes.emplace_back(mesh.name, mesh.vertices, mesh.indices, mesh_textures, mesh.quantization, mesh.bounds,
+                            mesh.lods);
     }
 }
 
-void Model::load_model(const std::string &file_path) {
-    Assimp::Importer importer;
-
-    const aiScene *scene = importer.ReadFile(file_path, aiProcess_Triangulate | aiProcess_FlipUVs);
+} // namespace
 
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        throw std::runtime_error(std::string("Assimp error: ") + importer.GetErrorString());
-    }
+Model::Model(const std::string &file_path) : directory(file_path.substr(0, file_path.find_last_of('/'))) {
+    load_model(file_path);
+}
 
-    process_node(scene->mRootNode, scene);
+Model::Model(std::vector<Mesh> meshes, const std::vector<NodeData> &nodes) : meshes(std::move(meshes)) {
+    place_meshes(nodes);
+    build_bvh();
 }
 
-void Model::process_node(aiNode *node, const aiScene *scene) {
-    std::printf("processing node: %s\n", node->mName.C_Str());
-    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-        aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(process_mesh(mesh, scene));
+void Model::draw(const Shader &shader, const glm::mat4 &model, Uniform<glm::mat4> model_uniform) const {
+    PROFILE_GPU_ZONE("Model::draw");
+    for (const auto &placed : node_meshes) {
+        shader.set(model_uniform, model * transforms.world(placed.node));
+        meshes[placed.mesh].draw(shader);
     }
+}
 
-    for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        process_node(node->mChildren[i], scene);
+void Model::draw_instanced(const Shader &shader, const InstanceBatch &instances) const {
+    PROFILE_GPU_ZONE("Model::draw_instanced");
+    for (const auto &placed : node_meshes) {
+        meshes[placed.mesh].draw_instanced(shader, instances, 0, transforms.world(placed.node));
     }
 }
 
-Mesh Model::process_mesh(aiMesh *mesh, const aiScene *scene) {
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+void Model::submit(RenderQueue &queue, const Shader &shader, const glm::mat4 &model, Uniform<glm::mat4> model_uniform,
+                   RenderLayer layer, LodState *lod_state) const {
+    PROFILE_ZONE("Model::submit");
+    const auto start = std::chrono::steady_clock::now();
 
-    // Process the vertices
-    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-        Vertex vertex;
+    visible_meshes.clear();
+    bvh.cull(queue.frustum().transformed(model), visible_meshes);
 
-        const auto &vp = mesh->mVertices[i];
-        vertex.position = glm::vec3(vp.x, vp.y, vp.z);
+    queue.cull_stats.tested += node_meshes.size();
+    queue.cull_stats.visible += visible_meshes.size();
+    queue.cull_stats.culled += node_meshes.size() - visible_meshes.size();
+    queue.cull_stats.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 
-        const auto &vn = mesh->mNormals[i];
-        vertex.normal = glm::vec3(vn.x, vn.y, vn.z);
+    if (lod_state) {
+        lod_state->lods.resize(node_meshes.size(), LOD_NONE);
+    }
 
-        if (mesh->mTextureCoords[0]) {
-            const auto &vtc = mesh->mTextureCoords[0][i];
-            vertex.tex_coord = glm::vec2(vtc.x, vtc.y);
-        } else {
-            vertex.tex_coord = glm::vec2(0.0f, 0.0f);
+    for (uint32_t index : visible_meshes) {
+        const Mesh &mesh = meshes[node_meshes[index].mesh];
+        const glm::mat4 world = model * transforms.world(node_meshes[index].node);
+        unsigned int lod = 0;
+        if (mesh.lod_count() > 1) {
+            // Bounding spheres grow with the largest axis scale
+            const float scale = std::max({glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])),
+                                          glm::length(glm::vec3(world[2]))});
+            const glm::vec3 center = glm::vec3(world * glm::vec4(mesh.bounds.center(), 1.0f));
+            const float radius = 0.5f * glm::length(mesh.bounds.extent()) * scale;
+            const unsigned int previous = lod_state ? lod_state->lods[index] : LOD_NONE;
+            lod = queue.lod.select(queue.lod.screen_size(center, radius), mesh.lod_count(), previous);
+            if (lod_state) {
+                queue.lod_stats.switches += previous != LOD_NONE && previous != lod;
+                lod_state->lods[index] = static_cast<uint8_t>(lod);
+            }
         }
+        queue.lod_stats.meshes[lod]++;
+        queue.lod_stats.triangles_saved += (mesh.lods[0].index_count - mesh.lods[lod].index_count) / 3;
 
-        vertices.push_back(vertex);
+        mesh.submit(queue, shader, world, model_uniform, layer, lod);
     }
+}
 
-    // Process the indices
-    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-        const auto &face = mesh->mFaces[i];
-        for (unsigned int j = 0; j < face.mNumIndices; j++) {
-            indices.push_back(face.mIndices[j]);
-        }
+TransformUpdateStats Model::update_transforms(ThreadPool *pool) {
+    const TransformUpdateStats stats = transforms.update(pool);
+    if (stats.updated > 0) {
+        build_bvh();
     }
+    return stats;
+}
 
-    // Process the textures
-    if (mesh->mMaterialIndex >= 0) {
-        const aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
+void Model::load_model(const std::string &file_path) {
+    PROFILE_ZONE("Model::load_model");
+    load_meshes(file_path);
+    build_bvh();
 
-        std::vector<Texture> diffuse_maps = load_material_textures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuse_maps.begin(), diffuse_maps.end());
+    const GeometryArenaStats arena = GeometryArena::shared().stats();
+    std::printf("geometry arena: %u meshes, %u/%u vertices, %u/%u indices, %u grows\n", arena.allocations,
+                arena.vertices_used, arena.vertex_capacity, arena.indices_used, arena.index_capacity, arena.grows);
+}
 
-        std::vector<Texture> specular_maps =
-            load_material_textures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specular_maps.begin(), specular_maps.end());
-    }
+void Model::place_meshes(const std::vector<NodeData> &nodes) {
+    transforms.clear();
+    node_meshes = build_hierarchy(nodes, meshes.size(), transforms);
+    transforms.update();
+}
 
-    return Mesh(mesh->mName.C_Str(), vertices, indices, textures);
+void Model::build_bvh() {
+    std::vector<AABB> bounds;
+    for (const auto &placed : node_meshes) {
+        bounds.push_back(meshes[placed.mesh].bounds.transformed(transforms.world(placed.node)));
+    }
+    bvh.build(bounds);
 }
 
-std::vector<Texture> Model::load_material_textures(const aiMaterial *mat, aiTextureType type, std::string type_name) {
-    std::vector<Texture> textures;
-    for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
-        aiString str;
-        mat->GetTexture(type, i, &str);
+void Model::load_meshes(const std::string &file_path) {
+    // Warm path: upload straight out of the mapped cache file
+    if (const auto baked = open_mesh_cache(file_path)) {
+        append_meshes(meshes, baked->meshes, load_textures(baked->textures));
+        place_meshes(baked->nodes);
+        return;
+    }
+
+    const ModelData data = import_model(file_path);
 
-        const std::string file_name = directory + "/" + std::string(str.C_Str());
+    try {
+        write_mesh_cache(file_path, data);
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "couldn't bake mesh cache for %s: %s\n", file_path.c_str(), e.what());
+    }
+
+    append_meshes(meshes, data.meshes, load_textures(data.textures));
+    place_meshes(data.nodes);
+}
 
-        bool skip = false;
+std::vector<Texture> Model::load_textures(const std::vector<TextureRef> &refs) {
+    PROFILE_ZONE("Model::load_textures");
+    // Reuse anything another model already uploaded; decode the rest in parallel
+    std::vector<TextureRef> missing;
+    for (const auto &ref : refs) {
+        bool loaded = false;
         for (const auto &tex : loaded_textures) {
-            if (tex.file_path == file_name) {
-                textures.push_back(tex);
-                skip = true;
+            if (tex.file_path == ref.file_path) {
+                loaded = true;
                 break;
             }
         }
+        if (!loaded) {
+            missing.push_back(ref);
+        }
+    }
 
-        if (!skip) {
-            Texture tex(file_name, type_name);
-            textures.push_back(tex);
-            loaded_textures.push_back(tex);
+    if (!missing.empty()) {
+        TextureLoadReport report;
+        for (auto &tex : load_textures_parallel(missing, &report)) {
+            loaded_textures.push_back(std::move(tex));
+        }
+        report.print();
+    }
+
+    std::vector<Texture> textures;
+    for (const auto &ref : refs) {
+        for (const auto &tex : loaded_textures) {
+            if (tex.file_path == ref.file_path) {
+                textures.push_back(tex);
+                break;
+            }
         }
     }
 
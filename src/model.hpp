@@ -1,11 +1,10 @@
 #ifndef MODEL_HPP
 #define MODEL_HPP
 
-#include "assimp/material.h"
+#include "bvh.hpp"
 #include "mesh.hpp"
-#include <assimp/Importer.hpp>
-#include <assimp/postprocess.h>
-#include <assimp/scene.h>
+#include "model_data.hpp"
+#include "transform_hierarchy.hpp"
 
 #include <string>
 #include <vector>
@@ -13,16 +12,39 @@
 class Model {
   public:
     Model(const std::string &file_path);
-    void draw(const Shader &shader);
+    // Meshes that are already on the GPU, e.g. streamed in by ModelStreamer, placed by `nodes`. Without nodes every
+    // mesh sits at the model's origin.
+    explicit Model(std::vector<Mesh> meshes, const std::vector<NodeData> &nodes = {});
+    // Draws every mesh right away, unculled, setting model_uniform to `model` times its node's world matrix first
+    void draw(const Shader &shader, const glm::mat4 &model, Uniform<glm::mat4> model_uniform) const;
+    // Draws every mesh once per instance in the batch; instances aren't culled. The node's world matrix goes into the
+    // shader's "nodeTransform" uniform (see vertex_model_instanced.glsl), applied before each instance's matrix.
+    void draw_instanced(const Shader &shader, const InstanceBatch &instances) const;
+    // Queues the meshes whose bounds intersect queue.frustum(), each at the LOD queue.lod picks for its projected size.
+    // Culling and LOD results go into queue.cull_stats and queue.lod_stats. Pass the same lod_state for the same
+    // instance every frame to get hysteresis; without one the pick is made from scratch.
+    void submit(RenderQueue &queue, const Shader &shader, const glm::mat4 &model, Uniform<glm::mat4> model_uniform,
+                RenderLayer layer = RenderLayer::OPAQUE, LodState *lod_state = nullptr) const;
+
+    // The file's node graph, relative to the model matrix. After set_local() on any node, update_transforms()
+    // recomputes the world matrices and rebuilds the culling BVH around the moved meshes.
+    TransformHierarchy transforms;
+    TransformUpdateStats update_transforms(ThreadPool *pool = nullptr);
 
   private:
     std::vector<Mesh> meshes;
+    // Every mesh reference in node order; LodState and the BVH index this, not `meshes`
+    std::vector<NodeMesh> node_meshes;
     std::string directory;
+    // Over the model-space bounds of `node_meshes`
+    Bvh bvh;
+    mutable std::vector<uint32_t> visible_meshes;
 
     void load_model(const std::string &file_path);
-    void process_node(aiNode *node, const aiScene *scene);
-    Mesh process_mesh(aiMesh *mesh, const aiScene *scene);
-    std::vector<Texture> load_material_textures(const aiMaterial *mat, aiTextureType type, std::string type_name);
+    void place_meshes(const std::vector<NodeData> &nodes);
+    void build_bvh();
+    void load_meshes(const std::string &file_path);
+    std::vector<Texture> load_textures(const std::vector<TextureRef> &refs);
 };
 
 #endif
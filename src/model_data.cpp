@@ -0,0 +1,196 @@
+#include "model_data.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "profiler.hpp"
+#include "assimp/Importer.hpp"
+#include "assimp/material.h"
+#include "assimp/postprocess.h"
+#include "assimp/scene.h"
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+struct ImportContext {
+    const aiScene *scene;
+    std::string directory;
+    ModelData data;
+};
+
+void load_material_textures(ImportContext &ctx, MeshData &mesh_data, const aiMaterial *mat, aiTextureType type,
+                            const std::string &type_name) {
+    for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
+        aiString str;
+        mat->GetTexture(type, i, &str);
+
+        const std::string file_name = ctx.directory + "/" + std::string(str.C_Str());
+
+        unsigned int index = 0;
+        while (index < ctx.data.textures.size() && ctx.data.textures[index].file_path != file_name) {
+            index++;
+        }
+
+        if (index == ctx.data.textures.size()) {
+            ctx.data.textures.push_back({file_name, type_name});
+        }
+
+        mesh_data.textures.push_back(index);
+    }
+}
+
+MeshData process_mesh(ImportContext &ctx, aiMesh *mesh) {
+    MeshData mesh_data;
+    mesh_data.name = mesh->mName.C_Str();
+    mesh_data.vertices.reserve(mesh->mNumVertices);
+    mesh_data.indices.reserve(mesh->mNumFaces * 3);
+
+    // Quantized formats need the bounds before any vertex can be encoded
+    glm::vec3 min(0.0f), max(0.0f);
+    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+        const auto &vp = mesh->mVertices[i];
+        const glm::vec3 p(vp.x, vp.y, vp.z);
+        min = i == 0 ? p : glm::min(min, p);
+        max = i == 0 ? p : glm::max(max, p);
+    }
+    mesh_data.bounds = {min, max};
+    mesh_data.quantization = VertexQuantization::from_bounds(min, max);
+
+    // Process the vertices
+    VertexEncodingError error;
+    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+        const auto &vp = mesh->mVertices[i];
+        const glm::vec3 position(vp.x, vp.y, vp.z);
+
+        const auto &vn = mesh->mNormals[i];
+        const glm::vec3 normal(vn.x, vn.y, vn.z);
+
+        glm::vec2 tex_coord(0.0f, 0.0f);
+        if (mesh->mTextureCoords[0]) {
+            const auto &vtc = mesh->mTextureCoords[0][i];
+            tex_coord = glm::vec2(vtc.x, vtc.y);
+        }
+
+        const Vertex vertex = encode_vertex(position, normal, tex_coord, mesh_data.quantization);
+        mesh_data.vertices.push_back(vertex);
+
+        float normal_error = 0.0f;
+        if (glm::length(normal) > 0.0f) {
+            const float cos_normal = glm::dot(glm::normalize(normal), glm::normalize(decode_normal(vertex)));
+            normal_error = glm::degrees(std::acos(glm::clamp(cos_normal, -1.0f, 1.0f)));
+        }
+        error.accumulate({glm::length(decode_position(vertex, mesh_data.quantization) - position), normal_error,
+                          glm::length(decode_tex_coord(vertex) - tex_coord)});
+    }
+    ctx.data.encoding_error.accumulate(error);
+
+    // Process the indices
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        const auto &face = mesh->mFaces[i];
+        for (unsigned int j = 0; j < face.mNumIndices; j++) {
+            mesh_data.indices.push_back(face.mIndices[j]);
+        }
+    }
+
+    // Process the textures
+    if (mesh->mMaterialIndex >= 0) {
+        const aiMaterial *material = ctx.scene->mMaterials[mesh->mMaterialIndex];
+        load_material_textures(ctx, mesh_data, material, aiTextureType_DIFFUSE, "texture_diffuse");
+        load_material_textures(ctx, mesh_data, material, aiTextureType_SPECULAR, "texture_specular");
+    }
+
+    return mesh_data;
+}
+
+void process_node(ImportContext &ctx, aiNode *node, int32_t parent) {
+    std::printf("processing node: %s\n", node->mName.C_Str());
+
+    // Shear doesn't survive the split into TRS, which is fine for anything an artist would export
+    aiVector3D scaling, position;
+    aiQuaternion rotation;
+    node->mTransformation.Decompose(scaling, rotation, position);
+
+    const auto index = static_cast<int32_t>(ctx.data.nodes.size());
+    NodeData node_data;
+    node_data.name = node->mName.C_Str();
+    node_data.parent = parent;
+    node_data.local.translation = glm::vec3(position.x, position.y, position.z);
+    node_data.local.rotation = glm::quat(rotation.w, rotation.x, rotation.y, rotation.z);
+    node_data.local.scale = glm::vec3(scaling.x, scaling.y, scaling.z);
+    ctx.data.nodes.push_back(std::move(node_data));
+
+    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+        aiMesh *mesh = ctx.scene->mMeshes[node->mMeshes[i]];
+        MeshData mesh_data = process_mesh(ctx, mesh);
+
+        const MeshOptimizationStats stats = optimize_mesh(mesh_data);
+        std::printf("optimized mesh %s: %zu -> %zu vertices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, "
+                    "overfetch %.2f -> %.2f\n",
+                    mesh_data.name.c_str(), stats.vertices_before, stats.vertices_after, stats.cache_before.acmr,
+                    stats.cache_after.acmr, stats.cache_before.atvr, stats.cache_after.atvr, stats.overfetch_before,
+                    stats.overfetch_after);
+
+        generate_lods(mesh_data);
+        std::printf("lods for mesh %s:", mesh_data.name.c_str());
+        for (const auto &lod : mesh_data.lods) {
+            std::printf(" %u tris (%.2f%%)", lod.index_count / 3, lod.error * 100.0f);
+        }
+        std::printf("\n");
+
+        ctx.data.nodes[index].meshes.push_back(ctx.data.meshes.size());
+        ctx.data.meshes.push_back(std::move(mesh_data));
+    }
+
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        process_node(ctx, node->mChildren[i], index);
+    }
+}
+
+} // namespace
+
+ModelData import_model(const std::string &file_path) {
+    PROFILE_ZONE("import_model");
+    Assimp::Importer importer;
+
+    const aiScene *scene = importer.ReadFile(file_path, aiProcess_Triangulate | aiProcess_FlipUVs);
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        throw std::runtime_error(std::string("Assimp error: ") + importer.GetErrorString());
+    }
+
+    ImportContext ctx{scene, file_path.substr(0, file_path.find_last_of('/')), {}};
+    process_node(ctx, scene->mRootNode, -1);
+
+    const VertexEncodingError &error = ctx.data.encoding_error;
+    std::printf("vertex format %s: %zu bytes/vertex (%zu unpacked), max error: position %g, normal %.3f deg, "
+                "tex coord %g\n",
+                vertex_format_name(), sizeof(Vertex), sizeof(glm::vec3) * 2 + sizeof(glm::vec2), error.position,
+                error.normal, error.tex_coord);
+
+    return std::move(ctx.data);
+}
+
+std::vector<NodeMesh> build_hierarchy(const std::vector<NodeData> &nodes, size_t mesh_count,
+                                      TransformHierarchy &hierarchy) {
+    std::vector<NodeMesh> placed;
+    if (nodes.empty()) {
+        const TransformNode root = hierarchy.add(TRANSFORM_NONE, {});
+        for (size_t i = 0; i < mesh_count; i++) {
+            placed.push_back({root, static_cast<uint32_t>(i)});
+        }
+        return placed;
+    }
+
+    const auto first = static_cast<TransformNode>(hierarchy.size());
+    for (const auto &node : nodes) {
+        const TransformNode parent = node.parent < 0 ? TRANSFORM_NONE : first + node.parent;
+        const TransformNode added = hierarchy.add(parent, node.local);
+        for (unsigned int mesh : node.meshes) {
+            if (mesh >= mesh_count) {
+                throw std::runtime_error("node mesh index out of range");
+            }
+            placed.push_back({added, mesh});
+        }
+    }
+    return placed;
+}
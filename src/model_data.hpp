@@ -0,0 +1,77 @@
+#ifndef MODEL_DATA_HPP
+#define MODEL_DATA_HPP
+
+#include "bounds.hpp"
+#include "transform_hierarchy.hpp"
+#include "vertex.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// CPU-side result of importing a model file. Nothing in here touches GL, so it can be produced by the bake tool or a
+// worker thread and uploaded later.
+
+struct TextureRef {
+    std::string file_path;
+    std::string type;
+};
+
+// Base mesh plus at most three simplified versions
+constexpr unsigned int MAX_MESH_LODS = 4;
+
+// One level of detail: a slice of the mesh's index buffer drawing the shared vertex buffer
+struct MeshLod {
+    uint32_t first_index;
+    uint32_t index_count;
+    // Worst geometric error of the simplification, as a fraction of the mesh's bounding box diagonal
+    float error;
+};
+
+struct MeshData {
+    std::string name;
+    std::vector<Vertex> vertices;
+    // Every LOD's indices, finest first
+    std::vector<unsigned int> indices;
+    // LOD 0 is the full mesh; empty means `indices` is LOD 0 alone
+    std::vector<MeshLod> lods;
+    VertexQuantization quantization;
+    AABB bounds;
+    // Indices into ModelData::textures
+    std::vector<unsigned int> textures;
+};
+
+// One node of the source file's scene graph
+struct NodeData {
+    std::string name;
+    // Index into ModelData::nodes, or -1 for the root; always lower than the node's own index
+    int32_t parent;
+    Transform local;
+    // Indices into ModelData::meshes, drawn with this node's world transform
+    std::vector<unsigned int> meshes;
+};
+
+struct ModelData {
+    std::vector<MeshData> meshes;
+    // Depth first, so each node's subtree follows it
+    std::vector<NodeData> nodes;
+    std::vector<TextureRef> textures;
+    // Precision lost encoding the float source into the compile-time Vertex format
+    VertexEncodingError encoding_error;
+};
+
+// Runs Assimp over file_path and flattens every node's meshes into a ModelData.
+ModelData import_model(const std::string &file_path);
+
+// A mesh placed by a node. A mesh some file references from several nodes is imported once per reference.
+struct NodeMesh {
+    TransformNode node;
+    uint32_t mesh;
+};
+
+// Adds `nodes` to the hierarchy and returns every mesh they place, in node order. Without nodes (models built from
+// bare meshes) each mesh goes under a single identity root.
+std::vector<NodeMesh> build_hierarchy(const std::vector<NodeData> &nodes, size_t mesh_count,
+                                      TransformHierarchy &hierarchy);
+
+#endif
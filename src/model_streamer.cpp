@@ -0,0 +1,521 @@
+#include "model_streamer.hpp"
+#include "geometry_arena.hpp"
+#include "mesh_cache.hpp"
+#include "profiler.hpp"
+#include "texture_loader.hpp"
+#include "thread_pool.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::duration<double, std::milli>;
+
+namespace {
+
+// A mesh from either source, with spans into whichever of ModelLoad::baked / ModelLoad::data owns the arrays
+struct StreamedMesh {
+    std::string name;
+    std::span<const Vertex> vertices;
+    std::span<const unsigned int> indices;
+    std::vector<MeshLod> lods;
+    VertexQuantization quantization;
+    AABB bounds;
+    std::vector<unsigned int> textures;
+};
+
+struct UploadItem {
+    enum Kind { VERTICES, INDICES, TEXTURE };
+
+    Kind kind;
+    // Mesh or texture index
+    unsigned int index;
+    size_t bytes;
+    size_t done;
+};
+
+template <typename MeshSource> StreamedMesh streamed_mesh(const MeshSource &mesh) {
+    return {mesh.name, mesh.vertices, mesh.indices, mesh.lods, mesh.quantization, mesh.bounds, mesh.textures};
+}
+
+const AABB UNIT_BOX = {glm::vec3(-0.5f), glm::vec3(0.5f)};
+
+constexpr int PLACEHOLDER_TEXTURE_SIZE = 8;
+
+// A unit cube around the origin with a grey checkerboard, wound counter-clockwise from outside
+std::unique_ptr<Mesh> make_placeholder() {
+    const VertexQuantization quantization = VertexQuantization::from_bounds(UNIT_BOX.min, UNIT_BOX.max);
+
+    // normal, then two edge directions whose cross product is the normal
+    const glm::vec3 faces[6][3] = {
+        {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}},  {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}}, {{0, 1, 0}, {0, 0, 1}, {1, 0, 0}},
+        {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}}, {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}},  {{0, 0, -1}, {0, 1, 0}, {1, 0, 0}},
+    };
+    const glm::vec2 corners[4] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    for (const auto &face : faces) {
+        const unsigned int first = vertices.size();
+        for (const auto &c : corners) {
+            const glm::vec3 position = 0.5f * (face[0] + c.x * face[1] + c.y * face[2]);
+            vertices.push_back(encode_vertex(position, face[0], c * 0.5f + glm::vec2(0.5f), quantization));
+        }
+        indices.insert(indices.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+    }
+
+    Image checker;
+    checker.width = checker.height = PLACEHOLDER_TEXTURE_SIZE;
+    checker.channels = 3;
+    checker.pixels = {static_cast<unsigned char *>(std::malloc(checker.size_bytes())), std::free};
+    for (int y = 0; y < checker.height; y++) {
+        for (int x = 0; x < checker.width; x++) {
+            const unsigned char shade = (x + y) % 2 ? 96 : 160;
+            std::memset(checker.pixels.get() + (size_t(y) * checker.width + x) * 3, shade, 3);
+        }
+    }
+
+    std::vector<Texture> textures;
+    textures.emplace_back("<placeholder>", "texture_diffuse", checker);
+    glBindTexture(GL_TEXTURE_2D, textures.back().id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return std::make_unique<Mesh>("placeholder", vertices, indices, textures, quantization, UNIT_BOX);
+}
+
+} // namespace
+
+// The CPU side of a load, shared by every load of the same path requested while it decodes, so the file is read (or
+// imported and baked) once however many copies are asked for
+struct ModelDecode {
+    std::string path;
+
+    // Filled by the worker tasks; the GL thread only reads them once the decode reaches the inbox
+    std::mutex error_mutex;
+    std::string error;
+    std::unique_ptr<BakedModel> baked;
+    ModelData data;
+    std::vector<StreamedMesh> meshes;
+    std::vector<NodeData> nodes;
+    std::vector<TextureRef> texture_refs;
+    std::vector<std::optional<Image>> images;
+    AABB bounds = UNIT_BOX;
+    // The geometry task plus every texture decode still running; whoever finishes last hands the decode over
+    std::atomic<unsigned int> pending{1};
+
+    void fail(const std::string &message) {
+        std::lock_guard lock(error_mutex);
+        if (error.empty()) {
+            error = message;
+        }
+    }
+};
+
+struct ModelLoad {
+    std::string path;
+    Clock::time_point requested;
+    std::atomic<LoadState> state{LoadState::LOADING};
+
+    // GL thread only
+    std::string error;
+    // Set once the decode arrives, and dropped again when the load is ready
+    std::shared_ptr<ModelDecode> decode;
+    AABB bounds = UNIT_BOX;
+    std::vector<GeometryAllocation> allocations;
+    std::vector<unsigned int> texture_ids;
+    std::vector<UploadItem> items;
+    size_t next_item = 0;
+    std::unique_ptr<Model> model;
+    double load_ms = 0.0;
+};
+
+struct ModelStreamer::Inbox {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ModelDecode>> decodes;
+
+    void push(std::shared_ptr<ModelDecode> decode) {
+        std::lock_guard lock(mutex);
+        decodes.push_back(std::move(decode));
+    }
+};
+
+LoadState ModelHandle::state() const { return m_load ? m_load->state.load() : LoadState::FAILED; }
+
+const std::string &ModelHandle::path() const { return m_load->path; }
+
+const Model *ModelHandle::model() const { return ready() ? m_load->model.get() : nullptr; }
+
+const std::string &ModelHandle::error() const {
+    static const std::string none;
+    return failed() && m_load ? m_load->error : none;
+}
+
+AABB ModelHandle::bounds() const {
+    const LoadState s = state();
+    return s == LoadState::UPLOADING || s == LoadState::READY ? m_load->bounds : UNIT_BOX;
+}
+
+double ModelHandle::load_ms() const { return ready() ? m_load->load_ms : 0.0; }
+
+ModelStreamer::ModelStreamer() : m_inbox(std::make_shared<Inbox>()), m_staging_size(budget.chunk_bytes) {
+    glGenBuffers(1, &m_staging);
+    m_placeholder = make_placeholder();
+}
+
+ModelStreamer::~ModelStreamer() {
+    // Half-uploaded loads give their arena space back; ready models keep theirs until their last handle goes
+    for (const auto &load : m_uploading) {
+        for (const auto &allocation : load->allocations) {
+            GeometryArena::shared().release(allocation);
+        }
+    }
+    glDeleteBuffers(1, &m_staging);
+}
+
+ModelHandle ModelStreamer::load(const std::string &file_path) {
+    auto load = std::make_shared<ModelLoad>();
+    load->path = file_path;
+    load->requested = Clock::now();
+    m_stats.loads_requested++;
+
+    // Join a decode of the same file that is still running rather than start another; several workers importing one
+    // model at once would each bake its mesh cache over the same file
+    auto [waiting, first] = m_decoding.try_emplace(file_path);
+    waiting->second.push_back(load);
+    if (!first) {
+        return ModelHandle(load);
+    }
+
+    auto decode = std::make_shared<ModelDecode>();
+    decode->path = file_path;
+    ThreadPool::shared().submit([decode, inbox = m_inbox] {
+        PROFILE_ZONE("ModelStreamer decode");
+        try {
+            if (auto baked = open_mesh_cache(decode->path)) {
+                decode->baked = std::move(baked);
+                decode->texture_refs = decode->baked->textures;
+                decode->nodes = decode->baked->nodes;
+                for (const auto &mesh : decode->baked->meshes) {
+                    decode->meshes.push_back(streamed_mesh(mesh));
+                }
+            } else {
+                decode->data = import_model(decode->path);
+                try {
+                    write_mesh_cache(decode->path, decode->data);
+                } catch (const std::exception &e) {
+                    std::fprintf(stderr, "couldn't bake mesh cache for %s: %s\n", decode->path.c_str(), e.what());
+                }
+                decode->texture_refs = decode->data.textures;
+                decode->nodes = decode->data.nodes;
+                for (const auto &mesh : decode->data.meshes) {
+                    decode->meshes.push_back(streamed_mesh(mesh));
+                }
+            }
+
+            // Placed the way the finished Model will place them, so the placeholder covers the same space
+            TransformHierarchy transforms;
+            const std::vector<NodeMesh> placed = build_hierarchy(decode->nodes, decode->meshes.size(), transforms);
+            transforms.update();
+            for (size_t i = 0; i < placed.size(); i++) {
+                const AABB bounds =
+                    decode->meshes[placed[i].mesh].bounds.transformed(transforms.world(placed[i].node));
+                if (i == 0) {
+                    decode->bounds = bounds;
+                } else {
+                    decode->bounds.expand(bounds);
+                }
+            }
+
+            // Each texture decodes in its own task so one model's textures spread over the pool
+            decode->images.resize(decode->texture_refs.size());
+            decode->pending += decode->texture_refs.size();
+            for (size_t i = 0; i < decode->texture_refs.size(); i++) {
+                ThreadPool::shared().submit([decode, inbox, i] {
+                    try {
+                        decode->images[i] = Image::load(decode->texture_refs[i].file_path);
+                    } catch (const std::exception &e) {
+                        decode->fail(e.what());
+                    }
+                    if (--decode->pending == 0) {
+                        inbox->push(decode);
+                    }
+                });
+            }
+        } catch (const std::exception &e) {
+            decode->fail(e.what());
+        }
+
+        if (--decode->pending == 0) {
+            inbox->push(decode);
+        }
+    });
+
+    return ModelHandle(load);
+}
+
+void ModelStreamer::update() {
+    PROFILE_ZONE("ModelStreamer::update");
+    const auto start = Clock::now();
+    m_stats.bytes = 0;
+    m_stats.chunks = 0;
+
+    std::vector<std::shared_ptr<ModelDecode>> arrived;
+    {
+        std::lock_guard lock(m_inbox->mutex);
+        arrived.swap(m_inbox->decodes);
+    }
+
+    for (const auto &decode : arrived) {
+        const auto waiting = m_decoding.extract(decode->path);
+        for (const auto &load : waiting.mapped()) {
+            load->error = decode->error;
+            if (load->error.empty()) {
+                try {
+                    load->decode = decode;
+                    load->bounds = decode->bounds;
+                    plan_uploads(*load);
+                    load->state = LoadState::UPLOADING;
+                    m_uploading.push_back(load);
+                    continue;
+                } catch (const std::exception &e) {
+                    load->error = e.what();
+                    load->decode.reset();
+                }
+            }
+
+            std::fprintf(stderr, "couldn't load %s: %s\n", load->path.c_str(), load->error.c_str());
+            load->state = LoadState::FAILED;
+            m_stats.loads_failed++;
+        }
+    }
+
+    while (!m_uploading.empty()) {
+        ModelLoad &load = *m_uploading.front();
+        if (load.next_item == load.items.size()) {
+            finish(load);
+            m_uploading.pop_front();
+            continue;
+        }
+
+        if (m_stats.chunks > 0 && (m_stats.bytes >= budget.bytes_per_frame ||
+                                   Millis(Clock::now() - start).count() >= budget.ms_per_frame)) {
+            break;
+        }
+
+        m_stats.bytes += upload_chunk(load);
+        m_stats.chunks++;
+    }
+
+    m_stats.total_bytes += m_stats.bytes;
+    m_stats.ms = Millis(Clock::now() - start).count();
+}
+
+void ModelStreamer::submit(RenderQueue &queue, const Shader &shader, const ModelHandle &handle,
+                           const glm::mat4 &model, Uniform<glm::mat4> model_uniform, RenderLayer layer,
+                           LodState *lod_state) const {
+    if (const Model *loaded = handle.model()) {
+        loaded->submit(queue, shader, model, model_uniform, layer, lod_state);
+        return;
+    }
+    if (!handle.valid() || handle.failed()) {
+        return;
+    }
+
+    const AABB bounds = handle.bounds();
+    const glm::vec3 size = glm::max(bounds.extent(), glm::vec3(1e-3f));
+    const glm::mat4 box = glm::scale(glm::translate(model, bounds.center()), size);
+    m_placeholder->submit(queue, shader, box, model_uniform, layer);
+}
+
+void ModelStreamer::plan_uploads(ModelLoad &load) {
+    ModelDecode &decode = *load.decode;
+    GeometryArena &arena = GeometryArena::shared();
+    for (size_t i = 0; i < decode.meshes.size(); i++) {
+        const StreamedMesh &mesh = decode.meshes[i];
+        load.allocations.push_back(arena.allocate(mesh.vertices.size(), mesh.indices.size()));
+        load.items.push_back({UploadItem::VERTICES, unsigned(i), mesh.vertices.size() * arena.stride(), 0});
+        load.items.push_back({UploadItem::INDICES, unsigned(i), mesh.indices.size() * sizeof(unsigned int), 0});
+    }
+
+    load.texture_ids.resize(decode.texture_refs.size());
+    for (size_t i = 0; i < decode.texture_refs.size(); i++) {
+        const auto it = m_textures.find(decode.texture_refs[i].file_path);
+        if (it != m_textures.end()) {
+            // Another load owns this one, so it isn't uploaded twice. The image stays: when that load shares this
+            // decode, it is the one still uploading it.
+            load.texture_ids[i] = it->second;
+            continue;
+        }
+
+        std::optional<Image> &decoded = decode.images[i];
+        if (decoded->compressed && !texture_codec_supported(decoded->compressed->codec)) {
+            // The driver can't sample the baked format (no S3TC), so go back to the source image
+            decoded = Image::decode(decode.texture_refs[i].file_path);
+        }
+        const Image &image = *decoded;
+        if (!image.compressed) {
+            image.format();
+        }
+        glGenTextures(1, &load.texture_ids[i]);
+        m_textures.emplace(decode.texture_refs[i].file_path, load.texture_ids[i]);
+        load.items.push_back({UploadItem::TEXTURE, unsigned(i), image.size_bytes(), 0});
+    }
+
+    // Zero-sized meshes have nothing to copy
+    std::erase_if(load.items, [](const UploadItem &item) { return item.bytes == 0; });
+}
+
+size_t ModelStreamer::upload_chunk(ModelLoad &load) {
+    PROFILE_ZONE("ModelStreamer upload chunk");
+    UploadItem &item = load.items[load.next_item];
+    size_t bytes = 0;
+
+    if (item.kind == UploadItem::TEXTURE) {
+        const Image &image = *load.decode->images[item.index];
+        glBindTexture(GL_TEXTURE_2D, load.texture_ids[item.index]);
+        if (item.done == 0) {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+
+        bytes = image.compressed ? upload_compressed_rows(image, item.done) : upload_rows(image, item.done);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (item.done + bytes == item.bytes) {
+            if (!image.compressed) {
+                glGenerateMipmap(GL_TEXTURE_2D);
+            }
+            load.decode->images[item.index].reset();
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    } else {
+        GeometryArena &arena = GeometryArena::shared();
+        const StreamedMesh &mesh = load.decode->meshes[item.index];
+        const GeometryAllocation &allocation = load.allocations[item.index];
+        const bool vertices = item.kind == UploadItem::VERTICES;
+
+        const char *source = vertices ? reinterpret_cast<const char *>(mesh.vertices.data())
+                                      : reinterpret_cast<const char *>(mesh.indices.data());
+        const size_t offset = vertices ? size_t(allocation.base_vertex) * arena.stride()
+                                       : size_t(allocation.first_index) * sizeof(unsigned int);
+        bytes = std::min(budget.chunk_bytes, item.bytes - item.done);
+
+        stage(GL_COPY_READ_BUFFER, source + item.done, bytes);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertices ? arena.vertex_buffer() : arena.index_buffer());
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, offset + item.done, bytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    item.done += bytes;
+    if (item.done == item.bytes) {
+        load.next_item++;
+    }
+    return bytes;
+}
+
+size_t ModelStreamer::upload_rows(const Image &image, size_t done) {
+    const GLenum format = image.format();
+    const size_t row_bytes = size_t(image.width) * image.channels;
+    const size_t first_row = done / row_bytes;
+    const size_t rows = std::clamp<size_t>(budget.chunk_bytes / row_bytes, 1, image.height - first_row);
+
+    if (done == 0) {
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+    }
+    stage(GL_PIXEL_UNPACK_BUFFER, image.pixels.get() + done, rows * row_bytes);
+    // Decoded rows are tightly packed, which the default alignment of 4 doesn't allow for RGB
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first_row, image.width, rows, format, GL_UNSIGNED_BYTE, nullptr);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    return rows * row_bytes;
+}
+
+size_t ModelStreamer::upload_compressed_rows(const Image &image, size_t done) {
+    const CompressedTexture &texture = *image.compressed;
+    const GLenum format = texture_codec_gl_format(texture.codec);
+
+    if (done == 0) {
+        // Allocate every level up front; the chunks fill them in from the top of the chain down
+        int width = texture.width, height = texture.height;
+        for (size_t level = 0; level < texture.levels.size(); level++) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, texture.levels[level].size(),
+                                   nullptr);
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.levels.size() - 1);
+    }
+
+    // `done` counts through the levels back to back
+    size_t level = 0, offset = done;
+    int width = texture.width, height = texture.height;
+    while (offset >= texture.levels[level].size()) {
+        offset -= texture.levels[level].size();
+        level++;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+
+    // Whole rows of 4x4 blocks, never crossing into the next level
+    const size_t row_bytes = compressed_level_size(texture.codec, width, 1);
+    const size_t first_row = offset / row_bytes;
+    const size_t rows = std::clamp<size_t>(budget.chunk_bytes / row_bytes, 1, (height + 3) / 4 - first_row);
+    const int y = first_row * 4;
+
+    stage(GL_PIXEL_UNPACK_BUFFER, texture.levels[level].data() + offset, rows * row_bytes);
+    glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, std::min<int>(rows * 4, height - y), format,
+                              rows * row_bytes, nullptr);
+    return rows * row_bytes;
+}
+
+void ModelStreamer::finish(ModelLoad &load) {
+    PROFILE_ZONE("ModelStreamer finish");
+    const ModelDecode &decode = *load.decode;
+    std::vector<Mesh> meshes;
+    meshes.reserve(decode.meshes.size());
+    for (size_t i = 0; i < decode.meshes.size(); i++) {
+        const StreamedMesh &mesh = decode.meshes[i];
+        std::vector<Texture> textures;
+        for (unsigned int t : mesh.textures) {
+            textures.emplace_back(load.texture_ids[t], decode.texture_refs[t].file_path, decode.texture_refs[t].type);
+        }
+        meshes.emplace_back(mesh.name, load.allocations[i], textures, mesh.quantization, mesh.bounds, mesh.lods);
+    }
+    // The meshes own the arena space now and give it back when the model goes
+    load.allocations.clear();
+    load.model = std::make_unique<Model>(std::move(meshes), decode.nodes);
+
+    // Everything CPU-side is on the GPU now; the last load sharing the decode frees its arrays and images
+    load.decode.reset();
+    load.items.clear();
+
+    load.load_ms = Millis(Clock::now() - load.requested).count();
+    load.state = LoadState::READY;
+    m_stats.loads_ready++;
+}
+
+void ModelStreamer::stage(GLenum target, const void *data, size_t bytes) {
+    glBindBuffer(target, m_staging);
+    m_staging_size = std::max(m_staging_size, bytes);
+    // Orphan first: the copy out of the previous chunk may still be queued, and this way it never has to wait
+    glBufferData(target, m_staging_size, nullptr, GL_STREAM_DRAW);
+    void *mapped = glMapBufferRange(target, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!mapped) {
+        glBindBuffer(target, 0);
+        throw std::runtime_error("couldn't map the streaming staging buffer");
+    }
+    std::memcpy(mapped, data, bytes);
+    glUnmapBuffer(target);
+}
@@ -0,0 +1,145 @@
+#ifndef MODEL_STREAMER_HPP
+#define MODEL_STREAMER_HPP
+
+#include "bounds.hpp"
+#include "lod.hpp"
+#include "mesh.hpp"
+#include "model.hpp"
+#include "render_queue.hpp"
+#include "shader.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Asynchronous model loading.
+//
+// ModelStreamer::load returns a handle right away. The mesh cache read (or the Assimp import and bake) runs on the
+// shared thread pool, and every texture decodes in its own pool task. The GL side then happens in update(), called
+// once per frame on the GL thread: vertex, index and pixel data go through a staging buffer in chunks, copied into
+// the geometry arena with glCopyBufferSubData and into textures from the same buffer bound as a pixel unpack buffer
+// (baked, block-compressed textures go level by level through glCompressedTexSubImage2D).
+// Each update() stops once its byte or time budget is spent, so a big load is spread over many frames instead of
+// stalling one. Loads upload in the order their decodes finished; a handle turns ready once all of its data is on the
+// GPU.
+//
+// Until then, submit() draws a placeholder box: a unit cube before the geometry is decoded, the model's bounds after.
+
+enum class LoadState { LOADING, UPLOADING, READY, FAILED };
+
+struct StreamingBudget {
+    // update() stops after this many bytes or this much time, whichever comes first. At least one chunk always goes
+    // through, so a tiny budget slows loads down but can't stall them.
+    size_t bytes_per_frame = size_t(8) << 20;
+    double ms_per_frame = 2.0;
+    // Largest single copy; bigger meshes and textures are split (textures by whole rows)
+    size_t chunk_bytes = size_t(1) << 20;
+};
+
+struct StreamingStats {
+    // Most recent update()
+    size_t bytes = 0;
+    unsigned int chunks = 0;
+    double ms = 0.0;
+
+    // Since the streamer was created
+    size_t total_bytes = 0;
+    unsigned int loads_requested = 0;
+    unsigned int loads_ready = 0;
+    unsigned int loads_failed = 0;
+
+    unsigned int loads_pending() const { return loads_requested - loads_ready - loads_failed; }
+};
+
+struct ModelLoad;
+
+class ModelHandle {
+  public:
+    ModelHandle() = default;
+
+    bool valid() const { return m_load != nullptr; }
+    LoadState state() const;
+    bool ready() const { return state() == LoadState::READY; }
+    bool failed() const { return state() == LoadState::FAILED; }
+
+    const std::string &path() const;
+    // Null until ready
+    const Model *model() const;
+    // Why the load failed; empty otherwise
+    const std::string &error() const;
+    // Model-space bounds of every mesh once the geometry is decoded, a unit cube around the origin before that
+    AABB bounds() const;
+    // From load() to ready, 0 until then
+    double load_ms() const;
+
+  private:
+    friend class ModelStreamer;
+    explicit ModelHandle(std::shared_ptr<ModelLoad> load) : m_load(std::move(load)) {}
+
+    std::shared_ptr<ModelLoad> m_load;
+};
+
+class ModelStreamer {
+  public:
+    StreamingBudget budget;
+
+    // Needs a current GL context (for the staging buffer and the placeholder)
+    ModelStreamer();
+    ~ModelStreamer();
+
+    ModelStreamer(const ModelStreamer &) = delete;
+    ModelStreamer &operator=(const ModelStreamer &) = delete;
+
+    // Starts loading file_path; never blocks. Every call gets a separate load and Model, but loads of a path requested
+    // while an earlier one is still decoding share that decode rather than reading the file again.
+    ModelHandle load(const std::string &file_path);
+
+    // GL thread, once per frame: picks up finished decodes and uploads within the budget
+    void update();
+
+    const StreamingStats &stats() const { return m_stats; }
+    // Nothing decoding or waiting for upload
+    bool idle() const { return m_stats.loads_pending() == 0; }
+
+    // Model::submit once the handle is ready, the placeholder box (stretched over handle.bounds()) until then; a
+    // failed load draws nothing
+    void submit(RenderQueue &queue, const Shader &shader, const ModelHandle &handle, const glm::mat4 &model,
+                Uniform<glm::mat4> model_uniform, RenderLayer layer = RenderLayer::OPAQUE,
+                LodState *lod_state = nullptr) const;
+
+  private:
+    struct Inbox;
+
+    // Shared with the worker tasks, which may outlive the streamer
+    std::shared_ptr<Inbox> m_inbox;
+    // Decoded loads, front first; only the front one uploads
+    std::deque<std::shared_ptr<ModelLoad>> m_uploading;
+    // Loads waiting for a decode, by path; the first one started it
+    std::unordered_map<std::string, std::vector<std::shared_ptr<ModelLoad>>> m_decoding;
+    // Texture objects by file path, so loads sharing a texture upload it once
+    std::unordered_map<std::string, unsigned int> m_textures;
+
+    unsigned int m_staging;
+    size_t m_staging_size;
+    std::unique_ptr<Mesh> m_placeholder;
+
+    StreamingStats m_stats;
+
+    void plan_uploads(ModelLoad &load);
+    // Copies the next chunk of the front load and returns its size
+    size_t upload_chunk(ModelLoad &load);
+    // Texture chunks, starting `done` bytes in; the texture is bound
+    size_t upload_rows(const Image &image, size_t done);
+    size_t upload_compressed_rows(const Image &image, size_t done);
+    void finish(ModelLoad &load);
+    // Orphans the staging buffer and fills its first `bytes` from `data`
+    void stage(GLenum target, const void *data, size_t bytes);
+};
+
+#endif
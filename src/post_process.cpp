@@ -0,0 +1,220 @@
+#include "post_process.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr const char *FULLSCREEN_VERTEX = "res/shaders/vertex_fullscreen.glsl";
+constexpr unsigned int SOURCE_UNIT = 0;
+constexpr unsigned int SCENE_UNIT = 1;
+// Timer tags are frame * TAG_STRIDE + pass, with the present copy as the last pass index
+constexpr uint64_t TAG_STRIDE = 256;
+// Enough for every pass of a few frames in flight
+constexpr unsigned int TIMER_RING = 256;
+
+// A 9x9 Gaussian: radius 4, about two sigma
+constexpr int BLUR_RADIUS = 4;
+constexpr float BLUR_SIGMA = 2.0f;
+
+// The two halves of a separable blur, with their taps set once
+void add_blur(PostChain &chain, const std::string &name, float scale) {
+    const LinearTaps taps = linear_gaussian_taps(BLUR_RADIUS, BLUR_SIGMA);
+    const auto setup = [taps](Shader &shader) {
+        shader.set(shader.uniform<float>("tapOffsets"), taps.offsets);
+        shader.set(shader.uniform<float>("tapWeights"), taps.weights);
+    };
+    const int tap_count = static_cast<int>(taps.offsets.size());
+    for (int axis : {0, 1}) {
+        chain.add({name, "res/shaders/fragment_blur.glsl", {{"BLUR_AXIS", axis}, {"BLUR_TAPS", tap_count}}, scale,
+                   false, setup});
+    }
+}
+
+} // namespace
+
+LinearTaps linear_gaussian_taps(int radius, float sigma) {
+    std::vector<float> kernel(radius + 1);
+    float total = 0.0f;
+    for (int k = 0; k <= radius; k++) {
+        kernel[k] = std::exp(-float(k * k) / (2.0f * sigma * sigma));
+        total += k == 0 ? kernel[k] : 2.0f * kernel[k];
+    }
+    for (float &weight : kernel) {
+        weight /= total;
+    }
+
+    LinearTaps taps;
+    taps.offsets.push_back(0.0f);
+    taps.weights.push_back(kernel[0]);
+    for (int k = 1; k <= radius; k += 2) {
+        // An odd radius leaves the outermost texel without a partner; it's sampled on its own
+        const float a = kernel[k], b = k + 1 <= radius ? kernel[k + 1] : 0.0f;
+        taps.offsets.push_back((k * a + (k + 1) * b) / (a + b));
+        taps.weights.push_back(a + b);
+    }
+    return taps;
+}
+
+glm::ivec2 scaled_size(glm::ivec2 size, float scale) {
+    return glm::max(glm::ivec2(glm::round(glm::vec2(size) * scale)), glm::ivec2(1));
+}
+
+PostChain::PostChain() : m_timer(TIMER_RING) {
+    glGenVertexArrays(1, &m_vao);
+    m_present = build("res/shaders/fragment_framebuffer.glsl", {{"EFFECT", 0}});
+    m_upscale = build("res/shaders/fragment_upscale.glsl", {});
+}
+
+PostChain::~PostChain() { glDeleteVertexArrays(1, &m_vao); }
+
+PostChain::Program PostChain::build(const std::string &fragment, const ShaderDefines &defines) {
+    Program program;
+    program.shader = &m_shaders.get(FULLSCREEN_VERTEX, fragment, defines);
+    program.source = program.shader->uniform<int>("sourceTexture");
+    program.scene = program.shader->uniform<int>("sceneTexture");
+    program.source_texel = program.shader->uniform<glm::vec2>("sourceTexel");
+
+    program.shader->use();
+    program.shader->set(program.source, SOURCE_UNIT);
+    program.shader->set(program.scene, SCENE_UNIT);
+    return program;
+}
+
+void PostChain::add(PostPass pass) {
+    if (m_passes.size() + 1 >= TAG_STRIDE) {
+        throw std::runtime_error("too many post passes");
+    }
+    const Program program = build(pass.fragment, pass.defines);
+    if (pass.setup) {
+        program.shader->use();
+        pass.setup(*program.shader);
+    }
+    m_passes.push_back(std::move(pass));
+    m_programs.push_back(program);
+}
+
+const std::string &PostChain::pass_name(unsigned int pass) const {
+    static const std::string present = "present";
+    return pass < m_passes.size() ? m_passes[pass].name : present;
+}
+
+bool PostChain::set_enabled(const std::string &name, bool enabled) {
+    bool found = false;
+    for (auto &pass : m_passes) {
+        if (pass.name == name) {
+            pass.enabled = enabled;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool PostChain::toggle(const std::string &name) { return set_enabled(name, !enabled(name)); }
+
+bool PostChain::enabled(const std::string &name) const {
+    bool any = false;
+    for (const auto &pass : m_passes) {
+        if (pass.name == name) {
+            if (!pass.enabled) {
+                return false;
+            }
+            any = true;
+        }
+    }
+    return any;
+}
+
+void PostChain::add_pass(FrameGraph &graph, const std::string &name, const Program &program, FrameResource input,
+                         FrameResource source, FrameResource output, uint64_t tag, bool first, bool final) {
+    // Only the passes that sample the scene keep it alive
+    const bool reads_source = program.scene.valid() && source != input;
+    FramePass pass;
+    pass.name = name;
+    pass.reads = {input};
+    pass.writes = {output};
+    if (reads_source) {
+        pass.reads.push_back(source);
+    }
+    pass.execute = [this, program, input, source, reads_source, tag, first, final](const FrameGraph &graph) {
+        m_timer.begin(tag);
+        program.shader->use();
+        program.shader->set(program.source_texel, 1.0f / glm::vec2(graph.size(input)));
+        if (reads_source) {
+            glActiveTexture(GL_TEXTURE0 + SCENE_UNIT);
+            glBindTexture(GL_TEXTURE_2D, graph.texture(source));
+        }
+        glActiveTexture(GL_TEXTURE0 + SOURCE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, graph.texture(input));
+        glBindVertexArray(m_vao);
+
+        if (first) {
+            glDisable(GL_DEPTH_TEST);
+        }
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        if (final) {
+            glEnable(GL_DEPTH_TEST);
+        }
+        glBindVertexArray(0);
+        m_timer.end();
+    };
+    graph.add_pass(std::move(pass));
+}
+
+void PostChain::add_passes(FrameGraph &graph, FrameResource source, FrameResource output, uint64_t frame) {
+    const glm::ivec2 source_size = graph.size(source), output_size = graph.size(output);
+
+    unsigned int last = PRESENT;
+    for (unsigned int i = 0; i < m_passes.size(); i++) {
+        if (m_passes[i].enabled) {
+            last = i;
+        }
+    }
+
+    // The last enabled pass writes `output` itself when it runs at full res and no upscale is needed
+    const bool presented = last != PRESENT && m_passes[last].scale == 1.0f && source_size == output_size;
+
+    FrameResource input = source;
+    bool first = true;
+    for (unsigned int i = 0; i < m_passes.size(); i++) {
+        const PostPass &pass = m_passes[i];
+        if (!pass.enabled) {
+            continue;
+        }
+        const bool final = presented && i == last;
+        const FrameResource out =
+            final ? output : graph.create(pass.name, scaled_size(source_size, pass.scale), GL_RGBA8);
+        add_pass(graph, pass.name, m_programs[i], input, source, out, frame * TAG_STRIDE + i, first, final);
+        input = out;
+        first = false;
+    }
+
+    if (!presented) {
+        const bool upscale = graph.size(input) != output_size;
+        add_pass(graph, upscale ? "upscale" : "present", upscale ? m_upscale : m_present, input, source, output,
+                 frame * TAG_STRIDE + m_passes.size(), first, true);
+    }
+}
+
+void PostChain::collect(std::vector<PostTiming> &out, bool wait) {
+    std::vector<GpuTiming> timings;
+    m_timer.collect(timings, wait);
+    for (const auto &timing : timings) {
+        const unsigned int pass = static_cast<unsigned int>(timing.tag % TAG_STRIDE);
+        out.push_back({timing.tag / TAG_STRIDE, pass < m_passes.size() ? pass : PRESENT, timing.ms});
+    }
+}
+
+void add_standard_passes(PostChain &chain) {
+    chain.add({"bloom", "res/shaders/fragment_bloom.glsl", {{"BLOOM_COMPOSITE", 0}}, 0.5f, false, nullptr});
+    add_blur(chain, "bloom", 0.25f);
+    chain.add({"bloom", "res/shaders/fragment_bloom.glsl", {{"BLOOM_COMPOSITE", 1}}, 1.0f, false, nullptr});
+
+    add_blur(chain, "blur", 0.5f);
+
+    const std::pair<const char *, int> effects[] = {{"grayscale", 2}, {"invert", 1}, {"sharpen", 3}, {"edge", 4}};
+    for (const auto &[name, effect] : effects) {
+        chain.add({name, "res/shaders/fragment_framebuffer.glsl", {{"EFFECT", effect}}, 1.0f, false, nullptr});
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef POST_PROCESS_HPP
+#define POST_PROCESS_HPP
+
+#include "frame_graph.hpp"
+#include "gpu_timer.hpp"
+#include "shader.hpp"
+#include "shader_library.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Offsets (in texels) and weights of a separable Gaussian blur folded for linear sampling. Entry 0 is the centre texel;
+// every other entry stands for the two texels k and k + 1 at once: sampled at the weighted mean of their offsets, the
+// bilinear filter returns exactly w[k] * t[k] + w[k + 1] * t[k + 1] (scaled by the entry's weight), and the shader
+// takes each entry on both sides of the centre. A kernel of 2 * radius + 1 texels costs 1 + 2 * ceil(radius / 2)
+// samples per axis: 5 instead of 9 for radius 4, so a 9x9 blur takes 10 samples instead of 81.
+struct LinearTaps {
+    std::vector<float> offsets;
+    std::vector<float> weights;
+};
+
+// Weights are normalized over the full 2 * radius + 1 texels
+LinearTaps linear_gaussian_taps(int radius, float sigma);
+
+// Size of a pass target at `scale` of `size`, never below 1x1
+glm::ivec2 scaled_size(glm::ivec2 size, float scale);
+
+// One full-screen pass: fragment shader `fragment` (a permutation picked by `defines`) on vertex_fullscreen.glsl.
+// Every pass shader may use
+//   sampler2D sourceTexture   the previous pass's output, or the chain's input for the first pass (unit 0)
+//   sampler2D sceneTexture    the chain's input, for passes that combine with it (unit 1)
+//   vec2 sourceTexel          1 / sourceTexture's size
+struct PostPass {
+    // Passes are toggled by name; the passes of one effect (say the two halves of a blur) share a name
+    std::string name;
+    std::string fragment;
+    ShaderDefines defines;
+    // Resolution relative to the chain's input, e.g. 0.5 for a half-res blur
+    float scale = 1.0f;
+    bool enabled = true;
+    // Sets the pass's constant uniforms once, right after its program is built (with the program bound)
+    std::function<void(Shader &)> setup;
+};
+
+struct PostTiming {
+    // The tag passed to add_passes()
+    uint64_t frame;
+    // Index into passes(), or PostChain::PRESENT for the final copy
+    unsigned int pass;
+    double ms;
+};
+
+// An ordered list of passes run over a scene's colour texture into an output, declared on a frame graph. Passes work
+// at the input's resolution (times their scale), each into a transient the graph aliases with the others. The last
+// enabled pass draws straight into the output when input and output are the same size and the pass is full
+// resolution. Otherwise (and when no pass is enabled) a final step, timed as PRESENT, finishes the chain: a plain copy
+// at the same size, a Catmull-Rom upscale (res/shaders/fragment_upscale.glsl) when the input was drawn smaller. Each
+// pass's GPU time is measured with timestamp queries and read back a few frames later, without stalling.
+class PostChain {
+  public:
+    static constexpr unsigned int PRESENT = ~0u;
+
+    PostChain();
+    ~PostChain();
+
+    PostChain(const PostChain &) = delete;
+    PostChain &operator=(const PostChain &) = delete;
+
+    // Builds the pass's program and runs its setup. Throws std::runtime_error when the shader doesn't compile.
+    void add(PostPass pass);
+
+    const std::vector<PostPass> &passes() const { return m_passes; }
+    const std::string &pass_name(unsigned int pass) const;
+
+    // Return whether any pass has that name
+    bool set_enabled(const std::string &name, bool enabled);
+    bool toggle(const std::string &name);
+    // True when every pass with that name is enabled
+    bool enabled(const std::string &name) const;
+
+    // Declares the enabled passes, reading the colour texture `source` and ending in `output` (a colour transient or an
+    // imported framebuffer), whose sizes needn't match. `frame` tags the timings. The first pass turns the depth test
+    // off and the last turns it back on (every renderer here draws with it enabled), leaving texture unit 0 active.
+    void add_passes(FrameGraph &graph, FrameResource source, FrameResource output, uint64_t frame);
+
+    // Appends the per-pass GPU times that have finished, oldest first; with `wait` set, waits for all of them
+    void collect(std::vector<PostTiming> &out, bool wait = false);
+    uint64_t timer_stalls() const { return m_timer.stalls; }
+
+  private:
+    struct Program {
+        Shader *shader;
+        Uniform<int> source, scene;
+        Uniform<glm::vec2> source_texel;
+    };
+
+    std::vector<PostPass> m_passes;
+    std::vector<Program> m_programs;
+    Program m_present, m_upscale;
+    ShaderLibrary m_shaders;
+    unsigned int m_vao = 0;
+    GpuTimer m_timer;
+
+    Program build(const std::string &fragment, const ShaderDefines &defines);
+    void add_pass(FrameGraph &graph, const std::string &name, const Program &program, FrameResource input,
+                  FrameResource source, FrameResource output, uint64_t tag, bool first, bool final);
+};
+
+// The effects the viewer and BenchFrames offer, all disabled, in the order they run:
+//   bloom      bright pass at half res, 9x9 Gaussian at quarter res, added back onto the scene
+//   blur       9x9 Gaussian at half res
+//   grayscale, invert, sharpen, edge   the framebuffer chapter's effects at full res
+void add_standard_passes(PostChain &chain);
+
+#endif
@@ -0,0 +1,153 @@
+#include "profiler.hpp"
+
+#if PROFILING_ENABLED
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+Profiler &Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+    : m_epoch(std::chrono::steady_clock::now()), m_thread_count(0), m_events(EVENT_CAPACITY), m_event_count(0),
+      m_frame(0), m_gpu_head(0), m_gpu_tail(0), m_gpu_stalls(0), m_gpu_offset_ns(0), m_gpu_calibrated(false) {}
+
+uint64_t Profiler::now_ns() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+uint32_t Profiler::thread_id() {
+    // 0 is the GPU timeline
+    thread_local uint32_t id = ++m_thread_count;
+    return id;
+}
+
+void Profiler::record(const ProfileEvent &event) {
+    std::lock_guard lock(m_mutex);
+    m_events[m_event_count % EVENT_CAPACITY] = event;
+    m_event_count++;
+}
+
+void Profiler::next_frame() {
+    collect_gpu(false);
+    m_frame++;
+}
+
+unsigned int Profiler::gpu_begin(const char *name) {
+    if (!m_gpu_calibrated) {
+        m_gpu_queries.resize(GPU_QUERY_CAPACITY);
+        for (auto &query : m_gpu_queries) {
+            glGenQueries(1, &query.begin);
+            glGenQueries(1, &query.end);
+            query.pending = false;
+        }
+
+        GLint64 gpu_now = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+        m_gpu_offset_ns = static_cast<int64_t>(now_ns()) - gpu_now;
+        m_gpu_calibrated = true;
+    }
+
+    const unsigned int slot = m_gpu_head;
+    GpuQuery &query = m_gpu_queries[slot];
+    if (query.pending) {
+        // Wrapped onto the oldest zone before it finished; this is the only place the profiler waits on the GPU
+        read_gpu(query);
+        m_gpu_stalls++;
+        m_gpu_tail = (slot + 1) % GPU_QUERY_CAPACITY;
+    }
+
+    query.name = name;
+    query.frame = m_frame;
+    glQueryCounter(query.begin, GL_TIMESTAMP);
+
+    m_gpu_head = (slot + 1) % GPU_QUERY_CAPACITY;
+    return slot;
+}
+
+void Profiler::gpu_end(unsigned int slot) {
+    GpuQuery &query = m_gpu_queries[slot];
+    glQueryCounter(query.end, GL_TIMESTAMP);
+    query.pending = true;
+}
+
+void Profiler::collect_gpu(bool wait) {
+    for (unsigned int i = 0; i < m_gpu_queries.size(); i++) {
+        GpuQuery &query = m_gpu_queries[m_gpu_tail];
+        if (!query.pending) {
+            break;
+        }
+
+        if (!wait) {
+            // The end timestamp lands after the begin one, so it being available covers both
+            GLint available = 0;
+            glGetQueryObjectiv(query.end, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                break;
+            }
+        }
+
+        read_gpu(query);
+        m_gpu_tail = (m_gpu_tail + 1) % GPU_QUERY_CAPACITY;
+    }
+}
+
+void Profiler::read_gpu(GpuQuery &query) {
+    GLuint64 begin = 0, end = 0;
+    glGetQueryObjectui64v(query.begin, GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(query.end, GL_QUERY_RESULT, &end);
+    query.pending = false;
+
+    const int64_t start = std::max<int64_t>(0, static_cast<int64_t>(begin) + m_gpu_offset_ns);
+    record({query.name, static_cast<uint64_t>(start), end > begin ? end - begin : 0, query.frame, 0});
+}
+
+std::vector<ProfileEvent> Profiler::events() const {
+    std::lock_guard lock(m_mutex);
+    const uint64_t count = std::min<uint64_t>(m_event_count, EVENT_CAPACITY);
+
+    std::vector<ProfileEvent> events;
+    events.reserve(count);
+    for (uint64_t i = m_event_count - count; i < m_event_count; i++) {
+        events.push_back(m_events[i % EVENT_CAPACITY]);
+    }
+    return events;
+}
+
+void Profiler::write_chrome_trace(const std::string &path) {
+    if (m_gpu_calibrated) {
+        glFinish();
+        collect_gpu(true);
+    }
+
+    std::FILE *out = std::fopen(path.c_str(), "w");
+    if (!out) {
+        throw std::runtime_error("couldn't open trace file: " + path);
+    }
+
+    std::fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    std::fprintf(out,
+                 "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"GPU\"}}");
+    for (const auto &event : events()) {
+        std::fprintf(out,
+                     ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, "
+                     "\"dur\": %.3f, \"args\": {\"frame\": %llu}}",
+                     event.name, event.thread == 0 ? "gpu" : "cpu", event.thread, event.start_ns / 1000.0,
+                     event.duration_ns / 1000.0, static_cast<unsigned long long>(event.frame));
+    }
+    std::fprintf(out, "\n]}\n");
+    std::fclose(out);
+
+    std::printf("wrote profile trace: %s\n", path.c_str());
+}
+
+CpuZone::~CpuZone() {
+    Profiler &profiler = Profiler::instance();
+    const uint64_t end = profiler.now_ns();
+    profiler.record({m_name, m_start, end - m_start, profiler.frame(), profiler.thread_id()});
+}
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+// Scoped CPU and GPU profiling zones.
+//
+//   PROFILE_ZONE("Mesh::draw");          CPU time of the enclosing scope, any thread
+//   PROFILE_GPU_ZONE("scene pass");      CPU time plus GPU time of the GL commands issued in the scope (GL thread)
+//   PROFILE_FRAME();                     once per frame on the GL thread: collects finished GPU zones
+//   PROFILE_WRITE_TRACE("profile.json"); Chrome trace-event JSON, loads in chrome://tracing or Perfetto
+//
+// GPU zones bracket their scope with GL_TIMESTAMP queries, so they nest freely. The queries go into a ring and are
+// only read back once the driver reports them available, normally a few frames later, so profiling never waits on the
+// GPU unless the ring wraps onto an unfinished query (counted in Profiler::gpu_stalls()).
+//
+// Zone names must be string literals (or otherwise outlive the profiler). Everything compiles out unless the build
+// defines PROFILING_ENABLED=1 (cmake -DLEARNOPENGL_PROFILING=ON).
+
+#ifndef PROFILING_ENABLED
+#define PROFILING_ENABLED 0
+#endif
+
+#if PROFILING_ENABLED
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ProfileEvent {
+    const char *name;
+    // Nanoseconds on the profiler's steady clock; GPU events are mapped onto it
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint64_t frame;
+    // Small per-thread id, 0 for the GPU timeline
+    uint32_t thread;
+};
+
+class Profiler {
+  public:
+    static constexpr size_t EVENT_CAPACITY = 1 << 16;
+    static constexpr unsigned int GPU_QUERY_CAPACITY = 512;
+
+    static Profiler &instance();
+
+    // Nanoseconds since the profiler started
+    uint64_t now_ns() const;
+    uint32_t thread_id();
+    uint64_t frame() const { return m_frame; }
+
+    void record(const ProfileEvent &event);
+    // Starts the next frame and collects every GPU zone that has finished
+    void next_frame();
+
+    // Returns the query slot to pass to gpu_end
+    unsigned int gpu_begin(const char *name);
+    void gpu_end(unsigned int slot);
+
+    // The most recent events (at most EVENT_CAPACITY), oldest first
+    std::vector<ProfileEvent> events() const;
+    uint64_t gpu_stalls() const { return m_gpu_stalls; }
+
+    // Waits for outstanding GPU zones first, so call it on the GL thread while the context is alive
+    void write_chrome_trace(const std::string &path);
+
+  private:
+    struct GpuQuery {
+        unsigned int begin, end;
+        const char *name;
+        uint64_t frame;
+        bool pending;
+    };
+
+    Profiler();
+
+    const std::chrono::steady_clock::time_point m_epoch;
+    std::atomic<uint32_t> m_thread_count;
+
+    mutable std::mutex m_mutex;
+    std::vector<ProfileEvent> m_events;
+    uint64_t m_event_count;
+    std::atomic<uint64_t> m_frame;
+
+    // GL thread only
+    std::vector<GpuQuery> m_gpu_queries;
+    unsigned int m_gpu_head, m_gpu_tail;
+    uint64_t m_gpu_stalls;
+    // CPU ns - GPU ns, measured when the first GPU zone is opened
+    int64_t m_gpu_offset_ns;
+    bool m_gpu_calibrated;
+
+    void collect_gpu(bool wait);
+    void read_gpu(GpuQuery &query);
+};
+
+class CpuZone {
+  public:
+    explicit CpuZone(const char *name) : m_name(name), m_start(Profiler::instance().now_ns()) {}
+    ~CpuZone();
+
+    CpuZone(const CpuZone &) = delete;
+    CpuZone &operator=(const CpuZone &) = delete;
+
+  private:
+    const char *m_name;
+    uint64_t m_start;
+};
+
+class GpuZone {
+  public:
+    explicit GpuZone(const char *name) : m_cpu(name), m_slot(Profiler::instance().gpu_begin(name)) {}
+    ~GpuZone() { Profiler::instance().gpu_end(m_slot); }
+
+    GpuZone(const GpuZone &) = delete;
+    GpuZone &operator=(const GpuZone &) = delete;
+
+  private:
+    CpuZone m_cpu;
+    unsigned int m_slot;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) CpuZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) GpuZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_FRAME() Profiler::instance().next_frame()
+#define PROFILE_WRITE_TRACE(path) Profiler::instance().write_chrome_trace(path)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_GPU_ZONE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_WRITE_TRACE(path) ((void)0)
+
+#endif
+
+#endif
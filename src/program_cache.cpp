@@ -0,0 +1,179 @@
+#include "program_cache.hpp"
+#include "mesh_cache.hpp"
+#include "profiler.hpp"
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::duration<double, std::milli>;
+
+constexpr char PROGRAM_CACHE_MAGIC[8] = {'L', 'O', 'G', 'L', 'P', 'R', 'O', 'G'};
+
+struct ProgramCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t binary_format;
+    uint64_t key;
+    uint64_t size;
+};
+static_assert(sizeof(ProgramCacheHeader) == 32);
+
+// FNV-1a, 64 bit
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t size) {
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Includes the terminating NUL, so "ab" + "c" and "a" + "bc" hash differently
+uint64_t hash_string(uint64_t hash, const char *s) { return hash_bytes(hash, s ? s : "", s ? std::strlen(s) + 1 : 1); }
+
+} // namespace
+
+ProgramCache::ProgramCache(std::string directory) : m_directory(std::move(directory)) {}
+
+ProgramCache &ProgramCache::shared() {
+    static ProgramCache cache("res/shaders/.cache");
+    return cache;
+}
+
+bool ProgramCache::available() const {
+    static const bool supported = [] {
+        if (!GLAD_GL_ARB_get_program_binary) {
+            return false;
+        }
+        int formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }();
+    return enabled && supported;
+}
+
+uint64_t ProgramCache::key(const std::string &vertex_src, const std::string &fragment_src) const {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = hash_bytes(hash, &PROGRAM_CACHE_VERSION, sizeof(PROGRAM_CACHE_VERSION));
+    hash = hash_string(hash, vertex_src.c_str());
+    hash = hash_string(hash, fragment_src.c_str());
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        hash = hash_string(hash, reinterpret_cast<const char *>(glGetString(name)));
+    }
+    return hash;
+}
+
+std::string ProgramCache::entry_path(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return (fs::path(m_directory) / name).string();
+}
+
+unsigned int ProgramCache::load(uint64_t key) {
+    PROFILE_ZONE("ProgramCache::load");
+    const std::string path = entry_path(key);
+    std::ifstream ifs(path, std::ios_base::binary);
+    if (!ifs.is_open()) {
+        m_stats.misses++;
+        return 0;
+    }
+
+    ProgramCacheHeader hdr;
+    std::vector<char> binary;
+    const bool valid = ifs.read(reinterpret_cast<char *>(&hdr), sizeof(hdr)) &&
+                       std::memcmp(hdr.magic, PROGRAM_CACHE_MAGIC, sizeof(hdr.magic)) == 0 &&
+                       hdr.version == PROGRAM_CACHE_VERSION && hdr.key == key && hdr.size > 0 &&
+                       hdr.size < (uint64_t(1) << 30);
+    if (valid) {
+        binary.resize(hdr.size);
+    }
+    if (!valid || !ifs.read(binary.data(), binary.size())) {
+        ifs.close();
+        std::error_code ec;
+        fs::remove(path, ec);
+        m_stats.misses++;
+        return 0;
+    }
+
+    const auto start = Clock::now();
+    const unsigned int program = glCreateProgram();
+    glProgramBinary(program, hdr.binary_format, binary.data(), binary.size());
+
+    int linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        // Typically a driver update that kept the version string; the source compile replaces the entry
+        glDeleteProgram(program);
+        ifs.close();
+        std::error_code ec;
+        fs::remove(path, ec);
+        m_stats.rejected++;
+        m_stats.misses++;
+        return 0;
+    }
+
+    m_stats.load_ms += Millis(Clock::now() - start).count();
+    m_stats.hits++;
+    return program;
+}
+
+void ProgramCache::store(uint64_t key, unsigned int program) {
+    PROFILE_ZONE("ProgramCache::store");
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    ProgramCacheHeader hdr{};
+    std::memcpy(hdr.magic, PROGRAM_CACHE_MAGIC, sizeof(hdr.magic));
+    hdr.version = PROGRAM_CACHE_VERSION;
+    hdr.key = key;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    hdr.binary_format = format;
+    hdr.size = length;
+
+    const std::string path = entry_path(key);
+    const std::string tmp_path = unique_temp_path(path);
+    std::error_code ec;
+    fs::create_directories(m_directory, ec);
+    {
+        std::ofstream ofs(tmp_path, std::ios_base::binary | std::ios_base::trunc);
+        if (!ofs.is_open() || !ofs.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr)) ||
+            !ofs.write(binary.data(), hdr.size)) {
+            std::fprintf(stderr, "couldn't write program cache entry %s\n", tmp_path.c_str());
+            ofs.close();
+            fs::remove(tmp_path, ec);
+            return;
+        }
+    }
+    fs::rename(tmp_path, path, ec);
+    if (ec) {
+        std::fprintf(stderr, "couldn't write program cache entry %s: %s\n", path.c_str(), ec.message().c_str());
+        fs::remove(tmp_path, ec);
+        return;
+    }
+    m_stats.writes++;
+}
+
+void ProgramCache::clear() {
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(m_directory, ec)) {
+        // Temp files are "<entry>.tmp.<pid>.<n>" (see unique_temp_path), left behind by a writer that was killed
+        if (entry.path().extension() == ".bin" || entry.path().filename().string().find(".tmp") != std::string::npos) {
+            fs::remove(entry.path(), ec);
+        }
+    }
+}
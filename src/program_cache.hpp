@@ -0,0 +1,79 @@
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+// Linked program binaries saved to disk (glGetProgramBinary), so later launches skip compiling and linking GLSL.
+//
+// ShaderBuilder looks a program up by key before compiling it. The key hashes the vertex and fragment source (any
+// defines are part of that text) together with the GL_VENDOR, GL_RENDERER and GL_VERSION strings, so a driver update
+// or another GPU misses instead of loading a binary meant for something else. A driver may still refuse a binary it
+// wrote itself; load() then deletes the entry and the builder falls back to compiling from source, which writes a fresh
+// one. Only used when the driver has ARB_get_program_binary and reports at least one binary format.
+//
+// Entries are "<directory>/<key as 16 hex digits>.bin" (native endianness, never shared between machines):
+//   char magic[8] "LOGLPROG", u32 version, u32 binary format, u64 key, u64 binary size
+//   binary size bytes, as returned by glGetProgramBinary
+//
+// GL thread only.
+
+constexpr uint32_t PROGRAM_CACHE_VERSION = 1;
+
+// Counts since startup (or reset_stats), summed over every program built
+struct ProgramCacheStats {
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+    // Entries the driver refused at glProgramBinary
+    unsigned int rejected = 0;
+    unsigned int writes = 0;
+    // Programs built from source, whether or not the cache is available
+    unsigned int compiled = 0;
+    // Time spent in glProgramBinary for hits
+    double load_ms = 0.0;
+    // GL thread time spent compiling and linking from source: issuing the work plus waiting for it in finish()
+    double compile_ms = 0.0;
+};
+
+class ProgramCache {
+  public:
+    // Skips the cache entirely when false (nothing is read or written)
+    bool enabled = true;
+
+    explicit ProgramCache(std::string directory);
+
+    // Cache in "res/shaders/.cache" used by ShaderBuilder, created on first use.
+    static ProgramCache &shared();
+
+    const std::string &directory() const { return m_directory; }
+    void set_directory(std::string directory) { m_directory = std::move(directory); }
+
+    // Enabled, and the current context can save and load program binaries
+    bool available() const;
+
+    uint64_t key(const std::string &vertex_src, const std::string &fragment_src) const;
+
+    // A new program linked from the entry for key, or 0 when there is none or the driver refused it.
+    unsigned int load(uint64_t key);
+    // Saves a linked program; programs linked without GL_PROGRAM_BINARY_RETRIEVABLE_HINT may have nothing to save.
+    // A failed write only warns, the program is usable either way.
+    void store(uint64_t key, unsigned int program);
+    // Deletes every entry, e.g. to measure a cold start
+    void clear();
+
+    const ProgramCacheStats &stats() const { return m_stats; }
+    void reset_stats() { m_stats = {}; }
+    void record_compile(double ms) {
+        m_stats.compiled++;
+        m_stats.compile_ms += ms;
+    }
+
+  private:
+    std::string m_directory;
+    ProgramCacheStats m_stats;
+
+    std::string entry_path(uint64_t key) const;
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "render_queue.hpp"
+#include "glm/gtc/type_ptr.hpp"
+#include "instancing.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+uint64_t bits(uint64_t v, unsigned int width) { return v & ((uint64_t(1) << width) - 1); }
+
+uint16_t material_hash(const DrawPacket &packet) {
+    uint32_t h = 2166136261u;
+    for (unsigned int i = 0; i < packet.texture_count; i++) {
+        h = (h ^ packet.textures[i].id) * 16777619u;
+    }
+    return static_cast<uint16_t>(h ^ (h >> 16));
+}
+
+uint64_t triangle_count(GLenum mode, unsigned int count) {
+    switch (mode) {
+    case GL_TRIANGLES:
+        return count / 3;
+    case GL_TRIANGLE_STRIP:
+    case GL_TRIANGLE_FAN:
+        return count >= 3 ? count - 2 : 0;
+    default:
+        return 0;
+    }
+}
+
+} // namespace
+
+const char *render_path_name(RenderPath path) { return path == RenderPath::DEFERRED ? "deferred" : "forward"; }
+
+const char *transparency_mode_name(TransparencyMode mode) {
+    return mode == TransparencyMode::WEIGHTED_BLENDED ? "weighted" : "sorted";
+}
+
+uint64_t make_sort_key(RenderLayer layer, unsigned int program, unsigned int material, unsigned int vao, float depth,
+                       TransparencyMode transparency) {
+    const uint64_t depth_bits = static_cast<uint64_t>(std::clamp(depth, 0.0f, 1.0f) * float((1 << 24) - 1));
+
+    if (layer == RenderLayer::OPAQUE || transparency == TransparencyMode::WEIGHTED_BLENDED) {
+        return bits(uint64_t(layer), 2) << 62 | bits(program, 10) << 52 | bits(material, 16) << 36 |
+               bits(vao, 12) << 24 | depth_bits;
+    }
+
+    return bits(uint64_t(layer), 2) << 62 | bits(~depth_bits, 24) << 38 | bits(program, 10) << 28 |
+           bits(material, 16) << 12 | bits(vao, 12);
+}
+
+void RenderQueue::begin_frame(const glm::mat4 &view, const glm::mat4 &projection, float far_plane) {
+    m_view = view;
+    m_frustum = Frustum::from_matrix(projection * view);
+    m_far_plane = far_plane;
+    order = 0;
+    stats = {};
+    cull_stats = {};
+    lod_stats = {};
+    m_packets.clear();
+    m_entries.clear();
+}
+
+void RenderQueue::begin_frame(const RenderQueue &frame) {
+    lod = frame.lod;
+    path = frame.path;
+    transparency = frame.transparency;
+    m_view = frame.m_view;
+    m_frustum = frame.m_frustum;
+    m_far_plane = frame.m_far_plane;
+    order = 0;
+    stats = {};
+    cull_stats = {};
+    lod_stats = {};
+    m_packets.clear();
+    m_entries.clear();
+}
+
+void RenderQueue::merge(RenderQueue &recorded) {
+    const auto offset = static_cast<uint32_t>(m_packets.size());
+    m_packets.insert(m_packets.end(), recorded.m_packets.begin(), recorded.m_packets.end());
+    for (const Entry &entry : recorded.m_entries) {
+        m_entries.push_back({entry.key, entry.order, entry.packet + offset});
+    }
+    cull_stats += recorded.cull_stats;
+    lod_stats += recorded.lod_stats;
+
+    recorded.m_packets.clear();
+    recorded.m_entries.clear();
+    recorded.cull_stats = {};
+    recorded.lod_stats = {};
+}
+
+void RenderQueue::submit(RenderLayer layer, glm::vec3 center, const DrawPacket &packet) {
+    // Camera looks down -z in view space
+    const float view_z = -(m_view * glm::vec4(center, 1.0f)).z;
+    const uint64_t key = make_sort_key(layer, packet.shader->_m_id, material_hash(packet), packet.vao,
+                                       view_z / m_far_plane, transparency);
+
+    m_entries.push_back({key, order, static_cast<uint32_t>(m_packets.size())});
+    m_packets.push_back(packet);
+}
+
+size_t RenderQueue::queued(RenderLayer layer) const {
+    return std::count_if(m_entries.begin(), m_entries.end(),
+                         [layer](const Entry &entry) { return RenderLayer(entry.key >> 62) == layer; });
+}
+
+void RenderQueue::flush(GlStateCache &state) {
+    PROFILE_GPU_ZONE("RenderQueue::flush");
+    sort();
+    issue(state, 0, m_entries.size());
+
+    m_packets.clear();
+    m_entries.clear();
+}
+
+void RenderQueue::flush(GlStateCache &state, RenderLayer layer) {
+    PROFILE_GPU_ZONE("RenderQueue::flush");
+    sort();
+    // The layer is the top of the key, so each layer is one contiguous run
+    const auto in_layer = [layer](const Entry &entry) { return RenderLayer(entry.key >> 62) == layer; };
+    const auto begin = std::find_if(m_entries.begin(), m_entries.end(), in_layer);
+    const auto end = std::find_if_not(begin, m_entries.end(), in_layer);
+    issue(state, begin - m_entries.begin(), end - m_entries.begin());
+
+    // Packets stay put: the remaining entries still index them
+    m_entries.erase(begin, end);
+}
+
+std::vector<const DrawPacket *> RenderQueue::sorted_packets() {
+    sort();
+    std::vector<const DrawPacket *> packets;
+    packets.reserve(m_entries.size());
+    for (const Entry &entry : m_entries) {
+        packets.push_back(&m_packets[entry.packet]);
+    }
+    return packets;
+}
+
+void RenderQueue::sort() {
+    const auto start = std::chrono::steady_clock::now();
+    // Stable, so packets with the same key and order keep their submission order
+    std::stable_sort(m_entries.begin(), m_entries.end(), [](const Entry &a, const Entry &b) {
+        return a.key < b.key || (a.key == b.key && a.order < b.order);
+    });
+    stats.sort_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RenderQueue::issue(GlStateCache &state, size_t begin, size_t end) {
+    const GlStateStats before = state.stats;
+    stats.packets += end - begin;
+
+    for (size_t entry = begin; entry < end; entry++) {
+        const DrawPacket &packet = m_packets[m_entries[entry].packet];
+
+        state.use_program(packet.shader->_m_id);
+        for (unsigned int i = 0; i < packet.texture_count; i++) {
+            state.bind_texture(i, GL_TEXTURE_2D, packet.textures[i].id);
+            state.set_sampler(packet.textures[i].sampler_location, i);
+        }
+        if (packet.model_uniform.valid()) {
+            glUniformMatrix4fv(packet.model_uniform.location, 1, GL_FALSE, glm::value_ptr(packet.model));
+        }
+        if (packet.position_scale.valid()) {
+            glUniform3fv(packet.position_scale.location, 1, glm::value_ptr(packet.quantization.scale));
+            glUniform3fv(packet.position_offset.location, 1, glm::value_ptr(packet.quantization.offset));
+        }
+        state.bind_vertex_array(packet.vao);
+
+        const void *first_index = reinterpret_cast<void *>(uintptr_t(packet.first) * sizeof(unsigned int));
+        if (packet.instances) {
+            if (packet.instances->empty()) {
+                continue;
+            }
+            packet.instances->attach();
+            if (packet.indexed) {
+                glDrawElementsInstancedBaseVertex(packet.mode, packet.count, GL_UNSIGNED_INT, first_index,
+                                                  packet.instances->size(), packet.base_vertex);
+            } else {
+                glDrawArraysInstanced(packet.mode, packet.first, packet.count, packet.instances->size());
+            }
+            stats.instances += packet.instances->size();
+            stats.triangles += triangle_count(packet.mode, packet.count) * packet.instances->size();
+        } else {
+            if (packet.indexed) {
+                glDrawElementsBaseVertex(packet.mode, packet.count, GL_UNSIGNED_INT, first_index, packet.base_vertex);
+            } else {
+                glDrawArrays(packet.mode, packet.first, packet.count);
+            }
+            stats.instances++;
+            stats.triangles += triangle_count(packet.mode, packet.count);
+        }
+        stats.draw_calls++;
+    }
+
+    stats.state += state.stats - before;
+}
@@ -0,0 +1,166 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include "bounds.hpp"
+#include "bvh.hpp"
+#include "gl_state.hpp"
+#include "lod.hpp"
+#include "shader.hpp"
+#include "vertex.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class InstanceBatch;
+
+enum class RenderLayer : uint8_t { OPAQUE = 0, TRANSPARENT = 1 };
+
+// How opaque geometry is lit. Transparent geometry is always shaded forward.
+//   FORWARD   every fragment evaluates its lights as it's drawn
+//   DEFERRED  opaque draws fill a G-buffer and a full-screen pass lights it (see deferred.hpp)
+enum class RenderPath : uint8_t { FORWARD = 0, DEFERRED = 1 };
+
+const char *render_path_name(RenderPath path);
+
+// How transparent geometry is composited.
+//   SORTED            drawn back to front with alpha blending; every transparent object is its own sorted draw
+//   WEIGHTED_BLENDED  drawn in any order into accumulation targets and composited in one full-screen pass (see
+//                     transparency.hpp), so it batches and instances like opaque geometry
+enum class TransparencyMode : uint8_t { SORTED = 0, WEIGHTED_BLENDED = 1 };
+
+const char *transparency_mode_name(TransparencyMode mode);
+
+constexpr unsigned int MAX_PACKET_TEXTURES = 4;
+
+struct PacketTexture {
+    unsigned int id;
+    int sampler_location;
+};
+
+// Everything needed to issue one draw without looking anything up. Texture i is bound to unit i.
+struct DrawPacket {
+    const Shader *shader = nullptr;
+    unsigned int vao = 0;
+    GLenum mode = GL_TRIANGLES;
+    // Indexed packets draw `count` GL_UNSIGNED_INT indices starting at index `first` of the VAO's element buffer,
+    // offset by base_vertex; others draw arrays
+    bool indexed = true;
+    unsigned int first = 0;
+    unsigned int count = 0;
+    int base_vertex = 0;
+
+    PacketTexture textures[MAX_PACKET_TEXTURES] = {};
+    unsigned int texture_count = 0;
+
+    Uniform<glm::mat4> model_uniform;
+    glm::mat4 model = glm::mat4(1.0f);
+
+    // Only resolved for quantized vertex formats
+    Uniform<glm::vec3> position_scale, position_offset;
+    VertexQuantization quantization;
+
+    // When set, the packet is drawn once per uploaded instance and `model` is ignored; the batch must outlive flush()
+    const InstanceBatch *instances = nullptr;
+};
+
+// Sort key layout, most significant first:
+//   opaque:      layer:2 | program:10 | material:16 | vao:12 | depth:24   (state first, then front-to-back)
+//   transparent: layer:2 | ~depth:24 | program:10 | material:16 | vao:12  (back-to-front)
+// Transparent packets composited WEIGHTED_BLENDED don't depend on order, so they take the opaque layout.
+// program and vao are GL names truncated to their field; material is a 16-bit hash of the texture set. A collision
+// only costs a redundant bind, never a wrong draw.
+uint64_t make_sort_key(RenderLayer layer, unsigned int program, unsigned int material, unsigned int vao, float depth,
+                       TransparencyMode transparency = TransparencyMode::SORTED);
+
+struct RenderStats {
+    uint64_t packets = 0;
+    uint64_t draw_calls = 0;
+    // Objects drawn: 1 per plain packet, the batch size for instanced ones
+    uint64_t instances = 0;
+    // Triangles rasterized, instances included
+    uint64_t triangles = 0;
+    // CPU time spent sorting packets
+    double sort_ms = 0.0;
+    GlStateStats state;
+
+    RenderStats &operator+=(const RenderStats &o) {
+        packets += o.packets;
+        draw_calls += o.draw_calls;
+        instances += o.instances;
+        triangles += o.triangles;
+        sort_ms += o.sort_ms;
+        state += o.state;
+        return *this;
+    }
+};
+
+class RenderQueue {
+  public:
+    // Everything flushed since begin_frame
+    RenderStats stats;
+    // Frustum culling done by submitters (Model::submit) since begin_frame
+    CullStats cull_stats;
+    // LOD picks made by submitters since begin_frame
+    LodStats lod_stats;
+    // What submitters pick LODs with; set its camera before submitting
+    LodSelector lod;
+    // The path this frame is drawn with. Submitters pick the matching shader permutation for opaque packets
+    // (fragment.glsl with GBUFFER for DEFERRED).
+    RenderPath path = RenderPath::FORWARD;
+    // How this frame's transparent layer is composited. Submitters pick the matching permutation for transparent
+    // packets (fragment_blending.glsl with WEIGHTED_BLENDED), and may batch them when it's WEIGHTED_BLENDED.
+    TransparencyMode transparency = TransparencyMode::SORTED;
+    // Packets with equal sort keys are issued by this, then in the order they were submitted. A worker recording items
+    // [begin, end) of a scene sets it to begin, so the merged queue sorts the same however the items were split and
+    // stolen, and the same as queueing them all in order on one thread. begin_frame resets it to 0.
+    uint32_t order = 0;
+
+    // The view matrix and far plane turn submitted positions into sort depth; view and projection also give the
+    // frustum submitters cull against
+    void begin_frame(const glm::mat4 &view, const glm::mat4 &projection, float far_plane);
+    // Empties this queue and starts it on `frame`'s frame: camera, frustum, LOD selector, path and transparency. A
+    // worker records into a queue of its own set up this way, and the owner merge()s it once the worker is done, so
+    // submitting never takes a lock.
+    void begin_frame(const RenderQueue &frame);
+    // Moves every packet `recorded` queued, with its cull and LOD stats, into this queue and empties it
+    void merge(RenderQueue &recorded);
+
+    // World-space frustum for this frame
+    const Frustum &frustum() const { return m_frustum; }
+
+    // `center` is the world-space point used for depth sorting (an object's origin or bounds center)
+    void submit(RenderLayer layer, glm::vec3 center, const DrawPacket &packet);
+
+    // Packets of `layer` waiting for a flush
+    size_t queued(RenderLayer layer) const;
+
+    // Sorts and issues every packet submitted since begin_frame, then empties the queue
+    void flush(GlStateCache &state);
+    // Sorts and issues only the packets of `layer`, keeping the rest queued for a later flush
+    void flush(GlStateCache &state, RenderLayer layer);
+
+    // Sorts the queue and returns its packets in the order flush() would issue them, without issuing anything
+    std::vector<const DrawPacket *> sorted_packets();
+
+  private:
+    struct Entry {
+        uint64_t key;
+        uint32_t order;
+        uint32_t packet;
+    };
+
+    std::vector<DrawPacket> m_packets;
+    std::vector<Entry> m_entries;
+    glm::mat4 m_view = glm::mat4(1.0f);
+    Frustum m_frustum;
+    float m_far_plane = 100.0f;
+
+    void sort();
+    // Issues m_entries[begin, end), adding to stats
+    void issue(GlStateCache &state, size_t begin, size_t end);
+};
+
+#endif
@@ -0,0 +1,1072 @@
+#include "scene.hpp"
+#include "instancing.hpp"
+#include "job_system.hpp"
+#include "mesh.hpp"
+#include "model.hpp"
+#include "model_streamer.hpp"
+#include "profiler.hpp"
+#include "shader.hpp"
+#include "shader_library.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// clang-format off
+const float CUBE_VERTICES[] = {
+    // Back face
+    -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, // Bottom-left
+    0.5f, 0.5f, -0.5f, 1.0f, 1.0f,   // top-right
+    0.5f, -0.5f, -0.5f, 1.0f, 0.0f,  // bottom-right
+    0.5f, 0.5f, -0.5f, 1.0f, 1.0f,   // top-right
+    -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, // bottom-left
+    -0.5f, 0.5f, -0.5f, 0.0f, 1.0f,  // top-left
+    // Front face
+    -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, // bottom-left
+    0.5f, -0.5f, 0.5f, 1.0f, 0.0f,  // bottom-right
+    0.5f, 0.5f, 0.5f, 1.0f, 1.0f,   // top-right
+    0.5f, 0.5f, 0.5f, 1.0f, 1.0f,   // top-right
+    -0.5f, 0.5f, 0.5f, 0.0f, 1.0f,  // top-left
+    -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, // bottom-left
+    // Left face
+    -0.5f, 0.5f, 0.5f, 1.0f, 0.0f,   // top-right
+    -0.5f, 0.5f, -0.5f, 1.0f, 1.0f,  // top-left
+    -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, // bottom-left
+    -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, // bottom-left
+    -0.5f, -0.5f, 0.5f, 0.0f, 0.0f,  // bottom-right
+    -0.5f, 0.5f, 0.5f, 1.0f, 0.0f,   // top-right
+    // Right face
+    0.5f, 0.5f, 0.5f, 1.0f, 0.0f,    // top-left
+    0.5f, -0.5f, -0.5f, 0.0f, 1.0f,  // bottom-right
+    0.5f, 0.5f, -0.5f, 1.0f, 1.0f,   // top-right
+    0.5f, -0.5f, -0.5f, 0.0f, 1.0f,  // bottom-right
+    0.5f, 0.5f, 0.5f, 1.0f, 0.0f,    // top-left
+    0.5f, -0.5f, 0.5f, 0.0f, 0.0f,   // bottom-left
+    // Bottom face
+    -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, // top-right
+    0.5f, -0.5f, -0.5f, 1.0f, 1.0f,  // top-left
+    0.5f, -0.5f, 0.5f, 1.0f, 0.0f,   // bottom-left
+    0.5f, -0.5f, 0.5f, 1.0f, 0.0f,   // bottom-left
+    -0.5f, -0.5f, 0.5f, 0.0f, 0.0f,  // bottom-right
+    -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, // top-right
+    // Top face
+    -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, // top-left
+    0.5f, 0.5f, 0.5f, 1.0f, 0.0f,   // bottom-right
+    0.5f, 0.5f, -0.5f, 1.0f, 1.0f,  // top-right
+    0.5f, 0.5f, 0.5f, 1.0f, 0.0f,   // bottom-right
+    -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, // top-left
+    -0.5f, 0.5f, 0.5f, 0.0f, 0.0f   // bottom-left
+};
+
+// positions, texture coords (higher than 1 together with GL_REPEAT so the floor texture repeats)
+const float PLANE_VERTICES[] = {
+    5.0f, -0.5f, 5.0f, 2.0f, 0.0f,
+    -5.0f, -0.5f, 5.0f, 0.0f, 0.0f,
+    -5.0f, -0.5f, -5.0f, 0.0f, 2.0f,
+
+    5.0f, -0.5f, 5.0f, 2.0f, 0.0f,
+    -5.0f, -0.5f, -5.0f, 0.0f, 2.0f,
+    5.0f, -0.5f, -5.0f, 2.0f, 2.0f
+};
+
+// A unit quad standing on the floor when placed at y = 0, for the blending chapter's window and grass textures
+const float QUAD_VERTICES[] = {
+    -0.5f, 0.5f, 0.0f, 0.0f, 1.0f,
+    -0.5f, -0.5f, 0.0f, 0.0f, 0.0f,
+    0.5f, -0.5f, 0.0f, 1.0f, 0.0f,
+
+    -0.5f, 0.5f, 0.0f, 0.0f, 1.0f,
+    0.5f, -0.5f, 0.0f, 1.0f, 0.0f,
+    0.5f, 0.5f, 0.0f, 1.0f, 1.0f
+};
+// clang-format on
+
+// The scattered containers of the lighting chapters
+const glm::vec3 LIT_CUBE_POSITIONS[] = {
+    glm::vec3(0.0f, 0.0f, 0.0f),    glm::vec3(2.0f, 5.0f, -15.0f), glm::vec3(-1.5f, -2.2f, -2.5f),
+    glm::vec3(-3.8f, -2.0f, -12.3f), glm::vec3(2.4f, -0.4f, -3.5f), glm::vec3(-1.7f, 3.0f, -7.5f),
+    glm::vec3(1.3f, -2.0f, -2.5f),  glm::vec3(1.5f, 2.0f, -2.5f),  glm::vec3(1.5f, 0.2f, -1.5f),
+    glm::vec3(-1.3f, 1.0f, -1.5f),
+};
+
+std::unique_ptr<Shader> load_shader(const std::string &vertex_path, const std::string &fragment_path) {
+    return ShaderBuilder::from_files(vertex_path, fragment_path).build();
+}
+
+// Position, normal, tex coord per vertex from position + tex coord triangles. The normal is the cross product of the
+// triangle's edges, so the triangles must wind counter-clockwise seen from the front (CUBE_VERTICES does).
+std::vector<float> with_face_normals(const float *vertices, unsigned int vertex_count) {
+    std::vector<float> out;
+    out.reserve(vertex_count * 8);
+    for (unsigned int t = 0; t + 3 <= vertex_count; t += 3) {
+        const float *v = vertices + t * 5;
+        const glm::vec3 a(v[0], v[1], v[2]), b(v[5], v[6], v[7]), c(v[10], v[11], v[12]);
+        const glm::vec3 normal = glm::normalize(glm::cross(b - a, c - a));
+        for (int i = 0; i < 3; i++) {
+            const float *vertex = v + i * 5;
+            out.insert(out.end(), {vertex[0], vertex[1], vertex[2], normal.x, normal.y, normal.z});
+            out.insert(out.end(), {vertex[3], vertex[4]});
+        }
+    }
+    return out;
+}
+
+// A position + tex coord VAO over a static array
+class SimpleGeometry {
+  public:
+    unsigned int vao;
+    unsigned int vertex_count;
+
+    // With `normals`, every vertex also gets its triangle's face normal and the layout matches vertex.glsl
+    // (position 0, normal 1, tex coord 2) instead of vertex_depth.glsl (position 0, tex coord 1)
+    SimpleGeometry(const float *vertices, size_t size, bool normals = false)
+        : vertex_count(size / (5 * sizeof(float))) {
+        const std::vector<float> data = normals ? with_face_normals(vertices, vertex_count)
+                                                : std::vector<float>(vertices, vertices + vertex_count * 5);
+        const int stride = (normals ? 8 : 5) * sizeof(float);
+
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &m_vbo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void *)0);
+        if (normals) {
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void *)(3 * sizeof(float)));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void *)(6 * sizeof(float)));
+        } else {
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void *)(3 * sizeof(float)));
+        }
+        glBindVertexArray(0);
+    }
+
+    ~SimpleGeometry() {
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &m_vbo);
+    }
+
+    SimpleGeometry(const SimpleGeometry &) = delete;
+    SimpleGeometry &operator=(const SimpleGeometry &) = delete;
+
+  private:
+    unsigned int m_vbo;
+};
+
+// Two textured cubes on a metal floor (the depth testing chapter)
+class CubesScene : public Scene {
+  public:
+    CubesScene()
+        : m_shader(load_shader("res/shaders/vertex_depth.glsl", "res/shaders/fragment_depth.glsl")),
+          m_shader_instanced(
+              load_shader("res/shaders/vertex_depth_instanced.glsl", "res/shaders/fragment_tinted.glsl")),
+          m_cube(CUBE_VERTICES, sizeof(CUBE_VERTICES)), m_plane(PLANE_VERTICES, sizeof(PLANE_VERTICES)),
+          m_cube_texture("res/textures/container.jpg", ""), m_floor_texture("res/textures/metal.png", "") {
+        // the cubes share one VAO and texture, so they go out as a single instanced draw
+        m_cube_instances.add(glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 0.0f, -1.0f)));
+        m_cube_instances.add(glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.0f, 0.0f)));
+        m_cube_instances.upload();
+
+        m_cube_packet.shader = m_shader_instanced.get();
+        m_cube_packet.vao = m_cube.vao;
+        m_cube_packet.indexed = false;
+        m_cube_packet.count = m_cube.vertex_count;
+        m_cube_packet.textures[0] = {m_cube_texture.id, m_shader_instanced->location("texture1")};
+        m_cube_packet.texture_count = 1;
+        m_cube_packet.instances = &m_cube_instances;
+
+        m_floor_packet.shader = m_shader.get();
+        m_floor_packet.vao = m_plane.vao;
+        m_floor_packet.indexed = false;
+        m_floor_packet.count = m_plane.vertex_count;
+        m_floor_packet.textures[0] = {m_floor_texture.id, m_shader->location("texture1")};
+        m_floor_packet.texture_count = 1;
+        m_floor_packet.model_uniform = m_shader->uniform<glm::mat4>("model");
+        m_floor_packet.model = glm::mat4(1.0f);
+    }
+
+    void submit(RenderQueue &queue) override {
+        queue.submit(RenderLayer::OPAQUE, glm::vec3(0.5f, 0.0f, -0.5f), m_cube_packet);
+        queue.submit(RenderLayer::OPAQUE, glm::vec3(0.0f), m_floor_packet);
+    }
+
+    CameraPath camera_path() const override {
+        return CameraPath::orbit(glm::vec3(0.5f, 0.0f, -0.5f), 4.0f, 1.5f, 8.0f);
+    }
+
+  private:
+    std::unique_ptr<Shader> m_shader, m_shader_instanced;
+    SimpleGeometry m_cube, m_plane;
+    Texture m_cube_texture, m_floor_texture;
+    InstanceBatch m_cube_instances;
+    // Nothing in them changes from frame to frame
+    DrawPacket m_cube_packet, m_floor_packet;
+};
+
+// A FIELD_SIZE x FIELD_SIZE grid of cubes, either as one instanced draw or as one packet per cube
+class CubeFieldScene : public Scene {
+  public:
+    static constexpr int FIELD_SIZE = 100;
+    static constexpr float SPACING = 2.0f;
+
+    explicit CubeFieldScene(bool instanced)
+        : m_instanced(instanced),
+          m_shader(instanced
+                       ? load_shader("res/shaders/vertex_depth_instanced.glsl", "res/shaders/fragment_tinted.glsl")
+                       : load_shader("res/shaders/vertex_depth.glsl", "res/shaders/fragment_depth.glsl")),
+          m_cube(CUBE_VERTICES, sizeof(CUBE_VERTICES)), m_texture("res/textures/container.jpg", "") {
+        const float half = (FIELD_SIZE - 1) * SPACING * 0.5f;
+        for (int z = 0; z < FIELD_SIZE; z++) {
+            for (int x = 0; x < FIELD_SIZE; x++) {
+                const glm::vec3 position(x * SPACING - half, 0.0f, z * SPACING - half);
+                const glm::vec4 tint(0.5f + 0.5f * x / FIELD_SIZE, 1.0f, 0.5f + 0.5f * z / FIELD_SIZE, 1.0f);
+                m_instances.add(glm::translate(glm::mat4(1.0f), position), tint);
+            }
+        }
+        m_instances.upload();
+
+        m_packet.shader = m_shader.get();
+        m_packet.vao = m_cube.vao;
+        m_packet.indexed = false;
+        m_packet.count = m_cube.vertex_count;
+        m_packet.textures[0] = {m_texture.id, m_shader->location("texture1")};
+        m_packet.texture_count = 1;
+        if (m_instanced) {
+            m_packet.instances = &m_instances;
+        } else {
+            m_packet.model_uniform = m_shader->uniform<glm::mat4>("model");
+        }
+    }
+
+    void submit(RenderQueue &queue) override {
+        // one packet per cube goes out through submit_items otherwise
+        if (m_instanced) {
+            queue.submit(RenderLayer::OPAQUE, glm::vec3(0.0f), m_packet);
+        }
+    }
+
+    size_t parallel_items() const override { return m_instanced ? 0 : m_instances.instances().size(); }
+
+    void submit_items(RenderQueue &queue, size_t begin, size_t end) const override {
+        DrawPacket packet = m_packet;
+        for (size_t i = begin; i < end; i++) {
+            packet.model = m_instances.instances()[i].model;
+            queue.submit(RenderLayer::OPAQUE, glm::vec3(packet.model[3]), packet);
+        }
+    }
+
+    CameraPath camera_path() const override { return CameraPath::orbit(glm::vec3(0.0f), 60.0f, 25.0f, 12.0f); }
+
+  private:
+    bool m_instanced;
+    std::unique_ptr<Shader> m_shader;
+    SimpleGeometry m_cube;
+    Texture m_texture;
+    InstanceBatch m_instances;
+    // The instanced draw, or everything but the model matrix of one cube
+    DrawPacket m_packet;
+};
+
+// Which lights a scene evaluates. Each combination is its own permutation of fragment.glsl, so a scene that only
+// needs the sun doesn't loop over point lights per fragment.
+struct LightingFeatures {
+    bool dir_light = true;
+    int point_lights = MAX_POINT_LIGHTS;
+    bool spot_light = true;
+
+    ShaderDefines defines() const {
+        return {{"DIR_LIGHT", dir_light}, {"NR_POINT_LIGHTS", point_lights}, {"SPOT_LIGHT", spot_light}};
+    }
+};
+
+// fragment.glsl's G-buffer permutation for a forward one. The light set plays no part in filling the G-buffer, so it's
+// dropped and scenes that light differently share G-buffer programs.
+ShaderDefines gbuffer_defines(const ShaderDefines &forward) {
+    ShaderDefines defines = {{"GBUFFER", 1}};
+    for (const char *name : {"SPECULAR_MAP", "ALPHA_TEST"}) {
+        if (const auto it = forward.find(name); it != forward.end()) {
+            defines[name] = it->second;
+        }
+    }
+    return defines;
+}
+
+// Ten lit containers (the multiple lights chapter). Every other box uses a material without a specular map, so the
+// scene builds two permutations per render path: one sampling material.specular and one using a constant specular
+// colour.
+class LightsScene : public Scene {
+  public:
+    static constexpr float SHININESS = 32.0f;
+
+    explicit LightsScene(LightingFeatures features)
+        : m_features(features), m_cube(CUBE_VERTICES, sizeof(CUBE_VERTICES), true),
+          m_diffuse("res/textures/container2.png", "texture_diffuse"),
+          m_specular("res/textures/container2_specular.png", "texture_specular"),
+          m_plain("res/textures/container.jpg", "texture_diffuse") {
+        ShaderDefines defines = features.defines();
+        defines["SPECULAR_MAP"] = 1;
+        m_mapped[FORWARD] = &m_shaders.get("res/shaders/vertex.glsl", "res/shaders/fragment.glsl", defines);
+        m_mapped[DEFERRED] =
+            &m_shaders.get("res/shaders/vertex.glsl", "res/shaders/fragment.glsl", gbuffer_defines(defines));
+        defines["SPECULAR_MAP"] = 0;
+        m_unmapped[FORWARD] = &m_shaders.get("res/shaders/vertex.glsl", "res/shaders/fragment.glsl", defines);
+        m_unmapped[DEFERRED] =
+            &m_shaders.get("res/shaders/vertex.glsl", "res/shaders/fragment.glsl", gbuffer_defines(defines));
+
+        // Never changes, so it's set once instead of per packet
+        for (Shader *shader : {m_mapped[FORWARD], m_mapped[DEFERRED], m_unmapped[FORWARD], m_unmapped[DEFERRED]}) {
+            shader->use();
+            shader->set_f("material.shininess", SHININESS);
+        }
+
+        for (int path : {FORWARD, DEFERRED}) {
+            for (size_t i = 0; i < std::size(LIT_CUBE_POSITIONS); i++) {
+                const bool mapped = i % 2 == 0;
+                const Shader &shader = mapped ? *m_mapped[path] : *m_unmapped[path];
+
+                DrawPacket &packet = m_packets[path][i];
+                packet.shader = &shader;
+                packet.vao = m_cube.vao;
+                packet.indexed = false;
+                packet.count = m_cube.vertex_count;
+                packet.textures[0] = {mapped ? m_diffuse.id : m_plain.id, shader.location("material.diffuse")};
+                packet.texture_count = 1;
+                if (mapped) {
+                    packet.textures[packet.texture_count++] = {m_specular.id, shader.location("material.specular")};
+                }
+                packet.model_uniform = shader.uniform<glm::mat4>("model");
+                packet.model = glm::rotate(glm::translate(glm::mat4(1.0f), LIT_CUBE_POSITIONS[i]),
+                                           glm::radians(20.0f * i), glm::vec3(1.0f, 0.3f, 0.5f));
+            }
+        }
+    }
+
+    void submit(RenderQueue &queue) override {
+        const int path = queue.path == RenderPath::DEFERRED ? DEFERRED : FORWARD;
+        for (size_t i = 0; i < std::size(LIT_CUBE_POSITIONS); i++) {
+            queue.submit(RenderLayer::OPAQUE, LIT_CUBE_POSITIONS[i], m_packets[path][i]);
+        }
+    }
+
+    CameraPath camera_path() const override {
+        return CameraPath::orbit(glm::vec3(0.0f, 0.0f, -6.0f), 11.0f, 2.0f, 12.0f);
+    }
+
+    std::optional<ShaderDefines> deferred_lighting() const override { return m_features.defines(); }
+
+  private:
+    enum { FORWARD, DEFERRED };
+
+    LightingFeatures m_features;
+    ShaderLibrary m_shaders;
+    Shader *m_mapped[2];
+    Shader *m_unmapped[2];
+    SimpleGeometry m_cube;
+    Texture m_diffuse, m_specular, m_plain;
+    // Per render path, one per cube
+    DrawPacket m_packets[2][std::size(LIT_CUBE_POSITIONS)];
+};
+
+// Deterministic value in [0, 1) for n, so generated scenes look the same on every run
+float unit_hash(uint32_t n) {
+    n = (n ^ 61u) ^ (n >> 16);
+    n *= 9u;
+    n ^= n >> 4;
+    n *= 0x27d4eb2du;
+    n ^= n >> 15;
+    return (n >> 8) * (1.0f / 16777216.0f);
+}
+
+glm::vec3 hue_color(float hue) {
+    return glm::vec3(glm::clamp(std::fabs(hue * 6.0f - 3.0f) - 1.0f, 0.0f, 1.0f),
+                     glm::clamp(2.0f - std::fabs(hue * 6.0f - 2.0f), 0.0f, 1.0f),
+                     glm::clamp(2.0f - std::fabs(hue * 6.0f - 4.0f), 0.0f, 1.0f));
+}
+
+// A field of pillars under `light_count` coloured lights circling above it (every fourth a spot light pointing down),
+// shaded through the light clusters. The light radius is fixed, so clustered shading pays for the lights near a
+// fragment, while the unculled variant evaluates every light everywhere as the baseline.
+class ClusteredLightsScene : public Scene {
+  public:
+    static constexpr int FIELD_SIZE = 32;
+    static constexpr float SPACING = 2.0f;
+    static constexpr float LIGHT_RADIUS = 4.0f;
+    static constexpr float SHININESS = 32.0f;
+    // Lights advance a fixed step per frame, so benchmark runs see the same lighting frame for frame
+    static constexpr float FRAME_STEP = 1.0f / 60.0f;
+
+    ClusteredLightsScene(unsigned int light_count, bool culled)
+        : m_cube(CUBE_VERTICES, sizeof(CUBE_VERTICES), true),
+          m_diffuse("res/textures/container2.png", "texture_diffuse"),
+          m_specular("res/textures/container2_specular.png", "texture_specular") {
+        m_lighting = {
+            {"DIR_LIGHT", 1}, {"NR_POINT_LIGHTS", 0}, {"SPOT_LIGHT", 0}, {"CLUSTERED_LIGHTS", culled ? 1 : 2}};
+        ShaderDefines defines = m_lighting;
+        defines["SPECULAR_MAP"] = 1;
+        m_shader[FORWARD] = &m_shaders.get("res/shaders/vertex_instanced.glsl", "res/shaders/fragment.glsl", defines);
+        m_shader[DEFERRED] =
+            &m_shaders.get("res/shaders/vertex_instanced.glsl", "res/shaders/fragment.glsl", gbuffer_defines(defines));
+        for (int path : {FORWARD, DEFERRED}) {
+            Shader &shader = *m_shader[path];
+            shader.use();
+            shader.set_f("material.shininess", SHININESS);
+
+            DrawPacket &packet = m_packets[path];
+            packet.shader = &shader;
+            packet.vao = m_cube.vao;
+            packet.indexed = false;
+            packet.count = m_cube.vertex_count;
+            packet.textures[0] = {m_diffuse.id, shader.location("material.diffuse")};
+            packet.textures[1] = {m_specular.id, shader.location("material.specular")};
+            packet.texture_count = 2;
+            packet.instances = &m_instances;
+        }
+
+        const float half = FIELD_SIZE * SPACING * 0.5f;
+        m_instances.add(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.1f, 0.0f)),
+                                   glm::vec3(2.0f * half, 0.2f, 2.0f * half)));
+        for (int z = 0; z < FIELD_SIZE; z++) {
+            for (int x = 0; x < FIELD_SIZE; x++) {
+                const float height = 0.5f + 3.0f * unit_hash(z * FIELD_SIZE + x);
+                const glm::vec3 position((x + 0.5f) * SPACING - half, height * 0.5f, (z + 0.5f) * SPACING - half);
+                m_instances.add(glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.8f, height, 0.8f)));
+            }
+        }
+        m_instances.upload();
+
+        // Dimmer as they get denser, so the field stays exposed at any count
+        const float intensity = 6.0f / std::sqrt(std::max(1.0f, light_count / 16.0f));
+        for (unsigned int i = 0; i < light_count; i++) {
+            LightPath path;
+            path.center = glm::vec3((unit_hash(4 * i) - 0.5f) * 2.0f * half, 1.5f + 3.0f * unit_hash(4 * i + 1),
+                                    (unit_hash(4 * i + 2) - 0.5f) * 2.0f * half);
+            path.radius = 1.0f + 4.0f * unit_hash(4 * i + 3);
+            path.speed = (i % 2 ? 1.0f : -1.0f) * (0.2f + 0.3f * unit_hash(i + 0x9e3779b9u));
+            path.phase = 6.2831853f * unit_hash(i + 0x7f4a7c15u);
+            m_paths.push_back(path);
+
+            const glm::vec3 color = hue_color(unit_hash(i + 0x632be5abu)) * intensity;
+            m_lights.push_back(i % 4 == 3 ? ClusterLight::spot(path.center, glm::vec3(0.0f, -1.0f, 0.0f),
+                                                               LIGHT_RADIUS, color, 30.0f, 45.0f)
+                                          : ClusterLight::point(path.center, LIGHT_RADIUS, color));
+        }
+    }
+
+    void submit(RenderQueue &queue) override {
+        m_time += FRAME_STEP;
+        for (size_t i = 0; i < m_lights.size(); i++) {
+            const LightPath &path = m_paths[i];
+            const float angle = path.phase + path.speed * m_time;
+            m_lights[i].position = path.center + glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * path.radius;
+        }
+
+        queue.submit(RenderLayer::OPAQUE, glm::vec3(0.0f),
+                     m_packets[queue.path == RenderPath::DEFERRED ? DEFERRED : FORWARD]);
+    }
+
+    CameraPath camera_path() const override { return CameraPath::orbit(glm::vec3(0.0f), 36.0f, 14.0f, 20.0f); }
+
+    std::span<const ClusterLight> lights() const override { return m_lights; }
+
+    std::optional<ShaderDefines> deferred_lighting() const override { return m_lighting; }
+
+  private:
+    enum { FORWARD, DEFERRED };
+
+    struct LightPath {
+        glm::vec3 center;
+        float radius;
+        float speed;
+        float phase;
+    };
+
+    // The light set, shared by the forward shader and the deferred lighting pass
+    ShaderDefines m_lighting;
+    ShaderLibrary m_shaders;
+    Shader *m_shader[2];
+    SimpleGeometry m_cube;
+    Texture m_diffuse, m_specular;
+    // Per render path
+    DrawPacket m_packets[2];
+    InstanceBatch m_instances;
+    std::vector<LightPath> m_paths;
+    std::vector<ClusterLight> m_lights;
+    float m_time = 0.0f;
+};
+
+// "clustered_<lights>" and "clustered_<lights>_unculled"
+bool parse_clustered_scene(const std::string &name, unsigned int &light_count, bool &culled) {
+    const std::string prefix = "clustered_", suffix = "_unculled";
+    if (name.rfind(prefix, 0) != 0) {
+        return false;
+    }
+    std::string count = name.substr(prefix.size());
+    culled = !(count.size() > suffix.size() && count.ends_with(suffix));
+    if (!culled) {
+        count.resize(count.size() - suffix.size());
+    }
+    if (count.empty() || count.find_first_not_of("0123456789") != std::string::npos || count.size() > 6) {
+        return false;
+    }
+    light_count = std::stoul(count);
+    return true;
+}
+
+// `count` windows and blades of grass scattered over a floor between opaque crates (the blending chapter, scaled up).
+// Sorted, every quad is its own packet for the queue to order back to front; weighted blended, each texture's quads
+// go out as one instanced draw in whatever order.
+class TransparentScene : public Scene {
+  public:
+    static constexpr float SPACING = 1.0f;
+    // Share of cells that also hold a crate
+    static constexpr float CRATE_DENSITY = 1.0f / 16.0f;
+
+    explicit TransparentScene(unsigned int count)
+        : m_quad(QUAD_VERTICES, sizeof(QUAD_VERTICES)), m_cube(CUBE_VERTICES, sizeof(CUBE_VERTICES)),
+          m_plane(PLANE_VERTICES, sizeof(PLANE_VERTICES)),
+          m_window_texture("res/textures/blending_transparent_window.png", ""),
+          m_grass_texture("res/textures/grass.png", ""), m_cube_texture("res/textures/container.jpg", ""),
+          m_floor_texture("res/textures/metal.png", "") {
+        m_floor_shader = &m_shaders.get("res/shaders/vertex_depth.glsl", "res/shaders/fragment_depth.glsl");
+        m_cube_shader = &m_shaders.get("res/shaders/vertex_depth_instanced.glsl", "res/shaders/fragment_tinted.glsl");
+        m_sorted_shader = &m_shaders.get("res/shaders/vertex_depth.glsl", "res/shaders/fragment_blending.glsl",
+                                         {{"WEIGHTED_BLENDED", 0}});
+        m_weighted_shader = &m_shaders.get("res/shaders/vertex_depth_instanced.glsl",
+                                           "res/shaders/fragment_blending.glsl", {{"WEIGHTED_BLENDED", 1}});
+
+        // Repeating would bleed the bottom of the grass into the top of the quad
+        for (unsigned int texture : {m_window_texture.id, m_grass_texture.id}) {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // One quad per cell of a square, jittered and turned at random
+        const int side = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count)))));
+        m_half = side * SPACING * 0.5f;
+        for (unsigned int i = 0; i < count; i++) {
+            const glm::vec3 position((i % side + unit_hash(3 * i)) * SPACING - m_half, 0.0f,
+                                     (i / side + unit_hash(3 * i + 1)) * SPACING - m_half);
+            const glm::mat4 model = glm::rotate(glm::translate(glm::mat4(1.0f), position),
+                                                6.2831853f * unit_hash(3 * i + 2), glm::vec3(0.0f, 1.0f, 0.0f));
+            (unit_hash(i + 0x9e3779b9u) < 0.5f ? m_windows : m_grass).add(model);
+            if (unit_hash(i + 0x7f4a7c15u) < CRATE_DENSITY) {
+                m_crates.add(glm::translate(glm::mat4(1.0f), glm::vec3((i % side + 0.5f) * SPACING - m_half, 0.0f,
+                                                                       (i / side + 0.5f) * SPACING - m_half)));
+            }
+        }
+        m_windows.upload();
+        m_grass.upload();
+        m_crates.upload();
+
+        m_crate_packet.shader = m_cube_shader;
+        m_crate_packet.vao = m_cube.vao;
+        m_crate_packet.indexed = false;
+        m_crate_packet.count = m_cube.vertex_count;
+        m_crate_packet.textures[0] = {m_cube_texture.id, m_cube_shader->location("texture1")};
+        m_crate_packet.texture_count = 1;
+        m_crate_packet.instances = &m_crates;
+
+        m_floor_packet.shader = m_floor_shader;
+        m_floor_packet.vao = m_plane.vao;
+        m_floor_packet.indexed = false;
+        m_floor_packet.count = m_plane.vertex_count;
+        m_floor_packet.textures[0] = {m_floor_texture.id, m_floor_shader->location("texture1")};
+        m_floor_packet.texture_count = 1;
+        m_floor_packet.model_uniform = m_floor_shader->uniform<glm::mat4>("model");
+        // PLANE_VERTICES is 10 across
+        m_floor_packet.model =
+            glm::scale(glm::mat4(1.0f), glm::vec3((m_half + 1.0f) / 5.0f, 1.0f, (m_half + 1.0f) / 5.0f));
+
+        const std::pair<unsigned int, const InstanceBatch *> quads[] = {{m_window_texture.id, &m_windows},
+                                                                         {m_grass_texture.id, &m_grass}};
+        for (const bool weighted : {false, true}) {
+            const Shader &shader = weighted ? *m_weighted_shader : *m_sorted_shader;
+            for (size_t i = 0; i < std::size(quads); i++) {
+                DrawPacket &packet = m_quad_packets[weighted][i];
+                packet.shader = &shader;
+                packet.vao = m_quad.vao;
+                packet.indexed = false;
+                packet.count = m_quad.vertex_count;
+                packet.textures[0] = {quads[i].first, shader.location("texture1")};
+                packet.texture_count = 1;
+                if (weighted) {
+                    packet.instances = quads[i].second;
+                } else {
+                    packet.model_uniform = shader.uniform<glm::mat4>("model");
+                }
+            }
+        }
+    }
+
+    void submit(RenderQueue &queue) override {
+        queue.submit(RenderLayer::OPAQUE, glm::vec3(0.0f), m_crate_packet);
+        queue.submit(RenderLayer::OPAQUE, glm::vec3(0.0f), m_floor_packet);
+
+        // Sorted, the quads go out one by one through submit_items
+        m_weighted = queue.transparency == TransparencyMode::WEIGHTED_BLENDED;
+        if (m_weighted) {
+            for (const DrawPacket &packet : m_quad_packets[1]) {
+                queue.submit(RenderLayer::TRANSPARENT, glm::vec3(0.0f), packet);
+            }
+        }
+    }
+
+    // The windows, then the grass
+    size_t parallel_items() const override {
+        return m_weighted ? 0 : m_windows.instances().size() + m_grass.instances().size();
+    }
+
+    void submit_items(RenderQueue &queue, size_t begin, size_t end) const override {
+        const size_t windows = m_windows.instances().size();
+        for (size_t i = begin; i < end; i++) {
+            DrawPacket packet = m_quad_packets[0][i < windows ? 0 : 1];
+            packet.model = i < windows ? m_windows.instances()[i].model : m_grass.instances()[i - windows].model;
+            queue.submit(RenderLayer::TRANSPARENT, glm::vec3(packet.model[3]), packet);
+        }
+    }
+
+    CameraPath camera_path() const override {
+        return CameraPath::orbit(glm::vec3(0.0f), m_half + 4.0f, 2.0f + 0.3f * m_half, 16.0f);
+    }
+
+  private:
+    ShaderLibrary m_shaders;
+    Shader *m_floor_shader, *m_cube_shader, *m_sorted_shader, *m_weighted_shader;
+    SimpleGeometry m_quad, m_cube, m_plane;
+    Texture m_window_texture, m_grass_texture, m_cube_texture, m_floor_texture;
+    InstanceBatch m_windows, m_grass, m_crates;
+    float m_half;
+    DrawPacket m_crate_packet, m_floor_packet;
+    // Window and grass packets, [0] sorted (everything but the model matrix) and [1] weighted blended (instanced)
+    DrawPacket m_quad_packets[2][2];
+    // This frame's mode, set by submit()
+    bool m_weighted = false;
+};
+
+// "transparent_<count>"
+bool parse_transparent_scene(const std::string &name, unsigned int &count) {
+    const std::string prefix = "transparent_";
+    if (name.rfind(prefix, 0) != 0) {
+        return false;
+    }
+    const std::string digits = name.substr(prefix.size());
+    if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos || digits.size() > 7) {
+        return false;
+    }
+    count = std::stoul(digits);
+    return true;
+}
+
+// `count` spinning crates filling a cube, every one its own draw: each frame rebuilds its model matrix and culls it
+// against the frustum before queueing it. That per-object CPU work is what parallel recording spreads over the
+// renderer's workers.
+class DrawCallScene : public Scene {
+  public:
+    static constexpr float SPACING = 1.5f;
+    static constexpr float CRATE_SIZE = 0.6f;
+    static constexpr float FRAME_STEP = 1.0f / 60.0f;
+
+    explicit DrawCallScene(unsigned int count)
+        : m_shader(load_shader("res/shaders/vertex_depth.glsl", "res/shaders/fragment_depth.glsl")),
+          m_cube(CUBE_VERTICES, sizeof(CUBE_VERTICES)), m_textures{Texture("res/textures/container.jpg", ""),
+                                                                   Texture("res/textures/metal.png", "")} {
+        const int side = std::max(1, static_cast<int>(std::ceil(std::cbrt(static_cast<float>(count)))));
+        m_half = side * SPACING * 0.5f;
+        m_crates.reserve(count);
+        for (unsigned int i = 0; i < count; i++) {
+            Crate crate;
+            crate.position = glm::vec3((i % side + 0.5f) * SPACING - m_half,
+                                       ((i / side) % side + 0.5f) * SPACING - m_half,
+                                       (i / (side * side) + 0.5f) * SPACING - m_half);
+            crate.axis = glm::normalize(glm::vec3(unit_hash(4 * i) - 0.5f, 1.0f, unit_hash(4 * i + 1) - 0.5f));
+            crate.speed = 0.5f + 2.0f * unit_hash(4 * i + 2);
+            crate.phase = 6.2831853f * unit_hash(4 * i + 3);
+            crate.texture = unit_hash(i + 0x9e3779b9u) < 0.5f ? 0 : 1;
+            m_crates.push_back(crate);
+        }
+
+        for (unsigned int i = 0; i < 2; i++) {
+            m_packets[i].shader = m_shader.get();
+            m_packets[i].vao = m_cube.vao;
+            m_packets[i].indexed = false;
+            m_packets[i].count = m_cube.vertex_count;
+            m_packets[i].textures[0] = {m_textures[i].id, m_shader->location("texture1")};
+            m_packets[i].texture_count = 1;
+            m_packets[i].model_uniform = m_shader->uniform<glm::mat4>("model");
+        }
+    }
+
+    // The crates go out through submit_items
+    void submit(RenderQueue &) override { m_time += FRAME_STEP; }
+
+    size_t parallel_items() const override { return m_crates.size(); }
+
+    void submit_items(RenderQueue &queue, size_t begin, size_t end) const override {
+        // Spinning never takes a crate outside the sphere around it
+        const glm::vec3 reach(CRATE_SIZE * 0.8660254f);
+        size_t visible = 0;
+        for (size_t i = begin; i < end; i++) {
+            const Crate &crate = m_crates[i];
+            if (!queue.frustum().intersects({crate.position - reach, crate.position + reach})) {
+                continue;
+            }
+            DrawPacket packet = m_packets[crate.texture];
+            packet.model = glm::scale(glm::rotate(glm::translate(glm::mat4(1.0f), crate.position),
+                                                  crate.phase + crate.speed * m_time, crate.axis),
+                                      glm::vec3(CRATE_SIZE));
+            queue.submit(RenderLayer::OPAQUE, crate.position, packet);
+            visible++;
+        }
+        queue.cull_stats.tested += end - begin;
+        queue.cull_stats.visible += visible;
+        queue.cull_stats.culled += end - begin - visible;
+    }
+
+    CameraPath camera_path() const override {
+        return CameraPath::orbit(glm::vec3(0.0f), 1.7f * m_half + 4.0f, 0.4f * m_half, 20.0f);
+    }
+
+  private:
+    struct Crate {
+        glm::vec3 position;
+        glm::vec3 axis;
+        float speed;
+        float phase;
+        unsigned int texture;
+    };
+
+    std::unique_ptr<Shader> m_shader;
+    SimpleGeometry m_cube;
+    Texture m_textures[2];
+    std::vector<Crate> m_crates;
+    float m_half;
+    float m_time = 0.0f;
+    // One per texture, everything but the model matrix
+    DrawPacket m_packets[2];
+};
+
+// "draws_<count>"
+bool parse_draw_call_scene(const std::string &name, unsigned int &count) {
+    const std::string prefix = "draws_";
+    if (name.rfind(prefix, 0) != 0) {
+        return false;
+    }
+    const std::string digits = name.substr(prefix.size());
+    if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos || digits.size() > 7) {
+        return false;
+    }
+    count = std::stoul(digits);
+    return true;
+}
+
+// A grid of backpack models, frustum culled and LOD selected per mesh
+class BackpackScene : public Scene {
+  public:
+    static constexpr int GRID_SIZE = 3;
+    static constexpr float SPACING = 5.0f;
+
+    BackpackScene()
+        : m_shader(load_shader("res/shaders/vertex_model.glsl", "res/shaders/fragment_model.glsl")),
+          m_model("res/models/backpack/backpack.obj"), m_model_uniform(m_shader->uniform<glm::mat4>("model")) {}
+
+    void submit(RenderQueue &queue) override {
+        const float half = (GRID_SIZE - 1) * SPACING * 0.5f;
+        for (int z = 0; z < GRID_SIZE; z++) {
+            for (int x = 0; x < GRID_SIZE; x++) {
+                const glm::mat4 model =
+                    glm::translate(glm::mat4(1.0f), glm::vec3(x * SPACING - half, 0.0f, z * SPACING - half));
+                m_model.submit(queue, *m_shader, model, m_model_uniform, RenderLayer::OPAQUE,
+                               &m_lod_states[z * GRID_SIZE + x]);
+            }
+        }
+    }
+
+    CameraPath camera_path() const override { return CameraPath::orbit(glm::vec3(0.0f), 14.0f, 4.0f, 10.0f); }
+
+  private:
+    std::unique_ptr<Shader> m_shader;
+    Model m_model;
+    Uniform<glm::mat4> m_model_uniform;
+    LodState m_lod_states[GRID_SIZE * GRID_SIZE];
+};
+
+// The backpack grid again, but every cell streams in its own copy through a ModelStreamer. Cells draw a placeholder
+// box until their copy is on the GPU; the uploads are spread over frames by the streamer's budget.
+class StreamingScene : public Scene {
+  public:
+    static constexpr int GRID_SIZE = 3;
+    static constexpr float SPACING = 5.0f;
+
+    StreamingScene()
+        : m_shader(load_shader("res/shaders/vertex_model.glsl", "res/shaders/fragment_model.glsl")),
+          m_model_uniform(m_shader->uniform<glm::mat4>("model")) {
+        for (auto &handle : m_handles) {
+            handle = m_streamer.load("res/models/backpack/backpack.obj");
+        }
+    }
+
+    void submit(RenderQueue &queue) override {
+        m_streamer.update();
+        if (!m_reported && m_streamer.idle()) {
+            m_reported = true;
+            const StreamingStats &stats = m_streamer.stats();
+            std::printf("streamed %u models (%u failed), %.1f MiB uploaded\n", stats.loads_ready, stats.loads_failed,
+                        stats.total_bytes / (1024.0 * 1024.0));
+        }
+
+        const float half = (GRID_SIZE - 1) * SPACING * 0.5f;
+        for (int z = 0; z < GRID_SIZE; z++) {
+            for (int x = 0; x < GRID_SIZE; x++) {
+                const int cell = z * GRID_SIZE + x;
+                const glm::mat4 model =
+                    glm::translate(glm::mat4(1.0f), glm::vec3(x * SPACING - half, 0.0f, z * SPACING - half));
+                m_streamer.submit(queue, *m_shader, m_handles[cell], model, m_model_uniform, RenderLayer::OPAQUE,
+                                  &m_lod_states[cell]);
+            }
+        }
+    }
+
+    CameraPath camera_path() const override { return CameraPath::orbit(glm::vec3(0.0f), 14.0f, 4.0f, 10.0f); }
+
+  private:
+    std::unique_ptr<Shader> m_shader;
+    Uniform<glm::mat4> m_model_uniform;
+    ModelStreamer m_streamer;
+    ModelHandle m_handles[GRID_SIZE * GRID_SIZE];
+    LodState m_lod_states[GRID_SIZE * GRID_SIZE];
+    bool m_reported = false;
+};
+
+} // namespace
+
+const std::vector<std::string> &scene_names() {
+    static const std::vector<std::string> names = {
+        "cubes", "cube_field", "cube_field_unbatched", "lights", "lights_directional", "clustered_4", "clustered_16",
+        "clustered_64", "clustered_256", "clustered_1024", "clustered_256_unculled", "transparent_100",
+        "transparent_1000", "transparent_10000", "draws_10000", "draws_30000", "draws_100000", "backpack", "streaming"};
+    return names;
+}
+
+std::unique_ptr<Scene> make_scene(const std::string &name) {
+    if (name == "cubes") {
+        return std::make_unique<CubesScene>();
+    }
+    if (name == "cube_field") {
+        return std::make_unique<CubeFieldScene>(true);
+    }
+    if (name == "cube_field_unbatched") {
+        return std::make_unique<CubeFieldScene>(false);
+    }
+    if (name == "lights") {
+        return std::make_unique<LightsScene>(LightingFeatures{});
+    }
+    if (name == "lights_directional") {
+        return std::make_unique<LightsScene>(LightingFeatures{true, 0, false});
+    }
+    unsigned int light_count;
+    bool culled;
+    if (parse_clustered_scene(name, light_count, culled)) {
+        return std::make_unique<ClusteredLightsScene>(light_count, culled);
+    }
+    unsigned int transparent_count;
+    if (parse_transparent_scene(name, transparent_count)) {
+        return std::make_unique<TransparentScene>(transparent_count);
+    }
+    unsigned int draw_count;
+    if (parse_draw_call_scene(name, draw_count)) {
+        return std::make_unique<DrawCallScene>(draw_count);
+    }
+    if (name == "backpack") {
+        return std::make_unique<BackpackScene>();
+    }
+    if (name == "streaming") {
+        return std::make_unique<StreamingScene>();
+    }
+    throw std::runtime_error("Unknown scene: " + name);
+}
+
+RecordStats record_scene(Scene &scene, RenderQueue &queue, JobSystem *jobs, std::vector<RenderQueue> &worker_queues,
+                         size_t grain) {
+    const auto start = std::chrono::steady_clock::now();
+    scene.submit(queue);
+
+    RecordStats stats;
+    stats.items = scene.parallel_items();
+    if (stats.items > 0 && (!jobs || jobs->worker_count() == 1)) {
+        scene.submit_items(queue, 0, stats.items);
+        stats.ranges = 1;
+    } else if (stats.items > 0) {
+        worker_queues.resize(jobs->worker_count());
+        for (auto &worker_queue : worker_queues) {
+            worker_queue.begin_frame(queue);
+        }
+        // Each range tags its packets with its first item, which puts ties back in item order whichever worker
+        // recorded them, so merging in worker order is fine
+        jobs->parallel_for(stats.items, grain, [&scene, &worker_queues](size_t begin, size_t end, unsigned int worker) {
+            RenderQueue &worker_queue = worker_queues[worker];
+            worker_queue.order = static_cast<uint32_t>(begin);
+            scene.submit_items(worker_queue, begin, end);
+        });
+        for (auto &worker_queue : worker_queues) {
+            queue.merge(worker_queue);
+        }
+        const JobStats job_stats = jobs->stats();
+        stats.ranges = job_stats.ranges;
+        stats.steals = job_stats.steals;
+    }
+    stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+SceneRenderer::SceneRenderer() : m_frame_ubo(FRAME_BLOCK_BINDING), m_lights_ubo(LIGHTS_BLOCK_BINDING) {}
+
+void SceneRenderer::render(Scene &scene, Camera &camera, float aspect) {
+    int viewport[4], target = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+    const FrameResource output = m_graph.import_framebuffer("target", target, glm::ivec2(viewport[2], viewport[3]));
+    add_passes(m_graph, scene, camera, aspect, output, output);
+    m_graph.execute();
+}
+
+void SceneRenderer::record(Scene &scene) {
+    PROFILE_ZONE("Scene::submit");
+    record_stats = record_scene(scene, m_queue, jobs, m_worker_queues);
+}
+
+void SceneRenderer::add_passes(FrameGraph &graph, Scene &scene, Camera &camera, float aspect, FrameResource color,
+                               FrameResource depth, std::optional<glm::vec4> clear_color) {
+    PROFILE_ZONE("SceneRenderer::add_passes");
+    // per-frame data shared by every program
+    FrameUniforms frame{};
+    frame.view = camera.get_view_matrix();
+    frame.projection = glm::perspective(glm::radians(camera.m_zoom), aspect, SCENE_NEAR_PLANE, SCENE_FAR_PLANE);
+    frame.view_pos = camera.m_position;
+    m_frame_ubo.update(frame);
+    m_lights_ubo.update(default_lights(camera.m_position, camera.m_front));
+
+    // scenes that can't be lit from the G-buffer stay forward
+    const std::optional<ShaderDefines> lighting = scene.deferred_lighting();
+    const RenderPath frame_path = lighting ? path : RenderPath::FORWARD;
+    const TransparencyMode frame_transparency = graph.imported(depth) ? TransparencyMode::SORTED : transparency;
+
+    // queue the scene; the queue sorts by state and depth and skips redundant binds
+    m_queue.begin_frame(frame.view, frame.projection, SCENE_FAR_PLANE);
+    m_queue.lod.set_camera(camera);
+    m_queue.path = frame_path;
+    m_queue.transparency = frame_transparency;
+    record(scene);
+
+    // the scene may have moved its lights while submitting
+    const glm::ivec2 size = graph.size(color);
+    m_clusters.update(scene.lights(), frame.view, frame.projection, SCENE_NEAR_PLANE, SCENE_FAR_PLANE, size);
+
+    // whatever ran before may have bound anything, and the graph may have reallocated textures the cache thinks are
+    // bound
+    const auto begin = [this] {
+        m_gl_state.invalidate();
+        m_clusters.bind();
+    };
+    std::vector<FrameResource> targets = {color};
+    if (depth != color) {
+        targets.push_back(depth);
+    }
+
+    if (frame_path == RenderPath::DEFERRED) {
+        const FrameResource albedo_specular =
+            graph.create("G-buffer albedo/specular", size, GBUFFER_ALBEDO_SPECULAR_FORMAT);
+        const FrameResource normal_shininess =
+            graph.create("G-buffer normal/shininess", size, GBUFFER_NORMAL_SHININESS_FORMAT);
+        const FrameResource gbuffer_depth = graph.create("G-buffer depth", size, GBUFFER_DEPTH_FORMAT);
+        m_gbuffer_bytes = size_t(size.x) * size.y * GBUFFER_BYTES_PER_PIXEL;
+
+        graph.add_pass({"G-buffer", {}, {albedo_specular, normal_shininess, gbuffer_depth}, true, glm::vec4(0.0f),
+                        [this, begin](const FrameGraph &) {
+                            PROFILE_GPU_ZONE("G-buffer pass");
+                            begin();
+                            m_queue.flush(m_gl_state, RenderLayer::OPAQUE);
+                        }});
+        graph.add_pass({"deferred lighting", {albedo_specular, normal_shininess, gbuffer_depth}, targets,
+                        clear_color.has_value(), clear_color.value_or(glm::vec4(0.0f)),
+                        [this, lighting, frame, albedo_specular, normal_shininess, gbuffer_depth](const FrameGraph &g) {
+                            PROFILE_GPU_ZONE("deferred lighting");
+                            const GBufferTextures gbuffer{g.texture(albedo_specular), g.texture(normal_shininess),
+                                                          g.texture(gbuffer_depth)};
+                            m_deferred_lighting.draw(m_gl_state, gbuffer, *lighting, frame.projection * frame.view);
+                        }});
+    }
+
+    // whichever pass flushes the queue last
+    const auto finish = [this, frame_path, frame_transparency] {
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+
+        stats = m_queue.stats;
+        cull_stats = m_queue.cull_stats;
+        lod_stats = m_queue.lod_stats;
+        cluster_stats = m_clusters.stats();
+        rendered_path = frame_path;
+        rendered_transparency = frame_transparency;
+    };
+
+    // the forward layers draw over the lit opaque scene on the deferred path; sorted transparency blends straight in
+    const bool deferred = frame_path == RenderPath::DEFERRED;
+    const bool weighted =
+        frame_transparency == TransparencyMode::WEIGHTED_BLENDED && m_queue.queued(RenderLayer::TRANSPARENT) > 0;
+    graph.add_pass({"forward", {}, targets, clear_color.has_value() && !deferred,
+                    clear_color.value_or(glm::vec4(0.0f)),
+                    [this, begin, finish, deferred, weighted](const FrameGraph &) {
+                        if (!deferred) {
+                            begin();
+                        }
+                        m_queue.flush(m_gl_state, RenderLayer::OPAQUE);
+                        if (!weighted) {
+                            begin_transparent_blend(TransparencyMode::SORTED);
+                            m_queue.flush(m_gl_state);
+                            end_transparent_blend();
+                            finish();
+                        }
+                    }});
+    if (!weighted) {
+        return;
+    }
+
+    // weighted blended OIT: the transparent layer accumulates in any order, tested against the opaque depth, then
+    // one full-screen pass blends it over the target
+    const FrameResource accum = graph.create("OIT accumulation", size, OIT_ACCUM_FORMAT);
+    const FrameResource weight = graph.create("OIT weight", size, OIT_WEIGHT_FORMAT);
+    FramePass accumulate;
+    accumulate.name = "transparent accumulation";
+    accumulate.writes = {accum, weight, depth};
+    // colour sums start at 0, revealage at 1
+    accumulate.clear = true;
+    accumulate.clear_color = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    accumulate.clear_depth = false;
+    accumulate.execute = [this, begin, finish](const FrameGraph &) {
+        PROFILE_GPU_ZONE("transparent accumulation");
+        begin();
+        begin_transparent_blend(TransparencyMode::WEIGHTED_BLENDED);
+        m_queue.flush(m_gl_state);
+        end_transparent_blend();
+        finish();
+    };
+    graph.add_pass(std::move(accumulate));
+    graph.add_pass({"transparent composite", {accum, weight}, {color}, false, glm::vec4(0.0f),
+                    [this, accum, weight](const FrameGraph &g) {
+                        PROFILE_GPU_ZONE("transparent composite");
+                        m_oit_composite.draw(m_gl_state, g.texture(accum), g.texture(weight));
+                    }});
+}
@@ -0,0 +1,146 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include "camera.hpp"
+#include "camera_path.hpp"
+#include "deferred.hpp"
+#include "frame_graph.hpp"
+#include "gl_state.hpp"
+#include "light_clusters.hpp"
+#include "render_queue.hpp"
+#include "transparency.hpp"
+#include "uniform_blocks.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+constexpr float SCENE_NEAR_PLANE = 0.1f;
+constexpr float SCENE_FAR_PLANE = 100.0f;
+
+// Something to render, owned GL resources and all. Scenes are picked by name so the interactive viewer and the
+// headless benchmark can run exactly the same content.
+class Scene {
+  public:
+    virtual ~Scene() = default;
+
+    // Queues everything to draw this frame; cull against queue.frustum() where it pays off
+    virtual void submit(RenderQueue &queue) = 0;
+
+    // Scenes with many independent objects can queue them here instead of in submit(), a slice of
+    // [0, parallel_items()) per call. Slices may be recorded at the same time on different threads, each into a queue
+    // of its own, so submit_items must only read the scene (submit() can prepare what it needs, uniform locations
+    // included). Both are called after submit() every frame.
+    virtual size_t parallel_items() const { return 0; }
+    virtual void submit_items(RenderQueue &, size_t, size_t) const {}
+
+    // Deterministic fly-through used for benchmark runs
+    virtual CameraPath camera_path() const = 0;
+
+    // Lights for the clustered permutations of fragment.glsl, read after submit() every frame
+    virtual std::span<const ClusterLight> lights() const { return {}; }
+
+    // Scenes that can be drawn deferred return the light set defines (include/lighting.glsl) their forward shaders
+    // use, for the lighting pass; they must then submit GBUFFER permutations when queue.path is DEFERRED. The rest are
+    // always drawn forward.
+    virtual std::optional<ShaderDefines> deferred_lighting() const { return std::nullopt; }
+};
+
+// Names accepted by make_scene; the first one is the default
+const std::vector<std::string> &scene_names();
+
+// Needs a current GL context. Throws std::runtime_error for an unknown name or missing resources.
+std::unique_ptr<Scene> make_scene(const std::string &name);
+
+struct RecordStats {
+    // CPU time queueing the scene: submit(), the parallel items and merging the workers' queues
+    double ms = 0.0;
+    uint64_t items = 0;
+    // Ranges the items were recorded in, and how many of those a worker stole (see JobSystem)
+    uint64_t ranges = 0;
+    uint64_t steals = 0;
+
+    RecordStats &operator+=(const RecordStats &o) {
+        ms += o.ms;
+        items += o.items;
+        ranges += o.ranges;
+        steals += o.steals;
+        return *this;
+    }
+};
+
+// Smallest slice of a scene's parallel items worth recording on its own
+constexpr size_t RECORD_GRAIN = 256;
+
+// Queues `scene` into `queue`, already begun for the frame: submit(), then its parallel_items() in ranges on `jobs`,
+// each worker recording into its own of `worker_queues` (resized to fit), merged back into `queue` on the calling
+// thread. The queue then sorts exactly as if every item had been queued in order on the calling thread, which is what
+// happens without jobs or with a single worker. Touches no GL itself.
+RecordStats record_scene(Scene &scene, RenderQueue &queue, JobSystem *jobs, std::vector<RenderQueue> &worker_queues,
+                         size_t grain = RECORD_GRAIN);
+
+// Per-frame plumbing shared by every scene: uploads the Frame/Lights uniform blocks for the camera, bins the scene's
+// lights into clusters, then sorts and flushes what the scene queued. On the deferred path the opaque layer goes to
+// the G-buffer, which is lit into the target, depth included, before the transparent layer is drawn over it: sorted
+// and blended straight into the target, or accumulated into weighted blended OIT targets and composited over it.
+class SceneRenderer {
+  public:
+    // Asked for; scenes without deferred_lighting() are drawn forward regardless
+    RenderPath path = RenderPath::FORWARD;
+    // Asked for; weighted blending needs the depth as a texture, so drawing straight into an imported framebuffer
+    // stays sorted
+    TransparencyMode transparency = TransparencyMode::SORTED;
+    // Records the scene's parallel_items() on these workers, each into its own queue, and merges them into the frame's
+    // queue on the calling thread, which alone talks to GL (see record_scene). Without one they're queued on the
+    // calling thread.
+    JobSystem *jobs = nullptr;
+
+    // For the most recent render()
+    RenderStats stats;
+    RecordStats record_stats;
+    CullStats cull_stats;
+    LodStats lod_stats;
+    ClusterStats cluster_stats;
+    RenderPath rendered_path = RenderPath::FORWARD;
+    TransparencyMode rendered_transparency = TransparencyMode::SORTED;
+
+    SceneRenderer();
+
+    // Hysteresis, bias and the on/off switch; the camera is set on every render()
+    LodSelector &lod_selector() { return m_queue.lod; }
+
+    // Draws into the currently bound framebuffer; clearing it is up to the caller
+    void render(Scene &scene, Camera &camera, float aspect);
+
+    // Queues the scene now and declares the passes drawing it into `color` and `depth` (transients, or one imported
+    // framebuffer passed as both), clearing them first when `clear_color` is set. The G-buffer and the OIT targets are
+    // transients of the same size. Stats are filled in when the passes run.
+    void add_passes(FrameGraph &graph, Scene &scene, Camera &camera, float aspect, FrameResource color,
+                    FrameResource depth, std::optional<glm::vec4> clear_color = std::nullopt);
+
+    // Of the most recent frame drawn deferred; zero until one was
+    size_t gbuffer_bytes() const { return m_gbuffer_bytes; }
+
+  private:
+    GlStateCache m_gl_state;
+    RenderQueue m_queue;
+    // One per worker of `jobs`, merged into m_queue every frame
+    std::vector<RenderQueue> m_worker_queues;
+    UniformBuffer<FrameUniforms> m_frame_ubo;
+    UniformBuffer<LightUniforms> m_lights_ubo;
+    ClusteredLights m_clusters;
+    DeferredLighting m_deferred_lighting;
+    WeightedBlendedComposite m_oit_composite;
+    size_t m_gbuffer_bytes = 0;
+    // For render()
+    FrameGraph m_graph;
+
+    void record(Scene &scene);
+};
+
+#endif
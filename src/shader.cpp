@@ -1,12 +1,21 @@
 #include "shader.hpp"
 #include "glm/ext/vector_float3.hpp"
 #include "glm/gtc/type_ptr.hpp"
+#include "profiler.hpp"
+#include "program_cache.hpp"
+#include "uniform_blocks.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <sstream>
 #include <stdexcept>
 
+namespace fs = std::filesystem;
+
 void Shader::use() { glUseProgram(this->_m_id); }
 
 std::string readFileToString(const std::string &filename) {
@@ -28,79 +37,326 @@ std::string readFileToString(const std::string &filename) {
     return content;
 }
 
-std::unique_ptr<Shader> ShaderBuilder::build() {
-    int success;
-    const int buff_size = 512;
-    char infolog[buff_size] = {};
+namespace {
 
-    const unsigned int id = glCreateProgram();
+// Appends path's lines to out, pasting includes in place; `files` holds every file pasted so far (index = source
+// string number)
+void expand_shader(const std::string &path, unsigned int source, const ShaderDefines &defines,
+                   std::vector<std::string> &files, std::string &out) {
+    std::istringstream lines(readFileToString(path));
+    std::string line;
+    for (unsigned int number = 1; std::getline(lines, line); number++) {
+        // Position of the directive name, for preprocessor lines only
+        const size_t hash = line.find_first_not_of(" \t");
+        const size_t directive = hash == std::string::npos || line[hash] != '#'
+                                     ? std::string::npos
+                                     : line.find_first_not_of(" \t", hash + 1);
+        if (directive == std::string::npos) {
+            out += line + "\n";
+            continue;
+        }
 
-    const unsigned int vertex_id = glCreateShader(GL_VERTEX_SHADER);
-    const char *vs = _m_vertex_src.c_str();
-    glShaderSource(vertex_id, 1, &vs, NULL);
-    glCompileShader(vertex_id);
+        if (source == 0 && line.compare(directive, 7, "version") == 0) {
+            out += line + "\n";
+            for (const auto &[name, value] : defines) {
+                out += "#define " + name + " " + std::to_string(value) + "\n";
+            }
+            out += "#line " + std::to_string(number + 1) + " 0\n";
+            continue;
+        }
+        if (line.compare(directive, 7, "include") != 0) {
+            out += line + "\n";
+            continue;
+        }
 
-    glGetShaderiv(vertex_id, GL_COMPILE_STATUS, &success);
+        const size_t open = line.find('"', directive + 7);
+        const size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+        if (close == std::string::npos || close == open + 1) {
+            throw std::runtime_error("Malformed #include in " + path + ":" + std::to_string(number));
+        }
+        const fs::path name = line.substr(open + 1, close - open - 1);
+        const std::string included = (fs::path(path).parent_path() / name).lexically_normal().generic_string();
 
-    if (!success) {
-        glGetShaderInfoLog(vertex_id, buff_size, NULL, infolog);
+        if (std::find(files.begin(), files.end(), included) == files.end()) {
+            const unsigned int included_source = files.size();
+            files.push_back(included);
+            out += "#line 1 " + std::to_string(included_source) + "\n";
+            expand_shader(included, included_source, defines, files, out);
+        }
+        out += "#line " + std::to_string(number + 1) + " " + std::to_string(source) + "\n";
+    }
+}
 
-        throw std::runtime_error("Failed to compile vertex shader: " + std::string(infolog));
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::duration<double, std::milli>;
+
+// Lets the driver use as many compiler threads as it likes; the default is implementation-defined and may be 0
+void enable_parallel_compile() {
+    static bool enabled = false;
+    if (!enabled && GLAD_GL_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
     }
+    enabled = true;
+}
 
-    const unsigned int fragment_id = glCreateShader(GL_FRAGMENT_SHADER);
-    const char *fs = _m_fragment_src.c_str();
-    glShaderSource(fragment_id, 1, &fs, NULL);
-    glCompileShader(fragment_id);
+unsigned int start_compile(GLenum type, const std::string &src) {
+    const unsigned int id = glCreateShader(type);
+    const char *s = src.c_str();
+    glShaderSource(id, 1, &s, NULL);
+    glCompileShader(id);
+    return id;
+}
 
-    glGetShaderiv(fragment_id, GL_COMPILE_STATUS, &success);
+void check_compile(unsigned int id, const char *stage) {
+    int success;
+    glGetShaderiv(id, GL_COMPILE_STATUS, &success);
 
     if (!success) {
         const int buff_size = 512;
         char infolog[buff_size] = {};
-        glGetShaderInfoLog(fragment_id, buff_size, NULL, infolog);
+        glGetShaderInfoLog(id, buff_size, NULL, infolog);
 
-        throw std::runtime_error("Failed to compile fragment shader: " + std::string(infolog));
+        throw std::runtime_error("Failed to compile " + std::string(stage) + " shader: " + std::string(infolog));
     }
+}
 
-    glAttachShader(id, vertex_id);
-    glAttachShader(id, fragment_id);
-    glLinkProgram(id);
+} // namespace
 
-    glGetProgramiv(id, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(id, buff_size, NULL, infolog);
-        throw std::runtime_error("Failed to link shader program: " + std::string(infolog));
+std::string preprocess_shader(const std::string &path, const ShaderDefines &defines) {
+    const std::string normalized = fs::path(path).lexically_normal().generic_string();
+    std::vector<std::string> files = {normalized};
+    std::string out;
+    expand_shader(normalized, 0, defines, files, out);
+    return out;
+}
+
+std::string shader_defines_key(const ShaderDefines &defines) {
+    std::string key;
+    for (const auto &[name, value] : defines) {
+        key += (key.empty() ? "" : ",") + name + "=" + std::to_string(value);
     }
+    return key;
+}
+
+ShaderBuilder ShaderBuilder::from_files(const std::string &vertex_path, const std::string &fragment_path,
+                                        const ShaderDefines &defines) {
+    ShaderBuilder builder;
+    builder._m_vertex_src = preprocess_shader(vertex_path, defines);
+    builder._m_fragment_src = preprocess_shader(fragment_path, defines);
+    return builder;
+}
+
+std::unique_ptr<Shader> ShaderBuilder::build() { return start().finish(); }
 
-    glDeleteShader(vertex_id);
-    glDeleteShader(fragment_id);
+PendingShader ShaderBuilder::start() {
+    PROFILE_ZONE("ShaderBuilder::start");
+    ProgramCache &cache = ProgramCache::shared();
+    PendingShader pending;
 
-    return std::make_unique<Shader>(id);
+    if (cache.available()) {
+        pending.m_key = cache.key(_m_vertex_src, _m_fragment_src);
+        pending.m_program = cache.load(pending.m_key);
+        if (pending.m_program) {
+            pending.m_cached = true;
+            return pending;
+        }
+    }
+
+    const auto start = Clock::now();
+    enable_parallel_compile();
+    pending.m_program = glCreateProgram();
+    pending.m_vertex = start_compile(GL_VERTEX_SHADER, _m_vertex_src);
+    pending.m_fragment = start_compile(GL_FRAGMENT_SHADER, _m_fragment_src);
+
+    // Linking right away (rather than after checking the stages) keeps the whole build on the driver's threads; a
+    // failed stage shows up in finish() either way
+    glAttachShader(pending.m_program, pending.m_vertex);
+    glAttachShader(pending.m_program, pending.m_fragment);
+    if (cache.available()) {
+        glProgramParameteri(pending.m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(pending.m_program);
+    pending.m_start_ms = Millis(Clock::now() - start).count();
+    return pending;
+}
+
+PendingShader::PendingShader(PendingShader &&other) noexcept
+    : m_program(other.m_program), m_vertex(other.m_vertex), m_fragment(other.m_fragment), m_key(other.m_key),
+      m_cached(other.m_cached), m_start_ms(other.m_start_ms) {
+    other.m_program = other.m_vertex = other.m_fragment = 0;
+}
+
+PendingShader::~PendingShader() {
+    // glDelete* ignore 0
+    glDeleteShader(m_vertex);
+    glDeleteShader(m_fragment);
+    glDeleteProgram(m_program);
 }
 
-Shader::Shader(unsigned int id) : _m_id(id) {}
+bool PendingShader::ready() const {
+    if (m_cached || !GLAD_GL_KHR_parallel_shader_compile) {
+        return true;
+    }
+    int done = 0;
+    glGetProgramiv(m_program, GL_COMPLETION_STATUS_KHR, &done);
+    return done;
+}
+
+std::unique_ptr<Shader> PendingShader::finish() {
+    PROFILE_ZONE("PendingShader::finish");
+    ProgramCache &cache = ProgramCache::shared();
+
+    if (!m_cached) {
+        const auto start = Clock::now();
+        check_compile(m_vertex, "vertex");
+        check_compile(m_fragment, "fragment");
+
+        int success;
+        glGetProgramiv(m_program, GL_LINK_STATUS, &success);
+        if (!success) {
+            const int buff_size = 512;
+            char infolog[buff_size] = {};
+            glGetProgramInfoLog(m_program, buff_size, NULL, infolog);
+            throw std::runtime_error("Failed to link shader program: " + std::string(infolog));
+        }
+
+        glDetachShader(m_program, m_vertex);
+        glDetachShader(m_program, m_fragment);
+        glDeleteShader(m_vertex);
+        glDeleteShader(m_fragment);
+        m_vertex = m_fragment = 0;
+        cache.record_compile(m_start_ms + Millis(Clock::now() - start).count());
+
+        if (cache.available()) {
+            cache.store(m_key, m_program);
+        }
+    }
+
+    // Entries are stored before this, so programs loaded from the cache need it as well
+    bind_uniform_blocks(m_program);
+
+    const unsigned int id = m_program;
+    m_program = 0;
+    return std::make_unique<Shader>(id, ShaderBuilder::reflect_uniforms(id));
+}
+
+std::vector<std::unique_ptr<Shader>> build_shaders(std::vector<ShaderBuilder> &builders) {
+    PROFILE_ZONE("build_shaders");
+    std::vector<PendingShader> pending;
+    pending.reserve(builders.size());
+    for (auto &builder : builders) {
+        pending.push_back(builder.start());
+    }
+
+    std::vector<std::unique_ptr<Shader>> shaders;
+    shaders.reserve(pending.size());
+    for (auto &p : pending) {
+        shaders.push_back(p.finish());
+    }
+    return shaders;
+}
+
+namespace {
+UniformStats uniform_stats;
+}
+
+std::vector<UniformInfo> ShaderBuilder::reflect_uniforms(unsigned int program) {
+    int count = 0, max_length = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+    std::vector<UniformInfo> uniforms;
+    std::vector<char> buffer(std::max(max_length, 1));
+    for (int i = 0; i < count; i++) {
+        int length = 0, size = 0;
+        GLenum type;
+        glGetActiveUniform(program, i, buffer.size(), &length, &size, &type, buffer.data());
+
+        std::string name(buffer.data(), length);
+        const int location = glGetUniformLocation(program, name.c_str());
+        uniform_stats.driver_queries++;
+
+        // Members of uniform blocks have no location
+        if (location < 0) {
+            continue;
+        }
+
+        const auto bracket = name.rfind("[0]");
+        if (bracket == std::string::npos || bracket + 3 != name.size()) {
+            uniforms.push_back({name, location, type});
+            continue;
+        }
+
+        // Arrays of basic types report only "a[0]"; expose "a" and every element
+        const std::string base = name.substr(0, bracket);
+        uniforms.push_back({base, location, type});
+        uniforms.push_back({name, location, type});
+        for (int j = 1; j < size; j++) {
+            const std::string element = base + "[" + std::to_string(j) + "]";
+            uniforms.push_back({element, glGetUniformLocation(program, element.c_str()), type});
+            uniform_stats.driver_queries++;
+        }
+    }
+
+    std::sort(uniforms.begin(), uniforms.end(), [](const auto &a, const auto &b) { return a.name < b.name; });
+    return uniforms;
+}
+
+Shader::Shader(unsigned int id, std::vector<UniformInfo> uniforms) : _m_id(id), _m_uniforms(std::move(uniforms)) {}
 
 Shader::~Shader() { glDeleteProgram(this->_m_id); }
 
-void Shader::set_vec3(const std::string &name, glm::vec3 v) const {
-    glUniform3f(glGetUniformLocation(_m_id, name.c_str()), v.x, v.y, v.z);
+int Shader::location(std::string_view name) const {
+    uniform_stats.table_lookups++;
+    const auto it = std::lower_bound(_m_uniforms.begin(), _m_uniforms.end(), name,
+                                     [](const UniformInfo &u, std::string_view n) { return u.name < n; });
+    return it != _m_uniforms.end() && it->name == name ? it->location : -1;
+}
+
+const UniformStats &Shader::stats() { return uniform_stats; }
+
+void Shader::reset_stats() { uniform_stats = {}; }
+
+void Shader::set(Uniform<glm::vec2> u, glm::vec2 v) const {
+    uniform_stats.handle_sets++;
+    glUniform2f(u.location, v.x, v.y);
 }
 
-void Shader::set_vec3(const std::string &name, float x, float y, float z) const {
-    glUniform3f(glGetUniformLocation(_m_id, name.c_str()), x, y, z);
+void Shader::set(Uniform<glm::vec3> u, glm::vec3 v) const {
+    uniform_stats.handle_sets++;
+    glUniform3f(u.location, v.x, v.y, v.z);
 }
 
-void Shader::set_vec3(const std::string &name, float v) const {
-    glUniform3f(glGetUniformLocation(_m_id, name.c_str()), v, v, v);
+void Shader::set(Uniform<glm::mat4> u, const glm::mat4 &v) const {
+    uniform_stats.handle_sets++;
+    glUniformMatrix4fv(u.location, 1, GL_FALSE, glm::value_ptr(v));
 }
 
-void Shader::set_mat4(const std::string &name, glm::mat4 v) const {
-    glUniformMatrix4fv(glGetUniformLocation(_m_id, name.c_str()), 1, GL_FALSE, glm::value_ptr(v));
+void Shader::set(Uniform<float> u, float v) const {
+    uniform_stats.handle_sets++;
+    glUniform1f(u.location, v);
 }
 
-void Shader::set_f(const std::string &name, float v) const {
-    glUniform1f(glGetUniformLocation(_m_id, name.c_str()), v);
+void Shader::set(Uniform<int> u, int v) const {
+    uniform_stats.handle_sets++;
+    glUniform1i(u.location, v);
 }
 
-void Shader::set_i(const std::string &name, int v) const { glUniform1i(glGetUniformLocation(_m_id, name.c_str()), v); }
+void Shader::set(Uniform<float> u, std::span<const float> v) const {
+    uniform_stats.handle_sets++;
+    glUniform1fv(u.location, static_cast<GLsizei>(v.size()), v.data());
+}
+
+void Shader::set_vec3(std::string_view name, glm::vec3 v) const { glUniform3f(location(name), v.x, v.y, v.z); }
+
+void Shader::set_vec3(std::string_view name, float x, float y, float z) const { glUniform3f(location(name), x, y, z); }
+
+void Shader::set_vec3(std::string_view name, float v) const { glUniform3f(location(name), v, v, v); }
+
+void Shader::set_mat4(std::string_view name, glm::mat4 v) const {
+    glUniformMatrix4fv(location(name), 1, GL_FALSE, glm::value_ptr(v));
+}
+
+void Shader::set_f(std::string_view name, float v) const { glUniform1f(location(name), v); }
+
+void Shader::set_i(std::string_view name, int v) const { glUniform1i(location(name), v); }
@@ -4,27 +4,127 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 std::string readFileToString(const std::string &filename);
 
+// Feature defines selecting one permutation of a shader, e.g. {{"NR_POINT_LIGHTS", 1}, {"SPOT_LIGHT", 0}}. Shaders
+// test them with #if, so a disabled feature is removed by the GLSL preprocessor instead of being branched over per
+// fragment. Ordered, so equal sets always give the same source text and the same key.
+using ShaderDefines = std::map<std::string, int>;
+
+// Reads a shader stage and expands it for compiling:
+// - `#include "file"` lines are replaced by the file, resolved relative to the including one. Each file is pasted at
+//   most once per stage, so shared headers need no include guards.
+// - `#define NAME VALUE` for every define is inserted right after the #version line.
+// #line directives keep compiler messages pointing into the right file: source string 0 is `path` itself, includes
+// are numbered from 1 in the order they are first pasted. Throws std::runtime_error for unreadable files or a
+// malformed #include.
+std::string preprocess_shader(const std::string &path, const ShaderDefines &defines = {});
+
+// "NAME=VALUE,..." in define order
+std::string shader_defines_key(const ShaderDefines &defines);
+
+// An active uniform found by reflecting a linked program. Array elements each get their own entry ("a[1]"), and
+// the bare array name ("a") aliases element 0, matching glGetUniformLocation.
+struct UniformInfo {
+    std::string name;
+    int location;
+    GLenum type;
+};
+
+// A uniform location resolved once against a particular program. Setting through a handle does no string hashing,
+// allocation or driver query. A handle for a uniform that doesn't exist (or was optimized out) has location -1 and
+// setting it is a no-op, exactly as with glUniform*.
+template <typename T> struct Uniform {
+    int location = -1;
+
+    bool valid() const { return location >= 0; }
+};
+
+// Counts of how uniform locations were obtained, summed over every program. Each table lookup or handle set is one
+// glGetUniformLocation call that used to happen and no longer does.
+struct UniformStats {
+    uint64_t driver_queries = 0;
+    uint64_t table_lookups = 0;
+    uint64_t handle_sets = 0;
+
+    uint64_t lookups_removed() const { return table_lookups + handle_sets; }
+};
+
 class Shader {
   public:
     unsigned int _m_id;
 
     void use();
-    Shader(unsigned int id);
+    Shader(unsigned int id, std::vector<UniformInfo> uniforms);
     ~Shader();
 
-    void set_vec3(const std::string &name, glm::vec3 v) const;
-    void set_vec3(const std::string &name, float x, float y, float z) const;
-    void set_vec3(const std::string &name, float x) const;
+    // Location of name from the reflected table, or -1
+    int location(std::string_view name) const;
+
+    template <typename T> Uniform<T> uniform(std::string_view name) const { return {location(name)}; }
+
+    void set(Uniform<glm::vec2> u, glm::vec2 v) const;
+    void set(Uniform<glm::vec3> u, glm::vec3 v) const;
+    void set(Uniform<glm::mat4> u, const glm::mat4 &v) const;
+    void set(Uniform<float> u, float v) const;
+    void set(Uniform<int> u, int v) const;
+    // A float array from element 0 (the handle of the bare array name)
+    void set(Uniform<float> u, std::span<const float> v) const;
+
+    void set_vec3(std::string_view name, glm::vec3 v) const;
+    void set_vec3(std::string_view name, float x, float y, float z) const;
+    void set_vec3(std::string_view name, float x) const;
+
+    void set_mat4(std::string_view name, glm::mat4 v) const;
 
-    void set_mat4(const std::string &name, glm::mat4 v) const;
+    void set_f(std::string_view name, float v) const;
+    void set_i(std::string_view name, int v) const;
 
-    void set_f(const std::string &name, float v) const;
-    void set_i(const std::string &name, int v) const;
+    const std::vector<UniformInfo> &uniforms() const { return _m_uniforms; }
+
+    static const UniformStats &stats();
+    static void reset_stats();
+
+  private:
+    // Sorted by name for binary search
+    std::vector<UniformInfo> _m_uniforms;
+};
+
+// A program whose compile and link have been issued but not checked yet. Drivers with KHR_parallel_shader_compile
+// keep working on it in the background until finish() asks for the result; others compile it on the spot.
+class PendingShader {
+  public:
+    PendingShader(PendingShader &&other) noexcept;
+    PendingShader &operator=(PendingShader &&other) = delete;
+    ~PendingShader();
+
+    // True once finish() won't block. Always true without KHR_parallel_shader_compile.
+    bool ready() const;
+    // Checks the compile and link, saves the binary to the program cache and reflects the uniforms. Throws
+    // std::runtime_error with the info log when either failed. Call once.
+    std::unique_ptr<Shader> finish();
+
+  private:
+    friend class ShaderBuilder;
+
+    unsigned int m_program = 0;
+    unsigned int m_vertex = 0;
+    unsigned int m_fragment = 0;
+    uint64_t m_key = 0;
+    // Loaded from the program cache: already linked, nothing to check or store
+    bool m_cached = false;
+    // Time spent issuing the compile, added to the stats in finish()
+    double m_start_ms = 0.0;
+
+    PendingShader() = default;
 };
 
 class ShaderBuilder {
@@ -32,9 +132,22 @@ class ShaderBuilder {
     std::string _m_vertex_src;
     std::string _m_fragment_src;
 
+    // Both stages through preprocess_shader, with the same defines
+    static ShaderBuilder from_files(const std::string &vertex_path, const std::string &fragment_path,
+                                    const ShaderDefines &defines = {});
+
+    // Loads the program from ProgramCache::shared() or compiles and links it, waiting for the result.
     std::unique_ptr<Shader> build();
+    // Same, but returns before the driver has finished compiling
+    PendingShader start();
 
   private:
+    friend class PendingShader;
+
+    static std::vector<UniformInfo> reflect_uniforms(unsigned int program);
 };
 
+// Starts every program before finishing any, so a driver with KHR_parallel_shader_compile builds them side by side.
+std::vector<std::unique_ptr<Shader>> build_shaders(std::vector<ShaderBuilder> &builders);
+
 #endif
@@ -0,0 +1,18 @@
+#include "shader_library.hpp"
+#include "profiler.hpp"
+
+Shader &ShaderLibrary::get(const std::string &vertex_path, const std::string &fragment_path,
+                           const ShaderDefines &defines) {
+    const std::string key = permutation_key(vertex_path, fragment_path, defines);
+    auto it = m_shaders.find(key);
+    if (it == m_shaders.end()) {
+        PROFILE_ZONE("ShaderLibrary::build");
+        it = m_shaders.emplace(key, ShaderBuilder::from_files(vertex_path, fragment_path, defines).build()).first;
+    }
+    return *it->second;
+}
+
+std::string ShaderLibrary::permutation_key(const std::string &vertex_path, const std::string &fragment_path,
+                                           const ShaderDefines &defines) {
+    return vertex_path + "|" + fragment_path + "|" + shader_defines_key(defines);
+}
@@ -0,0 +1,30 @@
+#ifndef SHADER_LIBRARY_HPP
+#define SHADER_LIBRARY_HPP
+
+#include "shader.hpp"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Programs built on demand, one per permutation (vertex path, fragment path, defines). The first request for a
+// permutation builds it through ShaderBuilder (so the program cache still applies); later ones get the same Shader.
+// Uniform values live in the program, so whatever one user sets is seen by everyone sharing that permutation.
+//
+// Owns the programs: destroy it while the context is current.
+class ShaderLibrary {
+  public:
+    // Throws std::runtime_error when the permutation doesn't compile
+    Shader &get(const std::string &vertex_path, const std::string &fragment_path, const ShaderDefines &defines = {});
+
+    // Permutations built so far
+    size_t size() const { return m_shaders.size(); }
+
+    static std::string permutation_key(const std::string &vertex_path, const std::string &fragment_path,
+                                       const ShaderDefines &defines);
+
+  private:
+    std::unordered_map<std::string, std::unique_ptr<Shader>> m_shaders;
+};
+
+#endif
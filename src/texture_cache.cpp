@@ -0,0 +1,185 @@
+#include "texture_cache.hpp"
+#include "mesh_cache.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr unsigned char KTX_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+constexpr uint32_t KTX_ENDIANNESS = 0x04030201;
+
+struct KtxHeader {
+    unsigned char identifier[12];
+    uint32_t endianness;
+    uint32_t gl_type;
+    uint32_t gl_type_size;
+    uint32_t gl_format;
+    uint32_t gl_internal_format;
+    uint32_t gl_base_internal_format;
+    uint32_t pixel_width;
+    uint32_t pixel_height;
+    uint32_t pixel_depth;
+    uint32_t array_elements;
+    uint32_t faces;
+    uint32_t mip_levels;
+    uint32_t key_value_bytes;
+};
+static_assert(sizeof(KtxHeader) == 64);
+
+const TextureCodec CODECS[] = {TextureCodec::BC1, TextureCodec::BC3, TextureCodec::BC4, TextureCodec::BC5};
+
+// The key/value entry identifying the source a file was baked from
+std::string source_stamp(const std::string &source_path) {
+    const auto mtime = static_cast<int64_t>(fs::last_write_time(source_path).time_since_epoch().count());
+    return std::to_string(TEXTURE_CACHE_VERSION) + " " + std::to_string(mtime) + " " +
+           std::to_string(fs::file_size(source_path));
+}
+
+size_t pad4(size_t v) { return (v + 3) & ~size_t(3); }
+
+// Reads and validates the header and key/value data; leaves `in` at the first mip level
+bool read_header(std::istream &in, const std::string &source_path, KtxHeader &hdr) {
+    if (!in.read(reinterpret_cast<char *>(&hdr), sizeof(hdr)) ||
+        std::memcmp(hdr.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0 || hdr.endianness != KTX_ENDIANNESS ||
+        hdr.gl_type != 0 || hdr.pixel_depth != 0 || hdr.array_elements != 0 || hdr.faces != 1 ||
+        hdr.pixel_width == 0 || hdr.pixel_height == 0 || hdr.mip_levels == 0 || hdr.key_value_bytes > 4096) {
+        return false;
+    }
+
+    std::string key_values(hdr.key_value_bytes, '\0');
+    if (!in.read(key_values.data(), key_values.size())) {
+        return false;
+    }
+
+    std::error_code ec;
+    if (!fs::exists(source_path, ec)) {
+        return false;
+    }
+    const std::string stamp = source_stamp(source_path);
+
+    for (size_t pos = 0; pos + 4 <= key_values.size();) {
+        uint32_t size;
+        std::memcpy(&size, &key_values[pos], 4);
+        if (size > key_values.size() - pos - 4) {
+            return false;
+        }
+        const std::string entry = key_values.substr(pos + 4, size);
+        const size_t nul = entry.find('\0');
+        if (nul != std::string::npos && entry.substr(0, nul) == TEXTURE_CACHE_KEY) {
+            return entry.compare(nul + 1, std::string::npos, stamp + '\0') == 0;
+        }
+        pos += pad4(4 + size);
+    }
+    return false;
+}
+
+} // namespace
+
+std::string texture_cache_path(const std::string &source_path) { return source_path + ".ktx"; }
+
+bool texture_cache_is_fresh(const std::string &source_path) {
+    std::ifstream ifs(texture_cache_path(source_path), std::ios_base::binary);
+    KtxHeader hdr;
+    return ifs.is_open() && read_header(ifs, source_path, hdr);
+}
+
+void write_texture_cache(const std::string &source_path, const CompressedTexture &texture) {
+    const std::string stamp = source_stamp(source_path);
+    // key\0value\0
+    const uint32_t entry_size = sizeof(TEXTURE_CACHE_KEY) + stamp.size() + 1;
+
+    KtxHeader hdr{};
+    std::memcpy(hdr.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    hdr.endianness = KTX_ENDIANNESS;
+    hdr.gl_type_size = 1;
+    hdr.gl_internal_format = texture_codec_gl_format(texture.codec);
+    hdr.gl_base_internal_format = texture_codec_base_format(texture.codec);
+    hdr.pixel_width = texture.width;
+    hdr.pixel_height = texture.height;
+    hdr.faces = 1;
+    hdr.mip_levels = texture.levels.size();
+    hdr.key_value_bytes = pad4(4 + entry_size);
+
+    std::vector<char> bytes(sizeof(hdr));
+    std::memcpy(bytes.data(), &hdr, sizeof(hdr));
+    const auto put = [&](const void *data, size_t size) {
+        bytes.insert(bytes.end(), static_cast<const char *>(data), static_cast<const char *>(data) + size);
+    };
+
+    put(&entry_size, 4);
+    put(TEXTURE_CACHE_KEY, sizeof(TEXTURE_CACHE_KEY));
+    put(stamp.c_str(), stamp.size() + 1);
+    bytes.resize(pad4(bytes.size()));
+
+    for (const auto &level : texture.levels) {
+        const uint32_t size = level.size();
+        put(&size, 4);
+        put(level.data(), level.size());
+        bytes.resize(pad4(bytes.size()));
+    }
+
+    const std::string path = texture_cache_path(source_path);
+    const std::string tmp_path = unique_temp_path(path);
+    std::error_code ec;
+    {
+        std::ofstream ofs(tmp_path, std::ios_base::binary | std::ios_base::trunc);
+        if (!ofs.is_open() || !ofs.write(bytes.data(), bytes.size())) {
+            ofs.close();
+            fs::remove(tmp_path, ec);
+            throw std::runtime_error("Failed to write texture cache: " + tmp_path);
+        }
+    }
+    // A failed rename leaves the previous file (or none) in place, which loads treat as stale or missing
+    fs::rename(tmp_path, path, ec);
+    if (ec) {
+        std::fprintf(stderr, "couldn't write texture cache %s: %s\n", path.c_str(), ec.message().c_str());
+        fs::remove(tmp_path, ec);
+    }
+}
+
+std::optional<CompressedTexture> open_texture_cache(const std::string &source_path) {
+    PROFILE_ZONE("open_texture_cache");
+    std::ifstream ifs(texture_cache_path(source_path), std::ios_base::binary);
+    KtxHeader hdr;
+    if (!ifs.is_open() || !read_header(ifs, source_path, hdr)) {
+        return std::nullopt;
+    }
+
+    CompressedTexture texture;
+    bool known = false;
+    for (TextureCodec codec : CODECS) {
+        if (texture_codec_gl_format(codec) == hdr.gl_internal_format) {
+            texture.codec = codec;
+            known = true;
+        }
+    }
+    if (!known) {
+        return std::nullopt;
+    }
+    texture.width = hdr.pixel_width;
+    texture.height = hdr.pixel_height;
+
+    int width = texture.width, height = texture.height;
+    for (uint32_t i = 0; i < hdr.mip_levels; i++) {
+        uint32_t size;
+        if (!ifs.read(reinterpret_cast<char *>(&size), 4) ||
+            size != compressed_level_size(texture.codec, width, height)) {
+            return std::nullopt;
+        }
+        auto &level = texture.levels.emplace_back(size);
+        if (!ifs.read(reinterpret_cast<char *>(level.data()), size)) {
+            return std::nullopt;
+        }
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return texture;
+}
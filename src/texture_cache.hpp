@@ -0,0 +1,36 @@
+#ifndef TEXTURE_CACHE_HPP
+#define TEXTURE_CACHE_HPP
+
+#include "texture_compression.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Baked, block-compressed textures.
+//
+// BakeTextures writes "<source>.ktx" next to each source image: a KTX 1.1 file holding the compressed mip chain, so
+// the loader hands every level straight to glCompressedTexImage2D without decoding or generating mips. Loaders use a
+// baked file when it's fresh and fall back to decoding the source otherwise. Like the mesh cache, a file is stale when
+// its version or the recorded source mtime/size no longer match; those live in a KTX key/value entry.
+//
+// Layout (little endian, as KTX 1.1 specifies):
+//   12-byte KTX identifier, 13 x u32 header (glType 0, glTypeSize 1, glFormat 0, glInternalFormat, ...)
+//   key/value data: one entry, TEXTURE_CACHE_KEY -> "<version> <source mtime> <source size>"
+//   per mip level: u32 imageSize, imageSize bytes (block data is already 4-byte aligned)
+
+constexpr uint32_t TEXTURE_CACHE_VERSION = 1;
+constexpr char TEXTURE_CACHE_KEY[] = "LearnOpenGL.source";
+
+std::string texture_cache_path(const std::string &source_path);
+
+// True when a baked file exists for source_path and was made from the current version of the source file.
+bool texture_cache_is_fresh(const std::string &source_path);
+
+// Writes the file atomically (temp file + rename), like write_mesh_cache. Only failing to write the temp file throws.
+void write_texture_cache(const std::string &source_path, const CompressedTexture &texture);
+
+// Reads the baked file for source_path, or returns nullopt when it is missing, stale or corrupt. Safe on any thread.
+std::optional<CompressedTexture> open_texture_cache(const std::string &source_path);
+
+#endif
@@ -0,0 +1,519 @@
+#include "texture_compression.hpp"
+#include "profiler.hpp"
+#include "texture_loader.hpp"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr int BLOCK_SIZE = 4;
+constexpr int BLOCK_PIXELS = BLOCK_SIZE * BLOCK_SIZE;
+constexpr int POWER_ITERATIONS = 8;
+
+// A mip level in floats, 0..1 per channel, colour in linear light when filtering sRGB data
+struct FloatImage {
+    int width = 0, height = 0;
+    std::vector<glm::vec4> pixels;
+};
+
+const std::array<float, 256> &srgb_to_linear_table() {
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> t;
+        for (int i = 0; i < 256; i++) {
+            const float c = i / 255.0f;
+            t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return t;
+    }();
+    return table;
+}
+
+float linear_to_srgb(float c) {
+    c = std::clamp(c, 0.0f, 1.0f);
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+unsigned char to_byte(float c) { return static_cast<unsigned char>(std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f)); }
+
+// Channels expand the way GL samples them: GL_RED as (r, 0, 0, 1); two channels are luminance + alpha
+FloatImage to_float(const Image &image, bool srgb) {
+    const auto &table = srgb_to_linear_table();
+    const auto color = [&](unsigned char c) { return srgb ? table[c] : c / 255.0f; };
+
+    FloatImage result{image.width, image.height, std::vector<glm::vec4>(size_t(image.width) * image.height)};
+    const unsigned char *p = image.pixels.get();
+    for (auto &pixel : result.pixels) {
+        switch (image.channels) {
+        case 1:
+            pixel = glm::vec4(color(p[0]), 0.0f, 0.0f, 1.0f);
+            break;
+        case 2:
+            pixel = glm::vec4(glm::vec3(color(p[0])), p[1] / 255.0f);
+            break;
+        case 3:
+            pixel = glm::vec4(color(p[0]), color(p[1]), color(p[2]), 1.0f);
+            break;
+        default:
+            pixel = glm::vec4(color(p[0]), color(p[1]), color(p[2]), p[3] / 255.0f);
+            break;
+        }
+        p += image.channels;
+    }
+    return result;
+}
+
+// 2x2 box filter; an odd last row or column is dropped, a dimension of 1 stays 1
+FloatImage downsample(const FloatImage &level, bool normal_map) {
+    FloatImage result;
+    result.width = std::max(1, level.width / 2);
+    result.height = std::max(1, level.height / 2);
+    result.pixels.resize(size_t(result.width) * result.height);
+
+    for (int y = 0; y < result.height; y++) {
+        const int y0 = std::min(2 * y, level.height - 1), y1 = std::min(2 * y + 1, level.height - 1);
+        for (int x = 0; x < result.width; x++) {
+            const int x0 = std::min(2 * x, level.width - 1), x1 = std::min(2 * x + 1, level.width - 1);
+            glm::vec4 sum = level.pixels[size_t(y0) * level.width + x0] + level.pixels[size_t(y0) * level.width + x1] +
+                            level.pixels[size_t(y1) * level.width + x0] + level.pixels[size_t(y1) * level.width + x1];
+            sum *= 0.25f;
+
+            if (normal_map) {
+                // Averaged unit vectors get shorter, which reads as a flatter surface
+                const glm::vec3 n = glm::vec3(sum) * 2.0f - 1.0f;
+                const float length = glm::length(n);
+                if (length > 1e-6f) {
+                    sum = glm::vec4(n / length * 0.5f + 0.5f, sum.w);
+                }
+            }
+            result.pixels[size_t(y) * result.width + x] = sum;
+        }
+    }
+    return result;
+}
+
+uint16_t pack_565(glm::vec3 c) {
+    const auto quantize = [](float v, int max) { return std::lround(std::clamp(v, 0.0f, 255.0f) * max / 255.0f); };
+    return static_cast<uint16_t>(quantize(c.x, 31) << 11 | quantize(c.y, 63) << 5 | quantize(c.z, 31));
+}
+
+glm::vec3 unpack_565(uint16_t c) {
+    const int r = c >> 11 & 31, g = c >> 5 & 63, b = c & 31;
+    return glm::vec3(r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2);
+}
+
+void put_u16(unsigned char *out, uint16_t v) {
+    out[0] = v & 0xff;
+    out[1] = v >> 8;
+}
+
+uint16_t get_u16(const unsigned char *in) { return static_cast<uint16_t>(in[0] | in[1] << 8); }
+
+// Endpoints along the principal axis of the block's colours, inset by 1/16 of the range, always in four-colour mode
+// (color0 > color1) so BC1 and BC3 decode it the same way
+void encode_color_block(const unsigned char block[BLOCK_PIXELS][4], unsigned char *out) {
+    glm::vec3 colors[BLOCK_PIXELS];
+    glm::vec3 mean(0.0f);
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        colors[i] = glm::vec3(block[i][0], block[i][1], block[i][2]);
+        mean += colors[i];
+    }
+    mean /= float(BLOCK_PIXELS);
+
+    // Covariance, then power iteration for its largest eigenvector
+    float xx = 0, xy = 0, xz = 0, yy = 0, yz = 0, zz = 0;
+    for (const auto &c : colors) {
+        const glm::vec3 d = c - mean;
+        xx += d.x * d.x;
+        xy += d.x * d.y;
+        xz += d.x * d.z;
+        yy += d.y * d.y;
+        yz += d.y * d.z;
+        zz += d.z * d.z;
+    }
+    glm::vec3 axis(1.0f);
+    for (int i = 0; i < POWER_ITERATIONS; i++) {
+        const glm::vec3 next(xx * axis.x + xy * axis.y + xz * axis.z, xy * axis.x + yy * axis.y + yz * axis.z,
+                             xz * axis.x + yz * axis.y + zz * axis.z);
+        const float scale = std::max({std::abs(next.x), std::abs(next.y), std::abs(next.z)});
+        if (scale < 1e-6f) {
+            break;
+        }
+        axis = next / scale;
+    }
+    axis = glm::normalize(axis);
+
+    float min_t = 0.0f, max_t = 0.0f;
+    for (const auto &c : colors) {
+        const float t = glm::dot(c - mean, axis);
+        min_t = std::min(min_t, t);
+        max_t = std::max(max_t, t);
+    }
+    const glm::vec3 inset = axis * ((max_t - min_t) / 16.0f);
+    uint16_t c0 = pack_565(mean + axis * max_t - inset);
+    uint16_t c1 = pack_565(mean + axis * min_t + inset);
+    if (c0 < c1) {
+        std::swap(c0, c1);
+    }
+    put_u16(out, c0);
+    put_u16(out + 2, c1);
+
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        const glm::vec3 p0 = unpack_565(c0), p1 = unpack_565(c1);
+        const glm::vec3 palette[4] = {p0, p1, (2.0f * p0 + p1) / 3.0f, (p0 + 2.0f * p1) / 3.0f};
+        for (int i = 0; i < BLOCK_PIXELS; i++) {
+            uint32_t best = 0;
+            float best_distance = INFINITY;
+            for (uint32_t p = 0; p < 4; p++) {
+                const glm::vec3 d = colors[i] - palette[p];
+                const float distance = glm::dot(d, d);
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    best = p;
+                }
+            }
+            indices |= best << (2 * i);
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        out[4 + i] = indices >> (8 * i) & 0xff;
+    }
+}
+
+// BC4, also the alpha half of BC3: min/max endpoints in the eight-value mode (a0 > a1)
+void encode_scalar_block(const unsigned char values[BLOCK_PIXELS], unsigned char *out) {
+    const auto [lo, hi] = std::minmax_element(values, values + BLOCK_PIXELS);
+    out[0] = *hi;
+    out[1] = *lo;
+
+    uint64_t indices = 0;
+    if (*hi != *lo) {
+        float palette[8] = {float(*hi), float(*lo)};
+        for (int i = 2; i < 8; i++) {
+            palette[i] = ((8 - i) * palette[0] + (i - 1) * palette[1]) / 7.0f;
+        }
+        for (int i = 0; i < BLOCK_PIXELS; i++) {
+            uint64_t best = 0;
+            float best_distance = INFINITY;
+            for (uint64_t p = 0; p < 8; p++) {
+                const float distance = std::abs(values[i] - palette[p]);
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    best = p;
+                }
+            }
+            indices |= best << (3 * i);
+        }
+    }
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = indices >> (8 * i) & 0xff;
+    }
+}
+
+void decode_color_block(const unsigned char *in, unsigned char block[BLOCK_PIXELS][4], bool four_color) {
+    const uint16_t c0 = get_u16(in), c1 = get_u16(in + 2);
+    const glm::vec3 p0 = unpack_565(c0), p1 = unpack_565(c1);
+    glm::vec4 palette[4] = {glm::vec4(p0, 255.0f), glm::vec4(p1, 255.0f)};
+    if (four_color || c0 > c1) {
+        palette[2] = glm::vec4((2.0f * p0 + p1) / 3.0f, 255.0f);
+        palette[3] = glm::vec4((p0 + 2.0f * p1) / 3.0f, 255.0f);
+    } else {
+        palette[2] = glm::vec4((p0 + p1) / 2.0f, 255.0f);
+        palette[3] = glm::vec4(0.0f);
+    }
+
+    const uint32_t indices = in[4] | in[5] << 8 | in[6] << 16 | uint32_t(in[7]) << 24;
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        const glm::vec4 &c = palette[indices >> (2 * i) & 3];
+        for (int k = 0; k < 4; k++) {
+            block[i][k] = static_cast<unsigned char>(std::lround(c[k]));
+        }
+    }
+}
+
+void decode_scalar_block(const unsigned char *in, unsigned char values[BLOCK_PIXELS]) {
+    const float a0 = in[0], a1 = in[1];
+    float palette[8] = {a0, a1};
+    if (a0 > a1) {
+        for (int i = 2; i < 8; i++) {
+            palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7.0f;
+        }
+    } else {
+        for (int i = 2; i < 6; i++) {
+            palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5.0f;
+        }
+        palette[6] = 0.0f;
+        palette[7] = 255.0f;
+    }
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++) {
+        indices |= uint64_t(in[2 + i]) << (8 * i);
+    }
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        values[i] = static_cast<unsigned char>(std::lround(palette[indices >> (3 * i) & 7]));
+    }
+}
+
+void encode_block(TextureCodec codec, const unsigned char block[BLOCK_PIXELS][4], unsigned char *out) {
+    unsigned char channel[BLOCK_PIXELS];
+    const auto extract = [&](int k) {
+        for (int i = 0; i < BLOCK_PIXELS; i++) {
+            channel[i] = block[i][k];
+        }
+        return channel;
+    };
+
+    switch (codec) {
+    case TextureCodec::BC1:
+        encode_color_block(block, out);
+        break;
+    case TextureCodec::BC3:
+        encode_scalar_block(extract(3), out);
+        encode_color_block(block, out + 8);
+        break;
+    case TextureCodec::BC4:
+        encode_scalar_block(extract(0), out);
+        break;
+    case TextureCodec::BC5:
+        encode_scalar_block(extract(0), out);
+        encode_scalar_block(extract(1), out + 8);
+        break;
+    }
+}
+
+std::vector<unsigned char> encode_level(const FloatImage &level, TextureCodec codec, bool srgb) {
+    std::vector<unsigned char> bytes(level.pixels.size() * 4);
+    for (size_t i = 0; i < level.pixels.size(); i++) {
+        const glm::vec4 &p = level.pixels[i];
+        for (int k = 0; k < 3; k++) {
+            bytes[i * 4 + k] = to_byte(srgb ? linear_to_srgb(p[k]) : p[k]);
+        }
+        bytes[i * 4 + 3] = to_byte(p.w);
+    }
+
+    std::vector<unsigned char> result(compressed_level_size(codec, level.width, level.height));
+    const size_t block_bytes = texture_codec_block_bytes(codec);
+    unsigned char *out = result.data();
+    unsigned char block[BLOCK_PIXELS][4];
+    for (int by = 0; by < level.height; by += BLOCK_SIZE) {
+        for (int bx = 0; bx < level.width; bx += BLOCK_SIZE) {
+            // Partial blocks at the edges repeat the last row and column
+            for (int y = 0; y < BLOCK_SIZE; y++) {
+                for (int x = 0; x < BLOCK_SIZE; x++) {
+                    const size_t px = std::min(bx + x, level.width - 1), py = std::min(by + y, level.height - 1);
+                    std::memcpy(block[y * BLOCK_SIZE + x], &bytes[(py * level.width + px) * 4], 4);
+                }
+            }
+            encode_block(codec, block, out);
+            out += block_bytes;
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+const char *texture_codec_name(TextureCodec codec) {
+    switch (codec) {
+    case TextureCodec::BC1:
+        return "BC1";
+    case TextureCodec::BC3:
+        return "BC3";
+    case TextureCodec::BC4:
+        return "BC4";
+    case TextureCodec::BC5:
+        return "BC5";
+    }
+    return "?";
+}
+
+GLenum texture_codec_gl_format(TextureCodec codec) {
+    switch (codec) {
+    case TextureCodec::BC1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TextureCodec::BC3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TextureCodec::BC4:
+        return GL_COMPRESSED_RED_RGTC1;
+    case TextureCodec::BC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    }
+    return GL_NONE;
+}
+
+GLenum texture_codec_base_format(TextureCodec codec) {
+    switch (codec) {
+    case TextureCodec::BC1:
+        return GL_RGB;
+    case TextureCodec::BC3:
+        return GL_RGBA;
+    case TextureCodec::BC4:
+        return GL_RED;
+    case TextureCodec::BC5:
+        return GL_RG;
+    }
+    return GL_NONE;
+}
+
+unsigned int texture_codec_channels(TextureCodec codec) {
+    switch (codec) {
+    case TextureCodec::BC1:
+        return 3;
+    case TextureCodec::BC3:
+        return 4;
+    case TextureCodec::BC4:
+        return 1;
+    case TextureCodec::BC5:
+        return 2;
+    }
+    return 0;
+}
+
+size_t texture_codec_block_bytes(TextureCodec codec) {
+    return codec == TextureCodec::BC1 || codec == TextureCodec::BC4 ? 8 : 16;
+}
+
+bool texture_codec_supported(TextureCodec codec) {
+    if (codec == TextureCodec::BC4 || codec == TextureCodec::BC5) {
+        return true;
+    }
+
+    static const bool s3tc = [] {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            const char *name = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+            if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) {
+                return true;
+            }
+        }
+        return false;
+    }();
+    return s3tc;
+}
+
+size_t compressed_level_size(TextureCodec codec, int width, int height) {
+    const size_t blocks_x = (width + BLOCK_SIZE - 1) / BLOCK_SIZE, blocks_y = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    return blocks_x * blocks_y * texture_codec_block_bytes(codec);
+}
+
+size_t CompressedTexture::size_bytes() const {
+    size_t total = 0;
+    for (const auto &level : levels) {
+        total += level.size();
+    }
+    return total;
+}
+
+TextureCodec choose_texture_codec(const Image &image, const std::string &type) {
+    if (type == "texture_normal") {
+        return TextureCodec::BC5;
+    }
+    if (image.channels == 1) {
+        return TextureCodec::BC4;
+    }
+    if (image.channels == 2) {
+        return TextureCodec::BC3;
+    }
+    if (image.channels == 4) {
+        const unsigned char *p = image.pixels.get();
+        for (size_t i = 0; i < size_t(image.width) * image.height; i++) {
+            if (p[i * 4 + 3] != 255) {
+                return TextureCodec::BC3;
+            }
+        }
+    }
+    return TextureCodec::BC1;
+}
+
+bool texture_type_is_srgb(const std::string &type) { return type != "texture_specular" && type != "texture_normal"; }
+
+CompressedTexture compress_texture(const Image &image, TextureCodec codec, bool srgb) {
+    PROFILE_ZONE("compress_texture");
+    if (!image.pixels || image.channels < 1 || image.channels > 4) {
+        throw std::runtime_error("compress_texture needs decoded 1-4 channel pixels");
+    }
+
+    // Only colour goes through sRGB; BC4/BC5 hold data
+    srgb = srgb && (codec == TextureCodec::BC1 || codec == TextureCodec::BC3);
+    const bool normal_map = codec == TextureCodec::BC5;
+
+    CompressedTexture result;
+    result.codec = codec;
+    result.width = image.width;
+    result.height = image.height;
+
+    FloatImage level = to_float(image, srgb);
+    for (;;) {
+        result.levels.push_back(encode_level(level, codec, srgb));
+        if (level.width == 1 && level.height == 1) {
+            break;
+        }
+        level = downsample(level, normal_map);
+    }
+    return result;
+}
+
+std::vector<unsigned char> decompress_level(TextureCodec codec, const unsigned char *data, int width, int height) {
+    std::vector<unsigned char> result(size_t(width) * height * 4);
+    const size_t block_bytes = texture_codec_block_bytes(codec);
+    unsigned char block[BLOCK_PIXELS][4];
+    unsigned char channel[BLOCK_PIXELS];
+
+    for (int by = 0; by < height; by += BLOCK_SIZE) {
+        for (int bx = 0; bx < width; bx += BLOCK_SIZE) {
+            for (auto &pixel : block) {
+                pixel[0] = pixel[1] = pixel[2] = 0;
+                pixel[3] = 255;
+            }
+            switch (codec) {
+            case TextureCodec::BC1:
+                decode_color_block(data, block, false);
+                break;
+            case TextureCodec::BC3:
+                decode_color_block(data + 8, block, true);
+                decode_scalar_block(data, channel);
+                for (int i = 0; i < BLOCK_PIXELS; i++) {
+                    block[i][3] = channel[i];
+                }
+                break;
+            case TextureCodec::BC4:
+            case TextureCodec::BC5:
+                for (int k = 0; k < (codec == TextureCodec::BC5 ? 2 : 1); k++) {
+                    decode_scalar_block(data + 8 * k, channel);
+                    for (int i = 0; i < BLOCK_PIXELS; i++) {
+                        block[i][k] = channel[i];
+                    }
+                }
+                break;
+            }
+            data += block_bytes;
+
+            for (int y = 0; y < BLOCK_SIZE && by + y < height; y++) {
+                for (int x = 0; x < BLOCK_SIZE && bx + x < width; x++) {
+                    std::memcpy(&result[(size_t(by + y) * width + bx + x) * 4], block[y * BLOCK_SIZE + x], 4);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+size_t uncompressed_texture_size(int width, int height, int channels) {
+    const size_t pixel_bytes = channels == 3 ? 4 : channels;
+    size_t total = 0;
+    for (;;) {
+        total += size_t(width) * height * pixel_bytes;
+        if (width == 1 && height == 1) {
+            return total;
+        }
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+}
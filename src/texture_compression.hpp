@@ -0,0 +1,71 @@
+#ifndef TEXTURE_COMPRESSION_HPP
+#define TEXTURE_COMPRESSION_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Block compression for the offline texture bake (tools/bake_textures.cpp; the results are stored by texture_cache).
+//
+// Every codec stores 4x4 pixel blocks at a fixed size:
+//   BC1   8 bytes  RGB   opaque colour maps
+//   BC3  16 bytes  RGBA  colour with a real alpha channel (grass, windows)
+//   BC4   8 bytes  R     single-channel images; samples as (r, 0, 0, 1), exactly like the uncompressed GL_RED upload
+//   BC5  16 bytes  RG    tangent-space normal maps; shaders rebuild z from x and y
+//
+// The mip chain is box filtered down to 1x1 before compression. Colour maps are filtered in linear light (sRGB decoded,
+// averaged, encoded again) so the mips don't darken; the stored values stay sRGB encoded, like the uncompressed path,
+// which doesn't use an sRGB internal format either. Normal map mips are renormalized.
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+enum class TextureCodec { BC1, BC3, BC4, BC5 };
+
+const char *texture_codec_name(TextureCodec codec);
+GLenum texture_codec_gl_format(TextureCodec codec);
+// GL_RGB, GL_RGBA, GL_RED or GL_RG
+GLenum texture_codec_base_format(TextureCodec codec);
+unsigned int texture_codec_channels(TextureCodec codec);
+size_t texture_codec_block_bytes(TextureCodec codec);
+
+// BC1 and BC3 need EXT_texture_compression_s3tc, which isn't core in GL 3.3; BC4 and BC5 are core RGTC. Checked once,
+// on the first call, which needs a current GL context.
+bool texture_codec_supported(TextureCodec codec);
+
+// Bytes of one compressed level; partial blocks at the right and bottom edges take a whole block
+size_t compressed_level_size(TextureCodec codec, int width, int height);
+
+struct CompressedTexture {
+    TextureCodec codec = TextureCodec::BC1;
+    int width = 0, height = 0;
+    // Finest first, down to 1x1
+    std::vector<std::vector<unsigned char>> levels;
+
+    size_t size_bytes() const;
+};
+
+struct Image;
+
+// Normal maps get BC5, single-channel images BC4, images with any alpha below 255 BC3 and everything else BC1
+TextureCodec choose_texture_codec(const Image &image, const std::string &type);
+
+// Specular and normal maps hold linear data; every other type (and untyped textures) is treated as sRGB colour
+bool texture_type_is_srgb(const std::string &type);
+
+CompressedTexture compress_texture(const Image &image, TextureCodec codec, bool srgb);
+
+// Expands one compressed level to RGBA8, for checking encoder quality. Missing channels read as the GL defaults
+// (0 for green and blue, 255 for alpha).
+std::vector<unsigned char> decompress_level(TextureCodec codec, const unsigned char *data, int width, int height);
+
+// What the same image takes in VRAM uncompressed with a full mip chain. Drivers pad RGB8 to four bytes per pixel.
+size_t uncompressed_texture_size(int width, int height, int channels);
+
+#endif
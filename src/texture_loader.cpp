@@ -0,0 +1,183 @@
+#include "texture_loader.hpp"
+#include "profiler.hpp"
+#include "texture_cache.hpp"
+#include "thread_pool.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stb/stb_image.h>
+#include <stdexcept>
+
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::duration<double, std::milli>;
+
+Image Image::decode(const std::string &file_path) {
+    PROFILE_ZONE("Image::decode");
+    Image image;
+    unsigned char *data = stbi_load(file_path.c_str(), &image.width, &image.height, &image.channels, 0);
+
+    if (data == NULL) {
+        throw std::runtime_error("couldn't load image file: " + file_path);
+    }
+
+    image.pixels = {data, stbi_image_free};
+    return image;
+}
+
+Image Image::load(const std::string &file_path) {
+    if (auto baked = open_texture_cache(file_path)) {
+        Image image;
+        image.width = baked->width;
+        image.height = baked->height;
+        image.channels = texture_codec_channels(baked->codec);
+        image.compressed = std::move(baked);
+        return image;
+    }
+    return decode(file_path);
+}
+
+GLenum Image::format() const {
+    if (channels == 1) {
+        return GL_RED;
+    } else if (channels == 3) {
+        return GL_RGB;
+    } else if (channels == 4) {
+        return GL_RGBA;
+    }
+    throw std::runtime_error("Unable to infer texture format");
+}
+
+double TextureLoadReport::total_decode_ms() const {
+    double total = 0.0;
+    for (const auto &t : textures) {
+        total += t.decode_ms;
+    }
+    return total;
+}
+
+double TextureLoadReport::total_upload_ms() const {
+    double total = 0.0;
+    for (const auto &t : textures) {
+        total += t.upload_ms;
+    }
+    return total;
+}
+
+void TextureLoadReport::print() const {
+    std::printf("texture load: %zu textures in %.1f ms wall\n", textures.size(), wall_ms);
+    for (const auto &t : textures) {
+        std::printf("  %-48s %-4s decode %8.1f ms  upload %6.1f ms  %8.1f KiB\n", t.file_path.c_str(), t.format,
+                    t.decode_ms, t.upload_ms, t.gpu_bytes / 1024.0);
+    }
+    std::printf("  total decode %.1f ms (worker threads), total upload %.1f ms (GL thread)\n", total_decode_ms(),
+                total_upload_ms());
+}
+
+namespace {
+
+struct DecodeResult {
+    size_t index;
+    std::optional<Image> image;
+    std::string error;
+    double decode_ms;
+};
+
+// Completed decodes, handed from the workers to the GL thread.
+struct CompletionQueue {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<DecodeResult> results;
+
+    void push(DecodeResult result) {
+        {
+            std::lock_guard lock(mutex);
+            results.push_back(std::move(result));
+        }
+        cv.notify_one();
+    }
+
+    DecodeResult pop() {
+        std::unique_lock lock(mutex);
+        cv.wait(lock, [this] { return !results.empty(); });
+        DecodeResult result = std::move(results.front());
+        results.pop_front();
+        return result;
+    }
+};
+
+} // namespace
+
+std::vector<Texture> load_textures_parallel(const std::vector<TextureRef> &refs, TextureLoadReport *report) {
+    PROFILE_ZONE("load_textures_parallel");
+    const auto start = Clock::now();
+
+    CompletionQueue queue;
+    for (size_t i = 0; i < refs.size(); i++) {
+        ThreadPool::shared().submit([&queue, &ref = refs[i], i] {
+            const auto decode_start = Clock::now();
+            DecodeResult result{i, std::nullopt, {}, 0.0};
+            try {
+                result.image = Image::load(ref.file_path);
+            } catch (const std::exception &e) {
+                result.error = e.what();
+            }
+            result.decode_ms = Millis(Clock::now() - decode_start).count();
+            queue.push(std::move(result));
+        });
+    }
+
+    std::vector<std::optional<Texture>> slots(refs.size());
+    std::vector<TextureLoadTiming> timings(refs.size());
+    std::string first_error;
+
+    // Every task must be drained before returning, even on error, since they reference `queue` and `refs`.
+    for (size_t done = 0; done < refs.size(); done++) {
+        DecodeResult result = queue.pop();
+        const TextureRef &ref = refs[result.index];
+        timings[result.index] = {ref.file_path, result.decode_ms, 0.0, "raw", 0};
+
+        if (!result.image) {
+            if (first_error.empty()) {
+                first_error = result.error;
+            }
+            continue;
+        }
+
+        PROFILE_ZONE("Texture upload");
+        const auto upload_start = Clock::now();
+        try {
+            slots[result.index].emplace(ref.file_path, ref.type, *result.image);
+        } catch (const std::exception &e) {
+            if (first_error.empty()) {
+                first_error = e.what();
+            }
+        }
+        timings[result.index].upload_ms = Millis(Clock::now() - upload_start).count();
+        const Image &image = *result.image;
+        if (image.compressed && texture_codec_supported(image.compressed->codec)) {
+            timings[result.index].format = texture_codec_name(image.compressed->codec);
+            timings[result.index].gpu_bytes = image.compressed->size_bytes();
+        } else {
+            timings[result.index].gpu_bytes = uncompressed_texture_size(image.width, image.height, image.channels);
+        }
+    }
+
+    if (!first_error.empty()) {
+        throw std::runtime_error(first_error);
+    }
+
+    if (report) {
+        report->textures = std::move(timings);
+        report->wall_ms = Millis(Clock::now() - start).count();
+    }
+
+    std::vector<Texture> textures;
+    textures.reserve(slots.size());
+    for (auto &slot : slots) {
+        textures.push_back(std::move(*slot));
+    }
+    return textures;
+}
@@ -0,0 +1,55 @@
+#ifndef TEXTURE_LOADER_HPP
+#define TEXTURE_LOADER_HPP
+
+#include "mesh.hpp"
+#include "model_data.hpp"
+#include "texture_compression.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Decoded, not yet uploaded, image pixels. Safe to produce on any thread.
+struct Image {
+    int width = 0, height = 0, channels = 0;
+    std::unique_ptr<unsigned char, void (*)(void *)> pixels{nullptr, nullptr};
+    // Set instead of `pixels` when the image came from a baked texture (see texture_cache.hpp)
+    std::optional<CompressedTexture> compressed;
+
+    // Runs stbi_load; throws when the file can't be decoded.
+    static Image decode(const std::string &file_path);
+    // The baked mip chain when a fresh one exists, decode() otherwise
+    static Image load(const std::string &file_path);
+
+    // GL_RED, GL_RGB or GL_RGBA for the channel count; throws for anything else
+    GLenum format() const;
+    size_t size_bytes() const {
+        return compressed ? compressed->size_bytes() : size_t(width) * height * channels;
+    }
+};
+
+struct TextureLoadTiming {
+    std::string file_path;
+    double decode_ms;
+    double upload_ms;
+    // Compressed codec name, or "raw"
+    const char *format;
+    // Texture memory, including the mip chain
+    size_t gpu_bytes;
+};
+
+struct TextureLoadReport {
+    std::vector<TextureLoadTiming> textures;
+    double wall_ms = 0.0;
+
+    double total_decode_ms() const;
+    double total_upload_ms() const;
+    void print() const;
+};
+
+// Decodes every ref on the shared thread pool and uploads each one on the calling (GL) thread as soon as its decode
+// finishes. Results are in the same order as refs.
+std::vector<Texture> load_textures_parallel(const std::vector<TextureRef> &refs, TextureLoadReport *report = nullptr);
+
+#endif
@@ -0,0 +1,89 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int thread_count) : m_stopping(false) {
+    thread_count = std::max(thread_count, 1u);
+    m_threads.reserve(thread_count);
+    for (unsigned int i = 0; i < thread_count; i++) {
+        m_threads.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+
+    for (auto &thread : m_threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+void ThreadPool::run_batches(size_t count, const std::function<void(size_t)> &batch) {
+    // Shared with the tasks, which may outlive this call
+    struct Batches {
+        std::function<void(size_t)> batch;
+        size_t count;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+
+        Batches(const std::function<void(size_t)> &batch, size_t count) : batch(batch), count(count) {}
+
+        void run() {
+            for (size_t i; (i = next.fetch_add(1)) < count;) {
+                batch(i);
+                if (done.fetch_add(1) + 1 == count) {
+                    done.notify_all();
+                }
+            }
+        }
+    };
+
+    const auto batches = std::make_shared<Batches>(batch, count);
+    const size_t helpers = count > 1 ? std::min<size_t>(size(), count - 1) : 0;
+    for (size_t i = 0; i < helpers; i++) {
+        submit([batches] { batches->run(); });
+    }
+    batches->run();
+    for (size_t finished = batches->done.load(); finished < count; finished = batches->done.load()) {
+        batches->done.wait(finished);
+    }
+}
+
+ThreadPool &ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+unsigned int ThreadPool::default_thread_count() {
+    const unsigned int hw = std::thread::hardware_concurrency();
+    return hw > 1 ? hw - 1 : 1;
+}
+
+void ThreadPool::worker_loop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            if (m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads draining a FIFO of tasks. Tasks must not touch GL; anything that needs the
+// context has to be handed back to the thread that owns it.
+class ThreadPool {
+  public:
+    explicit ThreadPool(unsigned int thread_count = default_thread_count());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> task);
+    unsigned int size() const { return m_threads.size(); }
+
+    // Calls batch(i) for every i in [0, count), in any order and on any thread, and returns once every call has. The
+    // calling thread claims batches too, so this never waits on a pool busy with other work; a task that only starts
+    // after it returned finds every batch claimed and exits without calling `batch`.
+    void run_batches(size_t count, const std::function<void(size_t)> &batch);
+
+    // Pool shared by the loaders, created on first use.
+    static ThreadPool &shared();
+    // One thread per hardware thread, leaving one for the GL thread.
+    static unsigned int default_thread_count();
+
+  private:
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stopping;
+
+    void worker_loop();
+};
+
+#endif
@@ -0,0 +1,201 @@
+#include "transform_hierarchy.hpp"
+#include "profiler.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::duration<double, std::milli>;
+
+namespace {
+
+// Past one in this many nodes dirty, sorting the dirty list costs more than scanning every flag
+constexpr size_t DIRTY_LIST_DIVISOR = 16;
+// Below this many nodes to recompute an update is cheaper than waking the pool
+constexpr size_t PARALLEL_MIN_NODES = 16384;
+// Smallest range worth handing to a worker
+constexpr size_t PARALLEL_MIN_JOB_NODES = 1024;
+
+} // namespace
+
+glm::mat4 Transform::matrix() const {
+    glm::mat4 m = glm::mat4_cast(rotation);
+    m[0] = m[0] * scale.x;
+    m[1] = m[1] * scale.y;
+    m[2] = m[2] * scale.z;
+    m[3] = glm::vec4(translation, 1.0f);
+    return m;
+}
+
+TransformNode TransformHierarchy::add(TransformNode parent, const Transform &local) {
+    const auto node = static_cast<TransformNode>(size());
+    if (node == TRANSFORM_NONE) {
+        throw std::runtime_error("transform hierarchy is full");
+    }
+
+    if (parent != TRANSFORM_NONE &&
+        (parent >= node || m_depth[parent] >= m_path.size() || m_path[m_depth[parent]] != parent)) {
+        throw std::runtime_error("transform nodes must be added in depth-first order");
+    }
+
+    // Everything below the parent on the current path is finished; its subtree ends here
+    const uint32_t depth = parent == TRANSFORM_NONE ? 0 : m_depth[parent] + 1;
+    while (m_path.size() > depth) {
+        m_end[m_path.back()] = node;
+        m_path.pop_back();
+    }
+    m_path.push_back(node);
+
+    m_parent.push_back(parent);
+    m_end.push_back(node + 1);
+    m_depth.push_back(depth);
+    m_translation.push_back(local.translation);
+    m_rotation.push_back(local.rotation);
+    m_scale.push_back(local.scale);
+    m_world.emplace_back(1.0f);
+    m_dirty.push_back(0);
+    mark_dirty(node);
+    return node;
+}
+
+void TransformHierarchy::set_local(TransformNode node, const Transform &local) {
+    m_translation[node] = local.translation;
+    m_rotation[node] = local.rotation;
+    m_scale[node] = local.scale;
+    mark_dirty(node);
+}
+
+void TransformHierarchy::clear() {
+    m_parent.clear();
+    m_end.clear();
+    m_depth.clear();
+    m_translation.clear();
+    m_rotation.clear();
+    m_scale.clear();
+    m_world.clear();
+    m_dirty.clear();
+    m_dirty_nodes.clear();
+    m_all_dirty = false;
+    m_path.clear();
+}
+
+void TransformHierarchy::mark_dirty(TransformNode node) {
+    if (m_dirty[node]) {
+        return;
+    }
+    m_dirty[node] = 1;
+    if (m_all_dirty) {
+        return;
+    }
+    if (m_dirty_nodes.size() >= size() / DIRTY_LIST_DIVISOR) {
+        m_all_dirty = true;
+        m_dirty_nodes.clear();
+        return;
+    }
+    m_dirty_nodes.push_back(node);
+}
+
+TransformUpdateStats TransformHierarchy::update(ThreadPool *pool) {
+    PROFILE_ZONE("TransformHierarchy::update");
+    const auto start = Clock::now();
+    TransformUpdateStats stats;
+    stats.nodes = size();
+    if (!dirty()) {
+        return stats;
+    }
+
+    // Subtrees still open on the path run to the end for now
+    for (TransformNode node : m_path) {
+        m_end[node] = size();
+    }
+
+    // Outermost dirty subtrees in node order; a dirty node inside one of them is covered by it
+    m_ranges.clear();
+    if (m_all_dirty) {
+        for (TransformNode node = 0; node < size();) {
+            if (m_dirty[node]) {
+                m_ranges.push_back(node);
+                m_ranges.push_back(m_end[node]);
+                node = m_end[node];
+            } else {
+                node++;
+            }
+        }
+    } else {
+        std::sort(m_dirty_nodes.begin(), m_dirty_nodes.end());
+        TransformNode covered = 0;
+        for (TransformNode node : m_dirty_nodes) {
+            if (node >= covered) {
+                m_ranges.push_back(node);
+                m_ranges.push_back(m_end[node]);
+                covered = m_end[node];
+            }
+        }
+    }
+    m_dirty_nodes.clear();
+    m_all_dirty = false;
+
+    stats.subtrees = m_ranges.size() / 2;
+    for (size_t i = 0; i < m_ranges.size(); i += 2) {
+        stats.updated += m_ranges[i + 1] - m_ranges[i];
+    }
+
+    if (!pool || pool->size() == 0 || stats.updated < PARALLEL_MIN_NODES) {
+        for (size_t i = 0; i < m_ranges.size(); i += 2) {
+            update_range(m_ranges[i], m_ranges[i + 1]);
+        }
+        stats.jobs = 1;
+        stats.ms = Millis(Clock::now() - start).count();
+        return stats;
+    }
+
+    // Nodes heading a subtree too big for one job are done here first, in order, which leaves their children's
+    // subtrees independent of each other. Those get packed into batches of at least `target` nodes.
+    const size_t target = std::max(PARALLEL_MIN_JOB_NODES, stats.updated / (4 * (pool->size() + 1)));
+    // Subtrees as begin/end pairs, and where each batch of them starts (plus one past the last)
+    std::vector<TransformNode> ranges;
+    std::vector<size_t> batches = {0};
+    size_t batch_nodes = 0;
+    for (size_t i = 0; i < m_ranges.size(); i += 2) {
+        for (TransformNode node = m_ranges[i]; node < m_ranges[i + 1];) {
+            const TransformNode end = m_end[node];
+            if (end - node > target) {
+                update_range(node, node + 1);
+                node++;
+                continue;
+            }
+            ranges.push_back(node);
+            ranges.push_back(end);
+            batch_nodes += end - node;
+            if (batch_nodes >= target) {
+                batches.push_back(ranges.size() / 2);
+                batch_nodes = 0;
+            }
+            node = end;
+        }
+    }
+    if (batch_nodes > 0) {
+        batches.push_back(ranges.size() / 2);
+    }
+
+    pool->run_batches(batches.size() - 1, [this, &ranges, &batches](size_t batch) {
+        for (size_t i = batches[batch]; i < batches[batch + 1]; i++) {
+            update_range(ranges[2 * i], ranges[2 * i + 1]);
+        }
+    });
+
+    stats.jobs = batches.size() - 1;
+    stats.ms = Millis(Clock::now() - start).count();
+    return stats;
+}
+
+void TransformHierarchy::update_range(TransformNode begin, TransformNode end) {
+    for (TransformNode node = begin; node < end; node++) {
+        const glm::mat4 local = Transform{m_translation[node], m_rotation[node], m_scale[node]}.matrix();
+        const TransformNode parent = m_parent[node];
+        m_world[node] = parent == TRANSFORM_NONE ? local : m_world[parent] * local;
+        m_dirty[node] = 0;
+    }
+}
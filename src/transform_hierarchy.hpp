@@ -0,0 +1,81 @@
+#ifndef TRANSFORM_HIERARCHY_HPP
+#define TRANSFORM_HIERARCHY_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+using TransformNode = uint32_t;
+constexpr TransformNode TRANSFORM_NONE = UINT32_MAX;
+
+// A node's transform relative to its parent, applied scale first, then rotation, then translation
+struct Transform {
+    glm::vec3 translation = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+
+    glm::mat4 matrix() const;
+};
+
+struct TransformUpdateStats {
+    size_t nodes = 0;
+    // Nodes whose world matrix was recomputed: every dirty node and everything below it
+    size_t updated = 0;
+    // Dirty subtrees, and the jobs they were split into (1 when the update stayed on the calling thread)
+    size_t subtrees = 0;
+    size_t jobs = 0;
+    double ms = 0.0;
+};
+
+// Flattened scene graph. Nodes live in parallel arrays in depth-first order, so a parent always comes before its
+// children and every subtree is the contiguous range [node, subtree_end(node)). Updating is a forward walk over the
+// dirty subtrees reading each parent's world matrix, which is already final by the time its children get there.
+class TransformHierarchy {
+  public:
+    // Appends a node under parent (TRANSFORM_NONE for a root). The parent has to be the last node added or one of its
+    // ancestors, i.e. nodes are added in depth-first order; anything else throws. New nodes start dirty.
+    TransformNode add(TransformNode parent, const Transform &local);
+    void set_local(TransformNode node, const Transform &local);
+    void clear();
+
+    // Recomputes the world matrices below every node set_local touched since the last update. With a pool, large
+    // updates split the dirty subtrees into independent ranges and spread them over the workers.
+    TransformUpdateStats update(ThreadPool *pool = nullptr);
+
+    size_t size() const { return m_parent.size(); }
+    bool dirty() const { return !m_dirty_nodes.empty() || m_all_dirty; }
+    TransformNode parent(TransformNode node) const { return m_parent[node]; }
+    Transform local(TransformNode node) const { return {m_translation[node], m_rotation[node], m_scale[node]}; }
+    // Both valid as of the last update()
+    TransformNode subtree_end(TransformNode node) const { return m_end[node]; }
+    const glm::mat4 &world(TransformNode node) const { return m_world[node]; }
+
+  private:
+    std::vector<TransformNode> m_parent;
+    // One past the last node of the subtree; only final once add() has moved on from the node's subtree
+    std::vector<TransformNode> m_end;
+    std::vector<uint32_t> m_depth;
+    std::vector<glm::vec3> m_translation;
+    std::vector<glm::quat> m_rotation;
+    std::vector<glm::vec3> m_scale;
+    std::vector<glm::mat4> m_world;
+    // Set by set_local and cleared once the node's world matrix is recomputed
+    std::vector<uint8_t> m_dirty;
+    std::vector<TransformNode> m_dirty_nodes;
+    // Too many dirty nodes to list; update() scans m_dirty instead
+    bool m_all_dirty = false;
+    // Root to the last node added: the only nodes add() accepts as a parent
+    std::vector<TransformNode> m_path;
+    // Dirty subtrees as begin/end pairs, scratch for update()
+    std::vector<TransformNode> m_ranges;
+
+    void mark_dirty(TransformNode node);
+    void update_range(TransformNode begin, TransformNode end);
+};
+
+#endif
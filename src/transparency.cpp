@@ -0,0 +1,51 @@
+#include "transparency.hpp"
+
+namespace {
+
+// Texture units the composite samples the accumulation targets from
+constexpr unsigned int ACCUM_UNIT = 0;
+constexpr unsigned int WEIGHT_UNIT = 1;
+
+} // namespace
+
+void begin_transparent_blend(TransparencyMode mode) {
+    glEnable(GL_BLEND);
+    if (mode == TransparencyMode::WEIGHTED_BLENDED) {
+        glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+    } else {
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+    // Tested against the opaque scene, but never hiding each other
+    glDepthMask(GL_FALSE);
+}
+
+void end_transparent_blend() {
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
+
+WeightedBlendedComposite::WeightedBlendedComposite() { glGenVertexArrays(1, &m_vao); }
+
+WeightedBlendedComposite::~WeightedBlendedComposite() { glDeleteVertexArrays(1, &m_vao); }
+
+void WeightedBlendedComposite::draw(GlStateCache &state, unsigned int accum, unsigned int weight) {
+    const Shader &shader =
+        m_shaders.get("res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_oit_composite.glsl");
+
+    state.use_program(shader._m_id);
+    state.bind_texture(ACCUM_UNIT, GL_TEXTURE_2D, accum);
+    state.set_sampler(shader.location("accumTexture"), ACCUM_UNIT);
+    state.bind_texture(WEIGHT_UNIT, GL_TEXTURE_2D, weight);
+    state.set_sampler(shader.location("weightTexture"), WEIGHT_UNIT);
+    state.bind_vertex_array(m_vao);
+
+    const GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glDisable(GL_BLEND);
+    if (depth_test) {
+        glEnable(GL_DEPTH_TEST);
+    }
+}
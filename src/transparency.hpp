@@ -0,0 +1,52 @@
+#ifndef TRANSPARENCY_HPP
+#define TRANSPARENCY_HPP
+
+#include "gl_state.hpp"
+#include "render_queue.hpp"
+#include "shader_library.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Weighted blended order-independent transparency (McGuire and Bavoil, JCGT 2013): transparent fragments add their
+// colour, weighted by alpha and depth, into an accumulation target in any order, and multiply the background's
+// visibility (the revealage) down. One full-screen pass then blends the weighted average colour over the opaque scene
+// by 1 - revealage. It's an approximation: layers of similar depth mix instead of occluding each other, which is
+// hard to see in glass and foliage and costs no sorting.
+//
+// GL 3.3 has no per-attachment blend functions, so the packing (res/shaders/include/oit.glsl) gets by with one:
+// colour adds, alpha multiplies by 1 - source alpha.
+//   0  RGBA16F  premultiplied colour x weight, revealage (cleared to 1)
+//   1  R16F     alpha x weight
+// Both are frame graph transients declared by SceneRenderer, which draws the accumulation with the scene's depth
+// attached (tested, not written).
+constexpr GLenum OIT_ACCUM_FORMAT = GL_RGBA16F;
+constexpr GLenum OIT_WEIGHT_FORMAT = GL_R16F;
+constexpr size_t OIT_BYTES_PER_PIXEL = 8 + 2;
+
+// Blend and depth-write state for drawing the transparent layer in `mode` (for WEIGHTED_BLENDED, into the
+// accumulation targets); end_transparent_blend() goes back to opaque drawing
+void begin_transparent_blend(TransparencyMode mode);
+void end_transparent_blend();
+
+// The compositing half: a full-screen triangle running fragment_oit_composite.glsl
+class WeightedBlendedComposite {
+  public:
+    WeightedBlendedComposite();
+    ~WeightedBlendedComposite();
+
+    WeightedBlendedComposite(const WeightedBlendedComposite &) = delete;
+    WeightedBlendedComposite &operator=(const WeightedBlendedComposite &) = delete;
+
+    // Blends the accumulated transparency over the currently bound framebuffer, whose viewport must match the
+    // targets' size. Binds through `state` (units 0-1); blending is on for the draw and the depth test off, restored
+    // after.
+    void draw(GlStateCache &state, unsigned int accum, unsigned int weight);
+
+  private:
+    ShaderLibrary m_shaders;
+    unsigned int m_vao = 0;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include "uniform_blocks.hpp"
+
+void bind_uniform_blocks(unsigned int program) {
+    const struct {
+        const char *name;
+        unsigned int binding;
+    } blocks[] = {
+        {"Frame", FRAME_BLOCK_BINDING},
+        {"Lights", LIGHTS_BLOCK_BINDING},
+        {"Clusters", CLUSTERS_BLOCK_BINDING},
+    };
+
+    for (const auto &block : blocks) {
+        const unsigned int index = glGetUniformBlockIndex(program, block.name);
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(program, index, block.binding);
+        }
+    }
+
+    const struct {
+        const char *name;
+        unsigned int unit;
+    } samplers[] = {
+        {"clusterLights", CLUSTER_LIGHTS_UNIT},
+        {"clusterRanges", CLUSTER_RANGES_UNIT},
+        {"clusterIndices", CLUSTER_INDICES_UNIT},
+    };
+
+    // Sampler uniforms can only be set on the current program; put the previous one back afterwards
+    int previous = -1;
+    for (const auto &sampler : samplers) {
+        const int location = glGetUniformLocation(program, sampler.name);
+        if (location < 0) {
+            continue;
+        }
+        if (previous < 0) {
+            glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+            glUseProgram(program);
+        }
+        glUniform1i(location, sampler.unit);
+    }
+    if (previous >= 0) {
+        glUseProgram(previous);
+    }
+}
+
+LightUniforms default_lights(glm::vec3 camera_position, glm::vec3 camera_front) {
+    const glm::vec3 point_light_positions[MAX_POINT_LIGHTS] = {
+        glm::vec3(0.7f, 0.2f, 2.0f),
+        glm::vec3(2.3f, -3.3f, -4.0f),
+        glm::vec3(-4.0f, 2.0f, -12.0f),
+        glm::vec3(0.0f, 0.0f, -3.0f),
+    };
+
+    LightUniforms lights{};
+
+    lights.dir_light.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+    lights.dir_light.ambient = glm::vec3(0.05f);
+    lights.dir_light.diffuse = glm::vec3(0.4f);
+    lights.dir_light.specular = glm::vec3(0.5f);
+
+    for (int i = 0; i < MAX_POINT_LIGHTS; i++) {
+        auto &light = lights.point_lights[i];
+        light.position = point_light_positions[i];
+        light.ambient = glm::vec3(0.05f);
+        light.diffuse = glm::vec3(0.8f);
+        light.specular = glm::vec3(1.0f);
+        light.constant = 1.0f;
+        light.linear = 0.09f;
+        light.quadratic = 0.032f;
+    }
+
+    lights.spot_light.position = camera_position;
+    lights.spot_light.direction = camera_front;
+    lights.spot_light.ambient = glm::vec3(0.0f);
+    lights.spot_light.diffuse = glm::vec3(1.0f);
+    lights.spot_light.specular = glm::vec3(1.0f);
+    lights.spot_light.constant = 1.0f;
+    lights.spot_light.linear = 0.09f;
+    lights.spot_light.quadratic = 0.032f;
+    lights.spot_light.inner_cut_off = glm::cos(glm::radians(12.5f));
+    lights.spot_light.outer_cut_off = glm::cos(glm::radians(15.0f));
+
+    return lights;
+}
@@ -0,0 +1,132 @@
+#ifndef UNIFORM_BLOCKS_HPP
+#define UNIFORM_BLOCKS_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// std140 uniform blocks shared by every program in res/shaders. Each block lives at a fixed binding point, so the
+// data is uploaded once per frame no matter how many programs read it. The structs below mirror the GLSL
+// declarations in res/shaders/include byte for byte; keep them in sync.
+
+// Capacity of the Lights block, MAX_POINT_LIGHTS in lights.glsl
+constexpr int MAX_POINT_LIGHTS = 4;
+
+enum UniformBlockBinding : unsigned int {
+    FRAME_BLOCK_BINDING = 0,
+    LIGHTS_BLOCK_BINDING = 1,
+    CLUSTERS_BLOCK_BINDING = 2,
+};
+
+// The clustered light lists are buffer textures, kept on the last units so they never collide with a draw's own
+// textures (see MAX_PACKET_TEXTURES)
+enum SharedTextureUnit : unsigned int {
+    CLUSTER_LIGHTS_UNIT = 13,
+    CLUSTER_RANGES_UNIT = 14,
+    CLUSTER_INDICES_UNIT = 15,
+};
+
+// layout (std140) uniform Frame { mat4 view; mat4 projection; vec3 viewPos; };
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 view_pos;
+    float _pad0;
+};
+
+struct DirLightUniforms {
+    glm::vec3 direction;
+    float _pad0;
+    glm::vec3 ambient;
+    float _pad1;
+    glm::vec3 diffuse;
+    float _pad2;
+    glm::vec3 specular;
+    float _pad3;
+};
+
+struct PointLightUniforms {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 ambient;
+    float linear;
+    glm::vec3 diffuse;
+    float quadratic;
+    glm::vec3 specular;
+    float _pad0;
+};
+
+struct SpotLightUniforms {
+    glm::vec3 position;
+    float inner_cut_off;
+    glm::vec3 direction;
+    float outer_cut_off;
+    glm::vec3 ambient;
+    float constant;
+    glm::vec3 diffuse;
+    float linear;
+    glm::vec3 specular;
+    float quadratic;
+};
+
+// layout (std140) uniform Lights { DirLight dirLight; PointLight pointLights[MAX_POINT_LIGHTS]; SpotLight spotLight; }
+// Shaders may evaluate fewer point lights (see NR_POINT_LIGHTS in fragment.glsl), the block always holds them all.
+struct LightUniforms {
+    DirLightUniforms dir_light;
+    PointLightUniforms point_lights[MAX_POINT_LIGHTS];
+    SpotLightUniforms spot_light;
+};
+
+// layout (std140) uniform Clusters { uvec4 clusterGrid; vec4 clusterParams; }; see light_clusters.hpp
+struct ClusterUniforms {
+    // tiles x, tiles y, depth slices, light count
+    glm::uvec4 grid;
+    // pixels per tile x and y, slice scale, slice bias
+    glm::vec4 params;
+};
+
+static_assert(sizeof(FrameUniforms) == 144 && offsetof(FrameUniforms, view_pos) == 128);
+static_assert(sizeof(DirLightUniforms) == 64);
+static_assert(sizeof(PointLightUniforms) == 64 && offsetof(PointLightUniforms, specular) == 48);
+static_assert(sizeof(SpotLightUniforms) == 80 && offsetof(SpotLightUniforms, quadratic) == 76);
+static_assert(sizeof(LightUniforms) == 64 + 64 * MAX_POINT_LIGHTS + 80);
+static_assert(sizeof(ClusterUniforms) == 32);
+
+// A uniform buffer sized for T and permanently bound to `binding`.
+template <typename T> class UniformBuffer {
+  public:
+    explicit UniformBuffer(unsigned int binding) : m_binding(binding) {
+        glGenBuffers(1, &m_id);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_id);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_id);
+    }
+
+    ~UniformBuffer() { glDeleteBuffers(1, &m_id); }
+
+    UniformBuffer(const UniformBuffer &) = delete;
+    UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+    void update(const T &data) {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_id);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    unsigned int id() const { return m_id; }
+
+  private:
+    unsigned int m_id;
+    unsigned int m_binding;
+};
+
+// Points any of the shared blocks the program declares at their fixed binding, and the cluster samplers at their
+// fixed units. Called by ShaderBuilder::build.
+void bind_uniform_blocks(unsigned int program);
+
+// The light setup from the multiple-lights chapter; the spot light is a flashlight at the camera.
+LightUniforms default_lights(glm::vec3 camera_position, glm::vec3 camera_front);
+
+#endif
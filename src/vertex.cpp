@@ -0,0 +1,137 @@
+#include "vertex.hpp"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/packing.hpp>
+
+namespace {
+
+[[maybe_unused]] uint32_t pack_snorm10(float v) {
+    const int i = static_cast<int>(std::lround(glm::clamp(v, -1.0f, 1.0f) * 511.0f));
+    return static_cast<uint32_t>(i) & 0x3FF;
+}
+
+[[maybe_unused]] float unpack_snorm10(uint32_t bits) {
+    int i = bits & 0x3FF;
+    if (i & 0x200) {
+        i -= 0x400;
+    }
+    return std::max(i / 511.0f, -1.0f);
+}
+
+// GL_INT_2_10_10_10_REV: x in the low bits, w (unused, 0) in the top two
+[[maybe_unused]] uint32_t pack_normal(glm::vec3 n) {
+    return pack_snorm10(n.x) | pack_snorm10(n.y) << 10 | pack_snorm10(n.z) << 20;
+}
+
+[[maybe_unused]] glm::vec3 unpack_normal(uint32_t packed) {
+    return glm::vec3(unpack_snorm10(packed), unpack_snorm10(packed >> 10), unpack_snorm10(packed >> 20));
+}
+
+[[maybe_unused]] uint16_t quantize_unorm16(float v, float scale, float offset) {
+    if (scale == 0.0f) {
+        return 0;
+    }
+    const float t = glm::clamp((v - offset) / scale, 0.0f, 1.0f);
+    return static_cast<uint16_t>(std::lround(t * 65535.0f));
+}
+
+} // namespace
+
+const char *vertex_format_name() {
+#if VERTEX_FORMAT == VERTEX_FORMAT_FULL
+    return "FULL";
+#elif VERTEX_FORMAT == VERTEX_FORMAT_PACKED
+    return "PACKED";
+#else
+    return "QUANTIZED";
+#endif
+}
+
+VertexQuantization VertexQuantization::from_bounds(glm::vec3 min, glm::vec3 max) {
+    VertexQuantization q;
+#if VERTEX_FORMAT == VERTEX_FORMAT_QUANTIZED
+    q.offset = min;
+    q.scale = max - min;
+#else
+    (void)min;
+    (void)max;
+#endif
+    return q;
+}
+
+Vertex encode_vertex(glm::vec3 position, glm::vec3 normal, glm::vec2 tex_coord, const VertexQuantization &q) {
+    Vertex v;
+#if VERTEX_FORMAT == VERTEX_FORMAT_FULL
+    (void)q;
+    v.position = position;
+    v.normal = normal;
+    v.tex_coord = tex_coord;
+#else
+#if VERTEX_FORMAT == VERTEX_FORMAT_PACKED
+    (void)q;
+    v.position = position;
+#else
+    v.position[0] = quantize_unorm16(position.x, q.scale.x, q.offset.x);
+    v.position[1] = quantize_unorm16(position.y, q.scale.y, q.offset.y);
+    v.position[2] = quantize_unorm16(position.z, q.scale.z, q.offset.z);
+    v.position[3] = 0;
+#endif
+    v.normal = pack_normal(normal);
+    v.tex_coord[0] = glm::packHalf1x16(tex_coord.x);
+    v.tex_coord[1] = glm::packHalf1x16(tex_coord.y);
+#endif
+    return v;
+}
+
+glm::vec3 decode_position(const Vertex &v, const VertexQuantization &q) {
+#if VERTEX_FORMAT == VERTEX_FORMAT_QUANTIZED
+    return glm::vec3(v.position[0], v.position[1], v.position[2]) / 65535.0f * q.scale + q.offset;
+#else
+    (void)q;
+    return v.position;
+#endif
+}
+
+glm::vec3 decode_normal(const Vertex &v) {
+#if VERTEX_FORMAT == VERTEX_FORMAT_FULL
+    return v.normal;
+#else
+    return unpack_normal(v.normal);
+#endif
+}
+
+glm::vec2 decode_tex_coord(const Vertex &v) {
+#if VERTEX_FORMAT == VERTEX_FORMAT_FULL
+    return v.tex_coord;
+#else
+    return glm::vec2(glm::unpackHalf1x16(v.tex_coord[0]), glm::unpackHalf1x16(v.tex_coord[1]));
+#endif
+}
+
+void VertexEncodingError::accumulate(const VertexEncodingError &o) {
+    position = std::max(position, o.position);
+    normal = std::max(normal, o.normal);
+    tex_coord = std::max(tex_coord, o.tex_coord);
+}
+
+const VertexLayout &vertex_layout() {
+    static const VertexLayout layout = {
+        sizeof(Vertex),
+        {
+#if VERTEX_FORMAT == VERTEX_FORMAT_FULL
+            {0, 3, GL_FLOAT, false, offsetof(Vertex, position)},
+            {1, 3, GL_FLOAT, false, offsetof(Vertex, normal)},
+            {2, 2, GL_FLOAT, false, offsetof(Vertex, tex_coord)},
+#else
+#if VERTEX_FORMAT == VERTEX_FORMAT_PACKED
+            {0, 3, GL_FLOAT, false, offsetof(Vertex, position)},
+#else
+            {0, 3, GL_UNSIGNED_SHORT, true, offsetof(Vertex, position)},
+#endif
+            {1, 4, GL_INT_2_10_10_10_REV, true, offsetof(Vertex, normal)},
+            {2, 2, GL_HALF_FLOAT, false, offsetof(Vertex, tex_coord)},
+#endif
+        },
+    };
+    return layout;
+}
@@ -0,0 +1,93 @@
+#ifndef VERTEX_HPP
+#define VERTEX_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// GPU vertex format, picked at compile time (cmake -DLEARNOPENGL_VERTEX_FORMAT=FULL|PACKED|QUANTIZED):
+//   FULL       32 B: float position, float normal, float tex coords
+//   PACKED     20 B: float position, GL_INT_2_10_10_10_REV normal, half-float tex coords
+//   QUANTIZED  16 B: unorm16 position relative to the mesh bounds, packed normal, half-float tex coords
+// Normals and tex coords are expanded by the vertex fetch hardware. Quantized positions are expanded in the vertex
+// shader with the mesh's VertexQuantization (positionScale/positionOffset uniforms).
+#define VERTEX_FORMAT_FULL 0
+#define VERTEX_FORMAT_PACKED 1
+#define VERTEX_FORMAT_QUANTIZED 2
+
+#ifndef VERTEX_FORMAT
+#define VERTEX_FORMAT VERTEX_FORMAT_FULL
+#endif
+
+#if VERTEX_FORMAT == VERTEX_FORMAT_FULL
+struct Vertex {
+    glm::vec3 position, normal;
+    glm::vec2 tex_coord;
+};
+static_assert(sizeof(Vertex) == 32);
+#elif VERTEX_FORMAT == VERTEX_FORMAT_PACKED
+struct Vertex {
+    glm::vec3 position;
+    uint32_t normal;
+    uint16_t tex_coord[2];
+};
+static_assert(sizeof(Vertex) == 20);
+#elif VERTEX_FORMAT == VERTEX_FORMAT_QUANTIZED
+struct Vertex {
+    // xyz, w is padding to keep the normal 4-byte aligned
+    uint16_t position[4];
+    uint32_t normal;
+    uint16_t tex_coord[2];
+};
+static_assert(sizeof(Vertex) == 16);
+#else
+#error "unknown VERTEX_FORMAT"
+#endif
+
+const char *vertex_format_name();
+
+// Maps encoded positions back to model space: position = encoded * scale + offset. Identity unless the format
+// quantizes positions.
+struct VertexQuantization {
+    glm::vec3 scale = glm::vec3(1.0f);
+    glm::vec3 offset = glm::vec3(0.0f);
+
+    // Spans [min, max] with the full unorm16 range
+    static VertexQuantization from_bounds(glm::vec3 min, glm::vec3 max);
+};
+
+Vertex encode_vertex(glm::vec3 position, glm::vec3 normal, glm::vec2 tex_coord, const VertexQuantization &q);
+glm::vec3 decode_position(const Vertex &v, const VertexQuantization &q);
+glm::vec3 decode_normal(const Vertex &v);
+glm::vec2 decode_tex_coord(const Vertex &v);
+
+// Worst-case difference between the encoded vertices and the float source they came from
+struct VertexEncodingError {
+    float position = 0.0f;
+    // degrees
+    float normal = 0.0f;
+    float tex_coord = 0.0f;
+
+    void accumulate(const VertexEncodingError &o);
+};
+
+struct VertexAttribute {
+    unsigned int index;
+    int size;
+    GLenum type;
+    bool normalized;
+    size_t offset;
+};
+
+struct VertexLayout {
+    size_t stride;
+    std::vector<VertexAttribute> attributes;
+};
+
+// Attribute layout of Vertex as seen by the vertex shaders (location 0 position, 1 normal, 2 tex coords)
+const VertexLayout &vertex_layout();
+
+#endif
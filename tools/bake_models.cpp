@@ -0,0 +1,68 @@
+// Pre-bakes the mesh cache for every model under a directory tree (res/models by default) so the first launch of the
+// renderer already takes the warm, memory-mapped load path.
+//
+// usage: BakeModels [--force] [root]
+
+#include "mesh_cache.hpp"
+#include "model_data.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+namespace fs = std::filesystem;
+
+const std::set<std::string> MODEL_EXTENSIONS = {".obj", ".fbx", ".gltf", ".glb", ".dae", ".3ds", ".blend", ".ply"};
+
+int main(int argc, char **argv) {
+    bool force = false;
+    std::string root = "res/models";
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--force") {
+            force = true;
+        } else {
+            root = arg;
+        }
+    }
+
+    if (!fs::is_directory(root)) {
+        std::fprintf(stderr, "not a directory: %s\n", root.c_str());
+        return EXIT_FAILURE;
+    }
+
+    int baked = 0, skipped = 0, failed = 0;
+    for (const auto &entry : fs::recursive_directory_iterator(root)) {
+        if (!entry.is_regular_file() || !MODEL_EXTENSIONS.contains(entry.path().extension().string())) {
+            continue;
+        }
+
+        const std::string path = entry.path().generic_string();
+        if (!force && mesh_cache_is_fresh(path)) {
+            std::printf("up to date: %s\n", path.c_str());
+            skipped++;
+            continue;
+        }
+
+        try {
+            const auto start = std::chrono::steady_clock::now();
+            const ModelData data = import_model(path);
+            write_mesh_cache(path, data);
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+            std::printf("baked: %s (%zu meshes, %.1f ms)\n", path.c_str(), data.meshes.size(), elapsed.count());
+            baked++;
+        } catch (const std::exception &e) {
+            std::fprintf(stderr, "failed: %s: %s\n", path.c_str(), e.what());
+            failed++;
+        }
+    }
+
+    std::printf("%d baked, %d up to date, %d failed\n", baked, skipped, failed);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
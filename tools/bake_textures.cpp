@@ -0,0 +1,166 @@
+// Bakes every image under the given directory trees (res/textures and res/models by default) into a block-compressed
+// KTX file with a precomputed mip chain (see texture_cache.hpp), then reports per texture what it saves: texture memory
+// against the uncompressed upload with glGenerateMipmap, and load time of the baked file against decoding the source.
+//
+// The codec follows what the image holds (see choose_texture_codec). Model textures take their type (diffuse,
+// specular, ...) from the models that reference them; other images go by file name.
+//
+// usage: BakeTextures [--force] [root...]
+
+#include "mesh_cache.hpp"
+#include "model_data.hpp"
+#include "texture_cache.hpp"
+#include "texture_compression.hpp"
+#include "texture_loader.hpp"
+
+#include <stb/stb_image.h>
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::duration<double, std::milli>;
+
+const std::set<std::string> IMAGE_EXTENSIONS = {".png", ".jpg", ".jpeg", ".tga", ".bmp"};
+const std::set<std::string> MODEL_EXTENSIONS = {".obj", ".fbx", ".gltf", ".glb", ".dae", ".3ds", ".blend", ".ply"};
+
+std::string normalized(const fs::path &path) { return path.lexically_normal().generic_string(); }
+
+// Texture types by path, from every model under root
+void collect_model_texture_types(const std::string &root, std::map<std::string, std::string> &types) {
+    for (const auto &entry : fs::recursive_directory_iterator(root)) {
+        if (!entry.is_regular_file() || !MODEL_EXTENSIONS.contains(entry.path().extension().string())) {
+            continue;
+        }
+
+        const std::string path = entry.path().generic_string();
+        try {
+            std::vector<TextureRef> refs;
+            if (const auto baked = open_mesh_cache(path)) {
+                refs = baked->textures;
+            } else {
+                refs = import_model(path).textures;
+            }
+            for (const auto &ref : refs) {
+                types.emplace(normalized(ref.file_path), ref.type);
+            }
+        } catch (const std::exception &e) {
+            std::fprintf(stderr, "couldn't read textures of %s: %s\n", path.c_str(), e.what());
+        }
+    }
+}
+
+std::string type_from_name(const std::string &path) {
+    const std::string stem = fs::path(path).stem().string();
+    if (stem.find("specular") != std::string::npos) {
+        return "texture_specular";
+    }
+    if (stem.find("normal") != std::string::npos) {
+        return "texture_normal";
+    }
+    return "texture_diffuse";
+}
+
+int main(int argc, char **argv) {
+    bool force = false;
+    std::vector<std::string> roots;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--force") {
+            force = true;
+        } else {
+            roots.push_back(arg);
+        }
+    }
+    if (roots.empty()) {
+        roots = {"res/textures", "res/models"};
+    }
+
+    // Same orientation as the renderer, so the baked texels match what it would have uploaded
+    stbi_set_flip_vertically_on_load(true);
+
+    std::map<std::string, std::string> model_types;
+    for (const auto &root : roots) {
+        if (!fs::is_directory(root)) {
+            std::fprintf(stderr, "not a directory: %s\n", root.c_str());
+            return EXIT_FAILURE;
+        }
+        collect_model_texture_types(root, model_types);
+    }
+
+    int baked = 0, skipped = 0, failed = 0;
+    size_t total_raw = 0, total_compressed = 0;
+    double total_decode_ms = 0.0, total_baked_ms = 0.0;
+
+    std::printf("%-48s %-5s %-9s %12s %12s %7s %12s %12s\n", "texture", "codec", "size", "raw KiB", "baked KiB",
+                "ratio", "decode ms", "baked ms");
+    for (const auto &root : roots) {
+        for (const auto &entry : fs::recursive_directory_iterator(root)) {
+            std::string extension = entry.path().extension().string();
+            for (char &c : extension) {
+                c = std::tolower(static_cast<unsigned char>(c));
+            }
+            if (!entry.is_regular_file() || !IMAGE_EXTENSIONS.contains(extension)) {
+                continue;
+            }
+
+            const std::string path = entry.path().generic_string();
+            const auto model_type = model_types.find(normalized(path));
+            const std::string type = model_type != model_types.end() ? model_type->second : type_from_name(path);
+
+            try {
+                auto start = Clock::now();
+                const Image image = Image::decode(path);
+                const double decode_ms = Millis(Clock::now() - start).count();
+
+                if (force || !texture_cache_is_fresh(path)) {
+                    const TextureCodec codec = choose_texture_codec(image, type);
+                    write_texture_cache(path, compress_texture(image, codec, texture_type_is_srgb(type)));
+                    baked++;
+                } else {
+                    skipped++;
+                }
+
+                start = Clock::now();
+                const auto texture = open_texture_cache(path);
+                const double baked_ms = Millis(Clock::now() - start).count();
+                if (!texture) {
+                    throw std::runtime_error("couldn't read back " + texture_cache_path(path));
+                }
+
+                const size_t raw = uncompressed_texture_size(image.width, image.height, image.channels);
+                const std::string size = std::to_string(image.width) + "x" + std::to_string(image.height);
+                std::printf("%-48s %-5s %-9s %12.1f %12.1f %6.1fx %12.2f %12.2f\n", path.c_str(),
+                            texture_codec_name(texture->codec), size.c_str(), raw / 1024.0,
+                            texture->size_bytes() / 1024.0, double(raw) / texture->size_bytes(), decode_ms, baked_ms);
+
+                total_raw += raw;
+                total_compressed += texture->size_bytes();
+                total_decode_ms += decode_ms;
+                total_baked_ms += baked_ms;
+            } catch (const std::exception &e) {
+                std::fprintf(stderr, "failed: %s: %s\n", path.c_str(), e.what());
+                failed++;
+            }
+        }
+    }
+
+    if (total_compressed > 0) {
+        std::printf("texture memory %.1f -> %.1f MiB (%.1fx), load %.1f -> %.1f ms, no glGenerateMipmap at upload\n",
+                    total_raw / (1024.0 * 1024.0), total_compressed / (1024.0 * 1024.0),
+                    double(total_raw) / total_compressed, total_decode_ms, total_baked_ms);
+    }
+    std::printf("%d baked, %d up to date, %d failed\n", baked, skipped, failed);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+// CPU-only frustum culling benchmark: random boxes, random cameras, BVH vs. brute force. Also checks that both
+// produce the same visible set.
+//
+// usage: BenchCulling [seed]
+
+#include "bounds.hpp"
+#include "bvh.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::duration<double, std::milli>;
+
+constexpr float WORLD_SIZE = 1000.0f;
+constexpr int CAMERAS = 32;
+
+int main(int argc, char **argv) {
+    const unsigned int seed = argc > 1 ? std::stoul(argv[1]) : 1234;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> coord(-WORLD_SIZE / 2, WORLD_SIZE / 2);
+    std::uniform_real_distribution<float> size(0.5f, 5.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+    std::printf("%10s %10s %10s %12s %12s %12s %8s\n", "boxes", "build ms", "visible", "brute ms", "bvh ms",
+                "boxes/us", "speedup");
+
+    for (const size_t count : {10000ul, 100000ul, 1000000ul}) {
+        std::vector<AABB> boxes(count);
+        for (auto &box : boxes) {
+            const glm::vec3 c(coord(rng), coord(rng), coord(rng));
+            const glm::vec3 e(size(rng), size(rng), size(rng));
+            box = {c - e * 0.5f, c + e * 0.5f};
+        }
+
+        Bvh bvh;
+        const auto build_start = Clock::now();
+        bvh.build(boxes);
+        const double build_ms = Millis(Clock::now() - build_start).count();
+
+        double brute_ms = 0.0, bvh_ms = 0.0;
+        size_t visible_total = 0;
+        std::vector<uint32_t> expected, visible;
+
+        for (int i = 0; i < CAMERAS; i++) {
+            const glm::vec3 eye(coord(rng), coord(rng), coord(rng));
+            const float yaw = angle(rng), pitch = angle(rng) * 0.25f - 0.8f;
+            const glm::vec3 front(std::cos(yaw) * std::cos(pitch), std::sin(pitch), std::sin(yaw) * std::cos(pitch));
+            const glm::mat4 view = glm::lookAt(eye, eye + front, glm::vec3(0.0f, 1.0f, 0.0f));
+            const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 300.0f);
+            const Frustum frustum = Frustum::from_matrix(projection * view);
+
+            expected.clear();
+            auto start = Clock::now();
+            for (uint32_t j = 0; j < boxes.size(); j++) {
+                if (frustum.intersects(boxes[j])) {
+                    expected.push_back(j);
+                }
+            }
+            brute_ms += Millis(Clock::now() - start).count();
+
+            visible.clear();
+            start = Clock::now();
+            bvh.cull(frustum, visible);
+            bvh_ms += Millis(Clock::now() - start).count();
+
+            std::sort(visible.begin(), visible.end());
+            if (visible != expected) {
+                std::fprintf(stderr, "mismatch with %zu boxes, camera %d: bvh %zu visible, brute force %zu\n", count,
+                             i, visible.size(), expected.size());
+                return EXIT_FAILURE;
+            }
+            visible_total += visible.size();
+        }
+
+        std::printf("%10zu %10.1f %10zu %12.3f %12.3f %12.1f %7.1fx\n", count, build_ms, visible_total / CAMERAS,
+                    brute_ms / CAMERAS, bvh_ms / CAMERAS, count / (bvh_ms / CAMERAS * 1000.0), brute_ms / bvh_ms);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,437 @@
+// Headless frame-time benchmark: renders a named scene into an offscreen framebuffer along the scene's scripted camera
+// path and reports per-frame CPU time, GPU time (GL_TIMESTAMP) and draw counts as JSON. Needs no window system, so
+// it runs on Mesa llvmpipe in CI; compare the JSON of two commits to spot regressions.
+//
+// usage: BenchFrames [--scene NAME] [--frames N] [--warmup N] [--size WxH] [--label TEXT] [--out FILE]
+//                    [--trace FILE] [--lod on|off] [--path forward|deferred] [--post PASS,...]
+//                    [--dynamic-resolution MS] [--transparency sorted|weighted] [--workers N]
+//
+// --lod off draws every mesh at full detail, for comparing triangle counts and GPU time against LOD selection.
+// --path deferred lights opaque geometry from the G-buffer; "path" in the JSON is what the scene was actually drawn
+// with (scenes without a deferred light set stay forward) and gbuffer_bytes the G-buffer's size.
+// --post runs the named standard post effects (bloom, blur, grayscale, invert, sharpen, edge) over the scene, which is
+// then drawn into a texture first; post_ms holds each effect's GPU time.
+// --dynamic-resolution scales the scene's resolution to hold each frame to MS of GPU time and upscales it to --size;
+// "scale" is the scale each frame was drawn at, render_target_allocations how many textures that took.
+// Frames are declared to a frame graph; transient_bytes is its peak transient texture memory per frame,
+// unaliased_bytes what it would take without sharing textures between passes.
+// The clustered_<lights> scenes sweep clustered shading from 4 to 1024 lights (clustered_<lights>_unculled evaluates
+// every light per fragment instead); cluster_ms is the CPU time spent binning and uploading the light lists.
+// --transparency weighted composites transparent geometry with weighted blended OIT, which draws the scene into a
+// texture first like --post; "transparency" in the JSON is what was actually used. The transparent_<count> scenes
+// sweep the number of transparent quads: sorted, each one is a packet the queue orders back to front, so sort_ms (CPU
+// time the queue spent sorting) and draw calls grow with the count, while weighted pays a fixed composite pass in
+// gpu_ms instead.
+// --workers records the scene's objects on a job system with N threads besides the GL thread (0, the default, records
+// them on the GL thread); record_ms is the CPU time spent queueing the scene, merging the workers' queues included.
+// The draws_<count> scenes sweep 10k to 100k individually culled draws for exactly that; BenchRecording runs the sweep
+// over worker counts.
+// --trace writes a Chrome trace of the profiling zones; it needs a build with -DLEARNOPENGL_PROFILING=ON.
+
+#include "dynamic_resolution.hpp"
+#include "frame_graph.hpp"
+#include "frame_stats.hpp"
+#include "gpu_timer.hpp"
+#include "headless_context.hpp"
+#include "job_system.hpp"
+#include "post_process.hpp"
+#include "profiler.hpp"
+#include "scene.hpp"
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::duration<double, std::milli>;
+
+namespace {
+
+struct Options {
+    std::string scene = scene_names().front();
+    unsigned int frames = 300;
+    unsigned int warmup = 30;
+    int width = 800;
+    int height = 600;
+    std::string label;
+    std::string out;
+    std::string trace;
+    bool lod = true;
+    RenderPath path = RenderPath::FORWARD;
+    std::vector<std::string> post;
+    // GPU time per frame dynamic resolution holds to; 0 draws at full resolution
+    double resolution_target_ms = 0.0;
+    TransparencyMode transparency = TransparencyMode::SORTED;
+    unsigned int workers = 0;
+};
+
+struct FrameSample {
+    double cpu_ms = 0.0;
+    double gpu_ms = -1.0;
+    uint64_t draw_calls = 0;
+    uint64_t instances = 0;
+    uint64_t state_changes = 0;
+    uint64_t triangles = 0;
+    double cluster_ms = 0.0;
+    uint64_t light_references = 0;
+    double sort_ms = 0.0;
+    double record_ms = 0.0;
+    // GPU time per post effect
+    std::map<std::string, double> post_ms;
+    float scale = 1.0f;
+    size_t transient_bytes = 0;
+};
+
+void usage() {
+    std::fprintf(stderr, "usage: BenchFrames [--scene NAME] [--frames N] [--warmup N] [--size WxH] [--label TEXT] "
+                         "[--out FILE] [--trace FILE] [--lod on|off] [--path forward|deferred] "
+                         "[--post PASS,...] [--dynamic-resolution MS] [--transparency sorted|weighted] [--workers N]\n"
+                         "scenes:");
+    for (const auto &name : scene_names()) {
+        std::fprintf(stderr, " %s", name.c_str());
+    }
+    std::fprintf(stderr, "\n");
+}
+
+Options parse_options(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            throw std::runtime_error("missing value for " + arg);
+        }
+        const std::string value = argv[++i];
+
+        if (arg == "--scene") {
+            options.scene = value;
+        } else if (arg == "--frames") {
+            options.frames = std::max(1ul, std::stoul(value));
+        } else if (arg == "--warmup") {
+            options.warmup = std::stoul(value);
+        } else if (arg == "--size") {
+            if (std::sscanf(value.c_str(), "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 ||
+                options.height <= 0) {
+                throw std::runtime_error("bad --size: " + value);
+            }
+        } else if (arg == "--label") {
+            options.label = value;
+        } else if (arg == "--out") {
+            options.out = value;
+        } else if (arg == "--trace") {
+            options.trace = value;
+        } else if (arg == "--lod") {
+            if (value != "on" && value != "off") {
+                throw std::runtime_error("bad --lod: " + value);
+            }
+            options.lod = value == "on";
+        } else if (arg == "--path") {
+            if (value != "forward" && value != "deferred") {
+                throw std::runtime_error("bad --path: " + value);
+            }
+            options.path = value == "deferred" ? RenderPath::DEFERRED : RenderPath::FORWARD;
+        } else if (arg == "--post") {
+            size_t start = 0;
+            while (start <= value.size()) {
+                const size_t end = std::min(value.find(',', start), value.size());
+                options.post.push_back(value.substr(start, end - start));
+                start = end + 1;
+            }
+        } else if (arg == "--dynamic-resolution") {
+            options.resolution_target_ms = std::stod(value);
+            if (options.resolution_target_ms <= 0.0) {
+                throw std::runtime_error("bad --dynamic-resolution: " + value);
+            }
+        } else if (arg == "--transparency") {
+            if (value != "sorted" && value != "weighted") {
+                throw std::runtime_error("bad --transparency: " + value);
+            }
+            options.transparency = value == "weighted" ? TransparencyMode::WEIGHTED_BLENDED : TransparencyMode::SORTED;
+        } else if (arg == "--workers") {
+            options.workers = std::stoul(value);
+        } else {
+            throw std::runtime_error("unknown option: " + arg);
+        }
+    }
+    return options;
+}
+
+std::string json_escape(const std::string &s) {
+    std::string escaped;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += (static_cast<unsigned char>(c) < 0x20) ? ' ' : c;
+    }
+    return escaped;
+}
+
+void write_json(std::FILE *out, const Options &options, const HeadlessContext &context, const SceneRenderer &renderer,
+                const FrameGraph &graph, const DynamicResolution &resolution, const std::vector<FrameSample> &samples,
+                uint64_t gpu_stalls) {
+    std::vector<double> cpu, gpu, draw_calls, triangles, cluster_ms, light_references, sort_ms, record_ms, scale,
+        transient_bytes;
+    std::map<std::string, std::vector<double>> post_ms;
+    for (const auto &sample : samples) {
+        for (const auto &[name, ms] : sample.post_ms) {
+            post_ms[name].push_back(ms);
+        }
+        cpu.push_back(sample.cpu_ms);
+        if (sample.gpu_ms >= 0.0) {
+            gpu.push_back(sample.gpu_ms);
+        }
+        draw_calls.push_back(sample.draw_calls);
+        triangles.push_back(sample.triangles);
+        cluster_ms.push_back(sample.cluster_ms);
+        light_references.push_back(sample.light_references);
+        sort_ms.push_back(sample.sort_ms);
+        record_ms.push_back(sample.record_ms);
+        scale.push_back(sample.scale);
+        transient_bytes.push_back(static_cast<double>(sample.transient_bytes));
+    }
+
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"label\": \"%s\",\n", json_escape(options.label).c_str());
+    std::fprintf(out, "  \"scene\": \"%s\",\n", json_escape(options.scene).c_str());
+    std::fprintf(out, "  \"vertex_format\": \"%s\",\n", vertex_format_name());
+    std::fprintf(out, "  \"gl_vendor\": \"%s\",\n", json_escape(context.vendor()).c_str());
+    std::fprintf(out, "  \"gl_renderer\": \"%s\",\n", json_escape(context.renderer()).c_str());
+    std::fprintf(out, "  \"gl_version\": \"%s\",\n", json_escape(context.version()).c_str());
+    std::fprintf(out, "  \"lod\": %s,\n", options.lod ? "true" : "false");
+    std::fprintf(out, "  \"path\": \"%s\",\n", render_path_name(renderer.rendered_path));
+    std::fprintf(out, "  \"transparency\": \"%s\",\n", transparency_mode_name(renderer.rendered_transparency));
+    std::fprintf(out, "  \"gbuffer_bytes\": %zu,\n", renderer.gbuffer_bytes());
+    std::fprintf(out, "  \"workers\": %u,\n", options.workers);
+    std::fprintf(out, "  \"width\": %d,\n  \"height\": %d,\n", options.width, options.height);
+    std::fprintf(out, "  \"warmup_frames\": %u,\n  \"frames\": %zu,\n", options.warmup, samples.size());
+    std::fprintf(out, "  \"gpu_timer_stalls\": %llu,\n", static_cast<unsigned long long>(gpu_stalls));
+    std::fprintf(out, "  \"cpu_ms\": ");
+    SampleSummary::of(cpu).write_json(out);
+    std::fprintf(out, ",\n  \"gpu_ms\": ");
+    SampleSummary::of(gpu).write_json(out);
+    std::fprintf(out, ",\n  \"draw_calls\": ");
+    SampleSummary::of(draw_calls).write_json(out);
+    std::fprintf(out, ",\n  \"triangles\": ");
+    SampleSummary::of(triangles).write_json(out);
+    std::fprintf(out, ",\n  \"cluster_ms\": ");
+    SampleSummary::of(cluster_ms).write_json(out);
+    std::fprintf(out, ",\n  \"light_references\": ");
+    SampleSummary::of(light_references).write_json(out);
+    std::fprintf(out, ",\n  \"sort_ms\": ");
+    SampleSummary::of(sort_ms).write_json(out);
+    std::fprintf(out, ",\n  \"record_ms\": ");
+    SampleSummary::of(record_ms).write_json(out);
+    std::fprintf(out, ",\n  \"transient_bytes\": ");
+    SampleSummary::of(transient_bytes).write_json(out);
+    std::fprintf(out, ",\n  \"unaliased_bytes\": %zu", graph.stats().unaliased_bytes);
+    std::fprintf(out, ",\n  \"frame_graph_textures\": %u", graph.stats().textures);
+    std::fprintf(out, ",\n  \"culled_passes\": %u", graph.stats().culled);
+    std::fprintf(out, ",\n  \"post_ms\": {");
+    for (auto it = post_ms.begin(); it != post_ms.end(); ++it) {
+        std::fprintf(out, "%s\n    \"%s\": ", it == post_ms.begin() ? "" : ",", json_escape(it->first).c_str());
+        SampleSummary::of(it->second).write_json(out);
+    }
+    std::fprintf(out, "%s}", post_ms.empty() ? "" : "\n  ");
+    std::fprintf(out, ",\n  \"dynamic_resolution_target_ms\": %.4f", options.resolution_target_ms);
+    std::fprintf(out, ",\n  \"resolution_changes\": %llu",
+                 static_cast<unsigned long long>(resolution.stats().changes));
+    std::fprintf(out, ",\n  \"render_target_allocations\": %llu",
+                 static_cast<unsigned long long>(graph.stats().allocations));
+    std::fprintf(out, ",\n  \"scale\": ");
+    SampleSummary::of(scale).write_json(out);
+    std::fprintf(out, ",\n  \"per_frame\": [\n");
+    for (size_t i = 0; i < samples.size(); i++) {
+        const FrameSample &s = samples[i];
+        std::fprintf(out,
+                     "    {\"cpu_ms\": %.4f, \"gpu_ms\": %.4f, \"draw_calls\": %llu, \"instances\": %llu, "
+                     "\"state_changes\": %llu, \"triangles\": %llu, \"cluster_ms\": %.4f, "
+                     "\"light_references\": %llu, \"sort_ms\": %.4f, \"record_ms\": %.4f, \"scale\": %.3f, "
+                     "\"transient_bytes\": %zu}%s\n",
+                     s.cpu_ms, s.gpu_ms, static_cast<unsigned long long>(s.draw_calls),
+                     static_cast<unsigned long long>(s.instances), static_cast<unsigned long long>(s.state_changes),
+                     static_cast<unsigned long long>(s.triangles), s.cluster_ms,
+                     static_cast<unsigned long long>(s.light_references), s.sort_ms, s.record_ms, s.scale,
+                     s.transient_bytes,
+                     i + 1 < samples.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        HeadlessContext context;
+        std::fprintf(stderr, "context: %s (%s)\n", context.renderer().c_str(), context.version().c_str());
+
+        stbi_set_flip_vertically_on_load(true);
+
+        std::unique_ptr<Scene> scene = make_scene(options.scene);
+        const CameraPath path = scene->camera_path();
+
+        OffscreenTarget target(options.width, options.height);
+        SceneRenderer renderer;
+        renderer.lod_selector().enabled = options.lod;
+        renderer.path = options.path;
+        renderer.transparency = options.transparency;
+        std::unique_ptr<JobSystem> jobs;
+        if (options.workers > 0) {
+            jobs = std::make_unique<JobSystem>(options.workers);
+            renderer.jobs = jobs.get();
+        }
+        GpuTimer gpu_timer;
+        Camera camera;
+
+        DynamicResolution resolution;
+        resolution.enabled = options.resolution_target_ms > 0.0;
+        resolution.target_ms = options.resolution_target_ms;
+
+        // With post effects, dynamic resolution or weighted blended transparency the scene goes to a texture first, and
+        // the chain draws it into `target`
+        const glm::ivec2 output_size(options.width, options.height);
+        FrameGraph graph;
+        std::unique_ptr<PostChain> post;
+        std::vector<PostTiming> post_timings;
+        if (!options.post.empty() || resolution.enabled ||
+            options.transparency == TransparencyMode::WEIGHTED_BLENDED) {
+            post = std::make_unique<PostChain>();
+            add_standard_passes(*post);
+            for (const auto &name : options.post) {
+                if (!post->set_enabled(name, true)) {
+                    throw std::runtime_error("unknown post pass: " + name);
+                }
+            }
+        }
+
+        std::vector<FrameSample> samples(options.frames);
+        std::vector<GpuTiming> gpu_timings;
+        // Timings already fed to the resolution controller
+        size_t gpu_timings_seen = 0;
+        const float aspect = static_cast<float>(options.width) / options.height;
+        // Measured frames cover the whole path; warmup replays its first steps
+        const float step = options.frames > 1 ? path.duration() / (options.frames - 1) : 0.0f;
+
+        glEnable(GL_DEPTH_TEST);
+
+        for (unsigned int frame = 0; frame < options.warmup + options.frames; frame++) {
+            const bool measured = frame >= options.warmup;
+            const unsigned int index = measured ? frame - options.warmup : frame;
+            path.apply(camera, index * step);
+
+            const auto start = Clock::now();
+            // Every frame is timed, so the resolution controller has settled by the end of the warmup
+            gpu_timer.begin(frame);
+
+            const glm::vec4 clear_color(0.1f, 0.1f, 0.1f, 1.0f);
+            const FrameResource output = graph.import_framebuffer("output", target.framebuffer(), output_size);
+            if (post) {
+                const glm::ivec2 render_size = resolution.render_size(output_size);
+                const FrameResource color = graph.create("scene color", render_size, GL_RGBA8);
+                const FrameResource depth = graph.create("scene depth", render_size, GL_DEPTH24_STENCIL8);
+                renderer.add_passes(graph, *scene, camera, aspect, color, depth, clear_color);
+                post->add_passes(graph, color, output, frame);
+            } else {
+                renderer.add_passes(graph, *scene, camera, aspect, output, output, clear_color);
+            }
+            {
+                PROFILE_GPU_ZONE("frame graph");
+                graph.execute();
+            }
+            gpu_timer.end();
+            // Stand-in for the swap: hand the frame to the driver without waiting for it
+            glFlush();
+
+            if (measured) {
+                FrameSample &sample = samples[index];
+                sample.cpu_ms = Millis(Clock::now() - start).count();
+                sample.draw_calls = renderer.stats.draw_calls;
+                sample.instances = renderer.stats.instances;
+                sample.state_changes = renderer.stats.state.state_changes();
+                sample.triangles = renderer.stats.triangles;
+                sample.cluster_ms = renderer.cluster_stats.bin_ms + renderer.cluster_stats.upload_ms;
+                sample.light_references = renderer.cluster_stats.references;
+                sample.sort_ms = renderer.stats.sort_ms;
+                sample.record_ms = renderer.record_stats.ms;
+                sample.scale = resolution.scale();
+                sample.transient_bytes = graph.stats().transient_bytes;
+            }
+
+            gpu_timer.collect(gpu_timings);
+            for (; gpu_timings_seen < gpu_timings.size(); gpu_timings_seen++) {
+                const GpuTiming &timing = gpu_timings[gpu_timings_seen];
+                resolution.update(timing.tag, timing.ms, frame + 1);
+            }
+            if (post) {
+                post->collect(post_timings);
+            }
+            PROFILE_FRAME();
+        }
+
+        glFinish();
+        gpu_timer.collect(gpu_timings, true);
+        if (post) {
+            post->collect(post_timings, true);
+        }
+        if (!options.trace.empty()) {
+#if PROFILING_ENABLED
+            PROFILE_WRITE_TRACE(options.trace);
+#else
+            std::fprintf(stderr, "--trace ignored: built without LEARNOPENGL_PROFILING\n");
+#endif
+        }
+        for (const auto &timing : gpu_timings) {
+            if (timing.tag >= options.warmup) {
+                samples[timing.tag - options.warmup].gpu_ms = timing.ms;
+            }
+        }
+        for (const auto &timing : post_timings) {
+            if (timing.frame >= options.warmup) {
+                samples[timing.frame - options.warmup].post_ms[post->pass_name(timing.pass)] += timing.ms;
+            }
+        }
+
+        std::FILE *out = stdout;
+        if (!options.out.empty() && !(out = std::fopen(options.out.c_str(), "w"))) {
+            throw std::runtime_error("couldn't open " + options.out);
+        }
+        write_json(out, options, context, renderer, graph, resolution, samples, gpu_timer.stalls);
+        if (out != stdout) {
+            std::fclose(out);
+        }
+
+        std::vector<double> cpu, gpu;
+        for (const auto &sample : samples) {
+            cpu.push_back(sample.cpu_ms);
+            if (sample.gpu_ms >= 0.0) {
+                gpu.push_back(sample.gpu_ms);
+            }
+        }
+        const SampleSummary cpu_summary = SampleSummary::of(cpu), gpu_summary = SampleSummary::of(gpu);
+        std::fprintf(stderr, "%s: %u frames, cpu p50 %.3f / p99 %.3f ms, gpu p50 %.3f / p99 %.3f ms, %llu draw calls\n",
+                     options.scene.c_str(), options.frames, cpu_summary.p50, cpu_summary.p99, gpu_summary.p50,
+                     gpu_summary.p99, static_cast<unsigned long long>(samples.back().draw_calls));
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
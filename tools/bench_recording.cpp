@@ -0,0 +1,188 @@
+// Parallel recording scaling benchmark: renders each scene offscreen along its camera path once per worker count and
+// prints how CPU frame time and recording time (queueing the scene, merging the workers' queues included) scale with
+// the number of threads recording it. The GL thread issues every draw in all runs; 0 workers records on it too.
+//
+// usage: BenchRecording [--scenes NAME,...] [--workers N,...] [--frames N] [--warmup N] [--size WxH]
+//
+// The default sweep is draws_10000, draws_30000 and draws_100000 (that many individually culled and spun crates) over
+// 0, 1, 2, 4, ... workers up to one per hardware thread besides the GL thread.
+
+#include "frame_graph.hpp"
+#include "frame_stats.hpp"
+#include "headless_context.hpp"
+#include "job_system.hpp"
+#include "scene.hpp"
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::duration<double, std::milli>;
+
+namespace {
+
+struct Options {
+    std::vector<std::string> scenes = {"draws_10000", "draws_30000", "draws_100000"};
+    std::vector<unsigned int> workers;
+    unsigned int frames = 120;
+    unsigned int warmup = 10;
+    int width = 800;
+    int height = 600;
+};
+
+void usage() {
+    std::fprintf(stderr, "usage: BenchRecording [--scenes NAME,...] [--workers N,...] [--frames N] [--warmup N] "
+                         "[--size WxH]\n");
+}
+
+std::vector<std::string> split(const std::string &value) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= value.size()) {
+        const size_t end = std::min(value.find(',', start), value.size());
+        parts.push_back(value.substr(start, end - start));
+        start = end + 1;
+    }
+    return parts;
+}
+
+Options parse_options(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            throw std::runtime_error("missing value for " + arg);
+        }
+        const std::string value = argv[++i];
+
+        if (arg == "--scenes") {
+            options.scenes = split(value);
+        } else if (arg == "--workers") {
+            options.workers.clear();
+            for (const auto &count : split(value)) {
+                options.workers.push_back(std::stoul(count));
+            }
+        } else if (arg == "--frames") {
+            options.frames = std::max(1ul, std::stoul(value));
+        } else if (arg == "--warmup") {
+            options.warmup = std::stoul(value);
+        } else if (arg == "--size") {
+            if (std::sscanf(value.c_str(), "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 ||
+                options.height <= 0) {
+                throw std::runtime_error("bad --size: " + value);
+            }
+        } else {
+            throw std::runtime_error("unknown option: " + arg);
+        }
+    }
+
+    if (options.workers.empty()) {
+        const unsigned int max_workers = ThreadPool::default_thread_count();
+        options.workers.push_back(0);
+        for (unsigned int count = 1; count < max_workers; count *= 2) {
+            options.workers.push_back(count);
+        }
+        options.workers.push_back(max_workers);
+    }
+    return options;
+}
+
+struct RunResult {
+    SampleSummary cpu_ms;
+    SampleSummary record_ms;
+    double draw_calls = 0.0;
+    double steals = 0.0;
+};
+
+RunResult run(const Options &options, Scene &scene, unsigned int workers) {
+    const CameraPath path = scene.camera_path();
+    OffscreenTarget target(options.width, options.height);
+    FrameGraph graph;
+    SceneRenderer renderer;
+    std::unique_ptr<JobSystem> jobs;
+    if (workers > 0) {
+        jobs = std::make_unique<JobSystem>(workers);
+        renderer.jobs = jobs.get();
+    }
+    Camera camera;
+
+    const glm::ivec2 size(options.width, options.height);
+    const float aspect = static_cast<float>(options.width) / options.height;
+    const float step = options.frames > 1 ? path.duration() / (options.frames - 1) : 0.0f;
+    std::vector<double> cpu, record;
+    RunResult result;
+
+    glEnable(GL_DEPTH_TEST);
+    for (unsigned int frame = 0; frame < options.warmup + options.frames; frame++) {
+        const bool measured = frame >= options.warmup;
+        path.apply(camera, (measured ? frame - options.warmup : frame) * step);
+
+        const auto start = Clock::now();
+        const FrameResource output = graph.import_framebuffer("output", target.framebuffer(), size);
+        renderer.add_passes(graph, scene, camera, aspect, output, output, glm::vec4(0.1f, 0.1f, 0.1f, 1.0f));
+        graph.execute();
+        glFlush();
+
+        if (measured) {
+            cpu.push_back(Millis(Clock::now() - start).count());
+            record.push_back(renderer.record_stats.ms);
+            result.draw_calls += renderer.stats.draw_calls;
+            result.steals += renderer.record_stats.steals;
+        }
+    }
+    glFinish();
+
+    result.cpu_ms = SampleSummary::of(cpu);
+    result.record_ms = SampleSummary::of(record);
+    result.draw_calls /= options.frames;
+    result.steals /= options.frames;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        HeadlessContext context;
+        std::fprintf(stderr, "context: %s (%s)\n", context.renderer().c_str(), context.version().c_str());
+        stbi_set_flip_vertically_on_load(true);
+
+        std::printf("%16s %8s %10s %12s %12s %12s %12s %10s %10s\n", "scene", "workers", "draws",
+                    "cpu p50 ms", "cpu p95 ms", "record p50", "record p95", "speedup", "steals");
+        for (const auto &name : options.scenes) {
+            std::unique_ptr<Scene> scene = make_scene(name);
+            double baseline_ms = 0.0;
+            for (const unsigned int workers : options.workers) {
+                const RunResult result = run(options, *scene, workers);
+                if (baseline_ms == 0.0) {
+                    baseline_ms = result.record_ms.p50;
+                }
+                std::printf("%16s %8u %10.0f %12.3f %12.3f %12.3f %12.3f %9.2fx %10.1f\n", name.c_str(),
+                            workers, result.draw_calls, result.cpu_ms.p50, result.cpu_ms.p95, result.record_ms.p50,
+                            result.record_ms.p95, baseline_ms / result.record_ms.p50, result.steals);
+            }
+        }
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,260 @@
+// Shader startup benchmark: builds every program the scenes use and reports how long that takes with a cold program
+// cache (compile and link from source, then save the binaries) and a warm one (glProgramBinary only), each both one
+// program at a time and with every program started before any is finished (see build_shaders). Writes the per-round
+// times as JSON.
+//
+// usage: BenchShaderStartup [--rounds N] [--cache-dir DIR] [--driver-cache] [--label TEXT] [--out FILE]
+//
+// Mesa keeps its own on-disk shader cache, which would turn every "cold" round after the first into a warm one; it is
+// disabled unless --driver-cache is given. Source files are read once up front, so only GL work is timed.
+
+#include "frame_stats.hpp"
+#include "headless_context.hpp"
+#include "program_cache.hpp"
+#include "shader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::duration<double, std::milli>;
+
+namespace {
+
+struct Program {
+    const char *vertex;
+    const char *fragment;
+    ShaderDefines defines;
+};
+
+// Every permutation loaded by main.cpp and the scenes
+const Program PROGRAMS[] = {
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_framebuffer.glsl", {{"EFFECT", 0}}},
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_framebuffer.glsl", {{"EFFECT", 1}}},
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_framebuffer.glsl", {{"EFFECT", 2}}},
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_framebuffer.glsl", {{"EFFECT", 3}}},
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_framebuffer.glsl", {{"EFFECT", 4}}},
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_blur.glsl", {{"BLUR_AXIS", 0}, {"BLUR_TAPS", 3}}},
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_blur.glsl", {{"BLUR_AXIS", 1}, {"BLUR_TAPS", 3}}},
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_bloom.glsl", {{"BLOOM_COMPOSITE", 0}}},
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_bloom.glsl", {{"BLOOM_COMPOSITE", 1}}},
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_upscale.glsl", {}},
+    {"res/shaders/vertex_depth.glsl", "res/shaders/fragment_depth.glsl", {}},
+    {"res/shaders/vertex_depth_instanced.glsl", "res/shaders/fragment_tinted.glsl", {}},
+    {"res/shaders/vertex_depth.glsl", "res/shaders/fragment_blending.glsl", {{"WEIGHTED_BLENDED", 0}}},
+    {"res/shaders/vertex_depth_instanced.glsl", "res/shaders/fragment_blending.glsl", {{"WEIGHTED_BLENDED", 1}}},
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_oit_composite.glsl", {}},
+    {"res/shaders/vertex_model.glsl", "res/shaders/fragment_model.glsl", {}},
+    {"res/shaders/vertex.glsl", "res/shaders/fragment.glsl",
+     {{"DIR_LIGHT", 1}, {"NR_POINT_LIGHTS", 4}, {"SPOT_LIGHT", 1}, {"SPECULAR_MAP", 1}}},
+    {"res/shaders/vertex.glsl", "res/shaders/fragment.glsl",
+     {{"DIR_LIGHT", 1}, {"NR_POINT_LIGHTS", 4}, {"SPOT_LIGHT", 1}, {"SPECULAR_MAP", 0}}},
+    {"res/shaders/vertex.glsl", "res/shaders/fragment.glsl",
+     {{"DIR_LIGHT", 1}, {"NR_POINT_LIGHTS", 0}, {"SPOT_LIGHT", 0}, {"SPECULAR_MAP", 1}}},
+    {"res/shaders/vertex.glsl", "res/shaders/fragment.glsl",
+     {{"DIR_LIGHT", 1}, {"NR_POINT_LIGHTS", 0}, {"SPOT_LIGHT", 0}, {"SPECULAR_MAP", 0}}},
+    {"res/shaders/vertex_instanced.glsl", "res/shaders/fragment.glsl",
+     {{"DIR_LIGHT", 1}, {"NR_POINT_LIGHTS", 0}, {"SPOT_LIGHT", 0}, {"SPECULAR_MAP", 1}, {"CLUSTERED_LIGHTS", 1}}},
+    {"res/shaders/vertex_instanced.glsl", "res/shaders/fragment.glsl",
+     {{"DIR_LIGHT", 1}, {"NR_POINT_LIGHTS", 0}, {"SPOT_LIGHT", 0}, {"SPECULAR_MAP", 1}, {"CLUSTERED_LIGHTS", 2}}},
+    {"res/shaders/vertex.glsl", "res/shaders/fragment.glsl", {{"GBUFFER", 1}, {"SPECULAR_MAP", 1}}},
+    {"res/shaders/vertex.glsl", "res/shaders/fragment.glsl", {{"GBUFFER", 1}, {"SPECULAR_MAP", 0}}},
+    {"res/shaders/vertex_instanced.glsl", "res/shaders/fragment.glsl", {{"GBUFFER", 1}, {"SPECULAR_MAP", 1}}},
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_deferred.glsl",
+     {{"DIR_LIGHT", 1}, {"NR_POINT_LIGHTS", 4}, {"SPOT_LIGHT", 1}}},
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_deferred.glsl",
+     {{"DIR_LIGHT", 1}, {"NR_POINT_LIGHTS", 0}, {"SPOT_LIGHT", 0}}},
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_deferred.glsl",
+     {{"DIR_LIGHT", 1}, {"NR_POINT_LIGHTS", 0}, {"SPOT_LIGHT", 0}, {"CLUSTERED_LIGHTS", 1}}},
+    {"res/shaders/vertex_fullscreen.glsl", "res/shaders/fragment_deferred.glsl",
+     {{"DIR_LIGHT", 1}, {"NR_POINT_LIGHTS", 0}, {"SPOT_LIGHT", 0}, {"CLUSTERED_LIGHTS", 2}}},
+};
+
+struct Options {
+    unsigned int rounds = 5;
+    std::string cache_dir = (fs::temp_directory_path() / "bench_shader_startup").string();
+    bool driver_cache = false;
+    std::string label;
+    std::string out;
+};
+
+struct Mode {
+    const char *name;
+    bool warm;
+    bool parallel;
+    std::vector<double> ms;
+    ProgramCacheStats stats;
+};
+
+void usage() {
+    std::fprintf(stderr, "usage: BenchShaderStartup [--rounds N] [--cache-dir DIR] [--driver-cache] [--label TEXT] "
+                         "[--out FILE]\n");
+}
+
+Options parse_options(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--driver-cache") {
+            options.driver_cache = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::runtime_error("missing value for " + arg);
+        }
+        const std::string value = argv[++i];
+
+        if (arg == "--rounds") {
+            options.rounds = std::max(1ul, std::stoul(value));
+        } else if (arg == "--cache-dir") {
+            options.cache_dir = value;
+        } else if (arg == "--label") {
+            options.label = value;
+        } else if (arg == "--out") {
+            options.out = value;
+        } else {
+            throw std::runtime_error("unknown option: " + arg);
+        }
+    }
+    return options;
+}
+
+std::string json_escape(const std::string &s) {
+    std::string escaped;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += (static_cast<unsigned char>(c) < 0x20) ? ' ' : c;
+    }
+    return escaped;
+}
+
+// Builds every program once; the shaders are deleted again before returning
+double build_all(std::vector<ShaderBuilder> &builders, bool parallel) {
+    const auto start = Clock::now();
+    std::vector<std::unique_ptr<Shader>> shaders;
+    if (parallel) {
+        shaders = build_shaders(builders);
+    } else {
+        for (auto &builder : builders) {
+            shaders.push_back(builder.build());
+        }
+    }
+    const double ms = Millis(Clock::now() - start).count();
+    glFinish();
+    return ms;
+}
+
+void write_json(std::FILE *out, const Options &options, const HeadlessContext &context,
+                const std::vector<Mode> &modes) {
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"label\": \"%s\",\n", json_escape(options.label).c_str());
+    std::fprintf(out, "  \"gl_renderer\": \"%s\",\n", json_escape(context.renderer()).c_str());
+    std::fprintf(out, "  \"gl_version\": \"%s\",\n", json_escape(context.version()).c_str());
+    std::fprintf(out, "  \"program_binary\": %s,\n", ProgramCache::shared().available() ? "true" : "false");
+    std::fprintf(out, "  \"parallel_shader_compile\": %s,\n", GLAD_GL_KHR_parallel_shader_compile ? "true" : "false");
+    std::fprintf(out, "  \"driver_cache\": %s,\n", options.driver_cache ? "true" : "false");
+    std::fprintf(out, "  \"programs\": %zu,\n", std::size(PROGRAMS));
+    std::fprintf(out, "  \"rounds\": %u,\n", options.rounds);
+    std::fprintf(out, "  \"modes\": [\n");
+    for (size_t i = 0; i < modes.size(); i++) {
+        const Mode &mode = modes[i];
+        std::fprintf(out,
+                     "    {\"name\": \"%s\", \"cache_hits\": %u, \"compiled\": %u, \"rejected\": %u, "
+                     "\"writes\": %u, \"ms\": ",
+                     mode.name, mode.stats.hits, mode.stats.compiled, mode.stats.rejected, mode.stats.writes);
+        SampleSummary::of(mode.ms).write_json(out);
+        std::fprintf(out, "}%s\n", i + 1 < modes.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if (!options.driver_cache) {
+        setenv("MESA_SHADER_CACHE_DISABLE", "true", 1);
+    }
+
+    try {
+        HeadlessContext context;
+        std::fprintf(stderr, "context: %s (%s)\n", context.renderer().c_str(), context.version().c_str());
+
+        std::vector<ShaderBuilder> builders;
+        for (const auto &program : PROGRAMS) {
+            builders.push_back(ShaderBuilder::from_files(program.vertex, program.fragment, program.defines));
+        }
+
+        ProgramCache &cache = ProgramCache::shared();
+        cache.set_directory(options.cache_dir);
+        if (!cache.available()) {
+            std::fprintf(stderr, "no program binary support, every round compiles from source\n");
+        }
+
+        std::vector<Mode> modes = {
+            {"cold", false, false, {}, {}},
+            {"cold_parallel", false, true, {}, {}},
+            {"warm", true, false, {}, {}},
+            {"warm_parallel", true, true, {}, {}},
+        };
+
+        // Rounds interleave the modes, so drift in clocks or caches hits them all alike
+        for (unsigned int round = 0; round < options.rounds; round++) {
+            for (auto &mode : modes) {
+                cache.clear();
+                if (mode.warm) {
+                    build_all(builders, mode.parallel);
+                }
+
+                const ProgramCacheStats before = cache.stats();
+                mode.ms.push_back(build_all(builders, mode.parallel));
+                const ProgramCacheStats &after = cache.stats();
+                mode.stats.hits += after.hits - before.hits;
+                mode.stats.compiled += after.compiled - before.compiled;
+                mode.stats.rejected += after.rejected - before.rejected;
+                mode.stats.writes += after.writes - before.writes;
+            }
+        }
+        cache.clear();
+
+        std::FILE *out = stdout;
+        if (!options.out.empty() && !(out = std::fopen(options.out.c_str(), "w"))) {
+            throw std::runtime_error("couldn't open " + options.out);
+        }
+        write_json(out, options, context, modes);
+        if (out != stdout) {
+            std::fclose(out);
+        }
+
+        for (const auto &mode : modes) {
+            const SampleSummary summary = SampleSummary::of(mode.ms);
+            std::fprintf(stderr, "%-14s %zu programs: p50 %.2f ms, min %.2f ms (%u hits, %u compiled)\n", mode.name,
+                         std::size(PROGRAMS), summary.p50, summary.min, mode.stats.hits, mode.stats.compiled);
+        }
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
@@ -0,0 +1,338 @@
+// Streaming stress test: loads many copies of a model through ModelStreamer while rendering a grid of them offscreen,
+// and reports how flat the frame times stay while the data arrives. Runs until every load is ready plus a tail of
+// steady-state frames, then writes per-frame CPU/GPU time and upload bytes as JSON.
+//
+// usage: BenchStreaming [--model PATH] [--count N] [--frames N] [--tail N] [--budget-mb MB] [--budget-ms MS]
+//                       [--chunk-kb KB] [--sync] [--size WxH] [--label TEXT] [--out FILE]
+//
+// --sync loads every model with the blocking Model constructor inside the first frame instead, which is the spike the
+// streamer is there to avoid. A spike is any frame over twice the median CPU time.
+
+#include "frame_stats.hpp"
+#include "gpu_timer.hpp"
+#include "headless_context.hpp"
+#include "model.hpp"
+#include "model_streamer.hpp"
+#include "scene.hpp"
+#include "shader.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::duration<double, std::milli>;
+
+namespace {
+
+constexpr float SPACING = 5.0f;
+// Simulated time per frame along the camera orbit
+constexpr float FRAME_SECONDS = 1.0f / 60.0f;
+
+struct Options {
+    std::string model = "res/models/backpack/backpack.obj";
+    unsigned int count = 16;
+    // Hard cap, in case loads never finish
+    unsigned int frames = 3000;
+    // Frames kept after everything is ready
+    unsigned int tail = 60;
+    StreamingBudget budget;
+    bool sync = false;
+    int width = 800;
+    int height = 600;
+    std::string label;
+    std::string out;
+};
+
+struct FrameSample {
+    double cpu_ms = 0.0;
+    double gpu_ms = -1.0;
+    size_t upload_bytes = 0;
+    double upload_ms = 0.0;
+    unsigned int ready = 0;
+};
+
+void usage() {
+    std::fprintf(stderr, "usage: BenchStreaming [--model PATH] [--count N] [--frames N] [--tail N] [--budget-mb MB] "
+                         "[--budget-ms MS] [--chunk-kb KB] [--sync] [--size WxH] [--label TEXT] [--out FILE]\n");
+}
+
+Options parse_options(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--sync") {
+            options.sync = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::runtime_error("missing value for " + arg);
+        }
+        const std::string value = argv[++i];
+
+        if (arg == "--model") {
+            options.model = value;
+        } else if (arg == "--count") {
+            options.count = std::max(1ul, std::stoul(value));
+        } else if (arg == "--frames") {
+            options.frames = std::max(1ul, std::stoul(value));
+        } else if (arg == "--tail") {
+            options.tail = std::stoul(value);
+        } else if (arg == "--budget-mb") {
+            options.budget.bytes_per_frame = static_cast<size_t>(std::stod(value) * (1 << 20));
+        } else if (arg == "--budget-ms") {
+            options.budget.ms_per_frame = std::stod(value);
+        } else if (arg == "--chunk-kb") {
+            options.budget.chunk_bytes = std::max(size_t(1), static_cast<size_t>(std::stod(value) * 1024));
+        } else if (arg == "--size") {
+            if (std::sscanf(value.c_str(), "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 ||
+                options.height <= 0) {
+                throw std::runtime_error("bad --size: " + value);
+            }
+        } else if (arg == "--label") {
+            options.label = value;
+        } else if (arg == "--out") {
+            options.out = value;
+        } else {
+            throw std::runtime_error("unknown option: " + arg);
+        }
+    }
+    return options;
+}
+
+// A square-ish grid of `count` copies of one model, streamed or loaded synchronously on the first frame
+class StressScene : public Scene {
+  public:
+    explicit StressScene(const Options &options)
+        : m_options(options), m_columns(static_cast<int>(std::ceil(std::sqrt(float(options.count))))),
+          m_shader(load_shader()), m_lod_states(options.count) {
+        m_streamer.budget = options.budget;
+        if (!options.sync) {
+            for (unsigned int i = 0; i < options.count; i++) {
+                m_handles.push_back(m_streamer.load(options.model));
+            }
+        }
+    }
+
+    void submit(RenderQueue &queue) override {
+        const auto u_model = m_shader->uniform<glm::mat4>("model");
+        if (m_options.sync) {
+            while (m_models.size() < m_options.count) {
+                m_models.push_back(std::make_unique<Model>(m_options.model));
+            }
+            for (unsigned int i = 0; i < m_options.count; i++) {
+                m_models[i]->submit(queue, *m_shader, cell(i), u_model, RenderLayer::OPAQUE, &m_lod_states[i]);
+            }
+            return;
+        }
+
+        m_streamer.update();
+        for (unsigned int i = 0; i < m_options.count; i++) {
+            m_streamer.submit(queue, *m_shader, m_handles[i], cell(i), u_model, RenderLayer::OPAQUE,
+                              &m_lod_states[i]);
+        }
+    }
+
+    CameraPath camera_path() const override {
+        const float extent = m_columns * SPACING;
+        return CameraPath::orbit(glm::vec3(0.0f), extent, extent * 0.4f, 20.0f);
+    }
+
+    unsigned int ready() const {
+        if (m_options.sync) {
+            return m_models.size();
+        }
+        return std::count_if(m_handles.begin(), m_handles.end(), [](const ModelHandle &h) { return h.ready(); });
+    }
+
+    bool done() const { return m_options.sync ? !m_models.empty() : m_streamer.idle(); }
+    const StreamingStats &stats() const { return m_streamer.stats(); }
+
+  private:
+    const Options &m_options;
+    int m_columns;
+    std::unique_ptr<Shader> m_shader;
+    ModelStreamer m_streamer;
+    std::vector<ModelHandle> m_handles;
+    std::vector<std::unique_ptr<Model>> m_models;
+    std::vector<LodState> m_lod_states;
+
+    static std::unique_ptr<Shader> load_shader() {
+        return ShaderBuilder::from_files("res/shaders/vertex_model.glsl", "res/shaders/fragment_model.glsl").build();
+    }
+
+    glm::mat4 cell(unsigned int i) const {
+        const float half = (m_columns - 1) * SPACING * 0.5f;
+        const glm::vec3 position((i % m_columns) * SPACING - half, 0.0f, (i / m_columns) * SPACING - half);
+        return glm::translate(glm::mat4(1.0f), position);
+    }
+};
+
+std::string json_escape(const std::string &s) {
+    std::string escaped;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += (static_cast<unsigned char>(c) < 0x20) ? ' ' : c;
+    }
+    return escaped;
+}
+
+void write_json(std::FILE *out, const Options &options, const HeadlessContext &context,
+                const std::vector<FrameSample> &samples, const StreamingStats &stats, int ready_frame,
+                double ready_ms) {
+    std::vector<double> cpu, gpu, upload_bytes, upload_ms;
+    for (const auto &sample : samples) {
+        cpu.push_back(sample.cpu_ms);
+        if (sample.gpu_ms >= 0.0) {
+            gpu.push_back(sample.gpu_ms);
+        }
+        upload_bytes.push_back(sample.upload_bytes);
+        upload_ms.push_back(sample.upload_ms);
+    }
+    const SampleSummary cpu_summary = SampleSummary::of(cpu);
+    const auto spikes = std::count_if(cpu.begin(), cpu.end(), [&](double ms) { return ms > 2.0 * cpu_summary.p50; });
+
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"label\": \"%s\",\n", json_escape(options.label).c_str());
+    std::fprintf(out, "  \"model\": \"%s\",\n", json_escape(options.model).c_str());
+    std::fprintf(out, "  \"vertex_format\": \"%s\",\n", vertex_format_name());
+    std::fprintf(out, "  \"gl_renderer\": \"%s\",\n", json_escape(context.renderer()).c_str());
+    std::fprintf(out, "  \"gl_version\": \"%s\",\n", json_escape(context.version()).c_str());
+    std::fprintf(out, "  \"mode\": \"%s\",\n", options.sync ? "sync" : "streamed");
+    std::fprintf(out, "  \"count\": %u,\n", options.count);
+    std::fprintf(out, "  \"budget\": {\"bytes_per_frame\": %zu, \"ms_per_frame\": %.3f, \"chunk_bytes\": %zu},\n",
+                 options.budget.bytes_per_frame, options.budget.ms_per_frame, options.budget.chunk_bytes);
+    std::fprintf(out, "  \"width\": %d,\n  \"height\": %d,\n", options.width, options.height);
+    std::fprintf(out, "  \"frames\": %zu,\n", samples.size());
+    std::fprintf(out, "  \"ready_frame\": %d,\n  \"ready_ms\": %.3f,\n", ready_frame, ready_ms);
+    std::fprintf(out, "  \"loads_failed\": %u,\n", stats.loads_failed);
+    std::fprintf(out, "  \"uploaded_bytes\": %zu,\n", stats.total_bytes);
+    std::fprintf(out, "  \"spikes\": %lld,\n", static_cast<long long>(spikes));
+    std::fprintf(out, "  \"cpu_ms\": ");
+    cpu_summary.write_json(out);
+    std::fprintf(out, ",\n  \"gpu_ms\": ");
+    SampleSummary::of(gpu).write_json(out);
+    std::fprintf(out, ",\n  \"upload_bytes\": ");
+    SampleSummary::of(upload_bytes).write_json(out);
+    std::fprintf(out, ",\n  \"upload_ms\": ");
+    SampleSummary::of(upload_ms).write_json(out);
+    std::fprintf(out, ",\n  \"per_frame\": [\n");
+    for (size_t i = 0; i < samples.size(); i++) {
+        const FrameSample &s = samples[i];
+        std::fprintf(out,
+                     "    {\"cpu_ms\": %.4f, \"gpu_ms\": %.4f, \"upload_bytes\": %zu, \"upload_ms\": %.4f, "
+                     "\"ready\": %u}%s\n",
+                     s.cpu_ms, s.gpu_ms, s.upload_bytes, s.upload_ms, s.ready, i + 1 < samples.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        HeadlessContext context;
+        std::fprintf(stderr, "context: %s (%s)\n", context.renderer().c_str(), context.version().c_str());
+
+        stbi_set_flip_vertically_on_load(true);
+
+        OffscreenTarget target(options.width, options.height);
+        SceneRenderer renderer;
+        GpuTimer gpu_timer;
+        Camera camera;
+
+        const auto start = Clock::now();
+        StressScene scene(options);
+        const CameraPath path = scene.camera_path();
+
+        std::vector<FrameSample> samples;
+        std::vector<GpuTiming> gpu_timings;
+        const float aspect = static_cast<float>(options.width) / options.height;
+        int ready_frame = -1;
+        double ready_ms = 0.0;
+
+        target.bind();
+        glViewport(0, 0, options.width, options.height);
+        glEnable(GL_DEPTH_TEST);
+
+        for (unsigned int frame = 0; frame < options.frames; frame++) {
+            path.apply(camera, std::fmod(frame * FRAME_SECONDS, path.duration()));
+
+            const auto frame_start = Clock::now();
+            gpu_timer.begin(frame);
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderer.render(scene, camera, aspect);
+            gpu_timer.end();
+            glFlush();
+
+            FrameSample sample;
+            sample.cpu_ms = Millis(Clock::now() - frame_start).count();
+            sample.upload_bytes = options.sync ? 0 : scene.stats().bytes;
+            sample.upload_ms = options.sync ? 0.0 : scene.stats().ms;
+            sample.ready = scene.ready();
+            samples.push_back(sample);
+            gpu_timer.collect(gpu_timings);
+
+            if (ready_frame < 0 && scene.done()) {
+                ready_frame = frame;
+                ready_ms = Millis(Clock::now() - start).count();
+            }
+            if (ready_frame >= 0 && frame >= static_cast<unsigned int>(ready_frame) + options.tail) {
+                break;
+            }
+        }
+
+        glFinish();
+        gpu_timer.collect(gpu_timings, true);
+        for (const auto &timing : gpu_timings) {
+            samples[timing.tag].gpu_ms = timing.ms;
+        }
+        if (ready_frame < 0) {
+            std::fprintf(stderr, "not every load finished within %u frames\n", options.frames);
+        }
+
+        std::FILE *out = stdout;
+        if (!options.out.empty() && !(out = std::fopen(options.out.c_str(), "w"))) {
+            throw std::runtime_error("couldn't open " + options.out);
+        }
+        write_json(out, options, context, samples, scene.stats(), ready_frame, ready_ms);
+        if (out != stdout) {
+            std::fclose(out);
+        }
+
+        std::vector<double> cpu;
+        for (const auto &sample : samples) {
+            cpu.push_back(sample.cpu_ms);
+        }
+        const SampleSummary summary = SampleSummary::of(cpu);
+        std::fprintf(stderr, "%s x%u (%s): ready after %d frames / %.1f ms, cpu p50 %.3f / p99 %.3f / max %.3f ms\n",
+                     options.model.c_str(), options.count, options.sync ? "sync" : "streamed", ready_frame, ready_ms,
+                     summary.p50, summary.p99, summary.max);
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
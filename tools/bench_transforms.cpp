@@ -0,0 +1,146 @@
+// CPU-only transform hierarchy benchmark: random scene graphs of 100k and 1M nodes in three shapes, timing a full
+// update on the calling thread, the same update spread over a thread pool, and updates after 1% of the nodes moved.
+// Every variant is checked against a from-scratch serial update of the same local transforms.
+//
+// usage: BenchTransforms [seed]
+
+#include "thread_pool.hpp"
+#include "transform_hierarchy.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+constexpr int FRAMES = 16;
+constexpr size_t DIRTY_DIVISOR = 100;
+
+namespace {
+
+struct Shape {
+    const char *name;
+    // Chance that a node starts a new root, and how deep a tree may get
+    double root_chance;
+    size_t max_depth;
+    // Chance that a node goes under the last one added rather than a random node on the path to it
+    double descend_chance;
+};
+
+constexpr Shape SHAPES[] = {
+    {"forest", 1.0 / 64, 8, 0.5},
+    {"one root", 0.0, 16, 0.5},
+    {"chains", 1.0 / 1000, 1000, 1.0},
+};
+
+Transform random_transform(std::mt19937 &rng) {
+    std::uniform_real_distribution<float> offset(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> scale(0.9f, 1.1f);
+
+    Transform t;
+    t.translation = glm::vec3(offset(rng), offset(rng), offset(rng));
+    t.rotation = glm::angleAxis(angle(rng), glm::normalize(glm::vec3(offset(rng), offset(rng), 1.0f)));
+    t.scale = glm::vec3(scale(rng));
+    return t;
+}
+
+void build(TransformHierarchy &hierarchy, const Shape &shape, size_t count, std::mt19937 &rng) {
+    std::bernoulli_distribution new_root(shape.root_chance), descend(shape.descend_chance);
+    std::vector<TransformNode> path;
+    for (size_t i = 0; i < count; i++) {
+        if (path.empty() || new_root(rng)) {
+            path.clear();
+        } else if (!descend(rng) || path.size() >= shape.max_depth) {
+            path.resize(std::uniform_int_distribution<size_t>(1, path.size())(rng));
+        }
+        const TransformNode parent = path.empty() ? TRANSFORM_NONE : path.back();
+        path.push_back(hierarchy.add(parent, random_transform(rng)));
+    }
+}
+
+// A fresh hierarchy with the same nodes and local transforms, updated serially from scratch
+bool matches_reference(const TransformHierarchy &hierarchy) {
+    TransformHierarchy reference;
+    for (TransformNode node = 0; node < hierarchy.size(); node++) {
+        reference.add(hierarchy.parent(node), hierarchy.local(node));
+    }
+    reference.update();
+    for (TransformNode node = 0; node < hierarchy.size(); node++) {
+        if (std::memcmp(&reference.world(node), &hierarchy.world(node), sizeof(glm::mat4)) != 0) {
+            std::fprintf(stderr, "node %u differs from a full serial update\n", node);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const unsigned int seed = argc > 1 ? std::stoul(argv[1]) : 1234;
+    std::mt19937 rng(seed);
+    ThreadPool pool;
+
+    std::printf("%u pool threads\n", pool.size());
+    std::printf("%10s %10s %8s %12s %12s %8s %12s %12s %10s\n", "shape", "nodes", "roots", "serial ms", "pool ms",
+                "speedup", "1% dirty ms", "1% updated", "nodes/us");
+
+    for (const Shape &shape : SHAPES) {
+        for (const size_t count : {100000ul, 1000000ul}) {
+            TransformHierarchy hierarchy;
+            build(hierarchy, shape, count, rng);
+            hierarchy.update();
+
+            size_t roots = 0;
+            for (TransformNode node = 0; node < hierarchy.size(); node++) {
+                roots += hierarchy.parent(node) == TRANSFORM_NONE;
+            }
+
+            // Every node moves every frame, so every update recomputes the whole hierarchy
+            const glm::quat spin = glm::angleAxis(0.01f, glm::vec3(0.0f, 1.0f, 0.0f));
+            double serial_ms = 0.0, pool_ms = 0.0;
+            for (int frame = 0; frame < 2 * FRAMES; frame++) {
+                for (TransformNode node = 0; node < hierarchy.size(); node++) {
+                    Transform local = hierarchy.local(node);
+                    local.rotation = glm::normalize(spin * local.rotation);
+                    hierarchy.set_local(node, local);
+                }
+                const bool parallel = frame % 2 == 1;
+                const TransformUpdateStats stats = hierarchy.update(parallel ? &pool : nullptr);
+                (parallel ? pool_ms : serial_ms) += stats.ms;
+                if (stats.updated != count) {
+                    std::fprintf(stderr, "%s, %zu nodes: full update recomputed %zu\n", shape.name, count,
+                                 stats.updated);
+                    return EXIT_FAILURE;
+                }
+            }
+            if (!matches_reference(hierarchy)) {
+                return EXIT_FAILURE;
+            }
+
+            // A few scattered nodes move, dragging their subtrees along
+            double dirty_ms = 0.0;
+            size_t dirty_updated = 0;
+            std::uniform_int_distribution<TransformNode> pick(0, count - 1);
+            for (int frame = 0; frame < FRAMES; frame++) {
+                for (size_t i = 0; i < count / DIRTY_DIVISOR; i++) {
+                    hierarchy.set_local(pick(rng), random_transform(rng));
+                }
+                const TransformUpdateStats stats = hierarchy.update(&pool);
+                dirty_ms += stats.ms;
+                dirty_updated += stats.updated;
+            }
+            if (!matches_reference(hierarchy)) {
+                return EXIT_FAILURE;
+            }
+
+            std::printf("%10s %10zu %8zu %12.3f %12.3f %7.1fx %12.3f %12zu %10.1f\n", shape.name, count, roots,
+                        serial_ms / FRAMES, pool_ms / FRAMES, serial_ms / pool_ms, dirty_ms / FRAMES,
+                        dirty_updated / FRAMES, count / (serial_ms / FRAMES * 1000.0));
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,25 @@
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+// The harness the CPU-only check_* tools share: expect() prints each failed condition as it happens, and main returns
+// report_checks(), which prints the tally and turns it into the exit code CTest looks at.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+inline int check_failures = 0;
+
+inline void expect(bool condition, const std::string &what, const char *detail) {
+    if (!condition) {
+        std::printf("  FAIL %s: %s\n", what.c_str(), detail);
+        check_failures++;
+    }
+}
+
+inline int report_checks() {
+    std::printf(check_failures ? "%d failures\n" : "all checks passed\n", check_failures);
+    return check_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,124 @@
+// CPU-only checks for the dynamic resolution controller: drives it with a simulated GPU whose frame time is a fixed
+// cost plus a per-pixel one, reported a few frames late like GpuTimer's, and verifies that it settles under the
+// target without oscillating, stays at full resolution when there's headroom, bottoms out at min_scale when even that
+// is too slow, climbs back once the load drops, ignores timings drawn at an old scale and only ever picks a handful of
+// sizes. Exits non-zero on any failure.
+//
+// usage: CheckDynamicResolution
+
+#include "check.hpp"
+#include "dynamic_resolution.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <set>
+#include <string>
+#include <utility>
+
+namespace {
+
+// Timings arrive this many frames after the frame is drawn
+constexpr unsigned int LATENCY = 3;
+const glm::ivec2 OUTPUT(1920, 1080);
+
+struct Simulation {
+    DynamicResolution controller;
+    // GPU time of a frame at full resolution: fixed_ms + pixel_ms
+    double fixed_ms = 2.0;
+    double pixel_ms = 10.0;
+    uint64_t frame = 0;
+    std::deque<std::pair<uint64_t, double>> in_flight;
+    std::set<std::pair<int, int>> sizes;
+
+    double frame_ms(float scale) const { return fixed_ms + pixel_ms * scale * scale; }
+
+    // Returns the number of scale changes
+    unsigned int run(unsigned int frames) {
+        unsigned int changes = 0;
+        for (unsigned int i = 0; i < frames; i++, frame++) {
+            const glm::ivec2 size = controller.render_size(OUTPUT);
+            sizes.insert({size.x, size.y});
+            in_flight.push_back({frame, frame_ms(controller.scale())});
+            while (in_flight.size() > LATENCY) {
+                const auto [drawn, ms] = in_flight.front();
+                in_flight.pop_front();
+                changes += controller.update(drawn, ms, frame + 1);
+            }
+        }
+        return changes;
+    }
+};
+
+void check_settles() {
+    Simulation sim;
+    sim.pixel_ms = 25.0;
+    sim.run(300);
+    const unsigned int late_changes = sim.run(300);
+    const float scale = sim.controller.scale();
+    expect(sim.frame_ms(scale) <= sim.controller.target_ms, "heavy load", "settled over the target");
+    expect(sim.frame_ms(scale + sim.controller.step) > sim.controller.target_ms * sim.controller.raise_below,
+           "heavy load", "settled more than a step below what fits");
+    expect(late_changes == 0, "heavy load", "still changing scale after settling");
+    expect(sim.controller.stats().changes <= 4, "heavy load", "took too many steps to settle");
+    std::printf("heavy load: scale %.2f, %.2f ms, %llu changes\n", scale, sim.frame_ms(scale),
+                static_cast<unsigned long long>(sim.controller.stats().changes));
+}
+
+void check_headroom() {
+    Simulation sim;
+    sim.pixel_ms = 6.0;
+    sim.run(300);
+    expect(sim.controller.scale() == sim.controller.max_scale, "light load", "dropped below full resolution");
+    expect(sim.controller.stats().changes == 0, "light load", "changed scale");
+}
+
+void check_bounds() {
+    Simulation sim;
+    sim.pixel_ms = 200.0;
+    sim.run(300);
+    expect(sim.controller.scale() == sim.controller.min_scale, "overload", "didn't stop at min_scale");
+
+    // The load goes away: back up to full resolution, and no further
+    sim.pixel_ms = 5.0;
+    sim.run(300);
+    expect(sim.controller.scale() == sim.controller.max_scale, "recovery", "didn't climb back to full resolution");
+
+    const float steps = (sim.controller.max_scale - sim.controller.min_scale) / sim.controller.step;
+    expect(sim.sizes.size() <= static_cast<size_t>(std::lround(steps)) + 1, "overload", "more sizes than steps");
+}
+
+void check_stale_timings() {
+    DynamicResolution controller;
+    controller.settle_frames = 1;
+    expect(controller.update(0, 40.0, 10), "stale timings", "an overloaded frame didn't lower the scale");
+    const float scale = controller.scale();
+    // Frames 1-9 were drawn before the change reached the GPU; however slow, they say nothing about the new scale
+    for (uint64_t frame = 1; frame < 10; frame++) {
+        expect(!controller.update(frame, 40.0, 11), "stale timings", "a frame drawn at the old scale counted");
+    }
+    expect(controller.scale() == scale && controller.stats().samples == 0, "stale timings", "average not restarted");
+}
+
+void check_disabled() {
+    DynamicResolution controller;
+    controller.settle_frames = 1;
+    controller.update(0, 40.0, 1);
+    controller.enabled = false;
+    controller.update(1, 40.0, 2);
+    expect(controller.scale() == controller.max_scale, "disabled", "didn't return to max_scale");
+    expect(controller.render_size(OUTPUT) == OUTPUT, "disabled", "render size isn't the output size");
+}
+
+} // namespace
+
+int main() {
+    check_settles();
+    check_headroom();
+    check_bounds();
+    check_stale_timings();
+    check_disabled();
+
+    return report_checks();
+}
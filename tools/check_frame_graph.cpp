@@ -0,0 +1,255 @@
+// CPU-only checks for the frame graph's compile step, which touches no GL: declares frames shaped like the renderer's
+// (G-buffer, lighting, transparency, post chain) and verifies that passes nothing leads from are culled, that the
+// order keeps every read after its write and every overwrite after the reads of what it overwrites (or the writes it
+// keeps), that transients of the same size and format share a texture exactly when their lifetimes don't overlap,
+// which attachments get invalidated, the memory stats, and that bad declarations and reads of unwritten transients
+// throw. Exits non-zero on any failure.
+//
+// usage: CheckFrameGraph
+
+#include "check.hpp"
+#include "frame_graph.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const glm::ivec2 FULL(1280, 720);
+const glm::ivec2 HALF(640, 360);
+
+FramePass pass(const std::string &name, std::vector<FrameResource> reads, std::vector<FrameResource> writes,
+               bool clear = false) {
+    FramePass pass;
+    pass.name = name;
+    pass.reads = std::move(reads);
+    pass.writes = std::move(writes);
+    pass.clear = clear;
+    return pass;
+}
+
+size_t position(const FrameGraph &graph, unsigned int pass) {
+    const auto &order = graph.order();
+    return std::find(order.begin(), order.end(), pass) - order.begin();
+}
+
+bool contains(const std::vector<FrameResource> &resources, FrameResource resource) {
+    return std::find(resources.begin(), resources.end(), resource) != resources.end();
+}
+
+bool throws(const std::function<void()> &declare) {
+    try {
+        declare();
+    } catch (const std::runtime_error &) {
+        return true;
+    }
+    return false;
+}
+
+// The deferred renderer followed by bloom: G-buffer -> lighting -> forward -> bright pass -> two blurs -> composite
+void check_deferred_frame() {
+    const std::string what = "deferred frame";
+    FrameGraph graph;
+    const FrameResource backbuffer = graph.import_framebuffer("backbuffer", 0, FULL);
+    const FrameResource color = graph.create("scene color", FULL, GL_RGBA8);
+    const FrameResource depth = graph.create("scene depth", FULL, GL_DEPTH24_STENCIL8);
+    const FrameResource albedo = graph.create("albedo", FULL, GL_RGBA8);
+    const FrameResource normal = graph.create("normal", FULL, GL_RGB10_A2);
+    const FrameResource gbuffer_depth = graph.create("G-buffer depth", FULL, GL_DEPTH24_STENCIL8);
+    const FrameResource bright = graph.create("bright", HALF, GL_RGBA8);
+    const FrameResource blur_x = graph.create("blur x", HALF, GL_RGBA8);
+    const FrameResource blur_y = graph.create("blur y", HALF, GL_RGBA8);
+    const FrameResource debug = graph.create("debug view", FULL, GL_RGBA8);
+
+    const unsigned int gbuffer = graph.add_pass(pass("G-buffer", {}, {albedo, normal, gbuffer_depth}, true));
+    const unsigned int lighting =
+        graph.add_pass(pass("lighting", {albedo, normal, gbuffer_depth}, {color, depth}, true));
+    const unsigned int forward = graph.add_pass(pass("forward", {}, {color, depth}));
+    // Nothing reads it
+    const unsigned int unused = graph.add_pass(pass("debug view", {normal}, {debug}, true));
+    const unsigned int bright_pass = graph.add_pass(pass("bright", {color}, {bright}));
+    const unsigned int blur_x_pass = graph.add_pass(pass("blur x", {bright}, {blur_x}));
+    const unsigned int blur_y_pass = graph.add_pass(pass("blur y", {blur_x}, {blur_y}));
+    const unsigned int composite = graph.add_pass(pass("composite", {color, blur_y}, {backbuffer}));
+    graph.compile();
+
+    expect(graph.culled(unused), what, "the unused pass wasn't culled");
+    expect(graph.order().size() == 7, what, "wrong number of passes scheduled");
+    expect(position(graph, gbuffer) < position(graph, lighting), what, "lighting before the G-buffer");
+    expect(position(graph, lighting) < position(graph, forward), what, "forward before lighting");
+    expect(position(graph, forward) < position(graph, bright_pass), what, "bright pass before forward");
+    expect(position(graph, bright_pass) < position(graph, blur_x_pass) &&
+               position(graph, blur_x_pass) < position(graph, blur_y_pass) &&
+               position(graph, blur_y_pass) < position(graph, composite),
+           what, "blur chain out of order");
+    expect(graph.order().back() == composite, what, "the backbuffer pass isn't last");
+
+    // The lighting pass reads the G-buffer while writing the scene, so neither can take the other's texture; the blur
+    // targets ping-pong, blur y reusing the bright pass's
+    expect(graph.slot(color) != graph.slot(albedo), what, "overlapping transients share a texture");
+    expect(graph.slot(depth) != graph.slot(gbuffer_depth), what, "overlapping depth buffers share a texture");
+    expect(graph.slot(bright) != graph.slot(blur_x), what, "blur x shares its input's texture");
+    expect(graph.slot(blur_y) == graph.slot(bright), what, "blur y didn't reuse the bright pass's texture");
+
+    // Nothing clears the blur targets, and the scene depth is dead after forward
+    expect(contains(graph.invalidated_before(bright_pass), bright), what, "bright target not invalidated before");
+    expect(graph.invalidated_before(lighting).empty(), what, "a cleared pass invalidates before");
+    expect(contains(graph.invalidated_after(forward), depth), what, "scene depth not invalidated after forward");
+    expect(!contains(graph.invalidated_after(forward), color), what, "scene colour invalidated while still read");
+    expect(graph.invalidated_after(composite).empty(), what, "the imported framebuffer was invalidated");
+
+    const FrameGraphStats &stats = graph.stats();
+    const size_t full = size_t(FULL.x) * FULL.y * 4, half = size_t(HALF.x) * HALF.y * 4;
+    expect(stats.passes == 8 && stats.culled == 1, what, "pass counts");
+    expect(stats.transients == 8, what, "transient count");
+    expect(stats.textures == 7, what, "texture count");
+    expect(stats.unaliased_bytes == 5 * full + 3 * half, what, "unaliased bytes");
+    expect(stats.transient_bytes == 5 * full + 2 * half, what, "transient bytes");
+    std::printf("deferred frame: %u of %u passes, %u transients in %u textures, %.1f of %.1f MB\n",
+                stats.passes - stats.culled, stats.passes, stats.transients, stats.textures,
+                stats.transient_bytes / (1024.0 * 1024.0), stats.unaliased_bytes / (1024.0 * 1024.0));
+}
+
+// Transients with disjoint lifetimes share one texture; a different format or size never does
+void check_aliasing() {
+    const std::string what = "aliasing";
+    FrameGraph graph;
+    const FrameResource output = graph.import_framebuffer("output", 0, FULL);
+    FrameResource previous = graph.create("chain 0", FULL, GL_RGBA16F);
+    graph.add_pass(pass("chain 0", {}, {previous}, true));
+    std::vector<FrameResource> chain = {previous};
+    for (int i = 1; i < 6; i++) {
+        const FrameResource next = graph.create("chain " + std::to_string(i), FULL, GL_RGBA16F);
+        graph.add_pass(pass("chain " + std::to_string(i), {previous}, {next}));
+        chain.push_back(previous = next);
+    }
+    const FrameResource other_format = graph.create("other format", FULL, GL_RGBA8);
+    const FrameResource other_size = graph.create("other size", HALF, GL_RGBA16F);
+    graph.add_pass(pass("other format", {previous}, {other_format}));
+    graph.add_pass(pass("other size", {other_format}, {other_size}));
+    graph.add_pass(pass("output", {other_size}, {output}));
+    graph.compile();
+
+    // A chain ping-pongs between two textures
+    for (size_t i = 2; i < chain.size(); i++) {
+        expect(graph.slot(chain[i]) == graph.slot(chain[i - 2]), what, "a chain link didn't reuse a texture");
+        expect(graph.slot(chain[i]) != graph.slot(chain[i - 1]), what, "a link shares its input's texture");
+    }
+    expect(graph.slot(other_format) != graph.slot(chain[4]) && graph.slot(other_format) != graph.slot(chain[5]), what,
+           "different formats share a texture");
+    expect(graph.slot(other_size) != graph.slot(chain[4]), what, "different sizes share a texture");
+    expect(graph.stats().textures == 4, what, "texture count");
+}
+
+// A pass that keeps what's there needs the previous writer; one that clears only runs after the previous readers
+void check_overwrites() {
+    const std::string what = "overwrites";
+    FrameGraph graph;
+    const FrameResource output = graph.import_framebuffer("output", 0, FULL);
+    const FrameResource target = graph.create("target", FULL, GL_RGBA8);
+    const FrameResource copy = graph.create("copy", FULL, GL_RGBA8);
+    const unsigned int first = graph.add_pass(pass("first", {}, {target}, true));
+    const unsigned int discarded = graph.add_pass(pass("discarded", {}, {target}));
+    const unsigned int reader = graph.add_pass(pass("reader", {target}, {copy}, true));
+    // Overwrites what reader read, clearing: reader must still see the old contents
+    const unsigned int second = graph.add_pass(pass("second", {copy}, {target}, true));
+    const unsigned int present = graph.add_pass(pass("present", {target}, {output}));
+    graph.compile();
+
+    expect(!graph.culled(first) && !graph.culled(discarded), what, "a pass drawn over without a clear was culled");
+    expect(position(graph, first) < position(graph, discarded), what, "draws over a target out of order");
+    expect(position(graph, reader) < position(graph, second), what, "cleared before its previous reader ran");
+    expect(position(graph, second) < position(graph, present), what, "present before its input");
+    expect(graph.stats().textures == 2, what, "target and copy should be the only textures");
+
+    // Without the reader, the clearing pass makes everything before it dead
+    FrameGraph cleared;
+    const FrameResource cleared_output = cleared.import_framebuffer("output", 0, FULL);
+    const FrameResource cleared_target = cleared.create("target", FULL, GL_RGBA8);
+    const unsigned int dead = cleared.add_pass(pass("dead", {}, {cleared_target}, true));
+    cleared.add_pass(pass("clear", {}, {cleared_target}, true));
+    cleared.add_pass(pass("present", {cleared_target}, {cleared_output}));
+    cleared.compile();
+    expect(cleared.culled(dead), what, "a pass whose output was cleared before use wasn't culled");
+}
+
+// A pass clearing its colour but testing against the depth an earlier pass drew (transparency accumulation)
+void check_kept_depth() {
+    const std::string what = "kept depth";
+    FrameGraph graph;
+    const FrameResource output = graph.import_framebuffer("output", 0, FULL);
+    const FrameResource color = graph.create("color", FULL, GL_RGBA8);
+    const FrameResource depth = graph.create("depth", FULL, GL_DEPTH24_STENCIL8);
+    const FrameResource accum = graph.create("accumulation", FULL, GL_RGBA16F);
+    const unsigned int opaque = graph.add_pass(pass("opaque", {}, {color, depth}, true));
+    FramePass accumulate = pass("accumulate", {}, {accum, depth}, true);
+    accumulate.clear_depth = false;
+    const unsigned int accumulation = graph.add_pass(std::move(accumulate));
+    const unsigned int composite = graph.add_pass(pass("composite", {accum}, {color}));
+    graph.add_pass(pass("present", {color}, {output}));
+    graph.compile();
+
+    expect(!graph.culled(opaque) && position(graph, opaque) < position(graph, accumulation), what,
+           "the depth's writer doesn't run before the pass testing against it");
+    expect(position(graph, accumulation) < position(graph, composite), what, "composite before accumulation");
+    expect(graph.invalidated_before(accumulation).empty(), what, "a cleared or kept attachment was invalidated");
+    expect(contains(graph.invalidated_after(accumulation), depth), what, "depth not invalidated after its last use");
+
+    // Nothing else keeps a depth prepass alive
+    FrameGraph prepass_graph;
+    const FrameResource prepass_output = prepass_graph.import_framebuffer("output", 0, FULL);
+    const FrameResource prepass_depth = prepass_graph.create("depth", FULL, GL_DEPTH_COMPONENT24);
+    const FrameResource prepass_accum = prepass_graph.create("accumulation", FULL, GL_RGBA16F);
+    const unsigned int prepass = prepass_graph.add_pass(pass("depth prepass", {}, {prepass_depth}, true));
+    FramePass tested = pass("accumulate", {}, {prepass_accum, prepass_depth}, true);
+    tested.clear_depth = false;
+    prepass_graph.add_pass(std::move(tested));
+    prepass_graph.add_pass(pass("present", {prepass_accum}, {prepass_output}));
+    prepass_graph.compile();
+    expect(!prepass_graph.culled(prepass), what, "the depth prepass was culled");
+}
+
+void check_declarations() {
+    const std::string what = "declarations";
+    FrameGraph graph;
+    const FrameResource output = graph.import_framebuffer("output", 0, FULL);
+    const FrameResource color = graph.create("color", FULL, GL_RGBA8);
+    const FrameResource half = graph.create("half", HALF, GL_RGBA8);
+    const FrameResource depth = graph.create("depth", FULL, GL_DEPTH24_STENCIL8);
+    const FrameResource depth2 = graph.create("depth 2", FULL, GL_DEPTH_COMPONENT32F);
+
+    expect(throws([&] { graph.add_pass(pass("unknown", {}, {99})); }), what, "unknown resource accepted");
+    expect(throws([&] { graph.add_pass(pass("feedback", {color}, {color})); }), what, "read/write of one accepted");
+    expect(throws([&] { graph.add_pass(pass("sizes", {}, {color, half})); }), what, "mixed sizes accepted");
+    expect(throws([&] { graph.add_pass(pass("depths", {}, {color, depth, depth2})); }), what, "two depths accepted");
+    expect(throws([&] { graph.add_pass(pass("imported", {}, {output, depth})); }), what,
+           "imported framebuffer with other writes accepted");
+    expect(throws([&] { graph.add_pass(pass("sample", {output}, {color})); }), what, "sampled backbuffer accepted");
+    expect(throws([&] { graph.add_pass(pass("twice", {}, {color, color})); }), what, "duplicate write accepted");
+
+    graph.add_pass(pass("uninitialised", {half}, {output}));
+    expect(throws([&] { graph.compile(); }), what, "a read of a transient nothing wrote compiled");
+
+    // Nothing above touched the pool, so destroying the graph makes no GL calls
+    graph.reset();
+    graph.compile();
+    expect(graph.order().empty() && graph.stats().allocations == 0, what, "reset didn't empty the frame");
+}
+
+} // namespace
+
+int main() {
+    check_deferred_frame();
+    check_aliasing();
+    check_overwrites();
+    check_kept_depth();
+    check_declarations();
+
+    return report_checks();
+}
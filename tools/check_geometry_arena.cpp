@@ -0,0 +1,145 @@
+// CPU-only checks for the free lists behind GeometryArena, which touch no GL: loads and unloads models made of random
+// mesh-sized vertex and index ranges over and over, the way streaming and dropping models does, and verifies that
+// the space freed by one model is reused by the next rather than needing a grow, and that once everything is
+// released the free ranges have merged back into one. Also checks merging in each direction and growing. Exits
+// non-zero on any failure.
+//
+// usage: CheckGeometryArena
+
+#include "check.hpp"
+#include "geometry_arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Same sizes as GeometryArena::shared() starts with
+constexpr uint32_t VERTEX_CAPACITY = 1 << 16;
+constexpr uint32_t INDEX_CAPACITY = 1 << 18;
+constexpr unsigned int CYCLES = 1000;
+// Models alive at once; together they never need more than half of either capacity
+constexpr unsigned int RESIDENT = 3;
+
+struct Range {
+    uint32_t offset;
+    uint32_t count;
+};
+
+struct LoadedModel {
+    std::vector<Range> vertices, indices;
+};
+
+class Arena {
+  public:
+    RangeAllocator vertices{VERTEX_CAPACITY};
+    RangeAllocator indices{INDEX_CAPACITY};
+    // Allocations that found no room, which GeometryArena would have grown for
+    unsigned int misses = 0;
+
+    LoadedModel load(std::mt19937 &rng) {
+        // Up to 8 meshes of up to 1300 vertices with 3 indices each: at most 10400 vertices and 31200 indices
+        std::uniform_int_distribution<uint32_t> mesh_count(1, 8), vertex_count(24, 1300);
+        LoadedModel model;
+        for (uint32_t i = mesh_count(rng); i > 0; i--) {
+            const uint32_t count = vertex_count(rng);
+            model.vertices.push_back(allocate(vertices, count));
+            model.indices.push_back(allocate(indices, count * 3));
+        }
+        return model;
+    }
+
+    void unload(const LoadedModel &model) {
+        for (const Range &range : model.vertices) {
+            vertices.release(range.offset, range.count);
+        }
+        for (const Range &range : model.indices) {
+            indices.release(range.offset, range.count);
+        }
+    }
+
+  private:
+    Range allocate(RangeAllocator &allocator, uint32_t count) {
+        const auto offset = allocator.allocate(count);
+        misses += !offset;
+        return {offset.value_or(0), offset ? count : 0};
+    }
+};
+
+void check_load_unload_cycles() {
+    const std::string what = "load/unload cycles";
+    std::mt19937 rng(1);
+    Arena arena;
+    std::vector<LoadedModel> resident;
+    uint32_t peak_vertices = 0, peak_indices = 0;
+
+    for (unsigned int cycle = 0; cycle < CYCLES; cycle++) {
+        if (resident.size() == RESIDENT) {
+            // Drop a random one so the holes land all over the ranges
+            const size_t victim = std::uniform_int_distribution<size_t>(0, resident.size() - 1)(rng);
+            arena.unload(resident[victim]);
+            resident.erase(resident.begin() + victim);
+        }
+        resident.push_back(arena.load(rng));
+        peak_vertices = std::max(peak_vertices, arena.vertices.used());
+        peak_indices = std::max(peak_indices, arena.indices.used());
+    }
+
+    expect(arena.misses == 0, what, "an allocation found no room in space the unloaded models gave back");
+    expect(arena.vertices.capacity() == VERTEX_CAPACITY && arena.indices.capacity() == INDEX_CAPACITY, what,
+           "the ranges grew");
+
+    for (const LoadedModel &model : resident) {
+        arena.unload(model);
+    }
+    expect(arena.vertices.used() == 0 && arena.indices.used() == 0, what, "space still in use after unloading all");
+    // Everything merged back into one free range, so the whole capacity fits again
+    expect(arena.vertices.allocate(VERTEX_CAPACITY) == 0u, what, "freed vertex ranges didn't merge back into one");
+    expect(arena.indices.allocate(INDEX_CAPACITY) == 0u, what, "freed index ranges didn't merge back into one");
+
+    std::printf("%u load/unload cycles: peak %u/%u vertices, %u/%u indices\n", CYCLES, peak_vertices,
+                VERTEX_CAPACITY, peak_indices, INDEX_CAPACITY);
+}
+
+void check_merging() {
+    const std::string what = "merging";
+    RangeAllocator allocator(300);
+    const auto a = allocator.allocate(100), b = allocator.allocate(100), c = allocator.allocate(100);
+    expect(a == 0u && b == 100u && c == 200u, what, "first fit didn't pack the ranges in order");
+    expect(!allocator.allocate(1), what, "allocated past the capacity");
+
+    // a merges with b, freed just before it, then c with the [0, 200) freed before it
+    allocator.release(100, 100);
+    allocator.release(0, 100);
+    expect(allocator.allocate(200) == 0u, what, "a range didn't merge with the free range after it");
+    allocator.release(0, 200);
+    allocator.release(200, 100);
+    expect(allocator.allocate(300) == 0u, what, "a range didn't merge with the free range before it");
+    expect(allocator.used() == 300, what, "used() is off");
+}
+
+void check_grow() {
+    const std::string what = "grow";
+    RangeAllocator allocator(100);
+    const auto a = allocator.allocate(60);
+    allocator.grow(200);
+    expect(allocator.capacity() == 200 && allocator.used() == 60, what, "capacity or used() is off after growing");
+    // The old free tail [60, 100) and the new one [100, 200) are a single range
+    expect(allocator.allocate(140) == 60u, what, "the new tail didn't merge with the old free tail");
+    expect(a == 0u, what, "the first allocation moved");
+}
+
+} // namespace
+
+int main() {
+    check_load_unload_cycles();
+    check_merging();
+    check_grow();
+
+    return report_checks();
+}
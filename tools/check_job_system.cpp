@@ -0,0 +1,159 @@
+// CPU-only checks for parallel recording: runs JobSystem::parallel_for over a few sizes and grains, with the calling
+// worker held up so the others have to steal, and verifies that the ranges cover every item exactly once and never
+// exceed the grain. Then records a synthetic scene full of sort key ties on the workers, over and over, and verifies
+// that the merged queue issues exactly the packets, in exactly the order, of recording it on one thread. Exits
+// non-zero on any failure.
+//
+// usage: CheckJobSystem
+
+#include "check.hpp"
+#include "job_system.hpp"
+#include "scene.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr unsigned int THREADS = 3;
+constexpr unsigned int RECORD_RUNS = 20;
+
+void check_coverage(JobSystem &jobs, size_t count, size_t grain, size_t &steals) {
+    const std::string what = "parallel_for " + std::to_string(count) + "/" + std::to_string(grain);
+    std::vector<std::atomic<unsigned int>> runs(count);
+    std::atomic<size_t> calls{0};
+    std::atomic<bool> oversized{false}, bad_worker{false};
+
+    jobs.parallel_for(count, grain, [&](size_t begin, size_t end, unsigned int worker) {
+        calls++;
+        if (end - begin > grain || begin >= end || end > count) {
+            oversized = true;
+        }
+        if (worker >= jobs.worker_count()) {
+            bad_worker = true;
+        }
+        // The calling thread dawdles, leaving the ranges it split off to be stolen
+        if (worker == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        for (size_t i = begin; i < end && i < count; i++) {
+            runs[i]++;
+        }
+    });
+
+    size_t missed = 0, repeated = 0;
+    for (const auto &run : runs) {
+        missed += run.load() == 0;
+        repeated += run.load() > 1;
+    }
+    expect(missed == 0, what, "items never ran");
+    expect(repeated == 0, what, "items ran more than once");
+    expect(!oversized, what, "a range was empty, out of bounds or over the grain");
+    expect(!bad_worker, what, "a worker index was out of range");
+    expect(jobs.stats().ranges == calls.load(), what, "stats().ranges doesn't match the calls");
+    steals += jobs.stats().steals;
+}
+
+// Packets share three programs and five VAOs and sit at seven depths, so most sort keys tie with many others. Each
+// packet's model matrix records where it came from: x is the item, y is 1 + the index of a packet queued by submit().
+class TieScene : public Scene {
+  public:
+    explicit TieScene(size_t items) : m_items(items) {
+        // Never destroyed: ~Shader would delete a GL program
+        for (unsigned int i = 0; i < std::size(m_shaders); i++) {
+            m_shaders[i] = new Shader(i + 1, {});
+        }
+    }
+
+    void submit(RenderQueue &queue) override {
+        for (unsigned int i = 0; i < 16; i++) {
+            queue.submit(RenderLayer::OPAQUE, glm::vec3(0.0f, 0.0f, -1.0f), packet(i, 0.0f, float(i + 1)));
+        }
+    }
+
+    size_t parallel_items() const override { return m_items; }
+
+    void submit_items(RenderQueue &queue, size_t begin, size_t end) const override {
+        for (size_t i = begin; i < end; i++) {
+            const RenderLayer layer = i % 4 == 0 ? RenderLayer::TRANSPARENT : RenderLayer::OPAQUE;
+            queue.submit(layer, glm::vec3(0.0f, 0.0f, -float(1 + i % 7)), packet(i, float(i), 0.0f));
+        }
+    }
+
+    CameraPath camera_path() const override { return {}; }
+
+  private:
+    size_t m_items;
+    Shader *m_shaders[3] = {};
+
+    DrawPacket packet(size_t i, float item, float submitted) const {
+        DrawPacket packet;
+        packet.shader = m_shaders[i % std::size(m_shaders)];
+        packet.vao = 1 + i % 5;
+        packet.count = 36;
+        packet.model[3][0] = item;
+        packet.model[3][1] = submitted;
+        return packet;
+    }
+};
+
+std::vector<glm::vec2> record(TieScene &scene, JobSystem *jobs, std::vector<RenderQueue> &worker_queues,
+                              RecordStats &stats) {
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+    RenderQueue queue;
+    queue.begin_frame(view, projection, 100.0f);
+    stats = record_scene(scene, queue, jobs, worker_queues, 64);
+
+    std::vector<glm::vec2> order;
+    for (const DrawPacket *packet : queue.sorted_packets()) {
+        order.push_back(glm::vec2(packet->model[3][0], packet->model[3][1]));
+    }
+    return order;
+}
+
+void check_recording(JobSystem &jobs, size_t items, size_t &steals) {
+    const std::string what = "recording " + std::to_string(items) + " items";
+    TieScene scene(items);
+    std::vector<RenderQueue> worker_queues;
+    RecordStats stats;
+    const std::vector<glm::vec2> serial = record(scene, nullptr, worker_queues, stats);
+    expect(serial.size() == items + 16, what, "serial recording lost packets");
+
+    for (unsigned int run = 0; run < RECORD_RUNS; run++) {
+        const std::vector<glm::vec2> parallel = record(scene, &jobs, worker_queues, stats);
+        steals += stats.steals;
+        expect(stats.items == items, what, "stats count the wrong number of items");
+        expect(parallel.size() == serial.size(), what, "parallel recording queued a different number of packets");
+        expect(parallel == serial, what, "parallel recording sorts differently from serial recording");
+    }
+}
+
+} // namespace
+
+int main() {
+    JobSystem jobs(THREADS);
+    size_t steals = 0;
+    for (size_t count : {1, 7, 64, 65, 1000, 20000}) {
+        for (size_t grain : {1, 16, 256}) {
+            check_coverage(jobs, count, grain, steals);
+        }
+    }
+    expect(steals > 0, "parallel_for", "no range was ever stolen, so stealing went untested");
+
+    steals = 0;
+    for (size_t items : {100, 5000, 20000}) {
+        check_recording(jobs, items, steals);
+    }
+    std::printf("recording: %zu ranges stolen over %u runs per size\n", steals, RECORD_RUNS);
+
+    return report_checks();
+}
@@ -0,0 +1,167 @@
+// CPU-only checks for clustered light binning: bins random lights for a few cameras and verifies that every cluster
+// lists exactly the lights whose sphere touches its bounds (against a plain scalar test), that binning on the thread
+// pool gives the same lists as binning inline, and that a point picked the way the shader picks its cluster (screen
+// tile, log depth slice) finds every light that reaches it. Also checks the index list cap. Exits non-zero on any
+// failure.
+//
+// usage: CheckLightClusters
+
+#include "check.hpp"
+#include "light_clusters.hpp"
+#include "thread_pool.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr float NEAR_PLANE = 0.1f;
+constexpr float FAR_PLANE = 100.0f;
+
+struct Camera {
+    const char *name;
+    glm::vec3 position;
+    glm::vec3 target;
+    float fov_degrees;
+    float aspect;
+};
+
+const Camera CAMERAS[] = {
+    {"level", glm::vec3(0.0f, 2.0f, 20.0f), glm::vec3(0.0f, 2.0f, 0.0f), 45.0f, 16.0f / 9.0f},
+    {"down", glm::vec3(5.0f, 30.0f, 5.0f), glm::vec3(0.0f, 0.0f, 0.0f), 60.0f, 4.0f / 3.0f},
+    {"narrow", glm::vec3(-10.0f, 1.0f, -10.0f), glm::vec3(10.0f, 3.0f, 10.0f), 20.0f, 1.0f},
+};
+
+std::vector<ClusterLight> random_lights(unsigned int count, std::mt19937 &rng) {
+    std::uniform_real_distribution<float> position(-40.0f, 40.0f), radius(0.2f, 10.0f), unit(0.0f, 1.0f);
+    std::vector<ClusterLight> lights;
+    for (unsigned int i = 0; i < count; i++) {
+        const glm::vec3 center(position(rng), position(rng) * 0.25f, position(rng));
+        const glm::vec3 color(unit(rng), unit(rng), unit(rng));
+        lights.push_back(i % 4 == 3 ? ClusterLight::spot(center, glm::vec3(0.0f, -1.0f, 0.0f), radius(rng), color,
+                                                         20.0f, 30.0f)
+                                    : ClusterLight::point(center, radius(rng), color));
+    }
+    return lights;
+}
+
+bool touches(const glm::vec3 &center, float radius, const AABB &box) {
+    const glm::vec3 closest = glm::min(glm::max(center, box.min), box.max);
+    const glm::vec3 d = center - closest;
+    return glm::dot(d, d) <= radius * radius;
+}
+
+std::vector<uint32_t> cluster_lights(const LightBinner &binner, unsigned int cluster) {
+    const uint32_t offset = binner.ranges()[2 * cluster], count = binner.ranges()[2 * cluster + 1];
+    std::vector<uint32_t> lights(binner.indices().begin() + offset, binner.indices().begin() + offset + count);
+    std::sort(lights.begin(), lights.end());
+    return lights;
+}
+
+void check_camera(const Camera &camera, const std::vector<ClusterLight> &lights, std::mt19937 &rng) {
+    const std::string what = std::string(camera.name) + " (" + std::to_string(lights.size()) + " lights)";
+    const glm::mat4 view = glm::lookAt(camera.position, camera.target, glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection = glm::perspective(glm::radians(camera.fov_degrees), camera.aspect, NEAR_PLANE,
+                                                  FAR_PLANE);
+
+    LightBinner serial, parallel;
+    serial.bin(lights, view, projection, NEAR_PLANE, FAR_PLANE, nullptr);
+    parallel.bin(lights, view, projection, NEAR_PLANE, FAR_PLANE, &ThreadPool::shared());
+
+    expect(serial.stats().dropped == 0, what, "dropped references");
+    expect(serial.ranges() == parallel.ranges() && serial.indices() == parallel.indices(), what,
+           "pool and inline binning differ");
+
+    std::vector<glm::vec3> centers;
+    for (const auto &light : lights) {
+        centers.push_back(glm::vec3(view * glm::vec4(light.position, 1.0f)));
+    }
+
+    // Exactly the lights touching each cluster's bounds
+    const ClusterGrid &grid = serial.grid();
+    unsigned int mismatches = 0;
+    for (unsigned int slice = 0; slice < grid.slices; slice++) {
+        for (unsigned int y = 0; y < grid.tiles_y; y++) {
+            for (unsigned int x = 0; x < grid.tiles_x; x++) {
+                const AABB box = serial.cluster_bounds(x, y, slice);
+                std::vector<uint32_t> expected;
+                for (uint32_t i = 0; i < lights.size(); i++) {
+                    if (touches(centers[i], lights[i].radius, box)) {
+                        expected.push_back(i);
+                    }
+                }
+                mismatches += cluster_lights(serial, grid.index(x, y, slice)) != expected;
+            }
+        }
+    }
+    expect(mismatches == 0, what, "cluster lists differ from the scalar sphere/box test");
+
+    // Points inside the frustum find every light reaching them in the cluster the shader would pick
+    std::uniform_real_distribution<float> ndc(-1.0f, 1.0f), unit(0.0f, 1.0f);
+    unsigned int missed = 0;
+    for (int sample = 0; sample < 20000; sample++) {
+        const float nx = ndc(rng), ny = ndc(rng);
+        const float depth = NEAR_PLANE * std::pow(FAR_PLANE / NEAR_PLANE, unit(rng));
+        const glm::vec3 point((nx + projection[2][0]) / projection[0][0] * depth,
+                              (ny + projection[2][1]) / projection[1][1] * depth, -depth);
+
+        const float slice = std::floor(std::log(depth) * serial.slice_scale() + serial.slice_bias());
+        const unsigned int z = static_cast<unsigned int>(std::clamp(slice, 0.0f, grid.slices - 1.0f));
+        const unsigned int x = std::min(static_cast<unsigned int>((nx + 1.0f) * 0.5f * grid.tiles_x), grid.tiles_x - 1);
+        const unsigned int y = std::min(static_cast<unsigned int>((ny + 1.0f) * 0.5f * grid.tiles_y), grid.tiles_y - 1);
+        const std::vector<uint32_t> listed = cluster_lights(serial, grid.index(x, y, z));
+
+        for (uint32_t i = 0; i < lights.size(); i++) {
+            // A hair inside the radius, where the shader's windowed attenuation is still above zero
+            if (glm::length(centers[i] - point) < lights[i].radius * 0.999f &&
+                !std::binary_search(listed.begin(), listed.end(), i)) {
+                missed++;
+            }
+        }
+    }
+    expect(missed == 0, what, "a point's cluster is missing a light that reaches it");
+}
+
+void check_cap() {
+    std::mt19937 rng(7);
+    const std::vector<ClusterLight> lights = random_lights(256, rng);
+    const Camera &camera = CAMERAS[0];
+    const glm::mat4 view = glm::lookAt(camera.position, camera.target, glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection =
+        glm::perspective(glm::radians(camera.fov_degrees), camera.aspect, NEAR_PLANE, FAR_PLANE);
+
+    LightBinner full, capped;
+    full.bin(lights, view, projection, NEAR_PLANE, FAR_PLANE, nullptr);
+    capped.max_references = full.stats().references / 2;
+    capped.bin(lights, view, projection, NEAR_PLANE, FAR_PLANE, nullptr);
+
+    expect(capped.indices().size() == capped.max_references, "cap", "index list not filled to the cap");
+    expect(capped.stats().dropped == full.stats().references - capped.max_references, "cap", "wrong dropped count");
+    bool in_range = true;
+    for (size_t i = 0; i < capped.ranges().size(); i += 2) {
+        in_range = in_range && capped.ranges()[i] + capped.ranges()[i + 1] <= capped.indices().size();
+    }
+    expect(in_range, "cap", "a range runs past the index list");
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(1);
+    for (unsigned int count : {0u, 1u, 4u, 63u, 64u, 300u, 1024u}) {
+        const std::vector<ClusterLight> lights = random_lights(count, rng);
+        for (const auto &camera : CAMERAS) {
+            check_camera(camera, lights, rng);
+        }
+    }
+    check_cap();
+
+    return report_checks();
+}
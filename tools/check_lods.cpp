@@ -0,0 +1,197 @@
+// CPU-only checks for LOD generation and selection: builds LOD chains for synthetic meshes and verifies that each LOD
+// is smaller than the last, stays within its error budget, never stitches across a UV seam and never turns triangles
+// over; then drives LodSelector through screen sizes around a threshold to check the hysteresis. Exits non-zero on
+// any failure.
+//
+// usage: CheckLods
+
+#include "check.hpp"
+#include "lod.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "model_data.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+MeshData make_mesh(const std::string &name, const std::vector<glm::vec3> &positions,
+                   const std::vector<glm::vec3> &normals, const std::vector<glm::vec2> &tex_coords,
+                   std::vector<unsigned int> indices) {
+    MeshData mesh;
+    mesh.name = name;
+    glm::vec3 min = positions.front(), max = positions.front();
+    for (const auto &p : positions) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    mesh.bounds = {min, max};
+    mesh.quantization = VertexQuantization::from_bounds(min, max);
+    for (size_t i = 0; i < positions.size(); i++) {
+        mesh.vertices.push_back(encode_vertex(positions[i], normals[i], tex_coords[i], mesh.quantization));
+    }
+    mesh.indices = std::move(indices);
+    return mesh;
+}
+
+// An indexed n x n quad grid in the xz plane; flat, so everything inside the border collapses at no error
+MeshData make_grid(int n) {
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> tex_coords;
+    for (int z = 0; z <= n; z++) {
+        for (int x = 0; x <= n; x++) {
+            positions.emplace_back(float(x), 0.0f, float(z));
+            normals.emplace_back(0.0f, 1.0f, 0.0f);
+            tex_coords.emplace_back(float(x) / n, float(z) / n);
+        }
+    }
+
+    std::vector<unsigned int> indices;
+    for (int z = 0; z < n; z++) {
+        for (int x = 0; x < n; x++) {
+            const unsigned int a = z * (n + 1) + x, b = a + n + 1;
+            indices.insert(indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+        }
+    }
+    return make_mesh("grid", positions, normals, tex_coords, std::move(indices));
+}
+
+// A UV sphere, wound counter-clockwise seen from outside to match its normals. The first and last columns share
+// positions but not tex coords.
+MeshData make_uv_sphere(int rings, int segments) {
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> tex_coords;
+    for (int r = 0; r <= rings; r++) {
+        for (int s = 0; s <= segments; s++) {
+            const float theta = glm::radians(180.0f) * r / rings;
+            const float phi = glm::radians(360.0f) * (s % segments) / segments;
+            const glm::vec3 n(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            positions.push_back(n);
+            normals.push_back(n);
+            tex_coords.emplace_back(float(s) / segments, float(r) / rings);
+        }
+    }
+
+    std::vector<unsigned int> indices;
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            const unsigned int a = r * (segments + 1) + s, b = a + segments + 1;
+            indices.insert(indices.end(), {a, a + 1, b, a + 1, b + 1, b});
+        }
+    }
+    return make_mesh("uv sphere", positions, normals, tex_coords, std::move(indices));
+}
+
+// `outward(centroid)` is a direction every triangle's face normal must agree with. With `seam`, the mesh wraps around
+// u = 0/1 and no triangle may span the whole u range.
+template <typename Outward> void check_chain(MeshData mesh, Outward outward, bool seam) {
+    optimize_mesh(mesh);
+    generate_lods(mesh);
+
+    std::printf("%-10s", mesh.name.c_str());
+    for (const auto &lod : mesh.lods) {
+        std::printf(" %6u tris (%.3f%%)", lod.index_count / 3, lod.error * 100.0f);
+    }
+    std::printf("\n");
+
+    expect(mesh.lods.size() > 1, mesh.name, "no LODs generated");
+    expect(mesh.lods.size() <= MAX_MESH_LODS, mesh.name, "too many LODs");
+
+    for (size_t l = 0; l < mesh.lods.size(); l++) {
+        const MeshLod &lod = mesh.lods[l];
+        const std::string what = mesh.name + " lod " + std::to_string(l);
+
+        expect(lod.index_count % 3 == 0, what, "partial triangle");
+        expect(lod.first_index + lod.index_count <= mesh.indices.size(), what, "index range past the buffer");
+        expect(lod.error <= LOD_MAX_ERROR[l] + 1e-6f, what, "error over budget");
+        if (l > 0) {
+            expect(lod.index_count < mesh.lods[l - 1].index_count, what, "not smaller than the previous LOD");
+            expect(lod.error >= mesh.lods[l - 1].error, what, "error decreased along the chain");
+        }
+
+        for (uint32_t t = lod.first_index; t + 2 < lod.first_index + lod.index_count; t += 3) {
+            glm::vec3 p[3];
+            glm::vec2 uv[3];
+            for (int k = 0; k < 3; k++) {
+                const unsigned int index = mesh.indices[t + k];
+                if (index >= mesh.vertices.size()) {
+                    expect(false, what, "index out of range");
+                    return;
+                }
+                p[k] = decode_position(mesh.vertices[index], mesh.quantization);
+                uv[k] = decode_tex_coord(mesh.vertices[index]);
+            }
+
+            // A triangle stitched across the seam spans almost the whole u range
+            const float u_span = std::max({uv[0].x, uv[1].x, uv[2].x}) - std::min({uv[0].x, uv[1].x, uv[2].x});
+            if (seam && u_span > 0.5f) {
+                expect(false, what, "triangle crosses the UV seam");
+                return;
+            }
+
+            // The sphere's pole triangles are degenerate, and quantization noise can give them any orientation
+            const glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+            if (glm::length(n) > 1e-5f && glm::dot(n, outward((p[0] + p[1] + p[2]) / 3.0f)) < 0.0f) {
+                expect(false, what, "triangle turned over");
+                return;
+            }
+        }
+    }
+}
+
+void check_selector() {
+    LodSelector selector;
+    const float threshold = LOD_SCREEN_SIZES[1];
+    const float h = selector.hysteresis;
+
+    expect(selector.select(1.0f, 4) == 0, "selector", "large object not at LOD 0");
+    expect(selector.select(0.01f, 4) == 3, "selector", "tiny object not at the coarsest LOD");
+    expect(selector.select(0.01f, 2) == 1, "selector", "pick past the mesh's last LOD");
+    expect(selector.select(0.01f, 1) == 0, "selector", "single-LOD mesh not at LOD 0");
+
+    // Hovering just around the threshold keeps whatever LOD the object already had
+    unsigned int lod = selector.select(threshold * 1.02f, 4);
+    expect(lod == 0, "selector", "just above the threshold isn't LOD 0");
+    for (int i = 0; i < 10; i++) {
+        const float size = threshold * (i % 2 ? 0.98f : 1.02f);
+        lod = selector.select(size, 4, lod);
+        expect(lod == 0, "hysteresis", "flickered to LOD 1 near the threshold");
+    }
+
+    // Crossing it by more than the margin switches, and coming back needs the margin again
+    lod = selector.select(threshold * (1.0f - 2.0f * h), 4, lod);
+    expect(lod == 1, "hysteresis", "didn't switch to LOD 1 well below the threshold");
+    lod = selector.select(threshold * 1.02f, 4, lod);
+    expect(lod == 1, "hysteresis", "switched back to LOD 0 just above the threshold");
+    lod = selector.select(threshold * (1.0f + 2.0f * h), 4, lod);
+    expect(lod == 0, "hysteresis", "didn't switch back to LOD 0 well above the threshold");
+
+    // Screen size follows the projection: twice the distance, half the size
+    Camera camera(glm::vec3(0.0f));
+    camera.m_zoom = 90.0f;
+    selector.set_camera(camera);
+    const float near_size = selector.screen_size(glm::vec3(0.0f, 0.0f, -10.0f), 1.0f);
+    const float far_size = selector.screen_size(glm::vec3(0.0f, 0.0f, -20.0f), 1.0f);
+    expect(std::abs(near_size - 0.1f) < 1e-4f, "selector", "wrong screen size for a 90 degree fov");
+    expect(std::abs(near_size - 2.0f * far_size) < 1e-4f, "selector", "screen size not inversely proportional");
+
+    selector.enabled = false;
+    expect(selector.select(0.01f, 4, 3) == 0, "selector", "disabled selector didn't pick LOD 0");
+}
+
+} // namespace
+
+int main() {
+    std::printf("vertex format %s\n", vertex_format_name());
+
+    check_chain(make_grid(64), [](glm::vec3) { return glm::vec3(0.0f, 1.0f, 0.0f); }, false);
+    check_chain(make_uv_sphere(48, 64), [](glm::vec3 centroid) { return centroid; }, true);
+    check_selector();
+
+    return report_checks();
+}
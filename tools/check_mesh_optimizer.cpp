@@ -0,0 +1,207 @@
+// CPU-only checks for the import-time mesh optimizer: runs every pass over synthetic meshes and verifies that the
+// triangle set (with winding) survives, indices stay in range, welding only merges byte-identical vertices, and cache
+// efficiency doesn't get worse. Exits non-zero on any failure.
+//
+// usage: CheckMeshOptimizer [seed]
+
+#include "check.hpp"
+#include "mesh_optimizer.hpp"
+#include "model_data.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using TriangleKey = std::array<std::string, 3>;
+
+std::string vertex_bytes(const Vertex &v) { return std::string(reinterpret_cast<const char *>(&v), sizeof(Vertex)); }
+
+// Triangles by vertex content, rotated so the smallest vertex comes first; rotation keeps the winding
+std::vector<TriangleKey> triangle_set(const MeshData &mesh) {
+    std::vector<TriangleKey> triangles;
+    for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+        TriangleKey key = {vertex_bytes(mesh.vertices[mesh.indices[t]]),
+                           vertex_bytes(mesh.vertices[mesh.indices[t + 1]]),
+                           vertex_bytes(mesh.vertices[mesh.indices[t + 2]])};
+        std::rotate(key.begin(), std::min_element(key.begin(), key.end()), key.end());
+        triangles.push_back(std::move(key));
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+size_t unique_vertex_count(const MeshData &mesh) {
+    std::vector<std::string> vertices;
+    for (unsigned int index : mesh.indices) {
+        vertices.push_back(vertex_bytes(mesh.vertices[index]));
+    }
+    std::sort(vertices.begin(), vertices.end());
+    return std::unique(vertices.begin(), vertices.end()) - vertices.begin();
+}
+
+MeshData make_mesh(const std::string &name, const std::vector<glm::vec3> &positions,
+                   const std::vector<glm::vec3> &normals, const std::vector<glm::vec2> &tex_coords,
+                   std::vector<unsigned int> indices) {
+    MeshData mesh;
+    mesh.name = name;
+    glm::vec3 min = positions.front(), max = positions.front();
+    for (const auto &p : positions) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    mesh.bounds = {min, max};
+    mesh.quantization = VertexQuantization::from_bounds(min, max);
+    for (size_t i = 0; i < positions.size(); i++) {
+        mesh.vertices.push_back(encode_vertex(positions[i], normals[i], tex_coords[i], mesh.quantization));
+    }
+    mesh.indices = std::move(indices);
+    return mesh;
+}
+
+// An n x n quad grid written as an unindexed triangle soup, the way a naive exporter would
+MeshData make_grid_soup(int n) {
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> tex_coords;
+    std::vector<unsigned int> indices;
+    const auto corner = [&](int x, int z) {
+        positions.emplace_back(float(x), 0.0f, float(z));
+        normals.emplace_back(0.0f, 1.0f, 0.0f);
+        tex_coords.emplace_back(float(x) / n, float(z) / n);
+        indices.push_back(static_cast<unsigned int>(indices.size()));
+    };
+    for (int z = 0; z < n; z++) {
+        for (int x = 0; x < n; x++) {
+            corner(x, z), corner(x, z + 1), corner(x + 1, z);
+            corner(x + 1, z), corner(x, z + 1), corner(x + 1, z + 1);
+        }
+    }
+    return make_mesh("grid soup", positions, normals, tex_coords, std::move(indices));
+}
+
+// A UV sphere with a texture seam: the first and last columns share positions but not tex coords, and the poles are
+// split per column, so welding must leave those vertices alone
+MeshData make_uv_sphere(int rings, int segments) {
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> tex_coords;
+    for (int r = 0; r <= rings; r++) {
+        for (int s = 0; s <= segments; s++) {
+            const float theta = glm::radians(180.0f) * r / rings;
+            const float phi = glm::radians(360.0f) * (s % segments) / segments;
+            const glm::vec3 n(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            positions.push_back(n);
+            normals.push_back(n);
+            tex_coords.emplace_back(float(s) / segments, float(r) / rings);
+        }
+    }
+
+    std::vector<unsigned int> indices;
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            const unsigned int a = r * (segments + 1) + s, b = a + segments + 1;
+            indices.insert(indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+        }
+    }
+    return make_mesh("uv sphere", positions, normals, tex_coords, std::move(indices));
+}
+
+// Random triangles over a shared vertex pool, in random order
+MeshData make_random_soup(std::mt19937 &rng, size_t vertex_count, size_t triangle_count) {
+    std::uniform_real_distribution<float> coord(-1.0f, 1.0f);
+    std::uniform_int_distribution<unsigned int> vertex(0, vertex_count - 1);
+
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> tex_coords;
+    for (size_t i = 0; i < vertex_count; i++) {
+        positions.emplace_back(coord(rng), coord(rng), coord(rng));
+        normals.push_back(glm::normalize(glm::vec3(coord(rng), coord(rng), coord(rng)) + glm::vec3(0.0f, 3.0f, 0.0f)));
+        tex_coords.emplace_back(coord(rng), coord(rng));
+    }
+
+    std::vector<unsigned int> indices;
+    for (size_t t = 0; t < triangle_count; t++) {
+        unsigned int a = vertex(rng), b = vertex(rng), c = vertex(rng);
+        while (b == a) {
+            b = vertex(rng);
+        }
+        while (c == a || c == b) {
+            c = vertex(rng);
+        }
+        indices.insert(indices.end(), {a, b, c});
+    }
+    return make_mesh("random soup", positions, normals, tex_coords, std::move(indices));
+}
+
+void check(MeshData mesh, bool expect_better_cache) {
+    const std::vector<TriangleKey> before = triangle_set(mesh);
+    const size_t unique_before = unique_vertex_count(mesh);
+    const MeshOptimizationStats stats = optimize_mesh(mesh);
+
+    std::printf("%-12s %6zu -> %6zu vertices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, overfetch %.2f -> %.2f\n",
+                mesh.name.c_str(), stats.vertices_before, stats.vertices_after, stats.cache_before.acmr,
+                stats.cache_after.acmr, stats.cache_before.atvr, stats.cache_after.atvr, stats.overfetch_before,
+                stats.overfetch_after);
+
+    expect(mesh.indices.size() == before.size() * 3, mesh.name, "index count changed");
+    expect(std::all_of(mesh.indices.begin(), mesh.indices.end(),
+                       [&](unsigned int i) { return i < mesh.vertices.size(); }),
+           mesh.name, "index out of range");
+    expect(triangle_set(mesh) == before, mesh.name, "triangle set or winding changed");
+    expect(mesh.vertices.size() == unique_before, mesh.name, "welding didn't produce exactly the unique vertices");
+
+    // Fetch order: vertex i is first referenced before vertex i + 1
+    unsigned int next = 0;
+    bool fetch_ordered = true;
+    for (unsigned int i : mesh.indices) {
+        if (i > next) {
+            fetch_ordered = false;
+        } else if (i == next) {
+            next++;
+        }
+    }
+    expect(fetch_ordered, mesh.name, "vertices not in first-use order");
+
+    if (expect_better_cache) {
+        expect(stats.cache_after.acmr < stats.cache_before.acmr, mesh.name, "ACMR didn't improve");
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const unsigned int seed = argc > 1 ? std::stoul(argv[1]) : 1234;
+    std::mt19937 rng(seed);
+
+    std::printf("vertex format %s, cache size %u\n", vertex_format_name(), VERTEX_CACHE_SIZE);
+
+    check(make_grid_soup(64), true);
+    check(make_uv_sphere(32, 48), false);
+    check(make_random_soup(rng, 2000, 20000), true);
+
+    // The sphere again with its triangles shuffled, which destroys the generator's nice strip order
+    MeshData shuffled = make_uv_sphere(32, 48);
+    shuffled.name = "shuffled";
+    std::vector<std::array<unsigned int, 3>> triangles;
+    for (size_t t = 0; t < shuffled.indices.size(); t += 3) {
+        triangles.push_back({shuffled.indices[t], shuffled.indices[t + 1], shuffled.indices[t + 2]});
+    }
+    std::shuffle(triangles.begin(), triangles.end(), rng);
+    shuffled.indices.clear();
+    for (const auto &tri : triangles) {
+        shuffled.indices.insert(shuffled.indices.end(), tri.begin(), tri.end());
+    }
+    check(std::move(shuffled), true);
+
+    // Degenerate inputs
+    check(make_grid_soup(1), false);
+
+    return report_checks();
+}
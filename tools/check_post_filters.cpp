@@ -0,0 +1,92 @@
+// CPU-only checks for the post-process blur taps: folds Gaussians of several radii for linear sampling and verifies
+// that sampling a signal the way the GPU does (bilinear between the two nearest texels, clamped to the edge) at the
+// folded taps gives the same result as the full discrete kernel, that the weights sum to one and that the tap count
+// is what the shader is built with. Also checks the pass target sizes. Exits non-zero on any failure.
+//
+// usage: CheckPostFilters
+
+#include "check.hpp"
+#include "post_process.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+float texel(const std::vector<float> &signal, int i) {
+    return signal[std::clamp(i, 0, static_cast<int>(signal.size()) - 1)];
+}
+
+// GL_LINEAR at `x` texels from texel 0's centre
+float bilinear(const std::vector<float> &signal, float x) {
+    const float base = std::floor(x);
+    const float t = x - base;
+    const int i = static_cast<int>(base);
+    return texel(signal, i) * (1.0f - t) + texel(signal, i + 1) * t;
+}
+
+float gaussian(int k, float sigma) { return std::exp(-float(k * k) / (2.0f * sigma * sigma)); }
+
+void check_taps(int radius, float sigma) {
+    const std::string what = "radius " + std::to_string(radius) + ", sigma " + std::to_string(sigma);
+    const LinearTaps taps = linear_gaussian_taps(radius, sigma);
+
+    expect(taps.offsets.size() == taps.weights.size(), what, "offsets and weights differ in length");
+    expect(taps.offsets.size() == size_t(1 + (radius + 1) / 2), what, "unexpected tap count");
+    float sum = taps.weights[0];
+    for (size_t i = 1; i < taps.weights.size(); i++) {
+        sum += 2.0f * taps.weights[i];
+    }
+    expect(std::fabs(sum - 1.0f) < 1e-5f, what, "weights don't sum to one");
+
+    float total = 0.0f;
+    for (int k = -radius; k <= radius; k++) {
+        total += gaussian(k, sigma);
+    }
+
+    std::mt19937 rng(radius);
+    std::uniform_real_distribution<float> value(0.0f, 1.0f);
+    std::vector<float> signal(64);
+    for (float &v : signal) {
+        v = value(rng);
+    }
+
+    float worst = 0.0f;
+    for (int x = 0; x < static_cast<int>(signal.size()); x++) {
+        float direct = 0.0f;
+        for (int k = -radius; k <= radius; k++) {
+            direct += texel(signal, x + k) * gaussian(k, sigma) / total;
+        }
+        float linear = texel(signal, x) * taps.weights[0];
+        for (size_t i = 1; i < taps.offsets.size(); i++) {
+            linear += (bilinear(signal, x + taps.offsets[i]) + bilinear(signal, x - taps.offsets[i])) * taps.weights[i];
+        }
+        worst = std::max(worst, std::fabs(direct - linear));
+    }
+    expect(worst < 1e-5f, what, "linear taps differ from the discrete kernel");
+}
+
+void check_sizes() {
+    expect(scaled_size(glm::ivec2(800, 600), 1.0f) == glm::ivec2(800, 600), "scaled_size", "full res changed");
+    expect(scaled_size(glm::ivec2(800, 600), 0.5f) == glm::ivec2(400, 300), "scaled_size", "wrong half res");
+    expect(scaled_size(glm::ivec2(801, 601), 0.25f) == glm::ivec2(200, 150), "scaled_size", "wrong quarter res");
+    expect(scaled_size(glm::ivec2(2, 3), 0.1f) == glm::ivec2(1, 1), "scaled_size", "smaller than 1x1");
+}
+
+} // namespace
+
+int main() {
+    for (int radius = 1; radius <= 8; radius++) {
+        for (float sigma : {0.8f, 2.0f, 4.0f}) {
+            check_taps(radius, sigma);
+        }
+    }
+    check_sizes();
+
+    return report_checks();
+}
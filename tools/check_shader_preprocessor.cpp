@@ -0,0 +1,149 @@
+// CPU-only checks for shader permutations: expands every shader under res/shaders, and a few fragment.glsl
+// permutations, and verifies includes are resolved, the defines land right after #version and the #line directives
+// keep line numbers intact. Also covers nested and repeated includes, include cycles and malformed lines on a scratch
+// tree. Exits non-zero on any failure.
+//
+// usage: CheckShaderPreprocessor
+
+#include "check.hpp"
+#include "shader.hpp"
+#include "shader_library.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::vector<std::string> lines_of(const std::string &text) {
+    std::vector<std::string> lines;
+    std::istringstream in(text);
+    for (std::string line; std::getline(in, line);) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+size_t count(const std::string &text, const std::string &needle) {
+    size_t n = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) {
+        n++;
+    }
+    return n;
+}
+
+void write_file(const fs::path &path, const std::string &text) {
+    fs::create_directories(path.parent_path());
+    std::ofstream ofs(path, std::ios_base::trunc);
+    ofs << text;
+}
+
+// Every line of the source must still be in the output, and a #line must follow the #version line
+void check_expanded(const std::string &path, const ShaderDefines &defines) {
+    const std::string what = path + " {" + shader_defines_key(defines) + "}";
+    std::string out;
+    try {
+        out = preprocess_shader(path, defines);
+    } catch (const std::exception &e) {
+        expect(false, what, e.what());
+        return;
+    }
+
+    const std::vector<std::string> lines = lines_of(out);
+    expect(!lines.empty() && lines[0].rfind("#version", 0) == 0, what, "#version isn't the first line");
+    expect(out.find("#include") == std::string::npos, what, "unresolved #include");
+
+    size_t i = 1;
+    for (const auto &[name, value] : defines) {
+        const std::string expected = "#define " + name + " " + std::to_string(value);
+        expect(i < lines.size() && lines[i] == expected, what, "defines don't follow #version");
+        i++;
+    }
+    expect(i < lines.size() && lines[i] == "#line 2 0", what, "no #line after the defines");
+}
+
+void check_permutations() {
+    for (const auto &entry : fs::directory_iterator("res/shaders")) {
+        if (entry.path().extension() == ".glsl") {
+            check_expanded(entry.path().generic_string(), {});
+        }
+    }
+
+    const std::string fragment = "res/shaders/fragment.glsl";
+    check_expanded(fragment, {{"DIR_LIGHT", 1}, {"NR_POINT_LIGHTS", 0}, {"SPOT_LIGHT", 0}});
+    check_expanded(fragment, {{"NR_POINT_LIGHTS", 2}, {"SPECULAR_MAP", 0}, {"ALPHA_TEST", 1}});
+    check_expanded(fragment, {{"NR_POINT_LIGHTS", 0}, {"SPOT_LIGHT", 0}, {"CLUSTERED_LIGHTS", 1}});
+    check_expanded(fragment, {{"GBUFFER", 1}, {"SPECULAR_MAP", 0}});
+    check_expanded("res/shaders/fragment_deferred.glsl", {{"NR_POINT_LIGHTS", 0}, {"CLUSTERED_LIGHTS", 1}});
+
+    // Both headers pasted exactly once, even though fragment.glsl and lights.glsl are separate includes
+    const std::string out = preprocess_shader(fragment);
+    expect(count(out, "uniform Lights") == 1 && count(out, "uniform Frame") == 1, fragment, "header pasted twice");
+
+    expect(ShaderLibrary::permutation_key("v", "f", {{"B", 0}, {"A", 1}}) ==
+               ShaderLibrary::permutation_key("v", "f", {{"A", 1}, {"B", 0}}),
+           "permutation key", "depends on define order");
+    expect(ShaderLibrary::permutation_key("v", "f", {{"A", 1}}) != ShaderLibrary::permutation_key("v", "f", {}),
+           "permutation key", "ignores defines");
+}
+
+void check_includes() {
+    const fs::path dir = fs::temp_directory_path() / "check_shader_preprocessor";
+    fs::remove_all(dir);
+    write_file(dir / "main.glsl", "#version 410 core\n"
+                                  "#include \"lib/a.glsl\"\n"
+                                  "  #  include \"lib/b.glsl\"\n"
+                                  "void main() {}\n");
+    write_file(dir / "lib/a.glsl", "// a\n#include \"b.glsl\"\n#include \"../main.glsl\"\nfloat a;\n");
+    write_file(dir / "lib/b.glsl", "float b;\n");
+    write_file(dir / "bad.glsl", "#version 410 core\n#include <a.glsl>\n");
+    write_file(dir / "missing.glsl", "#version 410 core\n#include \"nowhere.glsl\"\n");
+
+    const std::string main_path = (dir / "main.glsl").generic_string();
+    const std::string out = preprocess_shader(main_path, {{"X", 3}});
+    const std::string expected = "#version 410 core\n"
+                                 "#define X 3\n"
+                                 "#line 2 0\n"
+                                 "#line 1 1\n"
+                                 "// a\n"
+                                 "#line 1 2\n"
+                                 "float b;\n"
+                                 "#line 3 1\n"
+                                 "#line 4 1\n"
+                                 "float a;\n"
+                                 "#line 3 0\n"
+                                 "#line 4 0\n"
+                                 "void main() {}\n";
+    expect(out == expected, "nested includes", "unexpected expansion");
+    if (out != expected) {
+        std::printf("%s", out.c_str());
+    }
+
+    for (const char *name : {"bad.glsl", "missing.glsl"}) {
+        bool threw = false;
+        try {
+            preprocess_shader((dir / name).generic_string());
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        expect(threw, name, "no error");
+    }
+
+    fs::remove_all(dir);
+}
+
+} // namespace
+
+int main() {
+    check_permutations();
+    check_includes();
+
+    return report_checks();
+}
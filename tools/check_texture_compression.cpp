@@ -0,0 +1,156 @@
+// CPU-only checks for the texture bake: compresses synthetic images with every codec and verifies the codec choice,
+// the mip chain sizes, the decoded error against the source, that colour mips are filtered in linear light, and that
+// a baked KTX file round-trips and goes stale when its source changes. Exits non-zero on any failure.
+//
+// usage: CheckTextureCompression
+
+#include "check.hpp"
+#include "texture_cache.hpp"
+#include "texture_compression.hpp"
+#include "texture_loader.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// `pixel(x, y, channel)` gives each 0-255 value
+Image make_image(int width, int height, int channels, const std::function<int(int, int, int)> &pixel) {
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+    image.pixels = {static_cast<unsigned char *>(std::malloc(image.size_bytes())), std::free};
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < channels; c++) {
+                image.pixels.get()[(size_t(y) * width + x) * channels + c] = std::clamp(pixel(x, y, c), 0, 255);
+            }
+        }
+    }
+    return image;
+}
+
+// Largest per-channel difference between level 0 and the source over the channels the codec keeps
+int max_error(const Image &image, const CompressedTexture &texture) {
+    const std::vector<unsigned char> decoded =
+        decompress_level(texture.codec, texture.levels[0].data(), texture.width, texture.height);
+    const int channels = std::min<int>(image.channels, texture_codec_channels(texture.codec));
+    int error = 0;
+    for (size_t i = 0; i < size_t(image.width) * image.height; i++) {
+        for (int c = 0; c < channels; c++) {
+            error = std::max(error, std::abs(decoded[i * 4 + c] - image.pixels.get()[i * image.channels + c]));
+        }
+    }
+    return error;
+}
+
+void check_chain(const std::string &what, const CompressedTexture &texture) {
+    const int expected_levels = 1 + int(std::floor(std::log2(std::max(texture.width, texture.height))));
+    expect(int(texture.levels.size()) == expected_levels, what, "mip chain doesn't end at 1x1");
+
+    int width = texture.width, height = texture.height;
+    for (const auto &level : texture.levels) {
+        expect(level.size() == compressed_level_size(texture.codec, width, height), what, "wrong level size");
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+}
+
+void check_codec(const std::string &what, const Image &image, const std::string &type, TextureCodec expected,
+                 int tolerance) {
+    const TextureCodec codec = choose_texture_codec(image, type);
+    const CompressedTexture texture = compress_texture(image, codec, texture_type_is_srgb(type));
+    const int error = max_error(image, texture);
+    std::printf("%-22s %s %3dx%-3d %2zu levels %7zu -> %6zu bytes, max error %d\n", what.c_str(),
+                texture_codec_name(codec), image.width, image.height, texture.levels.size(),
+                uncompressed_texture_size(image.width, image.height, image.channels), texture.size_bytes(), error);
+
+    expect(codec == expected, what, "unexpected codec");
+    expect(error <= tolerance, what, "decoded level 0 too far from the source");
+    check_chain(what, texture);
+}
+
+// A 1-pixel black and white checkerboard: every 2x2 box of level 0 averages to 50% linear light, which is 188 in
+// sRGB. Filtering the encoded values instead would give 128 and visibly darken the mips.
+void check_gamma() {
+    const Image checker = make_image(16, 16, 3, [](int x, int y, int) { return (x + y) % 2 ? 255 : 0; });
+
+    for (bool srgb : {true, false}) {
+        const CompressedTexture texture = compress_texture(checker, TextureCodec::BC1, srgb);
+        const std::vector<unsigned char> level_1 = decompress_level(texture.codec, texture.levels[1].data(), 8, 8);
+        const int expected = srgb ? 188 : 128;
+        bool close = true;
+        for (size_t i = 0; i < level_1.size(); i += 4) {
+            close = close && std::abs(level_1[i] - expected) <= 4;
+        }
+        expect(close, srgb ? "srgb mips" : "linear mips", "level 1 isn't the filtered average");
+    }
+}
+
+void check_cache() {
+    const fs::path dir = fs::temp_directory_path() / "check_texture_compression";
+    fs::create_directories(dir);
+    const std::string source = (dir / "source.png").string();
+    {
+        std::ofstream ofs(source, std::ios_base::binary | std::ios_base::trunc);
+        ofs << "stand-in source";
+    }
+
+    const Image image = make_image(20, 12, 4, [](int x, int y, int c) { return c == 3 ? x * 12 : (x + y) * 8; });
+    const CompressedTexture texture = compress_texture(image, TextureCodec::BC3, true);
+    write_texture_cache(source, texture);
+
+    expect(texture_cache_is_fresh(source), "cache", "freshly written file isn't fresh");
+    const auto read = open_texture_cache(source);
+    expect(read.has_value(), "cache", "couldn't read the file back");
+    if (read) {
+        expect(read->codec == texture.codec && read->width == texture.width && read->height == texture.height &&
+                   read->levels == texture.levels,
+               "cache", "round trip changed the texture");
+    }
+
+    {
+        std::ofstream ofs(source, std::ios_base::binary | std::ios_base::app);
+        ofs << " edited";
+    }
+    expect(!texture_cache_is_fresh(source) && !open_texture_cache(source), "cache", "edited source still fresh");
+
+    fs::remove_all(dir);
+}
+
+} // namespace
+
+int main() {
+    const auto smooth = [](int x, int y, int c) { return c == 0 ? x * 4 : c == 1 ? y * 4 : 128 + (x - y) * 2; };
+    const auto opaque = [&](int x, int y, int c) { return c == 3 ? 255 : smooth(x, y, c); };
+    const auto alpha = [&](int x, int y, int c) { return c == 3 ? x * 4 : smooth(x, y, c); };
+
+    check_codec("opaque rgb", make_image(64, 64, 3, smooth), "texture_diffuse", TextureCodec::BC1, 16);
+    check_codec("opaque rgba", make_image(64, 64, 4, opaque), "texture_diffuse", TextureCodec::BC1, 16);
+    check_codec("alpha", make_image(64, 64, 4, alpha), "texture_diffuse", TextureCodec::BC3, 16);
+    check_codec("single channel", make_image(64, 64, 1, [](int x, int y, int) { return (x + y) * 2; }),
+                "texture_specular", TextureCodec::BC4, 4);
+    check_codec("normal map",
+                make_image(64, 64, 3,
+                           [](int x, int y, int c) {
+                               const float nx = 0.3f * std::sin(x * 0.2f), ny = 0.3f * std::cos(y * 0.2f);
+                               const float n[3] = {nx, ny, std::sqrt(1.0f - nx * nx - ny * ny)};
+                               return int(std::lround((n[c] * 0.5f + 0.5f) * 255.0f));
+                           }),
+                "texture_normal", TextureCodec::BC5, 4);
+    check_codec("odd size", make_image(37, 19, 3, smooth), "texture_diffuse", TextureCodec::BC1, 16);
+    check_gamma();
+    check_cache();
+
+    return report_checks();
+}